@@ -0,0 +1,23 @@
+#include "harness.hpp"
+#include "audio/capturechain.hpp"
+
+// a wav (or anything miniaudio decodes) through the capture chain with the defaults and with every stage on
+int main(int argc, char **argv) {
+    BenchHarness harness(argc, argv, { "Capture benchmark", "audio" });
+    const char *path = harness.GetArg(0);
+    if (path == nullptr) return harness.Fail("usage: capture-bench <audio file>");
+
+    CaptureChain::Params everything;
+    everything.HighPass = true;
+    everything.MixMono = true;
+    everything.UseRNNoiseVAD = true;
+    everything.SuppressNoise = true;
+
+    std::vector<BenchHarness::Case> cases;
+    for (const auto &[label, params] : { std::make_pair("defaults", CaptureChain::Params {}), std::make_pair("all stages", everything) }) {
+        cases.push_back({ label,
+                          [path, params = params]() { return BenchHarness::Report(CaptureChain::BenchmarkFile(path, params)); },
+                          std::string("couldn't decode ") + path });
+    }
+    return harness.Run(cases);
+}
@@ -0,0 +1,151 @@
+#include "channellistbench.hpp"
+#include "components/channellist/rowindex.hpp"
+#include <algorithm>
+#include <chrono>
+#include <queue>
+#include <random>
+#include <gtkmm/treemodelsort.h>
+#include <spdlog/fmt/bundled/format.h>
+
+namespace {
+// the columns the message path touches, the rest of the real ones dont matter here
+class Columns : public Gtk::TreeModel::ColumnRecord {
+public:
+    Columns() {
+        add(m_type);
+        add(m_id);
+        add(m_sort);
+    }
+
+    Gtk::TreeModelColumn<RenderType> m_type;
+    Gtk::TreeModelColumn<uint64_t> m_id;
+    Gtk::TreeModelColumn<int64_t> m_sort;
+};
+} // namespace
+
+std::string ChannelListBench::Result::ToString() const {
+    return fmt::format("{:<9} {} rows built in {:.1f}ms, {:.2f} us per message (p99 {:.2f} us), {} missed",
+                       Indexed ? "indexed" : "tree walk", Rows, BuildMs, PerMessageUs, MessageP99Us, Missed);
+}
+
+// how the tree found rows before the index
+static Gtk::TreeModel::iterator WalkForRow(const Glib::RefPtr<Gtk::TreeStore> &model, const Columns &columns, Snowflake id) {
+    std::queue<Gtk::TreeModel::iterator> queue;
+    for (const auto &child : model->children())
+        for (const auto &child2 : child.children())
+            queue.push(child2);
+
+    while (!queue.empty()) {
+        auto item = queue.front();
+        if ((*item)[columns.m_id] == id && (*item)[columns.m_type] != RenderType::Guild) return item;
+        for (const auto &child : item->children())
+            queue.push(child);
+        queue.pop();
+    }
+
+    return {};
+}
+
+ChannelListBench::Result ChannelListBench::Run(const Params &params, bool indexed) {
+    using clock = std::chrono::steady_clock;
+
+    Columns columns;
+    auto model = Gtk::TreeStore::create(columns);
+    auto sort_model = Gtk::TreeModelSort::create(model);
+    sort_model->set_sort_column(columns.m_sort, Gtk::SORT_ASCENDING);
+    ChannelListRowIndex index(columns.m_type, columns.m_id);
+
+    Result result;
+    result.Indexed = indexed;
+
+    std::vector<Snowflake> guild_channels;
+    std::vector<Snowflake> dms;
+    uint64_t next_id = 1000000;
+
+    const auto add = [&](const Gtk::TreeModel::Children &parent, RenderType type, int64_t sort) {
+        auto row = *model->append(parent);
+        row[columns.m_type] = type;
+        row[columns.m_id] = next_id++;
+        row[columns.m_sort] = sort;
+        index.Add(row);
+        result.Rows++;
+        return row;
+    };
+
+    const auto build_start = clock::now();
+    for (int g = 0; g < params.Guilds; g++) {
+        auto guild_row = *model->append();
+        guild_row[columns.m_type] = RenderType::Guild;
+        guild_row[columns.m_id] = next_id++;
+        guild_row[columns.m_sort] = g;
+        result.Rows++;
+        for (int c = 0; c < params.CategoriesPerGuild; c++) {
+            auto category_row = add(guild_row.children(), RenderType::Category, c);
+            for (int t = 0; t < params.ChannelsPerCategory; t++) {
+                auto channel_row = add(category_row.children(), RenderType::TextChannel, t);
+                guild_channels.push_back(static_cast<uint64_t>(channel_row[columns.m_id]));
+                for (int th = 0; th < params.ThreadsPerChannel; th++) {
+                    auto thread_row = add(channel_row.children(), RenderType::Thread, th);
+                    guild_channels.push_back(static_cast<uint64_t>(thread_row[columns.m_id]));
+                }
+            }
+        }
+    }
+
+    // dms go last under their header like in the real tree, so the walk has to get through every guild first
+    auto dm_header_row = *model->append();
+    dm_header_row[columns.m_type] = RenderType::DMHeader;
+    dm_header_row[columns.m_id] = next_id++;
+    dm_header_row[columns.m_sort] = params.Guilds;
+    result.Rows++;
+    for (int d = 0; d < params.DMs; d++) {
+        auto dm_row = add(dm_header_row.children(), RenderType::DM, -static_cast<int64_t>(d));
+        dms.push_back(static_cast<uint64_t>(dm_row[columns.m_id]));
+    }
+    result.BuildMs = std::chrono::duration<double, std::milli>(clock::now() - build_start).count();
+
+    // bursts are mostly a handful of busy channels with a long tail, and a dm now and then
+    std::mt19937_64 rng(1234);
+    std::vector<Snowflake> hot;
+    for (int i = 0; i < 16 && !guild_channels.empty(); i++)
+        hot.push_back(guild_channels[rng() % guild_channels.size()]);
+
+    uint64_t next_message_id = 1ULL << 40;
+    std::vector<double> times;
+    times.reserve(params.Messages);
+    for (int i = 0; i < params.Messages; i++) {
+        const auto roll = rng() % 100;
+        const bool is_dm = !dms.empty() && roll < 5;
+        Snowflake channel_id;
+        if (is_dm)
+            channel_id = dms[rng() % dms.size()];
+        else if (roll < 70 && !hot.empty())
+            channel_id = hot[rng() % hot.size()];
+        else if (!guild_channels.empty())
+            channel_id = guild_channels[rng() % guild_channels.size()];
+        else
+            continue;
+
+        const auto start = clock::now();
+        auto iter = indexed ? index.Find(channel_id) : WalkForRow(model, columns, channel_id);
+        if (iter) {
+            model->row_changed(model->get_path(iter), iter);
+            if (is_dm) (*iter)[columns.m_sort] = -static_cast<int64_t>(next_message_id);
+        } else {
+            result.Missed++;
+        }
+        next_message_id++;
+        times.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+    }
+
+    if (!times.empty()) {
+        double total = 0.0;
+        for (const auto t : times)
+            total += t;
+        result.PerMessageUs = total / static_cast<double>(times.size());
+        std::sort(times.begin(), times.end());
+        result.MessageP99Us = times[std::min(times.size() - 1, static_cast<size_t>(0.99 * static_cast<double>(times.size())))];
+    }
+
+    return result;
+}
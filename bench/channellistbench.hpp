@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+
+// what a burst of MESSAGE_CREATE costs the channel list. builds a tree shaped like the real one (guilds, categories,
+// channels, threads and dms) in a treestore behind a sort model and replays the per message work from
+// ChannelListTree::OnMessageCreate against it, finding rows with the row index or with the breadth first walk the
+// tree used before it. only needs gtkmm's type system, not a display
+class ChannelListBench {
+public:
+    struct Params {
+        int Guilds = 150;
+        int CategoriesPerGuild = 8;
+        int ChannelsPerCategory = 10;
+        int ThreadsPerChannel = 1;
+        int DMs = 500;
+        int Messages = 20000;
+    };
+
+    struct Result {
+        bool Indexed = false;
+        size_t Rows = 0;
+        double BuildMs = 0.0;
+        double PerMessageUs = 0.0;
+        double MessageP99Us = 0.0;
+        size_t Missed = 0; // messages whose channel wasnt found, should be 0
+
+        [[nodiscard]] std::string ToString() const;
+    };
+
+    // call Gtk::Main::init_gtkmm_internals first
+    static Result Run(const Params &params, bool indexed);
+};
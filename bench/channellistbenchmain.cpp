@@ -0,0 +1,15 @@
+#include "harness.hpp"
+#include "channellistbench.hpp"
+
+// a MESSAGE_CREATE burst against a large channel list with the old tree walk and with the row index
+int main(int argc, char **argv) {
+    BenchHarness harness(argc, argv, { "Channel list benchmark", "ui", true });
+
+    std::vector<BenchHarness::Case> cases;
+    for (const bool indexed : { false, true }) {
+        cases.push_back({ indexed ? "row index" : "tree walk",
+                          [indexed]() -> std::optional<std::string> { return ChannelListBench::Run({}, indexed).ToString(); },
+                          "" });
+    }
+    return harness.Run(cases);
+}
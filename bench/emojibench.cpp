@@ -0,0 +1,98 @@
+#include "emojibench.hpp"
+#include "emojis.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <random>
+#include <spdlog/fmt/bundled/format.h>
+
+std::string EmojiBench::Result::ToString() const {
+    return fmt::format("{:<13} {} patterns, {} chars, {} matches in {:.1f}ms, {:.2f} us per message (p99 {:.2f} us)",
+                       Trie ? "trie" : "per pattern", Patterns, Characters, Matches, TotalMs, PerMessageUs, MessageP99Us);
+}
+
+static std::vector<Glib::ustring> MakeCorpus(const EmojiBench::Params &params, const std::vector<Glib::ustring> &patterns) {
+    constexpr static const char *words[] = {
+        "the", "lol", "yeah", "ok", "what", "is", "going", "on", "here", "i", "think", "so", "maybe", "tomorrow",
+        "https://example.com/a/b?c=d", "<@123456789012345678>", "<:custom:123456789012345678>", "**bold**",
+        "café", "über", "日本語", "→", "©", "#", "*", "1",
+    };
+
+    std::mt19937_64 rng(1234);
+    std::vector<Glib::ustring> corpus;
+    corpus.reserve(params.Messages);
+    for (int i = 0; i < params.Messages; i++) {
+        const auto length = static_cast<Glib::ustring::size_type>(params.MinLength + rng() % std::max(params.MaxLength - params.MinLength, 1));
+        Glib::ustring text;
+        while (text.size() < length) {
+            if (!patterns.empty() && static_cast<int>(rng() % 100) < params.EmojiPercent) {
+                // runs of the same emoji and emojis with no space between them are common
+                const auto &pattern = patterns[rng() % patterns.size()];
+                for (uint64_t n = 0, repeat = rng() % 4 == 0 ? 1 + rng() % 5 : 1; n < repeat; n++)
+                    text += pattern;
+                if (rng() % 2 == 0) continue;
+            } else {
+                text += words[rng() % std::size(words)];
+            }
+            text += ' ';
+        }
+        corpus.push_back(std::move(text));
+    }
+    return corpus;
+}
+
+// how ReplaceEmojis looked for them before the trie
+static size_t FindPerPattern(const Glib::ustring &text, const std::vector<Glib::ustring> &patterns) {
+    size_t matches = 0;
+    for (const auto &pattern : patterns) {
+        Glib::ustring::size_type pos = 0;
+        while (true) {
+            const auto r = text.find(pattern, pos);
+            if (r == Glib::ustring::npos) break;
+            matches++;
+            pos = r + pattern.size();
+        }
+    }
+    return matches;
+}
+
+std::optional<EmojiBench::Result> EmojiBench::Run(const Params &params, const std::string &db_path, bool trie) {
+    using clock = std::chrono::steady_clock;
+
+    EmojiResource emojis(db_path);
+    if (!emojis.Load()) return std::nullopt;
+
+    std::vector<Glib::ustring> patterns;
+    for (const auto &[shortcode, pattern] : emojis.GetShortCodes())
+        patterns.emplace_back(pattern);
+    std::sort(patterns.begin(), patterns.end());
+    patterns.erase(std::unique(patterns.begin(), patterns.end()), patterns.end());
+
+    const auto corpus = MakeCorpus(params, patterns);
+
+    Result result;
+    result.Trie = trie;
+    result.Patterns = patterns.size();
+
+    std::vector<double> times;
+    times.reserve(corpus.size());
+    const auto total_start = clock::now();
+    for (const auto &text : corpus) {
+        result.Characters += text.size();
+        const auto start = clock::now();
+        if (trie)
+            result.Matches += emojis.FindPatterns(text).size();
+        else
+            result.Matches += FindPerPattern(text, patterns);
+        times.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+    }
+    result.TotalMs = std::chrono::duration<double, std::milli>(clock::now() - total_start).count();
+
+    if (!times.empty()) {
+        result.PerMessageUs = result.TotalMs * 1000.0 / static_cast<double>(times.size());
+        std::sort(times.begin(), times.end());
+        result.MessageP99Us = times[std::min(times.size() - 1, static_cast<size_t>(0.99 * static_cast<double>(times.size())))];
+    }
+
+    return result;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <optional>
+#include <string>
+
+// cost of finding stock emojis in message text. builds an emoji heavy corpus (sequences, skin tones, zwj families
+// between plain and non emoji unicode text) out of the patterns in the emoji db and runs it through the trie
+// matcher or through the old one find per pattern scan. matching only, no text buffer or pixbufs
+class EmojiBench {
+public:
+    struct Params {
+        int Messages = 2000;
+        int MinLength = 40; // characters
+        int MaxLength = 400;
+        int EmojiPercent = 30; // of tokens
+    };
+
+    struct Result {
+        bool Trie = false;
+        size_t Patterns = 0;
+        size_t Characters = 0; // across the corpus
+        size_t Matches = 0;
+        double TotalMs = 0.0;
+        double PerMessageUs = 0.0;
+        double MessageP99Us = 0.0;
+
+        [[nodiscard]] std::string ToString() const;
+    };
+
+    // nullopt if the emoji db cant be loaded
+    static std::optional<Result> Run(const Params &params, const std::string &db_path, bool trie);
+};
@@ -0,0 +1,17 @@
+#include "harness.hpp"
+#include "emojibench.hpp"
+#include "abaddon.hpp"
+
+// finding stock emojis in an emoji heavy corpus with a find per pattern and with the trie
+int main(int argc, char **argv) {
+    BenchHarness harness(argc, argv, { "Emoji benchmark", "ui", true });
+    const auto path = Abaddon::GetResPath("/emojis.db");
+
+    std::vector<BenchHarness::Case> cases;
+    for (const bool trie : { false, true }) {
+        cases.push_back({ trie ? "trie" : "find per pattern",
+                          [path, trie]() { return BenchHarness::Report(EmojiBench::Run({}, path, trie)); },
+                          "couldn't load " + path });
+    }
+    return harness.Run(cases);
+}
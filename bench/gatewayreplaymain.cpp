@@ -0,0 +1,16 @@
+#include "harness.hpp"
+#include "abaddon.hpp"
+
+// a gateway recording through the client as fast as possible. the report is logged by the client
+int main(int argc, char **argv) {
+    BenchHarness harness(argc, argv, { "Gateway replay", "discord", true });
+    const char *path = harness.GetArg(0);
+    if (path == nullptr) return harness.Fail("usage: gateway-replay <recording>");
+
+    return harness.Run({ { "",
+                           [path]() -> std::optional<std::string> {
+                               if (Abaddon::Get().RunHeadlessReplay(path) != 0) return std::nullopt;
+                               return std::string("finished ") + path;
+                           },
+                           std::string("couldn't replay ") + path } });
+}
@@ -0,0 +1,44 @@
+#include "harness.hpp"
+#include "abaddon.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <gtkmm/main.h>
+#include <spdlog/spdlog.h>
+
+BenchHarness::BenchHarness(int argc, char **argv, const Options &options)
+    : m_options(options)
+    , m_args(argv + std::min(argc, 1), argv + argc) {
+    Abaddon::InitLogging();
+
+    if (m_options.MainLoop || m_options.Headless)
+        Gtk::Main::init_gtkmm_internals();
+    if (m_options.Headless)
+        Abaddon::Get().StartHeadless();
+}
+
+const char *BenchHarness::GetArg(size_t index) const {
+    return index < m_args.size() ? m_args[index] : nullptr;
+}
+
+int BenchHarness::GetIntArg(size_t index, int fallback) const {
+    const char *arg = GetArg(index);
+    if (arg == nullptr) return fallback;
+    const int value = std::atoi(arg);
+    return value > 0 ? value : fallback;
+}
+
+int BenchHarness::Run(const std::vector<Case> &cases) const {
+    auto log = spdlog::get(m_options.Logger);
+    for (const auto &c : cases) {
+        const std::string name = c.Label.empty() ? m_options.Name : fmt::format("{}, {}", m_options.Name, c.Label);
+        const auto report = c.Run();
+        if (!report.has_value()) return Fail(c.Failure);
+        log->info("{}: {}", name, *report);
+    }
+    return 0;
+}
+
+int BenchHarness::Fail(const std::string &reason) const {
+    spdlog::get(m_options.Logger)->error("{}: {}", m_options.Name, reason);
+    return 1;
+}
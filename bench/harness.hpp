@@ -0,0 +1,45 @@
+#pragma once
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// what the bench and replay executables share. logging is set up like the app's, gtkmm and a headless Abaddon are
+// there for the ones that need them, and every case's report is logged under the executable's name
+class BenchHarness {
+public:
+    struct Options {
+        const char *Name = "";     // as it appears in the log, "Store benchmark"
+        const char *Logger = "ui"; // whichever the code being measured logs to
+        bool MainLoop = false;     // gtkmm, for anything with tree models or a Glib::MainLoop
+        bool Headless = false;     // Abaddon::Get() with the ui blocked, implies MainLoop
+    };
+
+    BenchHarness(int argc, char **argv, const Options &options);
+
+    // positional, not counting the program. nullptr if it wasnt given
+    [[nodiscard]] const char *GetArg(size_t index) const;
+    // fallback unless it's a positive number
+    [[nodiscard]] int GetIntArg(size_t index, int fallback) const;
+
+    struct Case {
+        std::string Label; // "with DAVE", empty if there's only the one
+        std::function<std::optional<std::string>()> Run;
+        std::string Failure; // logged if Run gives nullopt
+    };
+
+    // 0 if every case reported, otherwise 1 after the first that didnt
+    int Run(const std::vector<Case> &cases) const;
+    // for a missing argument and the like
+    int Fail(const std::string &reason) const;
+
+    template<typename Result>
+    static std::optional<std::string> Report(const std::optional<Result> &result) {
+        if (!result.has_value()) return std::nullopt;
+        return result->ToString();
+    }
+
+private:
+    Options m_options;
+    std::vector<const char *> m_args;
+};
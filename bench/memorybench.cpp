@@ -0,0 +1,131 @@
+#include "memorybench.hpp"
+#include "discord/message.hpp"
+#include "discord/member.hpp"
+#include "platform.hpp"
+#include <functional>
+#include <random>
+#include <vector>
+
+std::string MemoryBench::Result::ToString() const {
+    const auto bytes = [](const std::optional<double> &b) {
+        return b.has_value() ? fmt::format("{:.0f} B", *b) : std::string("unknown");
+    };
+    return fmt::format("{:<12} {} per message, {} per member, {} pooled strings",
+                       Interned ? "interned" : "not interned", bytes(BytesPerMessage), bytes(BytesPerMember), PoolStrings);
+}
+
+std::string MemoryBench::GetStructSizes() {
+    return fmt::format("sizeof Message {} B, UserData {} B, GuildMember {} B", sizeof(Message), sizeof(UserData), sizeof(GuildMember));
+}
+
+static std::string RandomString(std::mt19937_64 &rng, const char *alphabet, size_t alphabet_len, size_t len) {
+    std::string s(len, ' ');
+    for (auto &c : s)
+        c = alphabet[rng() % alphabet_len];
+    return s;
+}
+
+static std::string RandomName(std::mt19937_64 &rng) {
+    constexpr static char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789_.";
+    return RandomString(rng, alphabet, sizeof(alphabet) - 1, 4 + rng() % 16);
+}
+
+static std::string RandomHash(std::mt19937_64 &rng) {
+    constexpr static char alphabet[] = "0123456789abcdef";
+    return RandomString(rng, alphabet, sizeof(alphabet) - 1, 32);
+}
+
+static std::vector<nlohmann::json> MakeUsers(std::mt19937_64 &rng, int count, uint64_t first_id) {
+    std::vector<nlohmann::json> users;
+    for (int i = 0; i < count; i++) {
+        auto &user = users.emplace_back();
+        user["id"] = std::to_string(first_id + i);
+        user["username"] = RandomName(rng);
+        user["discriminator"] = "0";
+        user["avatar"] = rng() % 10 < 7 ? nlohmann::json(RandomHash(rng)) : nlohmann::json(nullptr);
+        user["global_name"] = rng() % 10 < 6 ? nlohmann::json(RandomName(rng)) : nlohmann::json(nullptr);
+        user["public_flags"] = 0;
+    }
+    return users;
+}
+
+static nlohmann::json MakeMember(std::mt19937_64 &rng, const nlohmann::json &user) {
+    nlohmann::json roles = nlohmann::json::array();
+    for (uint64_t i = 0, n = 1 + rng() % 4; i < n; i++)
+        roles.push_back(std::to_string(1000 + rng() % 40));
+    nlohmann::json member {
+        { "roles", std::move(roles) },
+        { "joined_at", "2021-06-14T18:32:05.123000+00:00" },
+        { "deaf", false },
+        { "mute", false },
+        { "nick", rng() % 10 < 2 ? nlohmann::json(RandomName(rng)) : nlohmann::json(nullptr) },
+        { "avatar", nullptr },
+    };
+    if (!user.is_null()) member["user"] = user;
+    return member;
+}
+
+template<typename T>
+static std::optional<double> MeasurePerItem(size_t count, const std::function<void(std::vector<T> &)> &fill, std::vector<T> &out) {
+    const auto before = Platform::GetHeapInUse();
+    out.reserve(count);
+    fill(out);
+    const auto after = Platform::GetHeapInUse();
+    if (!before.has_value() || !after.has_value() || out.empty()) return std::nullopt;
+    return (static_cast<double>(*after) - static_cast<double>(*before)) / static_cast<double>(out.size());
+}
+
+MemoryBench::Result MemoryBench::Run(const Params &params, bool interned) {
+    InternedString::SetPoolEnabled(interned);
+
+    std::mt19937_64 rng(1234);
+    const auto authors = MakeUsers(rng, std::max(params.Authors, 1), 100000);
+    const auto users = MakeUsers(rng, std::max(params.Users, 1), 200000);
+
+    Result result;
+    result.Interned = interned;
+
+    std::vector<Message> messages;
+    result.BytesPerMessage = MeasurePerItem<Message>(params.Messages, [&](std::vector<Message> &out) {
+        for (int i = 0; i < params.Messages; i++) {
+            const auto &author = authors[rng() % authors.size()];
+            nlohmann::json mentions = nlohmann::json::array();
+            if (rng() % 10 == 0) mentions.push_back(authors[rng() % authors.size()]);
+            nlohmann::json msg {
+                { "id", std::to_string(900000 + i) },
+                { "channel_id", "10" },
+                { "guild_id", "1" },
+                { "author", author },
+                { "member", MakeMember(rng, nullptr) },
+                { "content", RandomString(rng, "abcdefghij klmnopqrstuvwxyz", 27, 10 + rng() % 80) },
+                { "timestamp", "2024-02-03T12:34:56.789000+00:00" },
+                { "edited_timestamp", nullptr },
+                { "tts", false },
+                { "mention_everyone", false },
+                { "mentions", std::move(mentions) },
+                { "mention_roles", nlohmann::json::array() },
+                { "attachments", nlohmann::json::array() },
+                { "embeds", nlohmann::json::array() },
+                { "pinned", false },
+                { "type", 0 },
+            };
+            if (rng() % 20 == 0) {
+                msg["reactions"] = nlohmann::json::array({ { { "count", 1 + rng() % 5 }, { "me", false }, { "emoji", { { "id", nullptr }, { "name", "\U0001F44D" } } } } });
+            }
+            out.push_back(msg.get<Message>());
+        }
+    },
+                                                   messages);
+
+    std::vector<GuildMember> members;
+    result.BytesPerMember = MeasurePerItem<GuildMember>(params.Members, [&](std::vector<GuildMember> &out) {
+        for (int i = 0; i < params.Members; i++)
+            out.push_back(MakeMember(rng, users[rng() % users.size()]).get<GuildMember>());
+    },
+                                                        members);
+
+    result.PoolStrings = InternedString::GetPoolStats().Strings;
+    InternedString::SetPoolEnabled(true);
+
+    return result;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <optional>
+#include <string>
+
+// heap cost of holding parsed messages and members. synthesizes payloads shaped like what the api sends, with a
+// limited set of authors and users that show up in more than one guild, and keeps everything parsed at once
+class MemoryBench {
+public:
+    struct Params {
+        int Messages = 5000;
+        int Authors = 200; // distinct message authors
+        int Members = 20000;
+        int Users = 8000; // distinct users across the member lists
+    };
+
+    struct Result {
+        bool Interned = false;
+        // nullopt where heap usage cant be measured
+        std::optional<double> BytesPerMessage;
+        std::optional<double> BytesPerMember;
+        size_t PoolStrings = 0;
+
+        [[nodiscard]] std::string ToString() const;
+    };
+
+    // interned = false turns the string pool off for the run, every string gets its own allocation like before
+    static Result Run(const Params &params, bool interned);
+
+    // inline size of the structs, the part interning doesnt show up in
+    static std::string GetStructSizes();
+};
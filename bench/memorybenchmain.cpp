@@ -0,0 +1,16 @@
+#include "harness.hpp"
+#include "memorybench.hpp"
+
+// heap per parsed message and member with the string pool off and on
+int main(int argc, char **argv) {
+    BenchHarness harness(argc, argv, { "Memory benchmark", "discord" });
+
+    std::vector<BenchHarness::Case> cases;
+    cases.push_back({ "struct sizes", []() -> std::optional<std::string> { return MemoryBench::GetStructSizes(); }, "" });
+    for (const bool interned : { false, true }) {
+        cases.push_back({ interned ? "interned" : "not interned",
+                          [interned]() -> std::optional<std::string> { return MemoryBench::Run({}, interned).ToString(); },
+                          "" });
+    }
+    return harness.Run(cases);
+}
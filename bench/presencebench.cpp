@@ -0,0 +1,120 @@
+#include "presencebench.hpp"
+#include "discord/discord.hpp"
+#include "discord/gatewayrecorder.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <glibmm/fileutils.h>
+#include <glibmm/main.h>
+#include <glibmm/miscutils.h>
+#include <gtkmm/treestore.h>
+
+namespace {
+class Columns : public Gtk::TreeModel::ColumnRecord {
+public:
+    Columns() {
+        add(m_id);
+        add(m_status);
+    }
+
+    Gtk::TreeModelColumn<uint64_t> m_id;
+    Gtk::TreeModelColumn<PresenceStatus> m_status;
+};
+} // namespace
+
+std::string PresenceBench::Result::ToString() const {
+    const double main_thread = HandlerMs + ListMs;
+    return fmt::format("{} presences in {} batches: {:.1f}ms handlers, {:.1f}ms member list, {:.1f}ms main thread total "
+                       "({:.2f} us per presence), {:.1f}ms wall",
+                       Events, Batches, HandlerMs, ListMs, main_thread,
+                       Events > 0 ? main_thread * 1000.0 / static_cast<double>(Events) : 0.0, WallMs);
+}
+
+static bool WriteRecording(const PresenceBench::Params &params, const std::string &path) {
+    auto recorder = GatewayRecorder::Create(path);
+    if (!recorder) return false;
+
+    constexpr static const char *statuses[] = { "online", "idle", "dnd", "offline" };
+    std::mt19937_64 rng(1234);
+    for (int i = 0; i < params.Presences; i++) {
+        // a few users flap a lot, most show up once or twice
+        const auto user = rng() % 4 == 0 ? rng() % 64 : rng() % std::max(params.Users, 1);
+        nlohmann::json data {
+            { "user", { { "id", std::to_string(200000 + user) } } },
+            { "guild_id", "1" },
+            { "status", statuses[rng() % 4] },
+            { "activities", nlohmann::json::array() },
+            { "client_status", { { "desktop", "online" } } },
+        };
+        nlohmann::json msg {
+            { "op", 0 },
+            { "t", "PRESENCE_UPDATE" },
+            { "s", i + 1 },
+            { "d", std::move(data) },
+        };
+        recorder->Write(msg.dump());
+    }
+    return true;
+}
+
+std::optional<PresenceBench::Result> PresenceBench::Run(const Params &params, DiscordClient &discord) {
+    using clock = std::chrono::steady_clock;
+
+    const auto path = Glib::build_filename(Glib::get_tmp_dir(), "abaddon-presence-bench.rec");
+    if (!WriteRecording(params, path)) return std::nullopt;
+
+    Columns columns;
+    auto model = Gtk::TreeStore::create(columns);
+    const int roles = std::max(params.Roles, 1);
+    for (int r = 0; r < roles; r++) {
+        auto role_row = *model->append();
+        role_row[columns.m_id] = 1000 + r;
+        for (int u = r; u < params.Users; u += roles) {
+            auto member_row = *model->append(role_row.children());
+            member_row[columns.m_id] = 200000 + u;
+            member_row[columns.m_status] = PresenceStatus::Offline;
+        }
+    }
+
+    Result result;
+    clock::duration list_time {};
+    // same walk as MemberList::OnPresenceUpdate
+    auto presence_conn = discord.signal_presence_update().connect([&](const std::unordered_map<Snowflake, PresenceStatus> &statuses) {
+        const auto start = clock::now();
+        size_t remaining = statuses.size();
+        for (auto &role : model->children()) {
+            for (auto &member : role.children()) {
+                const auto it = statuses.find(static_cast<uint64_t>((*member)[columns.m_id]));
+                if (it == statuses.end()) continue;
+                (*member)[columns.m_status] = it->second;
+                if (--remaining == 0) break;
+            }
+            if (remaining == 0) break;
+        }
+        list_time += clock::now() - start;
+        result.Batches++;
+    });
+
+    auto loop = Glib::MainLoop::create();
+    auto finished_conn = discord.signal_replay_finished().connect([&loop](const std::string &) {
+        // let the last batch flush
+        Glib::signal_timeout().connect_once([&loop] { loop->quit(); }, 100);
+    });
+
+    const auto start = clock::now();
+    const bool started = discord.StartReplay(path, false);
+    if (started) loop->run();
+    result.WallMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+    presence_conn.disconnect();
+    finished_conn.disconnect();
+    std::remove(path.c_str());
+    if (!started) return std::nullopt;
+
+    if (const auto it = discord.GetReplayStats().find("PRESENCE_UPDATE"); it != discord.GetReplayStats().end()) {
+        result.Events = it->second.Count;
+        result.HandlerMs = std::chrono::duration<double, std::milli>(it->second.Parse + it->second.Handler).count();
+    }
+    result.ListMs = std::chrono::duration<double, std::milli>(list_time).count();
+    return result;
+}
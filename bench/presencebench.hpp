@@ -0,0 +1,31 @@
+#pragma once
+#include <optional>
+#include <string>
+
+class DiscordClient;
+
+// main thread cost of a presence storm. writes a recording of PRESENCE_UPDATEs for a big guild and replays it through
+// the client as fast as possible, with a model shaped like the member list's (role rows with members under them)
+// taking the batched updates the same way MemberList does
+class PresenceBench {
+public:
+    struct Params {
+        int Presences = 10000;
+        int Users = 5000;
+        int Roles = 10; // groups in the member list
+    };
+
+    struct Result {
+        size_t Events = 0;
+        size_t Batches = 0;   // presence signals the member list got
+        double HandlerMs = 0; // parse and handler, main thread
+        double ListMs = 0;    // applying batches to the member list model, main thread
+        double WallMs = 0;
+
+        [[nodiscard]] std::string ToString() const;
+    };
+
+    // runs its own main loop. the client must not be connected. call Gtk::Main::init_gtkmm_internals first
+    // nullopt if the recording cant be written or replayed
+    static std::optional<Result> Run(const Params &params, DiscordClient &discord);
+};
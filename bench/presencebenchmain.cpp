@@ -0,0 +1,12 @@
+#include "harness.hpp"
+#include "presencebench.hpp"
+#include "abaddon.hpp"
+
+// a 10k presence storm replayed through the client into a member list shaped model
+int main(int argc, char **argv) {
+    BenchHarness harness(argc, argv, { "Presence benchmark", "discord", true, true });
+
+    return harness.Run({ { "",
+                           []() { return BenchHarness::Report(PresenceBench::Run({}, Abaddon::Get().GetDiscordClient())); },
+                           "couldn't write or replay the recording" } });
+}
@@ -0,0 +1,141 @@
+#include "storebench.hpp"
+#include "discord/store.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <spdlog/fmt/bundled/format.h>
+
+std::string StoreBench::Result::ToString() const {
+    return fmt::format("{:<8} {} reads, p50 {:.1f} us, p99 {:.1f} us, max {:.1f} us, longest stall {:.2f} ms, "
+                       "{} direct writes, p50 {:.1f} us, p99 {:.1f} us, max {:.1f} us, {:.0f} members/s written",
+                       Threaded ? "writer" : "inline", Reads, ReadP50Us, ReadP99Us, ReadMaxUs, LongestStallMs,
+                       DirectWrites, DirectP50Us, DirectP99Us, DirectMaxUs, MembersPerSecond);
+}
+
+std::optional<StoreBench::Result> StoreBench::Run(const Params &params, bool threaded) {
+    Store store(false);
+    if (!store.IsValid()) return std::nullopt;
+
+    using clock = std::chrono::steady_clock;
+    constexpr uint64_t FirstUser = 1000;
+    const Snowflake guild_id = 1;
+    const auto batch_size = static_cast<uint64_t>(std::max(params.BatchSize, 1));
+
+    const auto make_batch = [&store, guild_id](uint64_t first, uint64_t count) {
+        return [&store, guild_id, first, count] {
+            for (uint64_t id = first; id < first + count; id++) {
+                UserData user;
+                user.ID = id;
+                user.Username = "user" + std::to_string(id);
+                user.Discriminator = "0";
+                store.SetUser(user.ID, user);
+
+                GuildMember member;
+                member.Nickname = "member " + std::to_string(id);
+                member.Roles = { 2, 3, static_cast<uint64_t>(4 + id % 8) };
+                member.JoinedAt = "2020-01-01T00:00:00.000000+00:00";
+                member.IsDeafened = false;
+                member.IsMuted = false;
+                store.SetGuildMember(guild_id, user.ID, member);
+            }
+        };
+    };
+
+    // something to read from the start
+    store.BeginTransaction();
+    make_batch(FirstUser, batch_size)();
+    store.EndTransaction();
+
+    const auto slice_size = std::min(static_cast<uint64_t>(std::max(params.SliceSize, 1)), batch_size);
+
+    std::mt19937_64 rng(1234);
+    std::vector<double> latencies;
+    std::vector<double> direct_latencies;
+    std::atomic<size_t> members_done = 0;
+    Result result;
+    result.Threaded = threaded;
+
+    uint64_t next_user = FirstUser + batch_size;
+    uint64_t next_message = 1;
+    const auto start = clock::now();
+    const auto end = start + std::chrono::seconds(std::max(params.Seconds, 1));
+    auto next_write = start;
+    auto next_direct_write = start;
+    auto last_read = start;
+    while (true) {
+        const auto now = clock::now();
+        if (now >= end) break;
+
+        if (now >= next_write) {
+            next_write += std::chrono::milliseconds(std::max(params.BatchIntervalMs, 1));
+            if (threaded) {
+                for (uint64_t first = 0; first < batch_size; first += slice_size) {
+                    const auto count = std::min(slice_size, batch_size - first);
+                    store.Write(make_batch(next_user + first, count), [&members_done, count] { members_done += count; });
+                }
+            } else {
+                store.BeginTransaction();
+                make_batch(next_user, batch_size)();
+                store.EndTransaction();
+                members_done += batch_size;
+            }
+            next_user += batch_size;
+        }
+
+        if (now >= next_direct_write) {
+            next_direct_write += std::chrono::milliseconds(std::max(params.DirectWriteIntervalMs, 1));
+
+            Message message;
+            message.ID = next_message++;
+            message.ChannelID = 2;
+            message.GuildID = guild_id;
+            message.Author.ID = std::uniform_int_distribution<uint64_t>(FirstUser, next_user - 1)(rng);
+            message.Content = "message " + std::to_string(static_cast<uint64_t>(message.ID));
+            message.Timestamp = "2020-01-01T00:00:00.000000+00:00";
+            message.IsTTS = false;
+            message.DoesMentionEveryone = false;
+            message.IsPinned = false;
+            message.Type = MessageType::DEFAULT;
+
+            const auto write_start = clock::now();
+            store.BeginTransaction();
+            store.SetMessage(message.ID, message);
+            store.EndTransaction();
+            direct_latencies.push_back(std::chrono::duration<double, std::micro>(clock::now() - write_start).count());
+        }
+
+        const Snowflake id = std::uniform_int_distribution<uint64_t>(FirstUser, next_user - 1)(rng);
+        const auto read_start = clock::now();
+        store.GetUser(id);
+        store.GetGuildMember(guild_id, id);
+        const auto read_end = clock::now();
+
+        latencies.push_back(std::chrono::duration<double, std::micro>(read_end - read_start).count());
+        result.LongestStallMs = std::max(result.LongestStallMs, std::chrono::duration<double, std::milli>(read_end - last_read).count());
+        last_read = read_end;
+    }
+
+    store.Flush();
+    const auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+    result.Reads = latencies.size();
+    result.Members = members_done;
+    result.MembersPerSecond = static_cast<double>(result.Members) / elapsed;
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        result.ReadP50Us = latencies[latencies.size() / 2];
+        result.ReadP99Us = latencies[latencies.size() * 99 / 100];
+        result.ReadMaxUs = latencies.back();
+    }
+    result.DirectWrites = direct_latencies.size();
+    if (!direct_latencies.empty()) {
+        std::sort(direct_latencies.begin(), direct_latencies.end());
+        result.DirectP50Us = direct_latencies[direct_latencies.size() / 2];
+        result.DirectP99Us = direct_latencies[direct_latencies.size() * 99 / 100];
+        result.DirectMaxUs = direct_latencies.back();
+    }
+
+    return result;
+}
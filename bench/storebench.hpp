@@ -0,0 +1,37 @@
+#pragma once
+#include <optional>
+#include <string>
+
+// how much big writes get in the way of reads and of direct writes. member chunk sized writes land on a timer while
+// the calling thread keeps reading users and members the way the ui does and stores a message now and then like a
+// MESSAGE_CREATE would, either with the chunks on the store's writer thread or committed inline like they used to be
+class StoreBench {
+public:
+    struct Params {
+        int Seconds = 5;
+        int BatchSize = 1000; // members per chunk
+        int SliceSize = 100;  // members per queued write, chunks get split like the client does
+        int BatchIntervalMs = 50;
+        int DirectWriteIntervalMs = 10;
+    };
+
+    struct Result {
+        bool Threaded = false;
+        size_t Reads = 0;
+        size_t Members = 0; // written
+        double ReadP50Us = 0.0;
+        double ReadP99Us = 0.0;
+        double ReadMaxUs = 0.0;
+        double LongestStallMs = 0.0; // longest the reading thread went between two reads
+        size_t DirectWrites = 0;
+        double DirectP50Us = 0.0;
+        double DirectP99Us = 0.0;
+        double DirectMaxUs = 0.0;
+        double MembersPerSecond = 0.0;
+
+        [[nodiscard]] std::string ToString() const;
+    };
+
+    // nullopt if the store cant be created
+    static std::optional<Result> Run(const Params &params, bool threaded);
+};
@@ -0,0 +1,15 @@
+#include "harness.hpp"
+#include "storebench.hpp"
+
+// reads under heavy writes with writes inline and with the writer thread
+int main(int argc, char **argv) {
+    BenchHarness harness(argc, argv, { "Store benchmark", "discord" });
+
+    std::vector<BenchHarness::Case> cases;
+    for (const bool threaded : { false, true }) {
+        cases.push_back({ threaded ? "writer thread" : "inline",
+                          [threaded]() { return BenchHarness::Report(StoreBench::Run({}, threaded)); },
+                          "couldn't create a store" });
+    }
+    return harness.Run(cases);
+}
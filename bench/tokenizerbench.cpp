@@ -0,0 +1,122 @@
+#include "tokenizerbench.hpp"
+#include "misc/chatutil.hpp"
+#include "emojis.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iterator>
+#include <random>
+#include <glibmm/regex.h>
+#include <spdlog/fmt/bundled/format.h>
+
+std::string TokenizerBench::Result::ToString() const {
+    return fmt::format("{:<12} {} KiB, {} spans in {:.1f}ms, {:.2f} us per message (p99 {:.2f} us)",
+                       SinglePass ? "single pass" : "regex passes", Bytes / 1024, Spans, TotalMs, PerMessageUs, MessageP99Us);
+}
+
+static std::vector<std::string> MakeCorpus(const TokenizerBench::Params &params, const std::vector<std::string> &stock_emojis) {
+    constexpr static const char *words[] = {
+        "the", "lol", "yeah", "ok", "what", "is", "going", "on", "here", "i", "think", "so", "maybe", "tomorrow",
+        "café", "日本語", "→", "a.b", "http", "<nope>", "<@abc>", "*", "~",
+    };
+
+    std::mt19937_64 rng(1234);
+    std::vector<std::string> corpus;
+    corpus.reserve(params.Messages);
+    for (int i = 0; i < params.Messages; i++) {
+        const auto length = static_cast<size_t>(params.MinLength + rng() % std::max(params.MaxLength - params.MinLength, 1));
+        std::string text;
+        while (text.size() < length) {
+            const auto id = std::to_string(100000000000000000ULL + rng() % 900000000000000000ULL);
+            switch (rng() % 12) {
+                case 0: text += "<@" + id + ">"; break;
+                case 1: text += "<@!" + id + ">"; break;
+                case 2: text += "<@&" + id + ">"; break;
+                case 3: text += "<#" + id + ">"; break;
+                case 4: text += (rng() % 4 == 0 ? "<a:party_" : "<:blob_") + std::to_string(rng() % 100) + ":" + id + ">"; break;
+                case 5:
+                case 6:
+                    if (!stock_emojis.empty()) text += stock_emojis[rng() % stock_emojis.size()];
+                    break;
+                case 7: text += "https://example.com/channels/" + id + "/x?y=z"; break;
+                case 8: text += rng() % 2 == 0 ? "**bold**" : "~~strike~~"; break;
+                case 9: text += "`code <@" + id + ">`"; break;
+                default: text += words[rng() % std::size(words)]; break;
+            }
+            text += rng() % 8 == 0 ? '\n' : ' ';
+        }
+        corpus.push_back(std::move(text));
+    }
+    return corpus;
+}
+
+// what chat messages ran before Tokenize: role mentions, user mentions, links, channel mentions and custom emojis each
+// ran their own regex over the whole text, then stock emojis were looked for one pattern at a time
+static size_t RunRegexPasses(const Glib::ustring &text, const std::vector<Glib::ustring> &stock_emojis) {
+    static const std::array<Glib::RefPtr<Glib::Regex>, 5> regexes {
+        Glib::Regex::create(R"(<@&(\d+)>)"),
+        Glib::Regex::create(R"(<@!?(\d+)>)"),
+        Glib::Regex::create(R"(\bhttps?:\/\/[^\s]+\.[^\s]+\b)"),
+        Glib::Regex::create(R"(<#(\d+)>)"),
+        Glib::Regex::create(R"(<a?:([\w\d_]+):(\d+)>)"),
+    };
+
+    size_t matches = 0;
+    for (const auto &regex : regexes) {
+        Glib::MatchInfo match;
+        regex->match(text, match);
+        while (match.matches()) {
+            matches++;
+            match.next();
+        }
+    }
+    for (const auto &pattern : stock_emojis) {
+        Glib::ustring::size_type pos = 0;
+        while ((pos = text.find(pattern, pos)) != Glib::ustring::npos) {
+            matches++;
+            pos += pattern.size();
+        }
+    }
+    return matches;
+}
+
+std::optional<TokenizerBench::Result> TokenizerBench::Run(const Params &params, const std::string &emoji_db_path, bool single_pass) {
+    using clock = std::chrono::steady_clock;
+
+    EmojiResource emojis(emoji_db_path);
+    if (!emojis.Load()) return std::nullopt;
+
+    std::vector<std::string> stock_emojis;
+    for (const auto &[shortcode, pattern] : emojis.GetShortCodes())
+        stock_emojis.push_back(pattern);
+    std::sort(stock_emojis.begin(), stock_emojis.end());
+    stock_emojis.erase(std::unique(stock_emojis.begin(), stock_emojis.end()), stock_emojis.end());
+    const std::vector<Glib::ustring> stock_patterns(stock_emojis.begin(), stock_emojis.end());
+
+    const auto corpus = MakeCorpus(params, stock_emojis);
+
+    Result result;
+    result.SinglePass = single_pass;
+
+    std::vector<double> times;
+    times.reserve(corpus.size());
+    const auto total_start = clock::now();
+    for (const auto &content : corpus) {
+        result.Bytes += content.size();
+        const auto start = clock::now();
+        if (single_pass)
+            result.Spans += ChatUtil::Tokenize(content, emojis).size();
+        else
+            result.Spans += RunRegexPasses(content, stock_patterns);
+        times.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+    }
+    result.TotalMs = std::chrono::duration<double, std::milli>(clock::now() - total_start).count();
+
+    if (!times.empty()) {
+        result.PerMessageUs = result.TotalMs * 1000.0 / static_cast<double>(times.size());
+        std::sort(times.begin(), times.end());
+        result.MessageP99Us = times[std::min(times.size() - 1, static_cast<size_t>(0.99 * static_cast<double>(times.size())))];
+    }
+
+    return result;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <optional>
+#include <string>
+
+// cost of turning message content into spans. long messages heavy on user/role/channel mentions, custom and stock
+// emojis, links and markdown, run through ChatUtil::Tokenize or through the regex passes it replaced. the old passes
+// also pulled the text back out of the buffer after every match, which isnt counted here, so they come out ahead of
+// what they really cost
+class TokenizerBench {
+public:
+    struct Params {
+        int Messages = 2000;
+        int MinLength = 500; // bytes
+        int MaxLength = 2000;
+    };
+
+    struct Result {
+        bool SinglePass = false;
+        size_t Bytes = 0; // across the corpus
+        size_t Spans = 0; // tokens, or matches for the regex passes
+        double TotalMs = 0.0;
+        double PerMessageUs = 0.0;
+        double MessageP99Us = 0.0;
+
+        [[nodiscard]] std::string ToString() const;
+    };
+
+    // nullopt if the emoji db cant be loaded
+    static std::optional<Result> Run(const Params &params, const std::string &emoji_db_path, bool single_pass);
+};
@@ -0,0 +1,17 @@
+#include "harness.hpp"
+#include "tokenizerbench.hpp"
+#include "abaddon.hpp"
+
+// long mention and emoji heavy messages through the old regex passes and the single pass tokenizer
+int main(int argc, char **argv) {
+    BenchHarness harness(argc, argv, { "Tokenizer benchmark", "ui", true });
+    const auto path = Abaddon::GetResPath("/emojis.db");
+
+    std::vector<BenchHarness::Case> cases;
+    for (const bool single_pass : { false, true }) {
+        cases.push_back({ single_pass ? "single pass" : "regex passes",
+                          [path, single_pass]() { return BenchHarness::Report(TokenizerBench::Run({}, path, single_pass)); },
+                          "couldn't load " + path });
+    }
+    return harness.Run(cases);
+}
@@ -0,0 +1,44 @@
+#include "harness.hpp"
+#include "abaddon.hpp"
+#include "voicecallbench.hpp"
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+// the real voice client against the loopback gateway, with and without DAVE. the argument is how many speakers.
+// "churn" instead has 25 speakers joining and leaving every so often (the next argument, in ms) and the odd downgrade
+// for 30 seconds, and fails unless the call settles back to encrypted afterwards
+int main(int argc, char **argv) {
+    BenchHarness harness(argc, argv, { "Voice benchmark", "voice", true, true });
+
+    std::vector<BenchHarness::Case> cases;
+    if (const char *mode = harness.GetArg(0); mode != nullptr && std::strcmp(mode, "churn") == 0) {
+        VoiceCallBench::Params params;
+        params.Server.Speakers = 25;
+        params.Seconds = 30;
+        params.ChurnIntervalMs = harness.GetIntArg(1, 100);
+        params.DowngradeEvery = 50;
+        cases.push_back({ "DAVE churn",
+                          [params]() -> std::optional<std::string> {
+                              const auto result = VoiceCallBench::Run(params, Abaddon::Get().GetAudio());
+                              if (!result.has_value()) return std::nullopt;
+                              if (!result->Settled) {
+                                  spdlog::get("voice")->info("Voice benchmark, DAVE churn: {}", result->ToString());
+                                  return std::nullopt;
+                              }
+                              return result->ToString();
+                          },
+                          "couldn't get connected with DAVE, or never settled after the churn" });
+        return harness.Run(cases);
+    }
+
+    const int speakers = harness.GetIntArg(0, VoiceLoopbackServer::Params {}.Speakers);
+    for (const bool dave : { false, true }) {
+        VoiceCallBench::Params params;
+        params.Server.Speakers = speakers;
+        params.Server.Dave = dave;
+        cases.push_back({ dave ? "with DAVE" : "without DAVE",
+                          [params]() { return BenchHarness::Report(VoiceCallBench::Run(params, Abaddon::Get().GetAudio())); },
+                          dave ? "couldn't get connected with DAVE" : "couldn't get connected" });
+    }
+    return harness.Run(cases);
+}
@@ -0,0 +1,233 @@
+#ifdef WITH_VOICE
+// clang-format off
+
+#include "voicecallbench.hpp"
+#include "discord/voiceclient.hpp"
+#include "audio/manager.hpp"
+#include "platform.hpp"
+#include "watchdog.hpp"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <glibmm/main.h>
+#include <spdlog/fmt/bundled/format.h>
+// clang-format on
+
+using clock_type = std::chrono::steady_clock;
+
+static double ToMilliseconds(clock_type::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+static double MeanMilliseconds(clock_type::duration total, size_t count) {
+    return count > 0 ? ToMilliseconds(total) / static_cast<double>(count) : 0.0;
+}
+
+size_t VoiceCallBench::Result::GetDropped() const {
+    const size_t arrived = Sent - Lost;
+    return arrived > Decoded + Failed ? arrived - Decoded - Failed : 0;
+}
+
+double VoiceCallBench::Result::GetCPUPerSpeaker() const {
+    if (Speakers == 0 || AudioSeconds <= 0.0) return 0.0;
+    return 100.0 * ClientCPUSeconds / AudioSeconds / Speakers;
+}
+
+std::string VoiceCallBench::Result::ToString() const {
+    std::string out = fmt::format("{} speakers for {:.1f}s {}: connected in {:.1f}ms{}, "
+                                  "{} packets sent, {} lost, {} decoded, {} dropped, {} failed, {} underruns in {} mixes, "
+                                  "{:.1f}us per decode, {:.1f}us per mix, {:.1f}ms mean {:.1f}ms max buffered, "
+                                  "{:.2f}% of a core per speaker, {} of {} sent by the client readable on the other end, "
+                                  "main loop {:.1f}ms p99 {:.1f}ms max late with {} stalls",
+                                  Speakers, AudioSeconds, Dave ? "with DAVE" : "without DAVE",
+                                  ConnectMs, Dave ? fmt::format(" and encrypted in {:.1f}ms", EncryptedMs) : "",
+                                  Sent, Lost, Decoded, GetDropped(), Failed, Underruns, Mixes,
+                                  Decoded + Failed > 0 ? DecodeSeconds * 1000000.0 / static_cast<double>(Decoded + Failed) : 0.0,
+                                  Mixes > 0 ? MixSeconds * 1000000.0 / static_cast<double>(Mixes) : 0.0,
+                                  MeanLatencyMs, MaxLatencyMs,
+                                  GetCPUPerSpeaker(), ReadableByPeers, SentByClient,
+                                  MainLoopP99Ms, MainLoopMaxMs, Stalls);
+    if (Churn) {
+        out += fmt::format("\n  churn: {} joins, {} leaves, {} downgrades, {} upgrades, {} commits ({:.1f}ms mean {:.1f}ms max), "
+                           "{} transitions ({:.1f}ms mean {:.1f}ms max), joins encrypted in {:.1f}ms mean {:.1f}ms max, {} failures, {}",
+                           Joins, Leaves, Downgrades, Upgrades, Commits, CommitMeanMs, CommitMaxMs,
+                           Transitions, TransitionMeanMs, TransitionMaxMs, KeyedMeanMs, KeyedMaxMs, Failures,
+                           Settled ? fmt::format("settled {:.1f}ms after it stopped", SettleMs) : std::string("never settled"));
+    }
+    for (const auto &[name, stats] : DaveOperations) {
+        out += fmt::format("\n  DAVE {}: {} ops, {:.2f}ms max, {:.2f}ms max queued",
+                           name, stats.Count, ToMilliseconds(stats.Max), ToMilliseconds(stats.MaxQueued));
+    }
+    return out;
+}
+
+std::optional<VoiceCallBench::Result> VoiceCallBench::Run(const Params &params, AudioManager &audio) {
+    if (!audio.OK()) return std::nullopt;
+
+    VoiceLoopbackServer server(params.Server);
+    if (!server.Start()) return std::nullopt;
+
+    audio.RemoveAllSSRCs();
+
+    DiscordVoiceClient client;
+    // abaddon does this for the client it owns
+    client.signal_speaking().connect([&audio](const VoiceSpeakingData &data) {
+        audio.AddSSRC(data.SSRC);
+    });
+    client.SetEndpoint(server.GetEndpoint());
+    client.SetServerID(VoiceLoopbackServer::ServerID);
+    client.SetChannelID(VoiceLoopbackServer::ChannelID);
+    client.SetUserID(VoiceLoopbackServer::ClientUserID);
+    client.SetSessionID("loopback");
+    client.SetToken("loopback");
+
+    Result result;
+    result.Speakers = std::clamp(params.Server.Speakers, 1, 64);
+    result.Dave = params.Server.Dave;
+
+    auto loop = Glib::MainLoop::create();
+    const auto start = clock_type::now();
+    bool ready = false;
+    auto poll = Glib::signal_timeout().connect([&]() -> bool {
+        const auto now = clock_type::now();
+        if (result.ConnectMs == 0.0 && client.IsConnected())
+            result.ConnectMs = ToMilliseconds(now - start);
+        if (client.IsConnected() && (!params.Server.Dave || client.IsDaveEnabled())) {
+            result.EncryptedMs = ToMilliseconds(now - start);
+            ready = true;
+            loop->quit();
+            return false;
+        }
+        if (now - start > std::chrono::seconds(params.TimeoutSeconds)) {
+            loop->quit();
+            return false;
+        }
+        return true;
+    },
+                                             2);
+    // after the client's own idle setup
+    Glib::signal_idle().connect_once([&client]() {
+        client.Start();
+    });
+    loop->run();
+    poll.disconnect();
+
+    if (!ready) {
+        if (client.IsConnected() || client.IsConnecting()) client.Stop();
+        return std::nullopt;
+    }
+
+    MainLoopWatchdog watchdog;
+    watchdog.Start(std::chrono::milliseconds(params.StallThresholdMs));
+
+    // the client sends whatever the null capture device hears, which is enough to go through DAVE on the way out
+    audio.ResetPlaybackStats();
+    audio.StartCaptureDevice();
+    const auto server_before = server.GetStats();
+    const double cpu_before = Platform::GetProcessCPUTime();
+    const auto media_start = clock_type::now();
+    server.StartMedia();
+
+    sigc::connection churn;
+    std::mt19937 rng(5678);
+    int step = 0;
+    if (params.ChurnIntervalMs > 0) {
+        result.Churn = true;
+        churn = Glib::signal_timeout().connect([&]() -> bool {
+            step++;
+            if (params.Server.Dave && params.DowngradeEvery > 0 && step % params.DowngradeEvery == 0) {
+                if (server.IsDowngraded()) {
+                    if (server.Upgrade()) result.Upgrades++;
+                } else if (server.Downgrade()) {
+                    result.Downgrades++;
+                }
+                return true;
+            }
+
+            const int peer = std::uniform_int_distribution<int>(0, server.GetPeerCount() - 1)(rng);
+            if (server.IsInCall(peer)) {
+                server.Leave(peer);
+                // or it counts as underruns from here on. it's added back when it speaks again
+                audio.RemoveSSRC(server.GetSSRC(peer));
+            } else {
+                server.Join(peer);
+            }
+            return true;
+        },
+                                               params.ChurnIntervalMs);
+    }
+
+    Glib::signal_timeout().connect_once([&loop]() { loop->quit(); }, std::max(params.Seconds, 1) * 1000);
+    loop->run();
+    churn.disconnect();
+
+    if (result.Churn) {
+        // let whatever was started finish, and come back if it was left downgraded
+        const auto settle_start = clock_type::now();
+        auto settle = Glib::signal_timeout().connect([&]() -> bool {
+            const auto now = clock_type::now();
+            if (server.IsDowngraded() && server.Upgrade()) result.Upgrades++;
+            if (server.IsSettled() && !server.IsDowngraded() && (!params.Server.Dave || client.IsDaveEnabled())) {
+                result.Settled = true;
+                result.SettleMs = ToMilliseconds(now - settle_start);
+                loop->quit();
+                return false;
+            }
+            if (now - settle_start > std::chrono::seconds(params.TimeoutSeconds)) {
+                loop->quit();
+                return false;
+            }
+            return true;
+        },
+                                                     5);
+        loop->run();
+        settle.disconnect();
+    }
+
+    server.StopMedia();
+    const double cpu = Platform::GetProcessCPUTime() - cpu_before;
+    result.AudioSeconds = std::chrono::duration<double>(clock_type::now() - media_start).count();
+    const auto playback = audio.GetPlaybackStats();
+    const auto server_after = server.GetStats();
+    audio.StopCaptureDevice();
+
+    const auto latency = watchdog.GetLatency();
+    result.MainLoopP99Ms = static_cast<double>(latency.P99.count()) / 1000.0;
+    result.MainLoopMaxMs = static_cast<double>(latency.Max.count()) / 1000.0;
+    result.Stalls = watchdog.GetStallCount();
+    watchdog.Stop();
+
+    result.Sent = server_after.Sent - server_before.Sent;
+    result.Lost = server_after.Lost - server_before.Lost;
+    result.Decoded = playback.Decoded;
+    result.Failed = playback.Failed;
+    result.Underruns = playback.Underruns;
+    result.Mixes = playback.Mixes;
+    result.DecodeSeconds = std::chrono::duration<double>(playback.DecodeTime).count();
+    result.MixSeconds = std::chrono::duration<double>(playback.MixTime).count();
+    result.MeanLatencyMs = playback.LatencySamples > 0 ? playback.LatencyTotalMs / static_cast<double>(playback.LatencySamples) : 0.0;
+    result.MaxLatencyMs = playback.LatencyMaxMs;
+    result.ClientCPUSeconds = std::max(0.0, cpu - (server_after.CPUSeconds - server_before.CPUSeconds));
+    result.SentByClient = server_after.ClientPackets - server_before.ClientPackets;
+    result.ReadableByPeers = server_after.ClientDecrypted - server_before.ClientDecrypted;
+    result.DaveOperations = client.GetDaveOperationStats();
+
+    result.Joins = server_after.Joins - server_before.Joins;
+    result.Leaves = server_after.Leaves - server_before.Leaves;
+    result.Commits = server_after.Commits - server_before.Commits;
+    result.Transitions = server_after.Transitions - server_before.Transitions;
+    result.Failures = server_after.Failures - server_before.Failures;
+    result.CommitMeanMs = MeanMilliseconds(server_after.CommitTotal - server_before.CommitTotal, result.Commits);
+    result.CommitMaxMs = ToMilliseconds(server_after.CommitMax);
+    result.TransitionMeanMs = MeanMilliseconds(server_after.TransitionTotal - server_before.TransitionTotal, result.Transitions);
+    result.TransitionMaxMs = ToMilliseconds(server_after.TransitionMax);
+    result.KeyedMeanMs = MeanMilliseconds(server_after.KeyedTotal - server_before.KeyedTotal, server_after.Keyed - server_before.Keyed);
+    result.KeyedMaxMs = ToMilliseconds(server_after.KeyedMax);
+
+    client.Stop();
+    audio.RemoveAllSSRCs();
+    server.Stop();
+    return result;
+}
+
+#endif
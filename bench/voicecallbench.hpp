@@ -0,0 +1,89 @@
+#pragma once
+#ifdef WITH_VOICE
+// clang-format off
+
+#include "discord/dave.hpp"
+#include "voiceloopback.hpp"
+#include <map>
+#include <optional>
+#include <string>
+// clang-format on
+
+class AudioManager;
+
+// the real receive path, unlike VoiceBench. a DiscordVoiceClient connects to a VoiceLoopbackServer, gets through
+// discovery and DAVE setup with the simulated speakers, and plays them on the AudioManager it's given. start abaddon
+// with ABADDON_AUDIO_BACKENDS=null to get miniaudio's null device, which keeps real time without a sound card.
+// with churn on, speakers keep joining and leaving (and the call downgrades and comes back) while audio flows, which
+// is the DAVE worker, its queue and the published media state under the load of a busy stage
+class VoiceCallBench {
+public:
+    struct Params {
+        VoiceLoopbackServer::Params Server;
+        int Seconds = 10;
+        int TimeoutSeconds = 10; // for connecting and getting encrypted, and settling after churn
+        int ChurnIntervalMs = 0; // someone joins or leaves this often, 0 for nobody
+        int DowngradeEvery = 0;  // churn steps between going to protocol version 0 and back, 0 for never
+        int StallThresholdMs = 50;
+    };
+
+    struct Result {
+        int Speakers = 0;
+        bool Dave = false;
+        double ConnectMs = 0.0;   // start until connected
+        double EncryptedMs = 0.0; // start until DAVE is on, same as connecting without DAVE
+        double AudioSeconds = 0.0;
+
+        size_t Sent = 0;
+        size_t Lost = 0;      // never left the server
+        size_t Decoded = 0;   // made it into the mixer
+        size_t Failed = 0;    // opus didnt like it
+        size_t Underruns = 0; // per speaker, mixes without a full period buffered
+        size_t Mixes = 0;
+
+        double DecodeSeconds = 0.0;
+        double MixSeconds = 0.0;
+        double MeanLatencyMs = 0.0; // buffered in front of the mixer
+        double MaxLatencyMs = 0.0;
+        double ClientCPUSeconds = 0.0; // process cpu minus what the server spent
+
+        size_t SentByClient = 0;
+        size_t ReadableByPeers = 0;
+
+        std::map<std::string, DaveSession::OperationStats> DaveOperations;
+
+        // the main loop while the audio was flowing
+        double MainLoopP99Ms = 0.0; // how late a beat was
+        double MainLoopMaxMs = 0.0;
+        size_t Stalls = 0; // over the threshold
+
+        bool Churn = false;
+        size_t Joins = 0;
+        size_t Leaves = 0;
+        size_t Downgrades = 0;
+        size_t Upgrades = 0;
+        size_t Commits = 0;
+        size_t Transitions = 0;
+        size_t Failures = 0; // on the server's side, rejected or unparseable commits and welcomes
+        double CommitMeanMs = 0.0; // proposals until the client's commit
+        double CommitMaxMs = 0.0;
+        double TransitionMeanMs = 0.0; // announced until the client is ready
+        double TransitionMaxMs = 0.0;
+        double KeyedMeanMs = 0.0; // a join until the new speaker is sending encrypted audio
+        double KeyedMaxMs = 0.0;
+        bool Settled = false; // back to encrypted with nothing outstanding once the churn stopped
+        double SettleMs = 0.0;
+
+        // arrived but never reached the mixer: transport, DAVE or decode. also whatever was in flight at the end
+        [[nodiscard]] size_t GetDropped() const;
+        // percent of one core per speaker
+        [[nodiscard]] double GetCPUPerSpeaker() const;
+        [[nodiscard]] std::string ToString() const;
+    };
+
+    // runs its own main loop. call Gtk::Main::init_gtkmm_internals first
+    // nullopt if the server wont start or the client doesnt get connected (and encrypted) in time
+    static std::optional<Result> Run(const Params &params, AudioManager &audio);
+};
+
+#endif
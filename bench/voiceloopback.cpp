@@ -0,0 +1,881 @@
+#ifdef WITH_VOICE
+// clang-format off
+
+#include "voiceloopback.hpp"
+#include "discord/voiceclient.hpp"
+#include "audio/voicebench.hpp"
+#include "platform.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <variant>
+#include <dave/array_view.h>
+#include <mls/credential.h>
+#include <mls/crypto.h>
+#include <mls/messages.h>
+#include <opus.h>
+#include <sodium.h>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+    #define S_ADDR(var) (var).sin_addr.S_un.S_addr
+    #define socklen_t int
+#else
+    #define S_ADDR(var) (var).sin_addr.s_addr
+#endif
+// clang-format on
+
+using namespace std::chrono_literals;
+using clock_type = std::chrono::steady_clock;
+
+constexpr static int FrameSize = 480;           // 10ms
+constexpr static int LoopFrames = 200;          // each speaker loops 2 seconds of audio
+constexpr static int FirstPort = 43210;         // ixwebsocket doesnt say what port 0 turned into
+constexpr static int HeartbeatInterval = 41250; // what discord sends
+constexpr static uint32_t ClientSSRC = 1;
+
+namespace {
+mlspp::bytes_ns::bytes BigEndian(uint64_t value) {
+    std::vector<uint8_t> out(8);
+    for (int i = 0; i < 8; i++)
+        out[7 - i] = static_cast<uint8_t>(value >> (8 * i));
+    return out;
+}
+
+std::vector<std::vector<uint8_t>> EncodeSpeaker(OpusEncoder *encoder, int speaker) {
+    opus_encoder_ctl(encoder, OPUS_RESET_STATE);
+    const double freq = 110.0 + 37.0 * speaker;
+
+    std::vector<std::vector<uint8_t>> frames;
+    std::array<int16_t, FrameSize * 2> pcm;
+    std::array<uint8_t, 1275> opus;
+    for (int f = 0; f < LoopFrames; f++) {
+        for (int i = 0; i < FrameSize; i++) {
+            const double t = static_cast<double>(f * FrameSize + i) / 48000.0;
+            const double tone = std::sin(2.0 * M_PI * freq * t) + 0.3 * std::sin(2.0 * M_PI * freq * 2.7 * t);
+            const auto sample = static_cast<int16_t>(6000.0 * tone);
+            pcm[i * 2] = sample;
+            pcm[i * 2 + 1] = sample;
+        }
+        const int len = opus_encode(encoder, pcm.data(), FrameSize, opus.data(), static_cast<opus_int32>(opus.size()));
+        if (len > 0) frames.emplace_back(opus.begin(), opus.begin() + len);
+    }
+    return frames;
+}
+
+// the client sends its commit followed by the welcome for whoever it added, if anyone
+std::optional<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> SplitCommitWelcome(const std::vector<uint8_t> &data) {
+    try {
+        mlspp::tls::istream r(data);
+        mlspp::MLSMessage commit;
+        r >> commit;
+        auto commit_bytes = mlspp::tls::marshal(commit);
+        if (commit_bytes.size() > data.size()) return std::nullopt;
+
+        std::vector<uint8_t> welcome(data.begin() + commit_bytes.size(), data.end());
+        // tolerate it being written as an optional<Welcome>. a bare welcome starts with the cipher suite, so 0
+        if (welcome.size() == 1 && welcome[0] == 0)
+            welcome.clear();
+        else if (!welcome.empty() && welcome[0] == 1)
+            welcome.erase(welcome.begin());
+        return std::make_pair(std::move(commit_bytes), std::move(welcome));
+    } catch (const std::exception &) {
+        return std::nullopt;
+    }
+}
+
+// a bare KeyPackage, or one wrapped in an MLSMessage. CheckWireFormats says which libdave sends
+std::optional<mlspp::KeyPackage> ParseKeyPackage(const std::vector<uint8_t> &data, bool *wrapped = nullptr) {
+    try {
+        auto key_package = mlspp::tls::get<mlspp::KeyPackage>(data);
+        if (wrapped != nullptr) *wrapped = false;
+        return key_package;
+    } catch (const std::exception &) {}
+    try {
+        const auto message = mlspp::tls::get<mlspp::MLSMessage>(data);
+        if (const auto *key_package = std::get_if<mlspp::KeyPackage>(&message.message)) {
+            if (wrapped != nullptr) *wrapped = true;
+            return *key_package;
+        }
+    } catch (const std::exception &) {}
+    return std::nullopt;
+}
+
+mlspp::Proposal MakeAdd(discord::dave::mls::ISession &session) {
+    auto key_package = ParseKeyPackage(session.GetMarshalledKeyPackage());
+    if (!key_package.has_value()) throw std::runtime_error("unreadable key package");
+    return mlspp::Proposal { mlspp::Add { std::move(*key_package) } };
+}
+
+mlspp::Proposal MakeRemove(size_t leaf) {
+    return mlspp::Proposal { mlspp::Remove { mlspp::LeafIndex { static_cast<uint32_t>(leaf) } } };
+}
+} // namespace
+
+struct VoiceLoopbackServer::Sender {
+    mlspp::CipherSuite Suite { mlspp::CipherSuite::ID::P256_AES128GCM_SHA256_P256 };
+    mlspp::SignaturePrivateKey Key = mlspp::SignaturePrivateKey::generate(Suite);
+
+    std::vector<uint8_t> GetPackage() const {
+        const mlspp::ExternalSender sender { Key.public_key, mlspp::Credential::basic(BigEndian(ServerID)) };
+        return mlspp::tls::marshal(sender);
+    }
+
+    // opcode 27, appending
+    std::vector<uint8_t> Propose(uint64_t epoch, const std::vector<mlspp::Proposal> &proposals) const {
+        std::vector<mlspp::MLSMessage> messages;
+        for (const auto &proposal : proposals)
+            messages.push_back(mlspp::external_proposal(Suite, BigEndian(ChannelID), epoch, proposal, 0, Key));
+
+        mlspp::tls::ostream w;
+        w << static_cast<uint8_t>(0) << messages;
+        return w.bytes();
+    }
+};
+
+struct VoiceLoopbackServer::Peer {
+    uint64_t UserID = 0;
+    uint32_t SSRC = 0;
+    std::shared_ptr<mlspp::SignaturePrivateKey> TransientKey;
+    std::unique_ptr<discord::dave::mls::ISession> Session;
+    std::unique_ptr<discord::dave::IEncryptor> Encryptor;
+    std::unique_ptr<discord::dave::IKeyRatchet> PendingRatchet; // switched to when the client executes the transition
+    bool InCall = true;
+    bool InGroup = false;
+    bool Keyed = false;
+    std::optional<clock_type::time_point> JoinedAt; // churn joins, until keyed
+
+    std::vector<std::vector<uint8_t>> Frames;
+    size_t NextFrame = 0;
+    uint16_t Sequence = 0;
+    uint32_t Timestamp = 0;
+    uint32_t Nonce = 0;
+};
+
+VoiceLoopbackServer::VoiceLoopbackServer(const Params &params)
+    : m_params(params)
+    , m_log(spdlog::get("voice"))
+    , m_dave_active(params.Dave) {
+}
+
+VoiceLoopbackServer::~VoiceLoopbackServer() {
+    Stop();
+}
+
+bool VoiceLoopbackServer::Start() {
+    if (sodium_init() < 0) return false;
+
+    int err;
+    OpusEncoder *encoder = opus_encoder_create(48000, 2, OPUS_APPLICATION_VOIP, &err);
+    if (err != OPUS_OK) return false;
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(m_params.Bitrate));
+
+    const auto on_failure = [log = m_log](const std::string &reason, const std::string &detail) {
+        log->warn("Loopback MLS failure: {} {}", reason, detail);
+    };
+    const int speakers = std::clamp(m_params.Speakers, 1, 64);
+    for (int i = 0; i < speakers; i++) {
+        auto peer = std::make_unique<Peer>();
+        peer->UserID = 2000 + i;
+        peer->SSRC = 100 + i;
+        peer->Session = discord::dave::mls::CreateSession(nullptr, "", on_failure);
+        peer->Encryptor = discord::dave::CreateEncryptor();
+        peer->Encryptor->AssignSsrcToCodec(peer->SSRC, discord::dave::Codec::Opus);
+        peer->Frames = EncodeSpeaker(encoder, i);
+        m_peers.push_back(std::move(peer));
+    }
+    opus_encoder_destroy(encoder);
+
+    m_sender = std::make_unique<Sender>();
+    m_client_decryptor = discord::dave::CreateDecryptor();
+    if (m_params.Dave && !CheckWireFormats()) return false;
+
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    S_ADDR(addr) = inet_addr("127.0.0.1");
+    addr.sin_port = 0;
+    socklen_t addrlen = sizeof(addr);
+    if (bind(m_socket, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        getsockname(m_socket, reinterpret_cast<sockaddr *>(&addr), &addrlen) != 0) {
+        m_log->error("Loopback gateway couldn't bind a udp socket");
+        return false;
+    }
+    m_udp_port = ntohs(addr.sin_port);
+
+    for (int port = FirstPort; port < FirstPort + 100 && !m_ws_server; port++) {
+        auto server = std::make_unique<ix::WebSocketServer>(port, "127.0.0.1");
+        server->setOnClientMessageCallback([this](const std::shared_ptr<ix::ConnectionState> &, ix::WebSocket &ws, const ix::WebSocketMessagePtr &msg) {
+            OnClientMessage(ws, msg);
+        });
+        if (!server->listen().first) continue;
+        server->start();
+        m_ws_server = std::move(server);
+        m_ws_port = port;
+    }
+    if (!m_ws_server) {
+        m_log->error("Loopback gateway couldn't listen on any port from {}", FirstPort);
+        return false;
+    }
+
+    m_log->info("Loopback voice gateway on {} with udp on {}", GetEndpoint(), m_udp_port);
+    m_running = true;
+    m_udp_thread = std::thread(&VoiceLoopbackServer::UDPThread, this);
+    return true;
+}
+
+bool VoiceLoopbackServer::CheckWireFormats() {
+    // one libdave session in the client's place and one joining, the same thing a call does with just the library
+    const auto on_failure = [log = m_log](const std::string &reason, const std::string &detail) {
+        log->warn("Wire format check MLS failure: {} {}", reason, detail);
+    };
+    const auto creator_id = std::to_string(ClientUserID);
+    const std::string joiner_id = "3000";
+    const std::set<std::string> users { creator_id, joiner_id };
+    const auto package = m_sender->GetPackage();
+
+    std::shared_ptr<mlspp::SignaturePrivateKey> creator_key;
+    std::shared_ptr<mlspp::SignaturePrivateKey> joiner_key;
+    auto creator = discord::dave::mls::CreateSession(nullptr, "", on_failure);
+    creator->Init(1, ChannelID, creator_id, creator_key);
+    creator->SetExternalSender(package);
+    auto joiner = discord::dave::mls::CreateSession(nullptr, "", on_failure);
+    joiner->Init(1, ChannelID, joiner_id, joiner_key);
+    joiner->SetExternalSender(package);
+
+    bool wrapped = false;
+    const auto key_package = ParseKeyPackage(joiner->GetMarshalledKeyPackage(), &wrapped);
+    if (!key_package.has_value()) {
+        m_log->error("Wire format check: libdave's key package is neither a KeyPackage nor an MLSMessage holding one");
+        return false;
+    }
+    m_log->info("Wire format check: libdave sends key packages {}", wrapped ? "wrapped in an MLSMessage" : "bare");
+
+    const auto commit_welcome = creator->ProcessProposals(m_sender->Propose(0, { mlspp::Proposal { mlspp::Add { *key_package } } }), users);
+    if (!commit_welcome.has_value()) {
+        m_log->error("Wire format check: libdave didn't commit the proposals as this server writes them");
+        return false;
+    }
+    const auto split = SplitCommitWelcome(*commit_welcome);
+    if (!split.has_value() || split->second.empty()) {
+        m_log->error("Wire format check: couldn't split libdave's commit from its welcome");
+        return false;
+    }
+    if (!std::holds_alternative<discord::dave::RosterMap>(creator->ProcessCommit(split->first)) ||
+        !joiner->ProcessWelcome(split->second, users).has_value()) {
+        m_log->error("Wire format check: libdave didn't take back its own commit and welcome after the split");
+        return false;
+    }
+
+    // both ends have to come out with the same keys
+    auto encryptor = discord::dave::CreateEncryptor();
+    encryptor->AssignSsrcToCodec(1, discord::dave::Codec::Opus);
+    encryptor->SetKeyRatchet(joiner->GetKeyRatchet(joiner_id));
+    auto decryptor = discord::dave::CreateDecryptor();
+    decryptor->TransitionToKeyRatchet(creator->GetKeyRatchet(joiner_id));
+
+    const std::vector<uint8_t> frame { 0xFC, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+    std::vector<uint8_t> encrypted(encryptor->GetMaxCiphertextByteSize(discord::dave::MediaType::Audio, frame.size()));
+    std::vector<uint8_t> decrypted(decryptor->GetMaxPlaintextByteSize(discord::dave::MediaType::Audio, encrypted.size()));
+    size_t encrypted_size = 0;
+    size_t decrypted_size = 0;
+    const bool ok = encryptor->Encrypt(discord::dave::MediaType::Audio, 1,
+                                       discord::dave::MakeArrayView(frame.data(), frame.size()),
+                                       discord::dave::MakeArrayView(encrypted.data(), encrypted.size()),
+                                       &encrypted_size) == discord::dave::IEncryptor::Success &&
+                    decryptor->Decrypt(discord::dave::MediaType::Audio,
+                                       discord::dave::MakeArrayView(static_cast<const uint8_t *>(encrypted.data()), encrypted_size),
+                                       discord::dave::MakeArrayView(decrypted.data(), decrypted.size()),
+                                       &decrypted_size) == discord::dave::IDecryptor::Success &&
+                    std::equal(frame.begin(), frame.end(), decrypted.begin(), decrypted.begin() + decrypted_size);
+    if (!ok) {
+        m_log->error("Wire format check: a frame encrypted by the joiner didn't decrypt on the creator's side");
+        return false;
+    }
+    return true;
+}
+
+void VoiceLoopbackServer::Stop() {
+    StopMedia();
+    m_running = false;
+    if (m_udp_thread.joinable()) m_udp_thread.join();
+    if (m_ws_server) {
+        m_ws_server->stop();
+        m_ws_server.reset();
+    }
+    if (m_socket != static_cast<decltype(m_socket)>(-1)) {
+#ifdef _WIN32
+        closesocket(m_socket);
+#else
+        close(m_socket);
+#endif
+        m_socket = static_cast<decltype(m_socket)>(-1);
+    }
+}
+
+std::string VoiceLoopbackServer::GetEndpoint() const {
+    return "ws://127.0.0.1:" + std::to_string(m_ws_port);
+}
+
+void VoiceLoopbackServer::StartMedia() {
+    if (m_media) return;
+    m_media = true;
+    m_media_thread = std::thread(&VoiceLoopbackServer::MediaThread, this);
+}
+
+void VoiceLoopbackServer::StopMedia() {
+    m_media = false;
+    if (m_media_thread.joinable()) m_media_thread.join();
+}
+
+VoiceLoopbackServer::Stats VoiceLoopbackServer::GetStats() const {
+    std::lock_guard<std::mutex> _(m_mutex);
+    auto stats = m_stats;
+    stats.CPUSeconds = m_handler_cpu + m_udp_cpu + m_media_cpu;
+    return stats;
+}
+
+int VoiceLoopbackServer::GetPeerCount() const {
+    std::lock_guard<std::mutex> _(m_mutex);
+    return static_cast<int>(m_peers.size());
+}
+
+bool VoiceLoopbackServer::IsInCall(int peer) const {
+    std::lock_guard<std::mutex> _(m_mutex);
+    return m_peers.at(peer)->InCall;
+}
+
+uint32_t VoiceLoopbackServer::GetSSRC(int peer) const {
+    std::lock_guard<std::mutex> _(m_mutex);
+    return m_peers.at(peer)->SSRC;
+}
+
+void VoiceLoopbackServer::Join(int index) {
+    std::lock_guard<std::mutex> _(m_mutex);
+    auto *peer = m_peers.at(index).get();
+    if (peer->InCall) return;
+
+    peer->InCall = true;
+    peer->JoinedAt = clock_type::now();
+    m_stats.Joins++;
+    AnnounceUsers({ peer });
+    if (m_dave_active) {
+        m_queued_joins.push_back(peer);
+        FlushChurn();
+    }
+}
+
+void VoiceLoopbackServer::Leave(int index) {
+    std::lock_guard<std::mutex> _(m_mutex);
+    auto *peer = m_peers.at(index).get();
+    if (!peer->InCall) return;
+
+    peer->InCall = false;
+    peer->JoinedAt.reset();
+    m_stats.Leaves++;
+    SendJSON(static_cast<int>(VoiceGatewayOp::ClientDisconnect), { { "user_id", std::to_string(peer->UserID) } });
+    if (m_dave_active) {
+        // if the join hasnt been proposed yet it never will be, but it might still have a leaf from before
+        m_queued_joins.erase(std::remove(m_queued_joins.begin(), m_queued_joins.end(), peer), m_queued_joins.end());
+        if (std::find(m_queued_leaves.begin(), m_queued_leaves.end(), peer) == m_queued_leaves.end())
+            m_queued_leaves.push_back(peer);
+        FlushChurn();
+    }
+}
+
+bool VoiceLoopbackServer::Downgrade() {
+    std::lock_guard<std::mutex> _(m_mutex);
+    if (!m_dave_active || IsOutstanding()) return false;
+
+    const int transition = m_next_transition;
+    m_next_transition = m_next_transition % 0xFFFF + 1;
+    SendJSON(static_cast<int>(VoiceGatewayOp::SecureFramesPrepareProtocolTransition), { { "protocol_version", 0 }, { "transition_id", transition } });
+    m_pending_transition = transition;
+    m_pending_downgrade = true;
+    m_announced_at = clock_type::now();
+    return true;
+}
+
+bool VoiceLoopbackServer::Upgrade() {
+    std::lock_guard<std::mutex> _(m_mutex);
+    if (!m_params.Dave || m_dave_active || IsOutstanding()) return false;
+
+    // the client starts over and sends a key package, which gets everyone proposed again
+    SendJSON(static_cast<int>(VoiceGatewayOp::SecureFramesPrepareEpoch), { { "protocol_version", 1 }, { "epoch", 1 } });
+    m_awaiting_commit = true;
+    return true;
+}
+
+bool VoiceLoopbackServer::IsDowngraded() const {
+    std::lock_guard<std::mutex> _(m_mutex);
+    return m_params.Dave && !m_dave_active;
+}
+
+bool VoiceLoopbackServer::IsSettled() const {
+    std::lock_guard<std::mutex> _(m_mutex);
+    return !IsOutstanding();
+}
+
+void VoiceLoopbackServer::OnClientMessage(ix::WebSocket &ws, const ix::WebSocketMessagePtr &msg) {
+    const double cpu_start = Platform::GetThreadCPUTime();
+    std::lock_guard<std::mutex> _(m_mutex);
+
+    try {
+        switch (msg->type) {
+            case ix::WebSocketMessageType::Open:
+                m_client = &ws;
+                SendJSON(static_cast<int>(VoiceGatewayOp::Hello), { { "heartbeat_interval", HeartbeatInterval }, { "v", 8 } });
+                break;
+            case ix::WebSocketMessageType::Close:
+                if (m_client == &ws) m_client = nullptr;
+                break;
+            case ix::WebSocketMessageType::Message:
+                if (msg->binary)
+                    OnBinaryMessage(msg->str);
+                else
+                    OnGatewayMessage(nlohmann::json::parse(msg->str));
+                break;
+            default:
+                break;
+        }
+    } catch (const std::exception &e) {
+        m_log->error("Loopback gateway: {}", e.what());
+        m_stats.Failures++;
+    }
+
+    m_handler_cpu += Platform::GetThreadCPUTime() - cpu_start;
+}
+
+void VoiceLoopbackServer::OnGatewayMessage(const nlohmann::json &j) {
+    const auto op = static_cast<VoiceGatewayOp>(j.at("op").get<int>());
+    const auto &d = j.at("d");
+    switch (op) {
+        case VoiceGatewayOp::Identify:
+            m_client_ssrc = ClientSSRC;
+            SendJSON(static_cast<int>(VoiceGatewayOp::Ready), {
+                                                                  { "ssrc", m_client_ssrc },
+                                                                  { "ip", "127.0.0.1" },
+                                                                  { "port", m_udp_port },
+                                                                  { "modes", nlohmann::json::array({ "aead_xchacha20_poly1305_rtpsize" }) },
+                                                              });
+            break;
+        case VoiceGatewayOp::SelectProtocol: {
+            // who else is here and which ssrc is whose, then the key
+            std::vector<Peer *> here;
+            for (auto &peer : m_peers) {
+                if (peer->InCall) here.push_back(peer.get());
+            }
+            AnnounceUsers(here);
+
+            randombytes_buf(m_secret_key.data(), m_secret_key.size());
+            SendJSON(static_cast<int>(VoiceGatewayOp::SessionDescription), {
+                                                                               { "mode", "aead_xchacha20_poly1305_rtpsize" },
+                                                                               { "secret_key", m_secret_key },
+                                                                               { "dave_protocol_version", m_params.Dave ? 1 : 0 },
+                                                                           });
+        } break;
+        case VoiceGatewayOp::Heartbeat:
+            SendJSON(static_cast<int>(VoiceGatewayOp::HeartbeatAck), { { "t", d.value("t", uint64_t(0)) } });
+            break;
+        case VoiceGatewayOp::SecureFramesReadyForTransition:
+            OnClientReady(d.value("transition_id", 0));
+            break;
+        case VoiceGatewayOp::MlsInvalidCommitWelcome:
+            m_log->warn("Loopback gateway: client rejected transition {}", d.value("transition_id", 0));
+            m_stats.Failures++;
+            break;
+        default:
+            break;
+    }
+}
+
+void VoiceLoopbackServer::OnBinaryMessage(const std::string &data) {
+    if (data.empty()) return;
+
+    const int op = static_cast<uint8_t>(data[0]);
+    std::vector<uint8_t> payload(data.begin() + 1, data.end());
+    if (op == static_cast<int>(VoiceGatewayOp::MlsKeyPackage)) {
+        // the client (re)started its session and wants a group
+        ResetGroup();
+    } else if (op == static_cast<int>(VoiceGatewayOp::MlsCommitWelcome)) {
+        OnClientCommit(payload);
+    }
+}
+
+void VoiceLoopbackServer::SendJSON(int opcode, nlohmann::json data) {
+    if (m_client == nullptr) return;
+    nlohmann::json j;
+    j["op"] = opcode;
+    j["d"] = std::move(data);
+    j["seq"] = ++m_seq;
+    m_client->sendText(j.dump());
+}
+
+void VoiceLoopbackServer::SendBinary(int opcode, const std::vector<uint8_t> &payload) {
+    if (m_client == nullptr) return;
+    const int seq = ++m_seq;
+    std::string frame(3 + payload.size(), '\0');
+    frame[0] = static_cast<char>((seq >> 8) & 0xFF);
+    frame[1] = static_cast<char>(seq & 0xFF);
+    frame[2] = static_cast<char>(opcode);
+    std::memcpy(frame.data() + 3, payload.data(), payload.size());
+    m_client->sendBinary(frame);
+}
+
+void VoiceLoopbackServer::AnnounceUsers(const std::vector<Peer *> &peers) {
+    nlohmann::json ids = nlohmann::json::array();
+    for (const auto *peer : peers)
+        ids.push_back(std::to_string(peer->UserID));
+    SendJSON(static_cast<int>(VoiceGatewayOp::ClientConnect), { { "user_ids", ids } });
+    for (const auto *peer : peers) {
+        SendJSON(static_cast<int>(VoiceGatewayOp::Speaking), {
+                                                                 { "user_id", std::to_string(peer->UserID) },
+                                                                 { "ssrc", peer->SSRC },
+                                                                 { "speaking", 1 },
+                                                             });
+    }
+}
+
+void VoiceLoopbackServer::ResetGroup() {
+    if (!m_params.Dave) return;
+
+    // also how a downgraded call comes back
+    m_dave_active = true;
+    m_epoch = 0;
+    m_leaves = { ClientUserID };
+    m_proposed.clear();
+    m_proposed_removes.clear();
+    m_awaiting_commit = false;
+    m_queued_joins.clear();
+    m_queued_leaves.clear();
+    m_pending_transition.reset();
+    m_pending_downgrade = false;
+    m_pending_client_ratchet.reset();
+
+    const auto package = m_sender->GetPackage();
+    std::vector<mlspp::Proposal> proposals;
+    for (auto &peer : m_peers) {
+        peer->InGroup = false;
+        peer->Keyed = false;
+        peer->PendingRatchet.reset();
+        if (!peer->InCall) continue;
+        peer->Session->Init(1, ChannelID, std::to_string(peer->UserID), peer->TransientKey);
+        peer->Session->SetExternalSender(package);
+        proposals.push_back(MakeAdd(*peer->Session));
+        m_proposed.push_back(peer.get());
+    }
+
+    SendBinary(static_cast<int>(VoiceGatewayOp::MlsExternalSenderPackage), package);
+    if (!proposals.empty()) SendProposals(m_sender->Propose(m_epoch, proposals));
+}
+
+void VoiceLoopbackServer::FlushChurn() {
+    if (!m_dave_active) {
+        m_queued_joins.clear();
+        m_queued_leaves.clear();
+        return;
+    }
+    // one commit at a time, like the real thing
+    if (m_awaiting_commit || m_pending_transition.has_value()) return;
+    if (m_queued_joins.empty() && m_queued_leaves.empty()) return;
+
+    std::vector<mlspp::Proposal> proposals;
+    for (auto *peer : m_queued_leaves) {
+        peer->InGroup = false;
+        peer->Keyed = false;
+        peer->PendingRatchet.reset();
+        const auto leaf = std::find(m_leaves.begin(), m_leaves.end(), std::optional<uint64_t>(peer->UserID));
+        if (leaf == m_leaves.end()) continue; // never made it in
+        const auto index = static_cast<size_t>(std::distance(m_leaves.begin(), leaf));
+        proposals.push_back(MakeRemove(index));
+        m_proposed_removes.push_back(index);
+    }
+
+    const auto package = m_sender->GetPackage();
+    for (auto *peer : m_queued_joins) {
+        // a fresh key package, the last one might have been used already
+        peer->Session->Init(1, ChannelID, std::to_string(peer->UserID), peer->TransientKey);
+        peer->Session->SetExternalSender(package);
+        proposals.push_back(MakeAdd(*peer->Session));
+        m_proposed.push_back(peer);
+    }
+
+    m_queued_leaves.clear();
+    m_queued_joins.clear();
+    if (!proposals.empty()) SendProposals(m_sender->Propose(m_epoch, proposals));
+}
+
+void VoiceLoopbackServer::SendProposals(const std::vector<uint8_t> &payload) {
+    m_proposed_at = clock_type::now();
+    m_awaiting_commit = true;
+    SendBinary(static_cast<int>(VoiceGatewayOp::MlsProposals), payload);
+
+    // members need the proposals to make sense of the commit. they make commits of their own but the client's wins
+    const auto users = GetUserIDs();
+    for (auto &peer : m_peers) {
+        if (peer->InGroup) peer->Session->ProcessProposals(payload, users);
+    }
+}
+
+void VoiceLoopbackServer::OnClientCommit(const std::vector<uint8_t> &data) {
+    const auto now = clock_type::now();
+    if (!m_awaiting_commit) {
+        m_log->warn("Loopback gateway: commit from the client with nothing proposed");
+        m_stats.Failures++;
+        return;
+    }
+    const auto split = SplitCommitWelcome(data);
+    if (!split.has_value()) {
+        m_log->warn("Loopback gateway: couldn't parse the client's commit");
+        m_stats.Failures++;
+        return;
+    }
+    const auto &[commit, welcome] = *split;
+
+    m_stats.Commits++;
+    m_stats.CommitTotal += now - m_proposed_at;
+    m_stats.CommitMax = std::max(m_stats.CommitMax, now - m_proposed_at);
+    m_epoch++;
+    m_awaiting_commit = false;
+
+    // removes first, then adds go in the leftmost free leaves
+    for (const auto leaf : m_proposed_removes)
+        m_leaves[leaf].reset();
+    m_proposed_removes.clear();
+    for (auto *peer : m_proposed) {
+        auto leaf = std::find(m_leaves.begin(), m_leaves.end(), std::nullopt);
+        if (leaf == m_leaves.end())
+            m_leaves.emplace_back(peer->UserID);
+        else
+            *leaf = peer->UserID;
+    }
+
+    const int transition = m_next_transition;
+    m_next_transition = m_next_transition % 0xFFFF + 1;
+    std::vector<uint8_t> announce { static_cast<uint8_t>(transition >> 8), static_cast<uint8_t>(transition & 0xFF) };
+    announce.insert(announce.end(), commit.begin(), commit.end());
+    SendBinary(static_cast<int>(VoiceGatewayOp::MlsPrepareCommitTransition), announce);
+    m_pending_transition = transition;
+    m_announced_at = clock_type::now();
+
+    const auto users = GetUserIDs();
+    for (auto &peer : m_peers) {
+        const bool joining = std::find(m_proposed.begin(), m_proposed.end(), peer.get()) != m_proposed.end();
+        if (joining) {
+            if (welcome.empty() || !peer->Session->ProcessWelcome(welcome, users)) {
+                m_log->warn("Loopback gateway: peer {} couldn't join with the client's welcome", peer->UserID);
+                m_stats.Failures++;
+                continue;
+            }
+            peer->InGroup = true;
+        } else if (peer->InGroup) {
+            const auto result = peer->Session->ProcessCommit(commit);
+            if (!std::holds_alternative<discord::dave::RosterMap>(result)) {
+                m_log->warn("Loopback gateway: peer {} couldn't process the client's commit", peer->UserID);
+                m_stats.Failures++;
+                continue;
+            }
+        } else {
+            continue;
+        }
+        peer->PendingRatchet = peer->Session->GetKeyRatchet(std::to_string(peer->UserID));
+        if (!m_pending_client_ratchet)
+            m_pending_client_ratchet = peer->Session->GetKeyRatchet(std::to_string(ClientUserID));
+    }
+    m_proposed.clear();
+}
+
+void VoiceLoopbackServer::OnClientReady(int transitionId) {
+    if (!m_pending_transition.has_value() || *m_pending_transition != transitionId) return;
+    m_pending_transition.reset();
+
+    const auto now = clock_type::now();
+    const auto took = now - m_announced_at;
+    m_stats.Transitions++;
+    m_stats.TransitionTotal += took;
+    m_stats.TransitionMax = std::max(m_stats.TransitionMax, took);
+
+    if (m_pending_downgrade) {
+        // everyone sends plain audio from here
+        m_pending_downgrade = false;
+        m_dave_active = false;
+        for (auto &peer : m_peers) {
+            peer->InGroup = false;
+            peer->Keyed = false;
+            peer->PendingRatchet.reset();
+        }
+        m_leaves.clear();
+        m_pending_client_ratchet.reset();
+    } else {
+        // everyone switches keys together
+        for (auto &peer : m_peers) {
+            if (!peer->PendingRatchet) continue;
+            peer->Encryptor->SetKeyRatchet(std::move(peer->PendingRatchet));
+            peer->Keyed = true;
+            if (peer->JoinedAt.has_value()) {
+                const auto keyed = now - *peer->JoinedAt;
+                m_stats.Keyed++;
+                m_stats.KeyedTotal += keyed;
+                m_stats.KeyedMax = std::max(m_stats.KeyedMax, keyed);
+                peer->JoinedAt.reset();
+            }
+        }
+        if (m_pending_client_ratchet)
+            m_client_decryptor->TransitionToKeyRatchet(std::move(m_pending_client_ratchet));
+    }
+
+    SendJSON(static_cast<int>(VoiceGatewayOp::SecureFramesExecuteTransition), { { "transition_id", transitionId } });
+    FlushChurn();
+}
+
+std::set<std::string> VoiceLoopbackServer::GetUserIDs() const {
+    // whoever is in the call, and whoever left but hasnt been removed from the tree yet
+    std::set<std::string> ids { std::to_string(ClientUserID) };
+    for (const auto &peer : m_peers) {
+        if (peer->InCall) ids.insert(std::to_string(peer->UserID));
+    }
+    for (const auto &leaf : m_leaves) {
+        if (leaf.has_value()) ids.insert(std::to_string(*leaf));
+    }
+    return ids;
+}
+
+bool VoiceLoopbackServer::IsOutstanding() const {
+    return m_awaiting_commit || m_pending_transition.has_value() || !m_queued_joins.empty() || !m_queued_leaves.empty();
+}
+
+void VoiceLoopbackServer::UDPThread() {
+    std::array<uint8_t, 4096> buf;
+    while (m_running) {
+        m_udp_cpu = Platform::GetThreadCPUTime();
+
+        timeval tv { 0, 100000 };
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(m_socket, &read_fds);
+        if (select(static_cast<int>(m_socket) + 1, &read_fds, nullptr, nullptr, &tv) <= 0) continue;
+
+        sockaddr_in from {};
+        socklen_t fromlen = sizeof(from);
+        const int n = recvfrom(m_socket, reinterpret_cast<char *>(buf.data()), static_cast<int>(buf.size()), 0, reinterpret_cast<sockaddr *>(&from), &fromlen);
+        if (n <= 0) continue;
+
+        if (n == 74 && buf[0] == 0x00 && buf[1] == 0x01) {
+            // discovery, tell the client what it looks like from here
+            std::array<uint8_t, 74> reply {};
+            std::memcpy(reply.data(), buf.data(), 8);
+            reply[1] = 0x02;
+            std::strcpy(reinterpret_cast<char *>(reply.data() + 8), "127.0.0.1");
+            const uint16_t port = ntohs(from.sin_port);
+            reply[72] = (port >> 8) & 0xFF;
+            reply[73] = (port >> 0) & 0xFF;
+            {
+                std::lock_guard<std::mutex> _(m_mutex);
+                m_client_addr = from;
+            }
+            sendto(m_socket, reinterpret_cast<const char *>(reply.data()), static_cast<int>(reply.size()), 0, reinterpret_cast<sockaddr *>(&from), sizeof(from));
+        } else if (n > 12 + static_cast<int>(crypto_aead_xchacha20poly1305_ietf_ABYTES + sizeof(uint32_t)) && (buf[1] & 0x7F) == 120) {
+            std::lock_guard<std::mutex> _(m_mutex);
+
+            std::array<uint8_t, 24> nonce = {};
+            std::memcpy(nonce.data(), buf.data() + n - sizeof(uint32_t), sizeof(uint32_t));
+            std::array<uint8_t, 4096> opus;
+            unsigned long long len = 0;
+            if (crypto_aead_xchacha20poly1305_ietf_decrypt(opus.data(), &len, nullptr, buf.data() + 12, n - 12 - sizeof(uint32_t), buf.data(), 12, nonce.data(), m_secret_key.data()) != 0) continue;
+
+            static const uint8_t OPUS_SILENCE[] = { 0xF8, 0xFF, 0xFE };
+            if (len == sizeof(OPUS_SILENCE) && std::memcmp(opus.data(), OPUS_SILENCE, sizeof(OPUS_SILENCE)) == 0) continue;
+
+            m_stats.ClientPackets++;
+            if (!m_dave_active) {
+                m_stats.ClientDecrypted++;
+                continue;
+            }
+            auto &dec = *m_client_decryptor;
+            m_scratch.resize(dec.GetMaxPlaintextByteSize(discord::dave::MediaType::Audio, len));
+            size_t written = 0;
+            const auto result = dec.Decrypt(discord::dave::MediaType::Audio,
+                                            discord::dave::MakeArrayView(static_cast<const uint8_t *>(opus.data()), static_cast<size_t>(len)),
+                                            discord::dave::MakeArrayView(m_scratch.data(), m_scratch.size()),
+                                            &written);
+            if (result == discord::dave::IDecryptor::Success) m_stats.ClientDecrypted++;
+        }
+    }
+}
+
+void VoiceLoopbackServer::MediaThread() {
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const auto jitter = std::chrono::microseconds(std::max(m_params.JitterMs, 0) * 1000);
+    const double media_cpu_start = m_media_cpu;
+    const double thread_cpu_start = Platform::GetThreadCPUTime();
+
+    auto next_tick = clock_type::now();
+    while (m_media) {
+        if (clock_type::now() >= next_tick) {
+            next_tick += 10ms;
+
+            std::lock_guard<std::mutex> _(m_mutex);
+            for (auto &peer : m_peers) {
+                if (!peer->InCall) continue;
+                const auto &frame = peer->Frames[peer->NextFrame++ % peer->Frames.size()];
+                const uint8_t *payload = frame.data();
+                size_t size = frame.size();
+
+                if (m_dave_active) {
+                    // not in the encrypted call yet
+                    if (!peer->Keyed) continue;
+
+                    auto &enc = *peer->Encryptor;
+                    m_scratch.resize(enc.GetMaxCiphertextByteSize(discord::dave::MediaType::Audio, size));
+                    size_t written = 0;
+                    const auto result = enc.Encrypt(discord::dave::MediaType::Audio,
+                                                    peer->SSRC,
+                                                    discord::dave::MakeArrayView(payload, size),
+                                                    discord::dave::MakeArrayView(m_scratch.data(), m_scratch.size()),
+                                                    &written);
+                    if (result != discord::dave::IEncryptor::Success) continue;
+                    payload = m_scratch.data();
+                    size = written;
+                }
+
+                auto packet = VoiceBench::MakePacket(payload, size, peer->Sequence++, peer->Timestamp, peer->SSRC, peer->Nonce++, m_secret_key);
+                peer->Timestamp += FrameSize;
+
+                m_stats.Sent++;
+                if (unit(m_rng) < m_params.Loss) {
+                    m_stats.Lost++;
+                    continue;
+                }
+                const auto delay = std::chrono::duration_cast<clock_type::duration>(jitter * unit(m_rng));
+                m_delayed.emplace(clock_type::now() + delay, std::move(packet));
+            }
+        }
+
+        while (!m_delayed.empty() && m_delayed.begin()->first <= clock_type::now()) {
+            SendUDP(m_delayed.begin()->second);
+            m_delayed.erase(m_delayed.begin());
+        }
+
+        m_media_cpu = media_cpu_start + Platform::GetThreadCPUTime() - thread_cpu_start;
+
+        auto wake = next_tick;
+        if (!m_delayed.empty()) wake = std::min(wake, m_delayed.begin()->first);
+        std::this_thread::sleep_until(wake);
+    }
+    m_delayed.clear();
+}
+
+void VoiceLoopbackServer::SendUDP(const std::vector<uint8_t> &packet) {
+    std::optional<sockaddr_in> addr;
+    {
+        std::lock_guard<std::mutex> _(m_mutex);
+        addr = m_client_addr;
+    }
+    if (!addr.has_value()) return;
+    sendto(m_socket, reinterpret_cast<const char *>(packet.data()), static_cast<int>(packet.size()), 0, reinterpret_cast<const sockaddr *>(&*addr), sizeof(*addr));
+}
+
+#endif
@@ -0,0 +1,176 @@
+#pragma once
+#ifdef WITH_VOICE
+// clang-format off
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dave/dave_interfaces.h>
+#include <ixwebsocket/IXNetSystem.h>
+#include <ixwebsocket/IXWebSocketServer.h>
+#include <spdlog/logger.h>
+#include "json.hpp"
+// clang-format on
+
+// a voice gateway and udp server on localhost so the real DiscordVoiceClient can be driven without discord. everyone
+// else in the call is simulated with their own libdave session, and the gateway is the mls external sender that adds
+// them, so the client goes through the same key package, proposals, commit and transition steps as a real call
+class VoiceLoopbackServer {
+public:
+    struct Params {
+        int Speakers = 8;
+        double Loss = 0.0; // 0-1
+        int JitterMs = 0;  // packets leave up to this late, so they can get reordered
+        int Bitrate = 64000;
+        bool Dave = true;
+    };
+
+    // what to point the client at
+    constexpr static uint64_t ServerID = 1000;
+    constexpr static uint64_t ChannelID = 1001;
+    constexpr static uint64_t ClientUserID = 1002;
+
+    explicit VoiceLoopbackServer(const Params &params);
+    ~VoiceLoopbackServer();
+
+    VoiceLoopbackServer(const VoiceLoopbackServer &) = delete;
+    VoiceLoopbackServer &operator=(const VoiceLoopbackServer &) = delete;
+
+    // false if opus wont set up, theres nowhere to listen, or the wire formats dont check out with libdave
+    bool Start();
+    void Stop();
+
+    // for DiscordVoiceClient::SetEndpoint
+    [[nodiscard]] std::string GetEndpoint() const;
+
+    // everyone in the call sends a 10ms frame every 10ms until stopped
+    void StartMedia();
+    void StopMedia();
+
+    // churn. peers are numbered from 0 and all start in the call. joins and leaves are told to the client straight
+    // away, the adds and removes that go with them are proposed together once the last commit has been executed
+    [[nodiscard]] int GetPeerCount() const;
+    [[nodiscard]] bool IsInCall(int peer) const;
+    [[nodiscard]] uint32_t GetSSRC(int peer) const;
+    void Join(int peer);
+    void Leave(int peer);
+    // to protocol version 0 with a transition and back with a new epoch. false if something is still outstanding
+    bool Downgrade();
+    bool Upgrade();
+    [[nodiscard]] bool IsDowngraded() const;
+    // nothing proposed, committed or queued that the client hasnt finished
+    [[nodiscard]] bool IsSettled() const;
+
+    struct Stats {
+        size_t Sent = 0;
+        size_t Lost = 0;            // dropped on purpose
+        size_t ClientPackets = 0;   // audio from the client, not counting silence
+        size_t ClientDecrypted = 0; // of those, how many the other side could take the DAVE layer off
+        size_t Commits = 0;
+        size_t Transitions = 0; // executed, including downgrades
+        size_t Joins = 0;
+        size_t Leaves = 0;
+        size_t Failures = 0; // commits or welcomes that didnt work out on either side
+        std::chrono::steady_clock::duration CommitTotal {}; // proposals sent until the client's commit comes back
+        std::chrono::steady_clock::duration CommitMax {};
+        std::chrono::steady_clock::duration TransitionTotal {}; // commit announced until the client is ready for it
+        std::chrono::steady_clock::duration TransitionMax {};
+        size_t Keyed = 0;                                 // joins that got as far as sending encrypted audio
+        std::chrono::steady_clock::duration KeyedTotal {}; // join until the peer is sending encrypted audio
+        std::chrono::steady_clock::duration KeyedMax {};
+        double CPUSeconds = 0.0; // the server's own work, to take out of the process total
+    };
+
+    [[nodiscard]] Stats GetStats() const;
+
+private:
+    struct Peer;
+    struct Sender; // external sender key, mlspp stays in the source file
+
+    // the proposals layout and the key package encoding come from libdave, so check them against libdave before any
+    // numbers are worth anything. false, with the reason logged, if it doesnt round trip
+    bool CheckWireFormats();
+
+    void OnClientMessage(ix::WebSocket &ws, const ix::WebSocketMessagePtr &msg);
+    void OnGatewayMessage(const nlohmann::json &j);
+    void OnBinaryMessage(const std::string &data);
+    void SendJSON(int opcode, nlohmann::json data);
+    void SendBinary(int opcode, const std::vector<uint8_t> &payload);
+
+    // everything below runs with m_mutex held
+    void ResetGroup();
+    void FlushChurn();
+    void AnnounceUsers(const std::vector<Peer *> &peers);
+    void SendProposals(const std::vector<uint8_t> &payload);
+    void OnClientCommit(const std::vector<uint8_t> &data);
+    void OnClientReady(int transitionId);
+    [[nodiscard]] std::set<std::string> GetUserIDs() const;
+    [[nodiscard]] bool IsOutstanding() const;
+
+    void UDPThread();
+    void MediaThread();
+    void SendUDP(const std::vector<uint8_t> &packet);
+
+    Params m_params;
+    std::shared_ptr<spdlog::logger> m_log;
+
+    std::unique_ptr<ix::WebSocketServer> m_ws_server;
+    int m_ws_port = 0;
+
+#ifdef _WIN32
+    SOCKET m_socket = INVALID_SOCKET;
+#else
+    int m_socket = -1;
+#endif
+    uint16_t m_udp_port = 0;
+    std::thread m_udp_thread;
+    std::thread m_media_thread;
+    std::atomic<bool> m_running = false;
+    std::atomic<bool> m_media = false;
+
+    mutable std::mutex m_mutex;
+    ix::WebSocket *m_client = nullptr;
+    std::optional<sockaddr_in> m_client_addr;
+    uint32_t m_client_ssrc = 0;
+    int m_seq = 0;
+    std::array<uint8_t, 32> m_secret_key {};
+
+    std::unique_ptr<Sender> m_sender;
+    std::vector<std::unique_ptr<Peer>> m_peers;
+    uint64_t m_epoch = 0;
+    std::vector<std::optional<uint64_t>> m_leaves; // user in each leaf of the tree, the client made the group so it's 0
+    std::vector<Peer *> m_proposed;                // adds in the order the commit will apply them
+    std::vector<size_t> m_proposed_removes;        // leaves
+    std::chrono::steady_clock::time_point m_proposed_at;
+    bool m_awaiting_commit = false;
+    std::vector<Peer *> m_queued_joins;
+    std::vector<Peer *> m_queued_leaves;
+    bool m_dave_active = false; // false once downgraded
+    int m_next_transition = 1;
+    std::optional<int> m_pending_transition;
+    bool m_pending_downgrade = false;
+    std::chrono::steady_clock::time_point m_announced_at;
+    // checks what the client sends, with a key any peer can work out
+    std::unique_ptr<discord::dave::IDecryptor> m_client_decryptor;
+    std::unique_ptr<discord::dave::IKeyRatchet> m_pending_client_ratchet;
+    std::vector<uint8_t> m_scratch;
+
+    std::mt19937 m_rng { 1234 };
+    std::multimap<std::chrono::steady_clock::time_point, std::vector<uint8_t>> m_delayed; // media thread only
+
+    Stats m_stats;
+    double m_handler_cpu = 0.0;
+    std::atomic<double> m_udp_cpu = 0.0;
+    std::atomic<double> m_media_cpu = 0.0;
+};
+
+#endif
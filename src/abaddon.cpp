@@ -1,4 +1,5 @@
 #include "abaddon.hpp"
+#include <future>
 #include <memory>
 #include <spdlog/spdlog.h>
 #include <spdlog/cfg/env.h>
@@ -7,6 +8,7 @@
 #include <algorithm>
 #include <gtkmm.h>
 #include "platform.hpp"
+#include "trace.hpp"
 #include "audio/manager.hpp"
 #include "discord/discord.hpp"
 #include "dialogs/token.hpp"
@@ -19,6 +21,7 @@
 #include "windows/profilewindow.hpp"
 #include "windows/pinnedwindow.hpp"
 #include "windows/threadswindow.hpp"
+#include "windows/mainlooplatencywindow.hpp"
 #include "windows/voice/voicewindow.hpp"
 #include "startup.hpp"
 #include "notifications/notifications.hpp"
@@ -46,37 +49,58 @@ void macOSThemeChangedCallback(CFNotificationCenterRef center, void *observer, C
 #include <handy.h>
 #endif
 
+#ifndef _WIN32
+#include <csignal>
+#include <glib-unix.h>
+#endif
+
 #ifdef _WIN32
 #pragma comment(lib, "crypt32.lib")
 #endif
 
+#ifdef WITH_VOICE
+// the env var wins without ending up in the settings file
+static Glib::ustring GetAudioBackends(const SettingsManager::Settings &settings) {
+    if (const char *backends = std::getenv("ABADDON_AUDIO_BACKENDS"); backends != nullptr)
+        return backends;
+    return settings.Backends;
+}
+#endif
+
 Abaddon::Abaddon()
     : m_settings(Platform::FindConfigFile())
     , m_discord(GetSettings().UseMemoryDB) // stupid but easy
     , m_emojis(GetResPath("/emojis.db"))
 #ifdef WITH_VOICE
-    , m_audio(GetSettings().Backends)
+    , m_audio(GetAudioBackends(GetSettings()))
 #endif
 {
+    m_startup_trace.Add("load settings, create store", m_startup_trace.GetOrigin());
+
     LoadFromSettings();
 
+    m_emojis.SetCacheBudget(static_cast<size_t>(std::max(GetSettings().EmojiCacheSize, 0)) * 1024);
+    m_img_mgr.SetAnimationCacheBudget(static_cast<size_t>(std::max(GetSettings().AnimationCacheSize, 0)) * 1024);
+
     // todo: set user agent for non-client(?)
     std::string ua = GetSettings().UserAgent;
     m_discord.SetUserAgent(ua);
 
     // todo rename funcs
-    m_discord.signal_gateway_ready_supplemental().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnReady));
-    m_discord.signal_message_create().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnMessageCreate));
-    m_discord.signal_message_delete().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnMessageDelete));
-    m_discord.signal_message_update().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnMessageUpdate));
-    m_discord.signal_guild_member_list_update().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnGuildMemberListUpdate));
-    m_discord.signal_thread_member_list_update().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnThreadMemberListUpdate));
-    m_discord.signal_reaction_add().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnReactionAdd));
-    m_discord.signal_reaction_remove().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnReactionRemove));
-    m_discord.signal_guild_join_request_create().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnGuildJoinRequestCreate));
-    m_discord.signal_thread_update().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnThreadUpdate));
-    m_discord.signal_message_sent().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnMessageSent));
-    m_discord.signal_disconnected().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnDisconnect));
+    // these all end up touching the main window so they get blocked when theres no window
+    m_ui_connections.push_back(m_discord.signal_gateway_ready_supplemental().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnReady)));
+    m_ui_connections.push_back(m_discord.signal_message_create().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnMessageCreate)));
+    m_ui_connections.push_back(m_discord.signal_message_delete().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnMessageDelete)));
+    m_ui_connections.push_back(m_discord.signal_message_update().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnMessageUpdate)));
+    m_ui_connections.push_back(m_discord.signal_guild_member_list_update().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnGuildMemberListUpdate)));
+    m_ui_connections.push_back(m_discord.signal_thread_member_list_update().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnThreadMemberListUpdate)));
+    m_ui_connections.push_back(m_discord.signal_reaction_add().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnReactionAdd)));
+    m_ui_connections.push_back(m_discord.signal_reaction_remove().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnReactionRemove)));
+    m_ui_connections.push_back(m_discord.signal_guild_join_request_create().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnGuildJoinRequestCreate)));
+    m_ui_connections.push_back(m_discord.signal_thread_update().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnThreadUpdate)));
+    m_ui_connections.push_back(m_discord.signal_message_sent().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnMessageSent)));
+    m_ui_connections.push_back(m_discord.signal_disconnected().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnDisconnect)));
+    m_ui_connections.push_back(m_discord.signal_replay_finished().connect(sigc::mem_fun(*this, &Abaddon::DiscordOnReplayFinished)));
 
 #ifdef WITH_VOICE
     m_discord.signal_voice_connected().connect(sigc::mem_fun(*this, &Abaddon::OnVoiceConnected));
@@ -91,15 +115,24 @@ Abaddon::Abaddon()
         if (!accessible)
             m_channels_requested.erase(id);
     });
+    m_ui_connections.push_back(m_prefetch.signal_prefetched().connect([this](Snowflake id, const std::vector<Message> &msgs) {
+        m_channels_requested.insert(id);
+        const auto channel = m_discord.GetChannel(id);
+        if (channel.has_value())
+            CheckMessagesForMembers(*channel, msgs);
+        // in case its view is cached
+        m_main_window->UpdateChatMergeMessages(id, msgs);
+    }));
+
     if (GetSettings().Prefetch) {
-        m_discord.signal_message_create().connect([this](const Message &message) {
+        m_ui_connections.push_back(m_discord.signal_message_create().connect([this](const Message &message) {
             if (message.Author.HasAvatar())
                 m_img_mgr.Prefetch(message.Author.GetAvatarURL());
             for (const auto &attachment : message.Attachments) {
                 if (IsURLViewableImage(attachment.ProxyURL))
                     m_img_mgr.Prefetch(attachment.ProxyURL);
             }
-        });
+        }));
     }
 
 #ifdef WITH_VOICE
@@ -193,16 +226,47 @@ static bool HandleKeyEvents(GdkEvent *event, MainWindow *main_window) {
     return false;
 }
 
+static void HandleActivityEvents(GdkEvent *event) {
+    switch (event->type) {
+        case GDK_KEY_PRESS:
+        case GDK_BUTTON_PRESS:
+        case GDK_SCROLL:
+            Abaddon::Get().GetHistoryBackfill().NotifyActivity();
+            break;
+        default:
+            break;
+    }
+}
+
 static void MainEventHandler(GdkEvent *event, void *main_window) {
+    HandleActivityEvents(event);
     if (HandleButtonEvents(event, static_cast<MainWindow *>(main_window))) return;
     if (HandleKeyEvents(event, static_cast<MainWindow *>(main_window))) return;
     gtk_main_do_event(event);
 }
 
 int Abaddon::StartGTK() {
+    // nothing reads emojis until messages are shown so this can overlap with building the ui and connecting
+    auto emojis_loaded = std::async(std::launch::async, [this] {
+        const auto start = StartupTrace::clock::now();
+        const bool ok = m_emojis.Load();
+        m_startup_trace.Add("load emojis", start);
+        return ok;
+    });
+
     m_gtk_app = Gtk::Application::create("io.github.uowuo.abaddon");
     Glib::set_application_name(APP_TITLE);
 
+#ifndef _WIN32
+    // kill -USR1 saves a trace for when the ui is too busy hitching to click anything. runs from the main loop
+    g_unix_signal_add(
+        SIGUSR1, [](gpointer) -> gboolean {
+            Abaddon::Get().ActionSavePerformanceTrace();
+            return G_SOURCE_CONTINUE;
+        },
+        nullptr);
+#endif
+
 #ifdef WITH_LIBHANDY
     m_gtk_app->signal_activate().connect([] {
         hdy_init();
@@ -239,6 +303,7 @@ int Abaddon::StartGTK() {
     }
 #endif
 
+    auto start = StartupTrace::clock::now();
     m_main_window = std::make_unique<MainWindow>();
     m_main_window->set_title(APP_TITLE);
     m_main_window->set_position(Gtk::WIN_POS_CENTER);
@@ -253,12 +318,6 @@ int Abaddon::StartGTK() {
         dlg.run();
     }
 
-    if (!m_emojis.Load()) {
-        Gtk::MessageDialog dlg(*m_main_window, "The emoji file couldn't be loaded!", false, Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
-        dlg.set_position(Gtk::WIN_POS_CENTER);
-        dlg.run();
-    }
-
     if (!m_discord.IsStoreValid()) {
         Gtk::MessageDialog dlg(*m_main_window, "The Discord cache could not be created!", false, Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
         dlg.set_position(Gtk::WIN_POS_CENTER);
@@ -292,6 +351,7 @@ int Abaddon::StartGTK() {
 
     // crashes for some stupid reason if i put it somewhere else
     SetupUserMenu();
+    m_startup_trace.Add("create main window", start);
 
     m_main_window->signal_action_connect().connect(sigc::mem_fun(*this, &Abaddon::ActionConnect));
     m_main_window->signal_action_disconnect().connect(sigc::mem_fun(*this, &Abaddon::ActionDisconnect));
@@ -305,6 +365,7 @@ int Abaddon::StartGTK() {
 
     m_main_window->GetChannelList()->signal_action_channel_item_select().connect(sigc::bind(sigc::mem_fun(*this, &Abaddon::ActionChannelOpened), true));
     m_main_window->GetChannelList()->signal_action_guild_leave().connect(sigc::mem_fun(*this, &Abaddon::ActionLeaveGuild));
+    m_main_window->GetChannelList()->signal_channel_hovered().connect(sigc::mem_fun(m_prefetch, &ChannelPrefetcher::SetHovered));
     m_main_window->GetChannelList()->signal_action_guild_settings().connect(sigc::mem_fun(*this, &Abaddon::ActionGuildSettings));
 
 #ifdef WITH_VOICE
@@ -320,8 +381,10 @@ int Abaddon::StartGTK() {
     m_main_window->GetChatWindow()->signal_action_reaction_add().connect(sigc::mem_fun(*this, &Abaddon::ActionReactionAdd));
     m_main_window->GetChatWindow()->signal_action_reaction_remove().connect(sigc::mem_fun(*this, &Abaddon::ActionReactionRemove));
 
+    start = StartupTrace::clock::now();
     ActionReloadCSS();
     AttachCSSMonitor();
+    m_startup_trace.Add("load css", start);
 
     if (m_settings.GetSettings().HideToTray) {
         m_tray = Gtk::StatusIcon::create("discord");
@@ -365,11 +428,47 @@ int Abaddon::StartGTK() {
 
     RunFirstTimeDiscordStartup();
 
+    if (emojis_loaded.get()) {
+        // the pixbuf cache is main thread only so this cant go on the loading thread
+        const auto start = StartupTrace::clock::now();
+        m_emojis.WarmUp(GetStateCachePath("/emojis.json"));
+        m_startup_trace.Add("warm up emojis", start);
+    } else {
+        Gtk::MessageDialog dlg(*m_main_window, "The emoji file couldn't be loaded!", false, Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
+        dlg.set_position(Gtk::WIN_POS_CENTER);
+        dlg.run();
+    }
+
+    if (const auto threshold = m_settings.GetSettings().StallThreshold; threshold > 0)
+        m_watchdog.Start(std::chrono::milliseconds(threshold));
+
     return m_gtk_app->run(*m_main_window);
 }
 
+void Abaddon::StartHeadless() {
+    for (auto &conn : m_ui_connections)
+        conn.block();
+}
+
+int Abaddon::RunHeadlessReplay(const std::string &path) {
+    StartHeadless();
+
+    auto loop = Glib::MainLoop::create();
+    m_discord.signal_replay_finished().connect([&loop](const std::string &) {
+        loop->quit();
+    });
+    if (!m_discord.StartReplay(path, false)) return 1;
+    loop->run();
+    return 0;
+}
+
 void Abaddon::OnShutdown() {
+    m_watchdog.Stop();
+    if (const auto report = m_watchdog.GetReport(); !report.empty())
+        spdlog::get("ui")->info("Main loop stall report:\n{}", report);
+
     StopDiscord();
+    m_emojis.SaveWarmUp(GetStateCachePath("/emojis.json"));
     m_settings.Close();
 }
 
@@ -412,7 +511,13 @@ const DiscordClient &Abaddon::GetDiscordClient() const {
 
 void Abaddon::DiscordOnReady() {
     m_main_window->UpdateComponents();
-    LoadState();
+    // a replay has nothing to fetch with and shouldnt have http traffic in its numbers
+    if (!m_discord.IsReplaying()) {
+        LoadState();
+        m_backfill.Start();
+        m_prefetch.Start();
+    }
+    m_startup_trace.Finish();
 }
 
 void Abaddon::DiscordOnMessageCreate(const Message &message) {
@@ -456,6 +561,8 @@ void Abaddon::DiscordOnMessageSent(const Message &data) {
 }
 
 void Abaddon::DiscordOnDisconnect(bool is_reconnecting, GatewayCloseCode close_code) {
+    m_backfill.Stop();
+    m_prefetch.Stop();
     m_channels_history_loaded.clear();
     m_channels_history_loading.clear();
     m_channels_requested.clear();
@@ -485,6 +592,15 @@ void Abaddon::DiscordOnThreadUpdate(const ThreadUpdateData &data) {
     }
 }
 
+void Abaddon::DiscordOnReplayFinished(const std::string &report) {
+    m_main_window->UpdateMenus();
+
+    Gtk::MessageDialog dlg(*m_main_window, "Replay finished", false, Gtk::MESSAGE_INFO, Gtk::BUTTONS_OK, true);
+    dlg.set_secondary_text("<tt>" + Glib::Markup::escape_text(report) + "</tt>", true);
+    dlg.set_position(Gtk::WIN_POS_CENTER);
+    dlg.run();
+}
+
 #ifdef WITH_VOICE
 void Abaddon::OnVoiceConnected() {
     m_audio.StartCaptureDevice();
@@ -601,23 +717,51 @@ void Abaddon::ShowUserMenu(const GdkEvent *event, Snowflake id, Snowflake guild_
     m_user_menu->popup_at_pointer(event);
 }
 
+// records the time until the next gateway hello
+static void TraceGatewayConnect(DiscordClient &discord, StartupTrace &trace) {
+    const auto start = StartupTrace::clock::now();
+    auto conn = std::make_shared<sigc::connection>();
+    *conn = discord.signal_connected().connect([&trace, start, conn] {
+        trace.Add("connect to gateway", start);
+        conn->disconnect();
+    });
+}
+
 void Abaddon::RunFirstTimeDiscordStartup() {
-    DiscordStartupDialog dlg(*m_main_window);
-    dlg.set_position(Gtk::WIN_POS_CENTER);
+    auto start = StartupTrace::clock::now();
+    const auto cache = StartupCache::Load(GetSettings().StartupCacheTTL);
+    m_startup_trace.Add("load startup cache", start);
 
-    std::optional<std::string> cookie;
-    std::optional<uint32_t> build_number;
+    std::optional<std::string> cookie = cache.Cookie;
+    std::optional<uint32_t> build_number = cache.BuildNumber;
 
-    dlg.signal_response().connect([&](int response) {
-        if (response == Gtk::RESPONSE_OK) {
-            cookie = dlg.GetCookie();
-            build_number = dlg.GetBuildNumber();
+    const bool autoconnect = GetSettings().Autoconnect && !GetDiscordToken().empty();
+
+    if (!cookie.has_value() || !build_number.has_value()) {
+        // connect while the rest is fetched. the token isnt sent until we have a build number
+        if (autoconnect) {
+            m_discord.SetIdentifyHeld(true);
+            TraceGatewayConnect(m_discord, m_startup_trace);
+            StartDiscord();
         }
-    });
 
-    dlg.run();
+        DiscordStartupDialog dlg(*m_main_window, cache);
+        dlg.set_position(Gtk::WIN_POS_CENTER);
+
+        dlg.signal_response().connect([&](int response) {
+            if (response == Gtk::RESPONSE_OK) {
+                cookie = dlg.GetCookie();
+                build_number = dlg.GetBuildNumber();
+                dlg.GetCache().Save();
+            }
+        });
 
-    Glib::signal_idle().connect_once([this, cookie, build_number]() {
+        dlg.run();
+    } else {
+        spdlog::get("discord")->debug("Using cached cookies and build number {}", *build_number);
+    }
+
+    Glib::signal_idle().connect_once([this, cookie, build_number, autoconnect]() {
         if (cookie.has_value()) {
             m_discord.SetCookie(*cookie);
         } else {
@@ -637,8 +781,18 @@ void Abaddon::RunFirstTimeDiscordStartup() {
         }
 
         // autoconnect
-        if (cookie.has_value() && build_number.has_value() && GetSettings().Autoconnect && !GetDiscordToken().empty()) {
-            ActionConnect();
+        if (cookie.has_value() && build_number.has_value() && autoconnect) {
+            if (m_discord.IsStarted()) {
+                m_discord.SetIdentifyHeld(false);
+            } else {
+                TraceGatewayConnect(m_discord, m_startup_trace);
+                ActionConnect();
+            }
+        } else {
+            // the early connection wasnt allowed to identify so drop it
+            if (m_discord.IsStarted()) StopDiscord();
+            m_discord.SetIdentifyHeld(false);
+            m_startup_trace.Finish();
         }
     });
 }
@@ -837,6 +991,10 @@ Glib::RefPtr<Gtk::Application> Abaddon::GetApp() {
     return m_gtk_app;
 }
 
+MainWindow *Abaddon::GetMainWindow() {
+    return m_main_window.get();
+}
+
 bool Abaddon::IsMainWindowActive() {
     return m_main_window->has_toplevel_focus();
 }
@@ -882,7 +1040,20 @@ void Abaddon::ActionLoginQR() {
 #endif
 }
 
+// logs the time from selecting a channel to the first frame that has its messages in it
+static void LogChannelOpenLatency(Gtk::Widget *widget, Snowflake channel_id, const std::shared_ptr<Glib::Timer> &timer, const char *source) {
+    auto conn = std::make_shared<sigc::connection>();
+    *conn = widget->signal_draw().connect([conn, channel_id, timer, source](const Cairo::RefPtr<Cairo::Context> &) -> bool {
+        conn->disconnect();
+        spdlog::get("ui")->debug("Painted {} in {:.1f} ms ({})", channel_id, timer->elapsed() * 1000.0, source);
+        return false;
+    });
+    widget->queue_draw();
+}
+
 void Abaddon::ActionChannelOpened(Snowflake id, bool expand_to) {
+    const auto open_timer = std::make_shared<Glib::Timer>();
+
     if (!id.IsValid()) {
         m_discord.SetReferringChannel(Snowflake::Invalid);
         return;
@@ -903,19 +1074,28 @@ void Abaddon::ActionChannelOpened(Snowflake id, bool expand_to) {
 
     const bool can_access = channel->IsDM() || m_discord.HasChannelPermission(m_discord.GetUserData().ID, id, Permission::VIEW_CHANNEL);
 
+    m_prefetch.OnChannelOpened(id);
+
     m_main_window->set_title(std::string(APP_TITLE) + " - " + channel->GetDisplayName());
     m_main_window->UpdateChatActiveChannel(id, expand_to);
+
+    // show whatever the store already has, the first fetch gets merged in after
+    m_main_window->UpdateChatWindowContents();
+    const bool has_cached = m_main_window->GetChatOldestListedMessage().IsValid();
+    if (has_cached)
+        LogChannelOpenLatency(m_main_window->GetChatWindow()->GetRoot(), id, open_timer, m_main_window->GetChatWindow()->IsViewCached() ? "view" : "cached");
+
     if (m_channels_requested.find(id) == m_channels_requested.end()) {
         // dont fire requests we know will fail
         if (can_access) {
-            m_discord.FetchMessagesInChannel(id, [channel, this, id](const std::vector<Message> &msgs) {
+            m_discord.FetchMessagesInChannel(id, [channel, this, id, open_timer, has_cached](const std::vector<Message> &msgs) {
                 CheckMessagesForMembers(*channel, msgs);
-                m_main_window->UpdateChatWindowContents();
+                m_main_window->UpdateChatMergeMessages(id, msgs);
                 m_channels_requested.insert(id);
+                if (!has_cached && id == m_main_window->GetChatActiveChannel())
+                    LogChannelOpenLatency(m_main_window->GetChatWindow()->GetRoot(), id, open_timer, "fetched");
             });
         }
-    } else {
-        m_main_window->UpdateChatWindowContents();
     }
 
     if (can_access) {
@@ -1084,6 +1264,12 @@ void Abaddon::ActionViewThreads(Snowflake channel_id) {
     window->show();
 }
 
+void Abaddon::ActionViewMainLoopLatency() {
+    auto window = new MainLoopLatencyWindow;
+    ManageHeapWindow(window);
+    window->show();
+}
+
 #ifdef WITH_VOICE
 void Abaddon::ActionJoinVoiceChannel(Snowflake channel_id) {
     m_discord.ConnectToVoice(channel_id);
@@ -1121,14 +1307,38 @@ void Abaddon::ActionReloadCSS() {
     }
 }
 
+void Abaddon::ActionSavePerformanceTrace() {
+    const auto path = "./trace-" + Glib::DateTime::create_now_utc().format("%Y-%m-%d_%H-%M-%S") + ".json";
+    if (Trace::Save(path))
+        spdlog::get("ui")->info("Saved performance trace to {}", path);
+    else
+        spdlog::get("ui")->warn("Couldn't save a performance trace to {}, is tracing on?", path);
+}
+
 ImageManager &Abaddon::GetImageManager() {
     return m_img_mgr;
 }
 
+AnimationClock &Abaddon::GetAnimationClock() {
+    return m_animation_clock;
+}
+
 EmojiResource &Abaddon::GetEmojis() {
     return m_emojis;
 }
 
+StartupTrace &Abaddon::GetStartupTrace() {
+    return m_startup_trace;
+}
+
+HistoryBackfill &Abaddon::GetHistoryBackfill() {
+    return m_backfill;
+}
+
+MainLoopWatchdog &Abaddon::GetMainLoopWatchdog() {
+    return m_watchdog;
+}
+
 #ifdef WITH_VOICE
 AudioManager &Abaddon::GetAudio() {
     return m_audio;
@@ -1153,44 +1363,16 @@ void Abaddon::on_window_hide() {
     }
 }
 
-int main(int argc, char **argv) {
-    if (std::getenv("ABADDON_NO_FC") == nullptr) {
-        Platform::SetupFonts();
-    }
-
-    // windows doesnt have langinfo.h so some localization falls back to translation strings
-    // i dont like the default translation so this lets us use strftime
-
-#ifdef _WIN32
-    char *systemLocale = std::setlocale(LC_ALL, "");
-    try {
-        if (systemLocale != nullptr) {
-            std::locale::global(std::locale(systemLocale));
-        }
-    } catch (...) {
-        try {
-            std::locale::global(std::locale::classic());
-            if (systemLocale != nullptr) {
-                std::setlocale(LC_ALL, systemLocale);
-            }
-        } catch (...) {}
-    }
-#endif
-
-#if defined(_WIN32) && defined(_MSC_VER)
-    TCHAR buf[2] { 0 };
-    GetEnvironmentVariableA("GTK_CSD", buf, sizeof(buf));
-    if (buf[0] != '1')
-        SetEnvironmentVariableA("GTK_CSD", "0");
-#endif
-
+void Abaddon::InitLogging() {
     spdlog::cfg::load_env_levels();
-    auto log_ui = spdlog::stdout_color_mt("ui");
-    auto log_audio = spdlog::stdout_color_mt("audio");
-    auto log_voice = spdlog::stdout_color_mt("voice");
-    auto log_discord = spdlog::stdout_color_mt("discord");
-    auto log_ra = spdlog::stdout_color_mt("remote-auth");
-
-    Gtk::Main::init_gtkmm_internals(); // why???
-    return Abaddon::Get().StartGTK();
+    spdlog::stdout_color_mt("ui");
+    spdlog::stdout_color_mt("audio");
+    spdlog::stdout_color_mt("voice");
+    spdlog::stdout_color_mt("discord");
+    spdlog::stdout_color_mt("remote-auth");
+
+    Trace::SetThreadName("main");
+    if (std::getenv("ABADDON_TRACE") != nullptr) {
+        Trace::SetEnabled(true);
+    }
 }
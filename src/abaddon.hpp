@@ -3,6 +3,7 @@
 #include <mutex>
 #include <string>
 #include <unordered_set>
+#include <vector>
 #include <gtkmm/application.h>
 #include <gtkmm/cssprovider.h>
 #include <gtkmm/statusicon.h>
@@ -10,9 +11,14 @@
 #include "windows/mainwindow.hpp"
 #include "settings.hpp"
 #include "imgmanager.hpp"
+#include "animationclock.hpp"
 #include "emojis.hpp"
 #include "notifications/notifications.hpp"
 #include "audio/manager.hpp"
+#include "backfill.hpp"
+#include "prefetch.hpp"
+#include "startup.hpp"
+#include "watchdog.hpp"
 
 #define APP_TITLE "Abaddon"
 
@@ -25,6 +31,9 @@ private:
 public:
     static Abaddon &Get();
 
+    // the loggers and tracing, before anything else. main and the bench executables
+    static void InitLogging();
+
     Abaddon(const Abaddon &) = delete;
     Abaddon &operator=(const Abaddon &) = delete;
     Abaddon(Abaddon &&) = delete;
@@ -33,6 +42,11 @@ public:
     int StartGTK();
     void OnShutdown();
 
+    // no window, no display. blocks everything that would update the ui
+    void StartHeadless();
+    // replays a gateway recording as fast as possible, logs the report once its done
+    int RunHeadlessReplay(const std::string &path);
+
     void StartDiscord();
     void StopDiscord();
 
@@ -58,6 +72,7 @@ public:
     void ActionAddRecipient(Snowflake channel_id);
     void ActionViewPins(Snowflake channel_id);
     void ActionViewThreads(Snowflake channel_id);
+    void ActionViewMainLoopLatency();
 
 #ifdef WITH_VOICE
     void ActionJoinVoiceChannel(Snowflake channel_id);
@@ -68,9 +83,13 @@ public:
     bool ShowConfirm(const Glib::ustring &prompt, Gtk::Window *window = nullptr);
 
     void ActionReloadCSS();
+    void ActionSavePerformanceTrace();
 
     ImageManager &GetImageManager();
+    AnimationClock &GetAnimationClock();
     EmojiResource &GetEmojis();
+    HistoryBackfill &GetHistoryBackfill();
+    MainLoopWatchdog &GetMainLoopWatchdog();
 
 #ifdef WITH_VOICE
     AudioManager &GetAudio();
@@ -93,6 +112,7 @@ public:
     void DiscordOnMessageSent(const Message &data);
     void DiscordOnDisconnect(bool is_reconnecting, GatewayCloseCode close_code);
     void DiscordOnThreadUpdate(const ThreadUpdateData &data);
+    void DiscordOnReplayFinished(const std::string &report);
 
 #ifdef WITH_VOICE
     void OnVoiceConnected();
@@ -117,9 +137,12 @@ public:
     static std::string GetStateCachePath(const std::string &path);
 
     [[nodiscard]] Glib::RefPtr<Gtk::Application> GetApp();
+    [[nodiscard]] MainWindow *GetMainWindow();
     [[nodiscard]] bool IsMainWindowActive();
     [[nodiscard]] Snowflake GetActiveChannelID() const noexcept;
 
+    StartupTrace &GetStartupTrace();
+
 protected:
     void RunFirstTimeDiscordStartup();
 
@@ -162,6 +185,7 @@ protected:
     void on_window_hide();
 
 private:
+    StartupTrace m_startup_trace; // first so it starts timing before settings are loaded
     SettingsManager m_settings;
 
     DiscordClient m_discord;
@@ -172,7 +196,11 @@ private:
     std::unordered_set<Snowflake> m_channels_history_loading;
 
     ImageManager m_img_mgr;
+    AnimationClock m_animation_clock;
     EmojiResource m_emojis;
+    HistoryBackfill m_backfill;
+    ChannelPrefetcher m_prefetch;
+    MainLoopWatchdog m_watchdog;
 
 #ifdef WITH_VOICE
     AudioManager m_audio;
@@ -184,6 +212,7 @@ private:
     Glib::RefPtr<Gtk::CssProvider> m_css_provider;
     Glib::RefPtr<Gtk::StatusIcon> m_tray;
     std::unique_ptr<MainWindow> m_main_window; // wah wah cant create a gtkstylecontext fuck you
+    std::vector<sigc::connection> m_ui_connections; // client signals handled by the ui, blocked when headless
 
     Notifications m_notifications;
 };
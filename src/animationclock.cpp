@@ -0,0 +1,140 @@
+#include "animationclock.hpp"
+
+#include <algorithm>
+
+#include <glibmm/main.h>
+#include <gtkmm/treeview.h>
+#include <gtkmm/widget.h>
+#include <gtkmm/window.h>
+
+#include "abaddon.hpp"
+
+constexpr static unsigned TickInterval = 20;  // ms. gifs can't go faster than this anyways
+constexpr static int MaxIdleTicks = 250;      // forget about animations that haven't been drawn in ~5 seconds
+
+AnimationClock::~AnimationClock() {
+    m_timer.disconnect();
+    for (auto &[widget, conn] : m_widgets)
+        conn.disconnect();
+}
+
+Glib::RefPtr<Gdk::Pixbuf> AnimationClock::GetFrame(const Glib::RefPtr<Gdk::PixbufAnimation> &anim, Gtk::Widget &widget, const Gdk::Rectangle &area) {
+    auto &state = m_animations[anim->gobj()];
+    if (!state.Anim) {
+        state.Anim = anim;
+        state.LastAdvance = std::chrono::steady_clock::now();
+    }
+    if (!state.Frames) {
+        // switching over once decoded starts it from the top
+        if ((state.Frames = Abaddon::Get().GetImageManager().GetAnimationFrames(anim))) {
+            state.Iter.reset();
+            state.Frame = 0;
+            state.Position = 0;
+        } else if (!state.Iter) {
+            state.Iter = anim->get_iter(nullptr);
+        }
+    }
+    state.IdleTicks = 0;
+
+    const auto same_target = [&widget, &area](const Target &t) {
+        return t.Widget == &widget && t.Area == area;
+    };
+    if (std::find_if(state.Targets.begin(), state.Targets.end(), same_target) == state.Targets.end())
+        state.Targets.push_back({ &widget, area });
+
+    // the slot never runs, its only there so the connection drops when the widget is destroyed
+    if (auto it = m_widgets.find(&widget); it == m_widgets.end() || !it->second.connected())
+        m_widgets[&widget] = widget.signal_unrealize().connect(sigc::track_obj([] {}, widget));
+
+    if (!m_timer.connected())
+        m_timer = Glib::signal_timeout().connect(sigc::mem_fun(*this, &AnimationClock::OnTick), TickInterval);
+
+    if (state.Frames)
+        return state.Frames->Frames[state.Frame].Pixbuf;
+    return state.Iter->get_pixbuf();
+}
+
+void AnimationClock::Reset(const Glib::RefPtr<Gdk::PixbufAnimation> &anim) {
+    m_animations.erase(anim->gobj());
+}
+
+// cell renderers get bin window coordinates
+void AnimationClock::QueueDraw(Gtk::Widget &widget, const Gdk::Rectangle &area) {
+    int x = area.get_x();
+    int y = area.get_y();
+    if (auto *tree = dynamic_cast<Gtk::TreeView *>(&widget))
+        tree->convert_bin_window_to_widget_coords(area.get_x(), area.get_y(), x, y);
+    widget.queue_draw_area(x, y, area.get_width(), area.get_height());
+}
+
+// true if the frame changed
+bool AnimationClock::Advance(Animation &state, std::chrono::steady_clock::time_point now) {
+    const int elapsed = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - state.LastAdvance).count());
+    state.LastAdvance = now;
+
+    if (!state.Frames) return state.Iter->advance();
+
+    const auto &frames = *state.Frames;
+    if (frames.Frames.size() < 2 || frames.Duration <= 0) return false;
+
+    const size_t old_frame = state.Frame;
+    state.Position += frames.Loops ? elapsed % frames.Duration : elapsed;
+    while (state.Position >= frames.Frames[state.Frame].Delay) {
+        if (!frames.Loops && state.Frame + 1 == frames.Frames.size()) break;
+        state.Position -= frames.Frames[state.Frame].Delay;
+        state.Frame = (state.Frame + 1) % frames.Frames.size();
+    }
+    return state.Frame != old_frame;
+}
+
+bool AnimationClock::OnTick() {
+    for (auto it = m_widgets.begin(); it != m_widgets.end();) {
+        if (it->second.connected())
+            it++;
+        else
+            it = m_widgets.erase(it);
+    }
+
+    const auto is_live = [this](const Target &t) {
+        return m_widgets.find(t.Widget) != m_widgets.end();
+    };
+    const auto is_focused = [](const Target &t) {
+        const auto *window = dynamic_cast<const Gtk::Window *>(t.Widget->get_toplevel());
+        return window != nullptr && window->is_active();
+    };
+
+    const auto now = std::chrono::steady_clock::now();
+    const int unfocused_fps = Abaddon::Get().GetSettings().AnimationUnfocusedFPS;
+    const auto unfocused_interval = std::chrono::milliseconds(1000 / std::max(unfocused_fps, 1));
+
+    for (auto it = m_animations.begin(); it != m_animations.end();) {
+        auto &state = it->second;
+        state.Targets.erase(std::remove_if(state.Targets.begin(), state.Targets.end(), [&is_live](const Target &t) { return !is_live(t); }), state.Targets.end());
+
+        if (state.Targets.empty()) {
+            if (++state.IdleTicks > MaxIdleTicks) {
+                it = m_animations.erase(it);
+                continue;
+            }
+            it++;
+            continue;
+        }
+
+        // unfocused windows are frozen or slowed down depending on settings
+        bool can_advance = std::any_of(state.Targets.begin(), state.Targets.end(), is_focused);
+        if (!can_advance && unfocused_fps <= 0)
+            state.LastAdvance = now;
+        else if (!can_advance)
+            can_advance = now - state.LastAdvance >= unfocused_interval;
+
+        if (can_advance && Advance(state, now)) {
+            // redrawing puts back whatever is still visible
+            for (const auto &target : state.Targets)
+                QueueDraw(*target.Widget, target.Area);
+            state.Targets.clear();
+        }
+        it++;
+    }
+
+    return !m_animations.empty();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <gdkmm/pixbufanimation.h>
+#include <gdkmm/rectangle.h>
+#include <sigc++/connection.h>
+
+namespace Gtk {
+class Widget;
+} // namespace Gtk
+
+struct AnimationFrames;
+
+// one timer that drives every animation on screen instead of a timeout per cell per frame
+// an animation only advances while something draws it, so anything scrolled away or in an unfocused window stops on its own
+// every place showing the same animation object shares one position
+// plays from ImageManager's pre-decoded frames when it has them and from the animation itself otherwise
+class AnimationClock {
+public:
+    AnimationClock() = default;
+    ~AnimationClock();
+
+    // call from a draw handler. returns the current frame and redraws area of widget when it changes
+    Glib::RefPtr<Gdk::Pixbuf> GetFrame(const Glib::RefPtr<Gdk::PixbufAnimation> &anim, Gtk::Widget &widget, const Gdk::Rectangle &area);
+    // starts the animation over from the first frame
+    void Reset(const Glib::RefPtr<Gdk::PixbufAnimation> &anim);
+
+private:
+    bool OnTick();
+    struct Animation;
+    static bool Advance(Animation &state, std::chrono::steady_clock::time_point now);
+    static void QueueDraw(Gtk::Widget &widget, const Gdk::Rectangle &area);
+
+    struct Target {
+        Gtk::Widget *Widget;
+        Gdk::Rectangle Area;
+    };
+
+    struct Animation {
+        Glib::RefPtr<Gdk::PixbufAnimation> Anim;
+        Glib::RefPtr<Gdk::PixbufAnimationIter> Iter; // only without frames
+        std::shared_ptr<const AnimationFrames> Frames;
+        size_t Frame = 0;
+        int Position = 0; // ms into Frame
+        std::chrono::steady_clock::time_point LastAdvance;
+        std::vector<Target> Targets; // drawn since the last frame change
+        int IdleTicks = 0;
+    };
+
+    std::unordered_map<GdkPixbufAnimation *, Animation> m_animations;
+    std::unordered_map<Gtk::Widget *, sigc::connection> m_widgets; // disconnected once the widget is gone
+
+    sigc::connection m_timer;
+};
@@ -0,0 +1,334 @@
+#ifdef WITH_VOICE
+// clang-format off
+
+#include "capturechain.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <miniaudio.h>
+#include <spdlog/fmt/bundled/format.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define CAPTURE_CHAIN_SSE2
+    #include <emmintrin.h>
+#endif
+
+// clang-format on
+
+constexpr static float HighPassCutoff = 80.0F; // hz
+constexpr static float LimiterCeiling = 32767.0F * 0.89F; // about -1 dBFS
+constexpr static float LimiterRelease = 0.05F;            // fraction of the way back to unity per frame
+constexpr static float GateDecay = 150.0F / 32768.0F;     // per frame
+constexpr static float VADDecay = 0.0125F;                // per frame
+constexpr static double TimingSmoothing = 0.02;
+
+// the kernels. fixed size so the scalar versions vectorize fine on their own where theres no sse2
+static_assert(CaptureChain::FrameSize % 4 == 0);
+
+namespace {
+void Deinterleave(const int16_t *in, float *left, float *right) {
+#ifdef CAPTURE_CHAIN_SSE2
+    for (size_t i = 0; i < CaptureChain::FrameSize; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2));
+        const __m128i l = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+        const __m128i r = _mm_srai_epi32(v, 16);
+        _mm_storeu_ps(left + i, _mm_cvtepi32_ps(l));
+        _mm_storeu_ps(right + i, _mm_cvtepi32_ps(r));
+    }
+#else
+    for (size_t i = 0; i < CaptureChain::FrameSize; i++) {
+        left[i] = static_cast<float>(in[i * 2]);
+        right[i] = static_cast<float>(in[i * 2 + 1]);
+    }
+#endif
+}
+
+void Interleave(const float *left, const float *right, int16_t *out) {
+#ifdef CAPTURE_CHAIN_SSE2
+    const __m128 lo = _mm_set1_ps(-32768.0F);
+    const __m128 hi = _mm_set1_ps(32767.0F);
+    for (size_t i = 0; i < CaptureChain::FrameSize; i += 4) {
+        const __m128i l = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(left + i), lo), hi));
+        const __m128i r = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(right + i), lo), hi));
+        const __m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), packed);
+    }
+#else
+    for (size_t i = 0; i < CaptureChain::FrameSize; i++) {
+        out[i * 2] = static_cast<int16_t>(std::clamp(left[i], -32768.0F, 32767.0F));
+        out[i * 2 + 1] = static_cast<int16_t>(std::clamp(right[i], -32768.0F, 32767.0F));
+    }
+#endif
+}
+
+void Scale(float *x, float gain) {
+#ifdef CAPTURE_CHAIN_SSE2
+    const __m128 g = _mm_set1_ps(gain);
+    for (size_t i = 0; i < CaptureChain::FrameSize; i += 4)
+        _mm_storeu_ps(x + i, _mm_mul_ps(_mm_loadu_ps(x + i), g));
+#else
+    for (size_t i = 0; i < CaptureChain::FrameSize; i++)
+        x[i] *= gain;
+#endif
+}
+
+// gain goes linearly from start to end over the frame so changes dont click
+void Ramp(float *x, float start, float end) {
+    const float step = (end - start) / static_cast<float>(CaptureChain::FrameSize);
+#ifdef CAPTURE_CHAIN_SSE2
+    __m128 g = _mm_setr_ps(start, start + step, start + step * 2.0F, start + step * 3.0F);
+    const __m128 inc = _mm_set1_ps(step * 4.0F);
+    for (size_t i = 0; i < CaptureChain::FrameSize; i += 4) {
+        _mm_storeu_ps(x + i, _mm_mul_ps(_mm_loadu_ps(x + i), g));
+        g = _mm_add_ps(g, inc);
+    }
+#else
+    for (size_t i = 0; i < CaptureChain::FrameSize; i++)
+        x[i] *= start + step * static_cast<float>(i);
+#endif
+}
+
+void MixMono(float *left, float *right) {
+#ifdef CAPTURE_CHAIN_SSE2
+    const __m128 half = _mm_set1_ps(0.5F);
+    for (size_t i = 0; i < CaptureChain::FrameSize; i += 4) {
+        const __m128 m = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(left + i), _mm_loadu_ps(right + i)), half);
+        _mm_storeu_ps(left + i, m);
+        _mm_storeu_ps(right + i, m);
+    }
+#else
+    for (size_t i = 0; i < CaptureChain::FrameSize; i++) {
+        const float m = (left[i] + right[i]) * 0.5F;
+        left[i] = m;
+        right[i] = m;
+    }
+#endif
+}
+
+float Peak(const float *x) {
+    float peak = 0.0F;
+#ifdef CAPTURE_CHAIN_SSE2
+    const __m128 sign = _mm_set1_ps(-0.0F);
+    __m128 acc = _mm_setzero_ps();
+    for (size_t i = 0; i < CaptureChain::FrameSize; i += 4)
+        acc = _mm_max_ps(acc, _mm_andnot_ps(sign, _mm_loadu_ps(x + i)));
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#else
+    for (size_t i = 0; i < CaptureChain::FrameSize; i++)
+        peak = std::max(peak, std::fabs(x[i]));
+#endif
+    return peak;
+}
+} // namespace
+
+// recursive so this one stays scalar
+void CaptureChain::Biquad::Process(float *x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const float in = x[i];
+        const float out = B0 * in + Z1;
+        Z1 = B1 * in - A1 * out + Z2;
+        Z2 = B2 * in - A2 * out;
+        x[i] = out;
+    }
+}
+
+const char *CaptureChain::GetStageName(Stage stage) {
+    switch (stage) {
+        case StageGain:
+            return "Gain";
+        case StageHighPass:
+            return "High-pass";
+        case StageMixdown:
+            return "Mixdown";
+        case StageVAD:
+            return "VAD";
+        case StageDenoise:
+            return "Denoise";
+        case StageLimiter:
+            return "Limiter";
+        default:
+            return "?";
+    }
+}
+
+CaptureChain::CaptureChain() {
+    // butterworth, rbj cookbook
+    const float w0 = 2.0F * static_cast<float>(M_PI) * HighPassCutoff / 48000.0F;
+    const float alpha = std::sin(w0) / (2.0F * std::sqrt(0.5F));
+    const float cos_w0 = std::cos(w0);
+    const float a0 = 1.0F + alpha;
+    for (auto &filter : m_highpass) {
+        filter.B0 = ((1.0F + cos_w0) / 2.0F) / a0;
+        filter.B1 = -(1.0F + cos_w0) / a0;
+        filter.B2 = ((1.0F + cos_w0) / 2.0F) / a0;
+        filter.A1 = (-2.0F * cos_w0) / a0;
+        filter.A2 = (1.0F - alpha) / a0;
+    }
+
+#ifdef WITH_RNNOISE
+    m_rnnoise[0] = rnnoise_create(nullptr);
+    m_rnnoise[1] = rnnoise_create(nullptr);
+#endif
+
+    for (auto &timing : m_timings)
+        timing.store(0.0);
+}
+
+CaptureChain::~CaptureChain() {
+#ifdef WITH_RNNOISE
+    rnnoise_destroy(m_rnnoise[0]);
+    rnnoise_destroy(m_rnnoise[1]);
+#endif
+}
+
+CaptureChain::Result CaptureChain::Process(const int16_t *in, int16_t *out, const Params &params) {
+    using clock = std::chrono::steady_clock;
+    auto last = clock::now();
+    const auto lap = [this, &last](Stage stage) {
+        const auto now = clock::now();
+        const double us = std::chrono::duration<double, std::micro>(now - last).count();
+        last = now;
+        m_last_timings[stage] = us;
+        const double prev = m_timings[stage].load(std::memory_order_relaxed);
+        m_timings[stage].store(prev + (us - prev) * TimingSmoothing, std::memory_order_relaxed);
+    };
+
+    Result result { false, 0.0F, 0.0F };
+
+    // conversion is counted as part of gain
+    Deinterleave(in, m_left.data(), m_right.data());
+    if (params.Gain != 1.0F) {
+        Scale(m_left.data(), params.Gain);
+        Scale(m_right.data(), params.Gain);
+    }
+    lap(StageGain);
+
+    if (params.HighPass) HighPass(m_left.data(), m_right.data());
+    lap(StageHighPass);
+
+    if (params.MixMono) MixMono(m_left.data(), m_right.data());
+    lap(StageMixdown);
+
+    result.Peak = std::min(Peak(m_left.data()), 32768.0F) / 32768.0F;
+    m_gate_envelope = std::max(m_gate_envelope - GateDecay, result.Peak);
+
+#ifdef WITH_RNNOISE
+    // vad runs on the left channel, and the right one only needs denoising if it'll actually be used
+    if (params.UseRNNoiseVAD || params.SuppressNoise) {
+        result.VADProbability = rnnoise_process_frame(m_rnnoise[0], m_denoised_left.data(), m_left.data());
+        m_vad_envelope = std::max(m_vad_envelope - VADDecay, result.VADProbability);
+    }
+#endif
+
+    if (params.UseRNNoiseVAD)
+        result.Transmit = m_vad_envelope > params.ProbThreshold;
+    else
+        result.Transmit = m_gate_envelope > params.Gate;
+    lap(StageVAD);
+
+    bool denoised = false;
+#ifdef WITH_RNNOISE
+    if (params.SuppressNoise) {
+        rnnoise_process_frame(m_rnnoise[1], m_denoised_right.data(), m_right.data());
+        denoised = true;
+    }
+#endif
+    lap(StageDenoise);
+
+    if (!result.Transmit) return result;
+
+    float *left = denoised ? m_denoised_left.data() : m_left.data();
+    float *right = denoised ? m_denoised_right.data() : m_right.data();
+    Limit(left, right);
+    Interleave(left, right, out);
+    lap(StageLimiter);
+
+    return result;
+}
+
+void CaptureChain::HighPass(float *left, float *right) {
+    m_highpass[0].Process(left, FrameSize);
+    m_highpass[1].Process(right, FrameSize);
+}
+
+// per frame gain, instant attack and a slow release that's ramped across the frame
+void CaptureChain::Limit(float *left, float *right) {
+    const float peak = std::max(Peak(left), Peak(right));
+    float target = m_limiter_gain + (1.0F - m_limiter_gain) * LimiterRelease;
+    if (peak * target > LimiterCeiling)
+        target = LimiterCeiling / peak;
+
+    if (target < m_limiter_gain) {
+        Scale(left, target);
+        Scale(right, target);
+    } else if (m_limiter_gain < 1.0F) {
+        Ramp(left, m_limiter_gain, target);
+        Ramp(right, m_limiter_gain, target);
+    }
+    m_limiter_gain = target;
+}
+
+std::array<double, CaptureChain::StageCount> CaptureChain::GetStageTimings() const {
+    std::array<double, StageCount> ret;
+    for (size_t i = 0; i < StageCount; i++)
+        ret[i] = m_timings[i].load(std::memory_order_relaxed);
+    return ret;
+}
+
+double CaptureChain::BenchmarkResult::GetRealtimeFactor() const {
+    const double audio_seconds = static_cast<double>(Frames * FrameSize) / 48000.0;
+    return Seconds > 0.0 ? audio_seconds / Seconds : 0.0;
+}
+
+std::string CaptureChain::BenchmarkResult::ToString() const {
+    std::string text = fmt::format("{} frames in {:.3f}s ({:.0f}x realtime), {} transmitted", Frames, Seconds, GetRealtimeFactor(), Transmitted);
+    for (size_t i = 0; i < StageCount; i++) {
+        text += fmt::format("\n{}: {:.2f} µs", GetStageName(static_cast<Stage>(i)), StageMicroseconds[i]);
+    }
+    return text;
+}
+
+std::optional<CaptureChain::BenchmarkResult> CaptureChain::BenchmarkFile(const std::string &path, const Params &params) {
+    auto config = ma_decoder_config_init(ma_format_s16, 2, 48000);
+    ma_decoder decoder;
+    if (ma_decoder_init_file(path.c_str(), &config, &decoder) != MA_SUCCESS) return std::nullopt;
+
+    std::vector<int16_t> pcm;
+    std::array<int16_t, FrameSize * 2> frame;
+    for (;;) {
+        ma_uint64 read = 0;
+        if (ma_decoder_read_pcm_frames(&decoder, frame.data(), FrameSize, &read) != MA_SUCCESS || read < FrameSize) break;
+        pcm.insert(pcm.end(), frame.begin(), frame.end());
+    }
+    ma_decoder_uninit(&decoder);
+
+    // decoding isnt part of the measurement
+    BenchmarkResult result;
+    CaptureChain chain;
+    std::array<int16_t, FrameSize * 2> out;
+    std::array<double, StageCount> totals {};
+
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    for (size_t offset = 0; offset + FrameSize * 2 <= pcm.size(); offset += FrameSize * 2) {
+        chain.m_last_timings.fill(0.0); // stages after a failed vad dont run
+        if (chain.Process(pcm.data() + offset, out.data(), params).Transmit)
+            result.Transmitted++;
+        for (size_t i = 0; i < StageCount; i++)
+            totals[i] += chain.m_last_timings[i];
+        result.Frames++;
+    }
+    result.Seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    if (result.Frames > 0) {
+        for (size_t i = 0; i < StageCount; i++)
+            result.StageMicroseconds[i] = totals[i] / static_cast<double>(result.Frames);
+    }
+
+    return result;
+}
+
+#endif
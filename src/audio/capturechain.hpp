@@ -0,0 +1,110 @@
+#pragma once
+#ifdef WITH_VOICE
+// clang-format off
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#ifdef WITH_RNNOISE
+#include <rnnoise.h>
+#endif
+
+// clang-format on
+
+// capture side processing for one 10ms stereo frame at a time: gain, high-pass, mixdown, vad, denoise, limiter
+// all buffers live in the object so processing a frame never allocates. one chain per stream, they share nothing
+class CaptureChain {
+public:
+    static constexpr size_t FrameSize = 480; // per channel
+
+    enum Stage {
+        StageGain,
+        StageHighPass,
+        StageMixdown,
+        StageVAD,
+        StageDenoise,
+        StageLimiter,
+        StageCount,
+    };
+
+    static const char *GetStageName(Stage stage);
+
+    struct Params {
+        float Gain = 1.0F;
+        bool HighPass = false;
+        bool MixMono = false;
+        bool UseRNNoiseVAD = false;
+        float Gate = 0.0F;
+        float ProbThreshold = 0.5F;
+        bool SuppressNoise = false;
+    };
+
+    struct Result {
+        bool Transmit;        // passed vad, out is filled
+        float Peak;           // 0-1, left channel before the limiter
+        float VADProbability; // this frame only. 0 without rnnoise
+    };
+
+    CaptureChain();
+    ~CaptureChain();
+
+    CaptureChain(const CaptureChain &) = delete;
+    CaptureChain &operator=(const CaptureChain &) = delete;
+
+    // in and out are FrameSize interleaved stereo frames
+    Result Process(const int16_t *in, int16_t *out, const Params &params);
+
+    // moving average of each stage in microseconds per frame. safe to read from any thread
+    std::array<double, StageCount> GetStageTimings() const;
+
+    struct BenchmarkResult {
+        size_t Frames = 0;
+        size_t Transmitted = 0;
+        double Seconds = 0.0; // wall time for the whole file
+        std::array<double, StageCount> StageMicroseconds {}; // mean per frame
+
+        [[nodiscard]] double GetRealtimeFactor() const;
+        // one line per stage
+        [[nodiscard]] std::string ToString() const;
+    };
+
+    // runs a file (anything miniaudio can decode) through a fresh chain as fast as possible
+    static std::optional<BenchmarkResult> BenchmarkFile(const std::string &path, const Params &params);
+
+private:
+    struct Biquad {
+        float B0, B1, B2, A1, A2;
+        float Z1 = 0.0F;
+        float Z2 = 0.0F;
+
+        void Process(float *x, size_t n);
+    };
+
+    void HighPass(float *left, float *right);
+    void Limit(float *left, float *right);
+
+    // 32 byte aligned so the kernels can use aligned loads if they want to
+    alignas(32) std::array<float, FrameSize> m_left;
+    alignas(32) std::array<float, FrameSize> m_right;
+    alignas(32) std::array<float, FrameSize> m_denoised_left;
+    alignas(32) std::array<float, FrameSize> m_denoised_right;
+
+    Biquad m_highpass[2];
+    float m_limiter_gain = 1.0F;
+
+    // held so short dips between words dont cut out
+    float m_gate_envelope = 0.0F;
+    float m_vad_envelope = 0.0F;
+
+#ifdef WITH_RNNOISE
+    DenoiseState *m_rnnoise[2];
+#endif
+
+    std::array<std::atomic<double>, StageCount> m_timings;
+    std::array<double, StageCount> m_last_timings {}; // unsmoothed, for the benchmark
+};
+
+#endif
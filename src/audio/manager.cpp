@@ -7,6 +7,7 @@
 
 #include "manager.hpp"
 #include "abaddon.hpp"
+#include <algorithm>
 #include <array>
 #include <glibmm/main.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
@@ -20,6 +21,9 @@ void data_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uin
     if (mgr == nullptr) return;
     std::lock_guard<std::mutex> _(mgr->m_mutex);
 
+    const auto start = std::chrono::steady_clock::now();
+    auto &stats = mgr->m_playback_stats;
+
     auto *pOutputF32 = static_cast<float *>(pOutput);
     for (auto &[ssrc, pair] : mgr->m_sources) {
         double volume = 1.0;
@@ -27,12 +31,23 @@ void data_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uin
             volume = vol_it->second;
         }
         auto &buf = pair.first;
-        const size_t n = std::min(static_cast<size_t>(buf.size()), static_cast<size_t>(frameCount * 2ULL));
+        const size_t want = frameCount * 2ULL;
+        if (mgr->m_fed_ssrcs.find(ssrc) != mgr->m_fed_ssrcs.end()) {
+            const double buffered_ms = static_cast<double>(buf.size()) / 2.0 / 48.0;
+            stats.LatencyTotalMs += buffered_ms;
+            stats.LatencyMaxMs = std::max(stats.LatencyMaxMs, buffered_ms);
+            stats.LatencySamples++;
+            if (buf.size() < want) stats.Underruns++;
+        }
+        const size_t n = std::min(static_cast<size_t>(buf.size()), want);
         for (size_t i = 0; i < n; i++) {
             pOutputF32[i] += volume * buf[i] / 32768.F;
         }
         buf.erase(buf.begin(), buf.begin() + n);
     }
+
+    stats.Mixes++;
+    stats.MixTime += std::chrono::steady_clock::now() - start;
 }
 
 void capture_data_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount) {
@@ -82,10 +97,6 @@ AudioManager::AudioManager(const Glib::ustring &backends_string)
     ma_log_init(nullptr, &m_ma_log);
     ma_log_register_callback(&m_ma_log, ma_log_callback_init(mgr_log_callback, m_log.get()));
 
-#ifdef WITH_RNNOISE
-    RNNoiseInitialize();
-#endif
-
     int err;
     m_encoder = opus_encoder_create(48000, 2, OPUS_APPLICATION_VOIP, &err);
     if (err != OPUS_OK) {
@@ -180,10 +191,6 @@ AudioManager::~AudioManager() {
     ma_device_uninit(&m_capture_device);
     ma_context_uninit(&m_context);
     RemoveAllSSRCs();
-
-#ifdef WITH_RNNOISE
-    RNNoiseUninitialize();
-#endif
 }
 
 void AudioManager::AddSSRC(uint32_t ssrc) {
@@ -201,6 +208,7 @@ void AudioManager::RemoveSSRC(uint32_t ssrc) {
         opus_decoder_destroy(it->second.second);
         m_sources.erase(it);
     }
+    m_fed_ssrcs.erase(ssrc);
 }
 
 void AudioManager::RemoveAllSSRCs() {
@@ -210,6 +218,7 @@ void AudioManager::RemoveAllSSRCs() {
         opus_decoder_destroy(pair.second);
     }
     m_sources.clear();
+    m_fed_ssrcs.clear();
 }
 
 void AudioManager::SetOpusBuffer(uint8_t *ptr) {
@@ -224,9 +233,14 @@ void AudioManager::FeedMeOpus(uint32_t ssrc, const std::vector<uint8_t> &data) {
 
     static std::array<opus_int16, 120 * 48 * 2> pcm;
     if (auto it = m_sources.find(ssrc); it != m_sources.end()) {
+        const auto start = std::chrono::steady_clock::now();
         int decoded = opus_decode(it->second.second, data.data(), static_cast<opus_int32>(data.size()), pcm.data(), 120 * 48, 0);
+        m_playback_stats.DecodeTime += std::chrono::steady_clock::now() - start;
         if (decoded <= 0) {
+            m_playback_stats.Failed++;
         } else {
+            m_playback_stats.Decoded++;
+            m_fed_ssrcs.insert(ssrc);
             UpdateReceiveVolume(ssrc, pcm.data(), decoded);
             auto &buf = it->second.first;
             buf.insert(buf.end(), pcm.begin(), pcm.begin() + decoded * 2);
@@ -234,6 +248,16 @@ void AudioManager::FeedMeOpus(uint32_t ssrc, const std::vector<uint8_t> &data) {
     }
 }
 
+AudioManager::PlaybackStats AudioManager::GetPlaybackStats() const {
+    std::lock_guard<std::mutex> _(m_mutex);
+    return m_playback_stats;
+}
+
+void AudioManager::ResetPlaybackStats() {
+    std::lock_guard<std::mutex> _(m_mutex);
+    m_playback_stats = {};
+}
+
 void AudioManager::StartCaptureDevice() {
     if (ma_device_start(&m_capture_device) != MA_SUCCESS) {
         spdlog::get("audio")->error("Failed to start capture device");
@@ -447,65 +471,21 @@ void AudioManager::Enumerate() {
 
 void AudioManager::OnCapturedPCM(const int16_t *pcm, ma_uint32 frames) {
     if (m_opus_buffer == nullptr || !m_should_capture) return;
+    // the device is configured for 10ms periods
+    if (frames < CaptureChain::FrameSize) return;
 
-    const double gain = m_capture_gain;
+    const auto result = m_capture_chain.Process(pcm, m_capture_out.data(), GetCaptureParams());
 
-    std::vector<int16_t> new_pcm(pcm, pcm + frames * 2);
-    for (auto &val : new_pcm) {
-        const int32_t unclamped = static_cast<int32_t>(val * gain);
-        val = std::clamp(unclamped, INT16_MIN, INT16_MAX);
-    }
+    const int amp = static_cast<int>(result.Peak * 32768.0F);
+    m_capture_peak_meter = std::max(m_capture_peak_meter.load(std::memory_order_relaxed), amp);
+    m_vad_prob = std::max(m_vad_prob.load(), result.VADProbability);
 
-    if (m_mix_mono) {
-        for (size_t i = 0; i < frames * 2; i += 2) {
-            const int sample_L = new_pcm[i];
-            const int sample_R = new_pcm[i + 1];
-            const int16_t mixed = static_cast<int16_t>((sample_L + sample_R) / 2);
-            new_pcm[i] = mixed;
-            new_pcm[i + 1] = mixed;
-        }
-    }
-
-    UpdateCaptureVolume(new_pcm.data(), frames);
-
-    static std::array<float, 480> denoised_L;
-    static std::array<float, 480> denoised_R;
-
-    bool m_rnnoise_passed = false;
-#ifdef WITH_RNNOISE
-    if (m_vad_method == VADMethod::RNNoise || m_enable_noise_suppression) {
-        m_rnnoise_passed = CheckVADRNNoise(new_pcm.data(), denoised_L.data(), denoised_R.data());
-    }
-#endif
-
-    switch (m_vad_method) {
-        case VADMethod::Gate:
-            if (!CheckVADVoiceGate()) return;
-            break;
-#ifdef WITH_RNNOISE
-        case VADMethod::RNNoise:
-            if (!m_rnnoise_passed) return;
-            break;
-#endif
-    }
+    if (!result.Transmit) return;
 
     m_enc_mutex.lock();
-    int payload_len = -1;
-
-    if (m_enable_noise_suppression) {
-        static std::array<int16_t, 960> denoised_interleaved;
-        for (size_t i = 0; i < 480; i++) {
-            denoised_interleaved[i * 2] = static_cast<int16_t>(denoised_L[i]);
-        }
-        for (size_t i = 0; i < 480; i++) {
-            denoised_interleaved[i * 2 + 1] = static_cast<int16_t>(denoised_R[i]);
-        }
-        payload_len = opus_encode(m_encoder, denoised_interleaved.data(), 480, static_cast<unsigned char *>(m_opus_buffer), 1275);
-    } else {
-        payload_len = opus_encode(m_encoder, new_pcm.data(), 480, static_cast<unsigned char *>(m_opus_buffer), 1275);
-    }
-
+    const int payload_len = opus_encode(m_encoder, m_capture_out.data(), CaptureChain::FrameSize, static_cast<unsigned char *>(m_opus_buffer), 1275);
     m_enc_mutex.unlock();
+
     if (payload_len < 0) {
         spdlog::get("audio")->error("encoding error: {}", payload_len);
     } else {
@@ -523,13 +503,6 @@ void AudioManager::UpdateReceiveVolume(uint32_t ssrc, const int16_t *pcm, int fr
     }
 }
 
-void AudioManager::UpdateCaptureVolume(const int16_t *pcm, ma_uint32 frames) {
-    for (ma_uint32 i = 0; i < frames * 2; i += 2) {
-        const int amp = std::abs(pcm[i]);
-        m_capture_peak_meter = std::max(m_capture_peak_meter.load(std::memory_order_relaxed), amp);
-    }
-}
-
 bool AudioManager::DecayVolumeMeters() {
     m_capture_peak_meter -= 600;
     if (m_capture_peak_meter < 0) m_capture_peak_meter = 0;
@@ -547,55 +520,6 @@ bool AudioManager::DecayVolumeMeters() {
     return true;
 }
 
-bool AudioManager::CheckVADVoiceGate() {
-    return m_capture_peak_meter / 32768.0 > m_capture_gate;
-}
-
-#ifdef WITH_RNNOISE
-bool AudioManager::CheckVADRNNoise(const int16_t *pcm, float *denoised_left, float *denoised_right) {
-    // use left channel for vad, only denoise right if noise suppression enabled
-    std::unique_lock<std::mutex> _(m_rnn_mutex);
-
-    static float rnnoise_input[480];
-    for (size_t i = 0; i < 480; i++) {
-        rnnoise_input[i] = static_cast<float>(pcm[i * 2]);
-    }
-    m_vad_prob = std::max(m_vad_prob.load(), rnnoise_process_frame(m_rnnoise[0], denoised_left, rnnoise_input));
-
-    if (m_enable_noise_suppression) {
-        for (size_t i = 0; i < 480; i++) {
-            rnnoise_input[i] = static_cast<float>(pcm[i * 2 + 1]);
-        }
-        rnnoise_process_frame(m_rnnoise[1], denoised_right, rnnoise_input);
-    }
-
-    return m_vad_prob > m_prob_threshold;
-}
-
-void AudioManager::RNNoiseInitialize() {
-    spdlog::get("audio")->debug("Initializing RNNoise");
-    RNNoiseUninitialize();
-    std::unique_lock<std::mutex> _(m_rnn_mutex);
-    m_rnnoise[0] = rnnoise_create(nullptr);
-    m_rnnoise[1] = rnnoise_create(nullptr);
-    const auto expected = rnnoise_get_frame_size();
-    if (expected != 480) {
-        spdlog::get("audio")->warn("RNNoise expects a frame count other than 480");
-    }
-}
-
-void AudioManager::RNNoiseUninitialize() {
-    if (m_rnnoise[0] != nullptr) {
-        spdlog::get("audio")->debug("Uninitializing RNNoise");
-        std::unique_lock<std::mutex> _(m_rnn_mutex);
-        rnnoise_destroy(m_rnnoise[0]);
-        rnnoise_destroy(m_rnnoise[1]);
-        m_rnnoise[0] = nullptr;
-        m_rnnoise[1] = nullptr;
-    }
-}
-#endif
-
 bool AudioManager::OK() const {
     return m_ok;
 }
@@ -663,8 +587,11 @@ std::vector<ma_backend> AudioManager::ParseBackendsList(const Glib::ustring &lis
         else if (s == "pulseaudio") backends.push_back(ma_backend_pulseaudio);
         else if (s == "alsa") backends.push_back(ma_backend_alsa);
         else if (s == "jack") backends.push_back(ma_backend_jack);
+        else if (s == "null") backends.push_back(ma_backend_null);
     }
-    backends.push_back(ma_backend_null);
+    // always there to fall back on
+    if (std::find(backends.begin(), backends.end(), ma_backend_null) == backends.end())
+        backends.push_back(ma_backend_null);
 
     return backends;
 }
@@ -699,6 +626,32 @@ bool AudioManager::GetMixMono() const {
     return m_mix_mono;
 }
 
+void AudioManager::SetHighPass(bool value) {
+    m_highpass = value;
+}
+
+bool AudioManager::GetHighPass() const {
+    return m_highpass;
+}
+
+CaptureChain::Params AudioManager::GetCaptureParams() const {
+    CaptureChain::Params params;
+    params.Gain = static_cast<float>(m_capture_gain.load());
+    params.HighPass = m_highpass;
+    params.MixMono = m_mix_mono;
+    params.Gate = static_cast<float>(m_capture_gate.load());
+#ifdef WITH_RNNOISE
+    params.UseRNNoiseVAD = m_vad_method == VADMethod::RNNoise;
+    params.ProbThreshold = static_cast<float>(m_prob_threshold.load());
+    params.SuppressNoise = m_enable_noise_suppression;
+#endif
+    return params;
+}
+
+std::array<double, CaptureChain::StageCount> AudioManager::GetCaptureStageTimings() const {
+    return m_capture_chain.GetStageTimings();
+}
+
 AudioManager::type_signal_opus_packet AudioManager::signal_opus_packet() {
     return m_signal_opus_packet;
 }
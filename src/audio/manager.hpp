@@ -4,6 +4,7 @@
 
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <deque>
 #include <gtkmm/treemodel.h>
 #include <mutex>
@@ -16,10 +17,7 @@
 #include <sigc++/sigc++.h>
 #include <spdlog/spdlog.h>
 
-#ifdef WITH_RNNOISE
-#include <rnnoise.h>
-#endif
-
+#include "capturechain.hpp"
 #include "devices.hpp"
 // clang-format on
 
@@ -93,23 +91,41 @@ public:
     void SetMixMono(bool value);
     bool GetMixMono() const;
 
+    void SetHighPass(bool value);
+    bool GetHighPass() const;
+
+    // what playback has done since the last reset. cheap enough to always keep, it's only read by the voice benchmark
+    struct PlaybackStats {
+        size_t Decoded = 0; // packets
+        size_t Failed = 0;  // didnt decode
+        std::chrono::steady_clock::duration DecodeTime {};
+        size_t Mixes = 0;
+        size_t Underruns = 0; // per source, mixes where someone who has sent audio didnt have a full period buffered
+        std::chrono::steady_clock::duration MixTime {};
+        // how much audio sources had buffered when the mix got to them
+        double LatencyTotalMs = 0.0;
+        double LatencyMaxMs = 0.0;
+        size_t LatencySamples = 0;
+    };
+
+    PlaybackStats GetPlaybackStats() const;
+    void ResetPlaybackStats();
+
+    // current settings as the capture chain sees them
+    CaptureChain::Params GetCaptureParams() const;
+    std::array<double, CaptureChain::StageCount> GetCaptureStageTimings() const;
+
 private:
     void OnCapturedPCM(const int16_t *pcm, ma_uint32 frames);
 
     void UpdateReceiveVolume(uint32_t ssrc, const int16_t *pcm, int frames);
-    void UpdateCaptureVolume(const int16_t *pcm, ma_uint32 frames);
     std::atomic<int> m_capture_peak_meter = 0;
 
     bool DecayVolumeMeters();
 
-    bool CheckVADVoiceGate();
-
-#ifdef WITH_RNNOISE
-    bool CheckVADRNNoise(const int16_t *pcm, float *denoised_left, float *denoised_right);
-
-    void RNNoiseInitialize();
-    void RNNoiseUninitialize();
-#endif
+    // only touched from the capture callback
+    CaptureChain m_capture_chain;
+    std::array<int16_t, CaptureChain::FrameSize * 2> m_capture_out;
 
     friend void data_callback(ma_device *, void *, const void *, ma_uint32);
     friend void capture_data_callback(ma_device *, void *, const void *, ma_uint32);
@@ -132,11 +148,10 @@ private:
     mutable std::mutex m_mutex;
     mutable std::mutex m_enc_mutex;
 
-#ifdef WITH_RNNOISE
-    mutable std::mutex m_rnn_mutex;
-#endif
-
     std::unordered_map<uint32_t, std::pair<std::deque<int16_t>, OpusDecoder *>> m_sources;
+    // under m_mutex too
+    PlaybackStats m_playback_stats;
+    std::unordered_set<uint32_t> m_fed_ssrcs;
 
     OpusEncoder *m_encoder;
 
@@ -151,6 +166,7 @@ private:
     std::atomic<float> m_vad_prob = 0.0;
     std::atomic<bool> m_enable_noise_suppression = false;
     std::atomic<bool> m_mix_mono = false;
+    std::atomic<bool> m_highpass = false;
 
     std::unordered_set<uint32_t> m_muted_ssrcs;
     std::unordered_map<uint32_t, double> m_volume_ssrc;
@@ -160,10 +176,7 @@ private:
 
     AudioDevices m_devices;
 
-    VADMethod m_vad_method;
-#ifdef WITH_RNNOISE
-    DenoiseState *m_rnnoise[2];
-#endif
+    std::atomic<VADMethod> m_vad_method = VADMethod::Gate;
     std::atomic<uint32_t> m_rtp_timestamp = 0;
 
     ma_log m_ma_log;
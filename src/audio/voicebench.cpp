@@ -0,0 +1,224 @@
+#ifdef WITH_VOICE
+// clang-format off
+
+#include "voicebench.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+#include <opus.h>
+#include <sodium.h>
+
+// clang-format on
+
+constexpr static int FrameSize = 480; // 10ms, same as capture
+constexpr static size_t HeaderSize = 12;
+
+namespace {
+struct Packet {
+    double Arrival; // ms
+    int Speaker;
+    std::vector<uint8_t> Data;
+};
+} // namespace
+
+std::vector<uint8_t> VoiceBench::MakePacket(const uint8_t *opus, size_t len, uint16_t seq, uint32_t timestamp, uint32_t ssrc, uint32_t nonce_counter, const std::array<uint8_t, 32> &key) {
+    std::vector<uint8_t> rtp(HeaderSize + len + crypto_aead_xchacha20poly1305_ietf_ABYTES + sizeof(uint32_t), 0);
+    rtp[0] = 0x80;
+    rtp[1] = 0x78;
+    rtp[2] = (seq >> 8) & 0xFF;
+    rtp[3] = (seq >> 0) & 0xFF;
+    rtp[4] = (timestamp >> 24) & 0xFF;
+    rtp[5] = (timestamp >> 16) & 0xFF;
+    rtp[6] = (timestamp >> 8) & 0xFF;
+    rtp[7] = (timestamp >> 0) & 0xFF;
+    rtp[8] = (ssrc >> 24) & 0xFF;
+    rtp[9] = (ssrc >> 16) & 0xFF;
+    rtp[10] = (ssrc >> 8) & 0xFF;
+    rtp[11] = (ssrc >> 0) & 0xFF;
+
+    std::array<uint8_t, 24> nonce = {};
+    std::memcpy(nonce.data(), &nonce_counter, sizeof(uint32_t));
+
+    unsigned long long clen = 0;
+    crypto_aead_xchacha20poly1305_ietf_encrypt(rtp.data() + HeaderSize, &clen, opus, len, rtp.data(), HeaderSize, nullptr, nonce.data(), key.data());
+    std::memcpy(rtp.data() + HeaderSize + clen, &nonce_counter, sizeof(uint32_t));
+    return rtp;
+}
+
+double VoiceBench::Result::GetCPUPerSpeaker() const {
+    if (Speakers == 0 || AudioSeconds <= 0.0) return 0.0;
+    return 100.0 * (DecryptSeconds + DecodeSeconds) / AudioSeconds / Speakers;
+}
+
+double VoiceBench::Result::GetDecodeThroughput() const {
+    if (DecodeSeconds <= 0.0) return 0.0;
+    return static_cast<double>(Packets - Lost - Failed) / DecodeSeconds;
+}
+
+double VoiceBench::Result::GetMixMicroseconds() const {
+    if (Mixes == 0) return 0.0;
+    return MixSeconds * 1000000.0 / static_cast<double>(Mixes);
+}
+
+std::optional<VoiceBench::Result> VoiceBench::Run(const Params &params) {
+    if (sodium_init() < 0) return std::nullopt;
+
+    const int speakers = std::clamp(params.Speakers, 1, 64);
+    const int frames = std::max(params.Seconds, 1) * 100;
+
+    std::array<uint8_t, 32> key;
+    randombytes_buf(key.data(), key.size());
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    Result result;
+    result.Speakers = speakers;
+    result.AudioSeconds = frames / 100.0;
+
+    // encoding isnt measured, it's just setting the scene
+    std::vector<Packet> packets;
+    packets.reserve(static_cast<size_t>(speakers) * frames);
+    {
+        int err;
+        OpusEncoder *encoder = opus_encoder_create(48000, 2, OPUS_APPLICATION_VOIP, &err);
+        if (err != OPUS_OK) return std::nullopt;
+        opus_encoder_ctl(encoder, OPUS_SET_BITRATE(params.Bitrate));
+
+        std::array<int16_t, FrameSize * 2> pcm;
+        std::array<uint8_t, 1275> opus;
+        for (int s = 0; s < speakers; s++) {
+            opus_encoder_ctl(encoder, OPUS_RESET_STATE);
+            const double freq = 110.0 + 37.0 * s;
+            for (int f = 0; f < frames; f++) {
+                for (int i = 0; i < FrameSize; i++) {
+                    const double t = static_cast<double>(f * FrameSize + i) / 48000.0;
+                    const double tone = std::sin(2.0 * M_PI * freq * t) + 0.3 * std::sin(2.0 * M_PI * freq * 2.7 * t);
+                    const auto sample = static_cast<int16_t>(6000.0 * tone + 500.0 * (unit(rng) - 0.5));
+                    pcm[i * 2] = sample;
+                    pcm[i * 2 + 1] = sample;
+                }
+                const int len = opus_encode(encoder, pcm.data(), FrameSize, opus.data(), static_cast<opus_int32>(opus.size()));
+                if (len <= 0) continue;
+
+                result.Packets++;
+                if (unit(rng) < params.Loss) {
+                    result.Lost++;
+                    continue;
+                }
+
+                const double arrival = f * 10.0 + unit(rng) * std::max(params.JitterMs, 0);
+                const auto ssrc = static_cast<uint32_t>(1000 + s);
+                packets.push_back({ arrival, s, MakePacket(opus.data(), len, static_cast<uint16_t>(f), static_cast<uint32_t>(f * FrameSize), ssrc, static_cast<uint32_t>(f), key) });
+            }
+        }
+        opus_encoder_destroy(encoder);
+    }
+
+    std::stable_sort(packets.begin(), packets.end(), [](const Packet &a, const Packet &b) {
+        return a.Arrival < b.Arrival;
+    });
+
+    struct Source {
+        OpusDecoder *Decoder = nullptr;
+        std::deque<int16_t> Buffer;
+        bool Started = false;
+        double LastArrival = 0.0;
+    };
+    std::vector<Source> sources(speakers);
+    const auto destroy_decoders = [&sources]() {
+        for (auto &source : sources) {
+            if (source.Decoder != nullptr) opus_decoder_destroy(source.Decoder);
+        }
+    };
+    for (auto &source : sources) {
+        int err;
+        source.Decoder = opus_decoder_create(48000, 2, &err);
+        if (err != OPUS_OK) {
+            destroy_decoders();
+            return std::nullopt;
+        }
+    }
+
+    using clock = std::chrono::steady_clock;
+    const auto seconds = [](clock::duration d) {
+        return std::chrono::duration<double>(d).count();
+    };
+
+    // same as AudioManager::FeedMeOpus and data_callback from here on
+    std::array<opus_int16, 120 * 48 * 2> pcm;
+    std::array<float, FrameSize * 2> mix;
+    double latency_total = 0.0;
+    size_t latency_count = 0;
+    size_t next = 0;
+    for (int tick = 1; next < packets.size() || tick <= frames + 1; tick++) {
+        const double now = tick * 10.0;
+
+        for (; next < packets.size() && packets[next].Arrival <= now; next++) {
+            auto &packet = packets[next];
+            auto &data = packet.Data;
+            auto &source = sources[packet.Speaker];
+
+            const auto decrypt_start = clock::now();
+            std::array<uint8_t, 24> nonce = {};
+            std::memcpy(nonce.data(), data.data() + data.size() - sizeof(uint32_t), sizeof(uint32_t));
+            unsigned long long mlen = 0;
+            const bool ok = crypto_aead_xchacha20poly1305_ietf_decrypt(data.data() + HeaderSize, &mlen, nullptr, data.data() + HeaderSize, data.size() - HeaderSize - sizeof(uint32_t), data.data(), HeaderSize, nonce.data(), key.data()) == 0;
+            const auto decode_start = clock::now();
+            result.DecryptSeconds += seconds(decode_start - decrypt_start);
+            if (!ok) {
+                result.Failed++;
+                continue;
+            }
+
+            const int decoded = opus_decode(source.Decoder, data.data() + HeaderSize, static_cast<opus_int32>(mlen), pcm.data(), 120 * 48, 0);
+            result.DecodeSeconds += seconds(clock::now() - decode_start);
+            if (decoded <= 0) {
+                result.Failed++;
+                continue;
+            }
+
+            source.Buffer.insert(source.Buffer.end(), pcm.begin(), pcm.begin() + decoded * 2);
+            source.Started = true;
+            source.LastArrival = packet.Arrival;
+        }
+
+        const auto mix_start = clock::now();
+        mix.fill(0.0F);
+        for (auto &source : sources) {
+            if (!source.Started) continue;
+
+            // the newest sample has to wait for everything in front of it
+            const double buffered_ms = static_cast<double>(source.Buffer.size()) / 2.0 / 48.0;
+            latency_total += buffered_ms;
+            latency_count++;
+            result.MaxLatencyMs = std::max(result.MaxLatencyMs, buffered_ms);
+
+            const size_t n = std::min(source.Buffer.size(), mix.size());
+            // short at the tail end is just the speaker being done
+            if (n < mix.size() && source.LastArrival < (frames - 1) * 10.0) result.Underruns++;
+            for (size_t i = 0; i < n; i++) {
+                mix[i] += source.Buffer[i] / 32768.F;
+            }
+            source.Buffer.erase(source.Buffer.begin(), source.Buffer.begin() + n);
+        }
+        for (const float sample : mix) {
+            if (std::fabs(sample) > 1.0F) result.Clipped++;
+        }
+        result.MixSeconds += seconds(clock::now() - mix_start);
+        result.Mixes++;
+    }
+
+    destroy_decoders();
+
+    if (latency_count > 0) result.MeanLatencyMs = latency_total / static_cast<double>(latency_count);
+
+    return result;
+}
+
+#endif
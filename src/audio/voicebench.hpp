@@ -0,0 +1,58 @@
+#pragma once
+#ifdef WITH_VOICE
+// clang-format off
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// clang-format on
+
+// offline stand in for a busy voice channel. synthesizes speakers and pushes their packets through the same
+// transport decrypt, opus decode and mix steps a real call does, on a simulated 10ms playback clock
+class VoiceBench {
+public:
+    struct Params {
+        int Speakers = 8;
+        int Seconds = 10;     // of audio per speaker
+        double Loss = 0.0;    // 0-1
+        int JitterMs = 0;     // packets arrive up to this late, so they can get reordered
+        int Bitrate = 64000;
+    };
+
+    struct Result {
+        int Speakers = 0;
+        double AudioSeconds = 0.0; // per speaker
+
+        size_t Packets = 0;   // sent
+        size_t Lost = 0;      // never arrived
+        size_t Failed = 0;    // didnt decrypt or decode
+        size_t Underruns = 0; // mixes where a speaker who was talking didnt have a full frame buffered
+        size_t Clipped = 0;   // mixed samples out of range
+
+        double DecryptSeconds = 0.0;
+        double DecodeSeconds = 0.0;
+        double MixSeconds = 0.0;
+        size_t Mixes = 0;
+
+        // how long decoded audio sits in a speaker's buffer before the mix gets to it
+        double MeanLatencyMs = 0.0;
+        double MaxLatencyMs = 0.0;
+
+        // percent of one core per speaker for receiving, decrypt and decode
+        [[nodiscard]] double GetCPUPerSpeaker() const;
+        // decoded 10ms frames per second of cpu
+        [[nodiscard]] double GetDecodeThroughput() const;
+        [[nodiscard]] double GetMixMicroseconds() const;
+    };
+
+    // nullopt if opus wont set up
+    static std::optional<Result> Run(const Params &params);
+
+    // rtpsize aead like UDPSocket::SendEncrypted, with the nonce counter on the end
+    static std::vector<uint8_t> MakePacket(const uint8_t *opus, size_t len, uint16_t seq, uint32_t timestamp, uint32_t ssrc, uint32_t nonce_counter, const std::array<uint8_t, 32> &key);
+};
+
+#endif
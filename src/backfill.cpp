@@ -0,0 +1,156 @@
+#include "backfill.hpp"
+
+#include <algorithm>
+
+#include <glibmm/main.h>
+#include <spdlog/spdlog.h>
+
+#include "abaddon.hpp"
+#include "util.hpp"
+
+void HistoryBackfill::Start() {
+    Stop();
+
+    const auto &settings = Abaddon::Get().GetSettings();
+    if (!settings.BackfillEnabled) return;
+
+    m_channels = GetChannelsFromSettings();
+    if (m_channels.empty()) return;
+
+    m_next = 0;
+    m_failures = 0;
+    m_last_activity = std::chrono::steady_clock::now();
+    m_resume_at = m_last_activity;
+
+    const auto interval = static_cast<unsigned int>(std::max(settings.BackfillInterval, 500));
+    m_timer = Glib::signal_timeout().connect(sigc::mem_fun(*this, &HistoryBackfill::OnTick), interval, Glib::PRIORITY_LOW);
+
+    spdlog::get("discord")->info("Backfilling history for {} channel(s)", m_channels.size());
+}
+
+void HistoryBackfill::Stop() {
+    m_timer.disconnect();
+    m_channels.clear();
+    m_in_flight = false;
+    m_generation++;
+}
+
+void HistoryBackfill::NotifyActivity() {
+    m_last_activity = std::chrono::steady_clock::now();
+}
+
+bool HistoryBackfill::IsRunning() const noexcept {
+    return m_timer.connected();
+}
+
+bool HistoryBackfill::OnTick() {
+    if (m_in_flight) return true;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now < m_resume_at) return true;
+
+    const auto idle = std::chrono::seconds(Abaddon::Get().GetSettings().BackfillIdle);
+    if (Abaddon::Get().IsMainWindowActive() && now - m_last_activity < idle) return true;
+
+    const auto channel_id = GetNextChannel();
+    if (!channel_id.has_value()) {
+        spdlog::get("discord")->info("Backfill finished");
+        m_channels.clear();
+        return false;
+    }
+
+    FetchPage(*channel_id);
+    return true;
+}
+
+void HistoryBackfill::FetchPage(Snowflake channel_id) {
+    auto &discord = Abaddon::Get().GetDiscordClient();
+
+    Snowflake before_id = Snowflake::FromNow();
+    if (const auto cursor = GetCursor(channel_id); cursor.has_value())
+        before_id = cursor->Before;
+
+    m_in_flight = true;
+    const int generation = m_generation;
+    discord.FetchMessagesInChannelBefore(
+        channel_id, before_id,
+        [this, generation, channel_id, before_id](const std::vector<Message> &msgs) {
+            if (generation != m_generation) return;
+            OnPageFetched(channel_id, before_id, msgs);
+        },
+        [this, generation, channel_id](int status, float retry_after) {
+            if (generation != m_generation) return;
+            OnPageFailed(channel_id, status, retry_after);
+        });
+}
+
+void HistoryBackfill::OnPageFetched(Snowflake channel_id, Snowflake before_id, const std::vector<Message> &msgs) {
+    m_in_flight = false;
+    m_failures = 0;
+
+    // msgs are sorted ascending. a short page means we hit the start of the channel
+    BackfillCursor cursor;
+    cursor.Before = msgs.empty() ? before_id : msgs.front().ID;
+    cursor.Complete = msgs.size() < 50;
+    SetCursor(channel_id, cursor);
+
+    spdlog::get("discord")->debug("Backfilled {} messages in {}", msgs.size(), channel_id);
+}
+
+void HistoryBackfill::OnPageFailed(Snowflake channel_id, int status, float retry_after) {
+    m_in_flight = false;
+
+    if (status == http::Forbidden || status == http::NotFound) {
+        spdlog::get("discord")->warn("Can't backfill {} (status {}), skipping", channel_id, status);
+        SetCursor(channel_id, { Snowflake::Invalid, true });
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (retry_after > 0.0F) {
+        m_resume_at = now + std::chrono::milliseconds(static_cast<int64_t>(retry_after * 1000.0F));
+    } else {
+        // exponential backoff, capped at 64 intervals
+        m_failures = std::min(m_failures + 1, 6);
+        m_resume_at = now + std::chrono::milliseconds(Abaddon::Get().GetSettings().BackfillInterval) * (1 << m_failures);
+    }
+}
+
+std::vector<Snowflake> HistoryBackfill::GetChannelsFromSettings() const {
+    std::vector<Snowflake> ret;
+    std::string str = Abaddon::Get().GetSettings().BackfillChannels;
+    for (const auto &part : StringSplit(str, ", ")) {
+        const Snowflake id = std::strtoull(part.c_str(), nullptr, 10);
+        if (id != 0 && std::find(ret.begin(), ret.end(), id) == ret.end())
+            ret.push_back(id);
+    }
+    return ret;
+}
+
+std::optional<Snowflake> HistoryBackfill::GetNextChannel() {
+    auto &discord = Abaddon::Get().GetDiscordClient();
+    const auto self_id = discord.GetUserData().ID;
+
+    // round robin so one deep channel doesn't starve the rest
+    for (size_t i = 0; i < m_channels.size(); i++) {
+        const auto id = m_channels[(m_next + i) % m_channels.size()];
+
+        const auto cursor = GetCursor(id);
+        if (cursor.has_value() && cursor->Complete) continue;
+
+        if (!discord.HasChannelPermission(self_id, id, Permission::VIEW_CHANNEL | Permission::READ_MESSAGE_HISTORY)) continue;
+
+        m_next = (m_next + i + 1) % m_channels.size();
+        return id;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<BackfillCursor> HistoryBackfill::GetCursor(Snowflake channel_id) const {
+    return Abaddon::Get().GetDiscordClient().GetBackfillCursor(channel_id);
+}
+
+void HistoryBackfill::SetCursor(Snowflake channel_id, const BackfillCursor &cursor) {
+    Abaddon::Get().GetDiscordClient().SetBackfillCursor(channel_id, cursor);
+}
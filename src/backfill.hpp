@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <optional>
+#include <vector>
+#include <sigc++/connection.h>
+#include "discord/snowflake.hpp"
+
+struct Message;
+
+struct BackfillCursor;
+
+// crawls the history of selected channels in the background so scrollback comes from the store
+// one request in flight at a time, and only while the user isn't doing anything
+// cursors are kept in the store with the messages, so a crawl only skips history the store still has
+class HistoryBackfill {
+public:
+    HistoryBackfill() = default;
+
+    void Start(); // on ready
+    void Stop();  // on disconnect
+
+    // any user input pushes the next request back by the idle delay
+    void NotifyActivity();
+
+    [[nodiscard]] bool IsRunning() const noexcept;
+
+private:
+    bool OnTick();
+    void FetchPage(Snowflake channel_id);
+    void OnPageFetched(Snowflake channel_id, Snowflake before_id, const std::vector<Message> &msgs);
+    void OnPageFailed(Snowflake channel_id, int status, float retry_after);
+
+    std::vector<Snowflake> GetChannelsFromSettings() const;
+    std::optional<Snowflake> GetNextChannel();
+
+    std::optional<BackfillCursor> GetCursor(Snowflake channel_id) const;
+    void SetCursor(Snowflake channel_id, const BackfillCursor &cursor);
+
+    std::vector<Snowflake> m_channels;
+    size_t m_next = 0;
+    bool m_in_flight = false;
+    int m_failures = 0;
+    int m_generation = 0; // so responses from before a restart are dropped
+
+    std::chrono::steady_clock::time_point m_last_activity;
+    std::chrono::steady_clock::time_point m_resume_at;
+
+    sigc::connection m_timer;
+};
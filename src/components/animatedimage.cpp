@@ -0,0 +1,23 @@
+#include "animatedimage.hpp"
+
+#include <gdkmm/general.h>
+
+#include "abaddon.hpp"
+
+AnimatedImage::AnimatedImage(const Glib::RefPtr<Gdk::PixbufAnimation> &anim)
+    : m_anim(anim) {
+    set_size_request(anim->get_width(), anim->get_height());
+}
+
+bool AnimatedImage::on_draw(const Cairo::RefPtr<Cairo::Context> &cr) {
+    const int w = m_anim->get_width();
+    const int h = m_anim->get_height();
+    const int x = (get_allocated_width() - w) / 2;
+    const int y = (get_allocated_height() - h) / 2;
+
+    const auto frame = Abaddon::Get().GetAnimationClock().GetFrame(m_anim, *this, Gdk::Rectangle(x, y, w, h));
+    Gdk::Cairo::set_source_pixbuf(cr, frame, x, y);
+    cr->paint();
+
+    return true;
+}
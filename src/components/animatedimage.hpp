@@ -0,0 +1,15 @@
+#pragma once
+#include <gdkmm/pixbufanimation.h>
+#include <gtkmm/drawingarea.h>
+
+// shows an animation driven by the shared animation clock instead of GtkImage's own timeout
+class AnimatedImage : public Gtk::DrawingArea {
+public:
+    AnimatedImage(const Glib::RefPtr<Gdk::PixbufAnimation> &anim);
+
+protected:
+    bool on_draw(const Cairo::RefPtr<Cairo::Context> &cr) override;
+
+private:
+    Glib::RefPtr<Gdk::PixbufAnimation> m_anim;
+};
@@ -1,6 +1,6 @@
 #include "cellrendererpixbufanimation.hpp"
 #include <gdkmm/general.h>
-#include <glibmm/main.h>
+#include "abaddon.hpp"
 
 CellRendererPixbufAnimation::CellRendererPixbufAnimation()
     : Glib::ObjectBase(typeid(CellRendererPixbufAnimation))
@@ -73,17 +73,8 @@ void CellRendererPixbufAnimation::render_vfunc(const Cairo::RefPtr<Cairo::Contex
         return;
 
     if (auto anim = m_property_pixbuf_animation.get_value()) {
-        auto map_iter = m_pixbuf_animation_iters.find(anim);
-        if (map_iter == m_pixbuf_animation_iters.end())
-            m_pixbuf_animation_iters[anim] = anim->get_iter(nullptr);
-        auto pb_iter = m_pixbuf_animation_iters.at(anim);
-
-        const auto cb = [this, &widget, anim] {
-            if (m_pixbuf_animation_iters.at(anim)->advance())
-                widget.queue_draw();
-        };
-        Glib::signal_timeout().connect_once(sigc::track_obj(cb, widget), pb_iter->get_delay_time());
-        Gdk::Cairo::set_source_pixbuf(cr, pb_iter->get_pixbuf(), pix_x, pix_y);
+        const auto frame = Abaddon::Get().GetAnimationClock().GetFrame(anim, widget, pix_rect);
+        Gdk::Cairo::set_source_pixbuf(cr, frame, pix_x, pix_y);
         cr->rectangle(pix_x, pix_y, natural.width, natural.height);
         cr->fill();
     } else if (auto pixbuf = m_property_pixbuf.get_value()) {
@@ -1,5 +1,4 @@
 #pragma once
-#include <unordered_map>
 #include <gdkmm/pixbufanimation.h>
 #include <glibmm/property.h>
 #include <gtkmm/cellrenderer.h>
@@ -31,13 +30,4 @@ protected:
 private:
     Glib::Property<Glib::RefPtr<Gdk::Pixbuf>> m_property_pixbuf;
     Glib::Property<Glib::RefPtr<Gdk::PixbufAnimation>> m_property_pixbuf_animation;
-    /* one cellrenderer is used for every animation and i dont know how to
-       store data per-pixbuf (in this case the iter) so this little map thing will have to do
-       i would try set_data on the pixbuf but i dont know if that will cause memory leaks
-       this would mean if a row's pixbuf animation is changed more than once then it wont be released immediately
-       but thats not a problem for me in this case
-
-       unordered_map doesnt compile cuz theres no hash overload, i guess
-    */
-    std::map<Glib::RefPtr<Gdk::PixbufAnimation>, Glib::RefPtr<Gdk::PixbufAnimationIter>> m_pixbuf_animation_iters;
 };
@@ -348,28 +348,18 @@ void CellRendererChannels::render_vfunc_guild(const Cairo::RefPtr<Cairo::Context
     const bool is_hovered = flags & Gtk::CELL_RENDERER_PRELIT;
     auto anim = m_property_pixbuf_animation.get_value();
 
-    // kinda gross
     if (anim) {
-        auto map_iter = m_pixbuf_anim_iters.find(anim);
-        if (map_iter == m_pixbuf_anim_iters.end())
-            m_pixbuf_anim_iters[anim] = anim->get_iter(nullptr);
-        auto pb_iter = m_pixbuf_anim_iters.at(anim);
-
-        const auto cb = [this, &widget, anim, icon_x, icon_y, icon_w, icon_h] {
-            if (m_pixbuf_anim_iters.at(anim)->advance())
-                widget.queue_draw_area(
-                    static_cast<int>(icon_x),
-                    static_cast<int>(icon_y),
-                    static_cast<int>(icon_w),
-                    static_cast<int>(icon_h));
-        };
-
-        if ((hover_only && is_hovered) || !hover_only)
-            Glib::signal_timeout().connect_once(sigc::track_obj(cb, widget), pb_iter->get_delay_time());
-        if (hover_only && !is_hovered)
-            m_pixbuf_anim_iters[anim] = anim->get_iter(nullptr);
-
-        Gdk::Cairo::set_source_pixbuf(cr, pb_iter->get_pixbuf(), icon_x, icon_y);
+        auto &clock = Abaddon::Get().GetAnimationClock();
+        Glib::RefPtr<Gdk::Pixbuf> frame;
+        if (hover_only && !is_hovered) {
+            clock.Reset(anim);
+            frame = anim->get_static_image();
+        } else {
+            const Gdk::Rectangle icon_area(static_cast<int>(icon_x), static_cast<int>(icon_y), static_cast<int>(icon_w), static_cast<int>(icon_h));
+            frame = clock.GetFrame(anim, widget, icon_area);
+        }
+
+        Gdk::Cairo::set_source_pixbuf(cr, frame, icon_x, icon_y);
         cr->rectangle(icon_x, icon_y, icon_w, icon_h);
         cr->fill();
     } else if (auto pixbuf = m_property_pixbuf.get_value()) {
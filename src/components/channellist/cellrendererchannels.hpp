@@ -164,9 +164,4 @@ private:
     Glib::Property<bool> m_property_nsfw;                                           // channel
     Glib::Property<std::optional<Gdk::RGBA>> m_property_color;                      // folder
     Glib::Property<VoiceStateFlags> m_property_voice_state;
-
-    // same pitfalls as in https://github.com/uowuo/abaddon/blob/60404783bd4ce9be26233fe66fc3a74475d9eaa3/components/cellrendererpixbufanimation.hpp#L32-L39
-    // this will manifest though since guild icons can change
-    // an animation or two wont be the end of the world though
-    std::map<Glib::RefPtr<Gdk::PixbufAnimation>, Glib::RefPtr<Gdk::PixbufAnimationIter>> m_pixbuf_anim_iters;
 };
@@ -93,6 +93,10 @@ void ChannelList::ConnectSignals() {
         m_signal_action_guild_settings.emit(id);
     });
 
+    m_tree.signal_channel_hovered().connect([this](Snowflake id) {
+        m_signal_channel_hovered.emit(id);
+    });
+
     m_guilds.signal_action_guild_leave().connect([this](Snowflake id) {
         m_signal_action_guild_leave.emit(id);
     });
@@ -129,3 +133,7 @@ ChannelList::type_signal_action_guild_leave ChannelList::signal_action_guild_lea
 ChannelList::type_signal_action_guild_settings ChannelList::signal_action_guild_settings() {
     return m_signal_action_guild_settings;
 }
+
+ChannelList::type_signal_channel_hovered ChannelList::signal_channel_hovered() {
+    return m_signal_channel_hovered;
+}
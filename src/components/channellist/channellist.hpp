@@ -37,6 +37,7 @@ public:
     using type_signal_action_channel_item_select = sigc::signal<void, Snowflake>;
     using type_signal_action_guild_leave = sigc::signal<void, Snowflake>;
     using type_signal_action_guild_settings = sigc::signal<void, Snowflake>;
+    using type_signal_channel_hovered = sigc::signal<void, Snowflake>;
 
 #ifdef WITH_LIBHANDY
     using type_signal_action_open_new_tab = sigc::signal<void, Snowflake>;
@@ -54,11 +55,13 @@ public:
     type_signal_action_channel_item_select signal_action_channel_item_select();
     type_signal_action_guild_leave signal_action_guild_leave();
     type_signal_action_guild_settings signal_action_guild_settings();
+    type_signal_channel_hovered signal_channel_hovered();
 
 private:
     type_signal_action_channel_item_select m_signal_action_channel_item_select;
     type_signal_action_guild_leave m_signal_action_guild_leave;
     type_signal_action_guild_settings m_signal_action_guild_settings;
+    type_signal_channel_hovered m_signal_channel_hovered;
 
 #ifdef WITH_LIBHANDY
     type_signal_action_open_new_tab m_signal_action_open_new_tab;
@@ -8,6 +8,7 @@
 
 #include "abaddon.hpp"
 #include "imgmanager.hpp"
+#include "trace.hpp"
 #include "util.hpp"
 
 ChannelListTree::ChannelListTree()
@@ -15,6 +16,7 @@ ChannelListTree::ChannelListTree()
     , m_model(Gtk::TreeStore::create(m_columns))
     , m_filter_model(Gtk::TreeModelFilter::create(m_model))
     , m_sort_model(Gtk::TreeModelSort::create(m_filter_model))
+    , m_row_index(m_columns.m_type, m_columns.m_id)
     , m_menu_guild_copy_id("_Copy ID", true)
     , m_menu_guild_settings("View _Settings", true)
     , m_menu_guild_leave("_Leave", true)
@@ -77,6 +79,8 @@ ChannelListTree::ChannelListTree()
     m_view.get_selection()->set_mode(Gtk::SELECTION_SINGLE);
     m_view.get_selection()->set_select_function(sigc::mem_fun(*this, &ChannelListTree::SelectionFunc));
     m_view.signal_button_press_event().connect(sigc::mem_fun(*this, &ChannelListTree::OnButtonPressEvent), false);
+    m_view.signal_motion_notify_event().connect(sigc::mem_fun(*this, &ChannelListTree::OnMotionNotifyEvent), false);
+    m_view.signal_leave_notify_event().connect(sigc::mem_fun(*this, &ChannelListTree::OnLeaveNotifyEvent), false);
 
     m_view.set_hexpand(true);
     m_view.set_vexpand(true);
@@ -399,6 +403,7 @@ void ChannelListTree::UpdateListingClassic() {
     // otherwise clear() causes a CRITICAL assert in a slot for the filter model
     m_filter_model->refilter();
     m_model->clear();
+    m_row_index.Clear();
 
     auto &discord = Abaddon::Get().GetDiscordClient();
     const auto guild_ids = discord.GetUserSortedGuilds();
@@ -414,6 +419,13 @@ void ChannelListTree::UpdateListingClassic() {
 }
 
 void ChannelListTree::UpdateListing() {
+    TRACE_ZONE("ChannelListTree::UpdateListing");
+    // only build from scratch the first time, after that just apply whatever changed
+    if (!m_model->children().empty()) {
+        ReconcileListing();
+        return;
+    }
+
     if (m_classic) {
         UpdateListingClassic();
         return;
@@ -422,6 +434,7 @@ void ChannelListTree::UpdateListing() {
     m_updating_listing = true;
 
     m_model->clear();
+    m_row_index.Clear();
 
     auto &discord = Abaddon::Get().GetDiscordClient();
 
@@ -487,31 +500,246 @@ void ChannelListTree::UpdateListing() {
     AddPrivateChannels();
 }
 
-// TODO update for folders
 void ChannelListTree::UpdateNewGuild(const GuildData &guild) {
-    AddGuild(guild, m_model->children());
-    // update sort order
-    int sortnum = 0;
-    for (const auto guild_id : Abaddon::Get().GetDiscordClient().GetUserSortedGuilds()) {
+    TRACE_ZONE("ChannelListTree::UpdateNewGuild");
+    // puts it in the right folder and fixes up the sort order of everything else
+    ReconcileListing(false);
+}
+
+void ChannelListTree::ReconcileListing(bool contents) {
+    TRACE_ZONE("ChannelListTree::ReconcileListing");
+    auto &discord = Abaddon::Get().GetDiscordClient();
+
+    // where every guild should end up. invalid folder means the top level
+    struct Placement {
+        Snowflake Folder;
+        int64_t Sort;
+    };
+    std::unordered_map<Snowflake, Placement> placements;
+    std::vector<Snowflake> guild_order;
+    std::unordered_map<Snowflake, std::pair<UserSettingsGuildFoldersEntry, int64_t>> folders;
+
+    const auto place = [&](Snowflake guild_id, Snowflake folder_id, int64_t sort) {
+        if (placements.find(guild_id) != placements.end()) return;
+        if (!discord.GetGuild(guild_id).has_value()) return;
+        placements[guild_id] = { folder_id, sort };
+        guild_order.push_back(guild_id);
+    };
+
+    const auto guild_ids = discord.GetUserSortedGuilds();
+    if (m_classic) {
+        int64_t sort_value = 0;
+        for (const auto guild_id : guild_ids)
+            place(guild_id, Snowflake::Invalid, sort_value++);
+    } else {
+        // same order UpdateListing builds in
+        int64_t sort_value = 0;
+        const auto user_folders = discord.GetUserSettings().GuildFolders;
+
+        std::set<Snowflake> foldered_guilds;
+        for (const auto &group : user_folders) {
+            foldered_guilds.insert(group.GuildIDs.begin(), group.GuildIDs.end());
+        }
+
+        for (auto iter = guild_ids.rbegin(); iter != guild_ids.rend(); iter++) {
+            if (foldered_guilds.find(*iter) == foldered_guilds.end())
+                place(*iter, Snowflake::Invalid, sort_value++);
+        }
+
+        for (const auto &group : user_folders) {
+            if (!group.ID.has_value()) {
+                if (!group.GuildIDs.empty())
+                    place(group.GuildIDs[0], Snowflake::Invalid, sort_value++);
+                continue;
+            }
+            folders[*group.ID] = { group, sort_value++ };
+            int64_t folder_sort_value = 0;
+            for (const auto guild_id : group.GuildIDs)
+                place(guild_id, *group.ID, folder_sort_value++);
+        }
+    }
+
+    // folders first so guilds have somewhere to go
+    std::unordered_map<Snowflake, Gtk::TreeModel::iterator> folder_rows;
+    for (const auto &row : m_model->children()) {
+        if (row[m_columns.m_type] == RenderType::Folder)
+            folder_rows[static_cast<Snowflake>(row[m_columns.m_id])] = row;
+    }
+    for (const auto &[folder_id, entry] : folders) {
+        auto &[folder, sort] = entry;
+        auto iter = folder_rows[folder_id];
+        if (!iter) {
+            iter = m_model->append();
+            (*iter)[m_columns.m_type] = RenderType::Folder;
+            (*iter)[m_columns.m_id] = folder_id;
+            folder_rows[folder_id] = iter;
+        }
+        UpdateFolderRow(iter, folder);
+        (*iter)[m_columns.m_sort] = sort;
+    }
+
+    for (const auto guild_id : guild_order) {
+        const auto &placement = placements[guild_id];
+        const auto guild = discord.GetGuild(guild_id);
+        const auto parent = placement.Folder.IsValid() ? folder_rows[placement.Folder] : Gtk::TreeModel::iterator();
+
         auto iter = GetIteratorForGuildFromID(guild_id);
-        if (iter)
-            (*iter)[m_columns.m_sort] = ++sortnum;
+        if (!iter) {
+            iter = AddGuild(*guild, parent ? parent->children() : m_model->children());
+        } else {
+            const auto current_parent = iter->parent();
+            if (parent ? current_parent != parent : static_cast<bool>(current_parent)) {
+                MoveRow(iter, parent);
+                iter = GetIteratorForGuildFromID(guild_id);
+            }
+            if (contents) {
+                (*iter)[m_columns.m_name] = "<b>" + Glib::Markup::escape_text(guild->Name) + "</b>";
+                ReconcileGuild(iter, *guild);
+            }
+        }
+        (*iter)[m_columns.m_sort] = placement.Sort;
+    }
+
+    // then whatever is left over. guilds before folders so folders are empty by the time theyre removed
+    std::vector<Gtk::TreeModel::iterator> stale_guilds;
+    std::vector<Gtk::TreeModel::iterator> stale_folders;
+    for (const auto &row : m_model->children()) {
+        const RenderType type = row[m_columns.m_type];
+        const auto id = static_cast<Snowflake>(row[m_columns.m_id]);
+        if (type == RenderType::Guild && placements.find(id) == placements.end()) {
+            stale_guilds.push_back(row);
+        } else if (type == RenderType::Folder) {
+            for (const auto &child : row.children()) {
+                if (placements.find(static_cast<Snowflake>(child[m_columns.m_id])) == placements.end())
+                    stale_guilds.push_back(child);
+            }
+            if (folders.find(id) == folders.end())
+                stale_folders.push_back(row);
+        }
+    }
+    for (const auto &iter : stale_guilds)
+        EraseRow(iter);
+    for (const auto &iter : stale_folders)
+        EraseRow(iter);
+
+    if (contents) ReconcilePrivateChannels();
+
+    // rows that were moved lost their selection
+    if (const auto iter = GetIteratorForRowFromID(m_active_channel)) {
+        if (const auto view_iter = ConvertModelIterToView(iter))
+            m_view.get_selection()->select(view_iter);
     }
 }
 
+void ChannelListTree::ReconcileGuild(const Gtk::TreeModel::iterator &guild_iter, const GuildData &guild) {
+    auto &discord = Abaddon::Get().GetDiscordClient();
+    if (!guild.Channels.has_value()) return;
+
+    std::unordered_set<Snowflake> wanted;
+
+    // categories first so channels have somewhere to go
+    for (const auto &channel_ : *guild.Channels) {
+        const auto channel = discord.GetChannel(channel_.ID);
+        if (!channel.has_value() || channel->Type != ChannelType::GUILD_CATEGORY) continue;
+        wanted.insert(channel->ID);
+        if (GetIteratorForRowFromIDOfType(channel->ID, RenderType::Category))
+            UpdateChannelCategory(*channel);
+        else
+            UpdateCreateChannelCategory(*channel);
+    }
+
+    for (const auto &channel_ : *guild.Channels) {
+        const auto channel = discord.GetChannel(channel_.ID);
+        if (!channel.has_value() || channel->Type == ChannelType::GUILD_CATEGORY) continue;
+        wanted.insert(channel->ID);
+        if (GetIteratorForRowFromID(channel->ID))
+            UpdateChannel(channel->ID);
+        else if (!channel->ParentID.has_value() || GetIteratorForRowFromIDOfType(*channel->ParentID, RenderType::Category))
+            UpdateCreateChannel(*channel);
+    }
+
+    if (guild.Threads.has_value()) {
+        for (const auto &tmp : *guild.Threads) {
+            const auto thread = discord.GetChannel(tmp.ID);
+            if (!thread.has_value()) continue;
+            wanted.insert(thread->ID);
+            if (GetIteratorForRowFromID(thread->ID)) continue;
+            if (const auto parent = GetIteratorForRowFromID(*thread->ParentID))
+                CreateThreadRow(parent->children(), *thread);
+        }
+    }
+
+    // deepest first so nothing gets erased out from under a parent thats also going away
+    std::vector<Gtk::TreeModel::iterator> stale;
+    std::queue<Gtk::TreeModel::iterator> queue;
+    queue.push(guild_iter);
+    while (!queue.empty()) {
+        auto item = queue.front();
+        queue.pop();
+        for (const auto &child : item->children()) {
+            const RenderType type = child[m_columns.m_type];
+            const auto id = static_cast<Snowflake>(child[m_columns.m_id]);
+            if (type != RenderType::VoiceParticipant && wanted.find(id) == wanted.end() && child != m_temporary_thread_row)
+                stale.push_back(child);
+            queue.push(child);
+        }
+    }
+    for (auto it = stale.rbegin(); it != stale.rend(); it++)
+        EraseRow(*it);
+}
+
+void ChannelListTree::ReconcilePrivateChannels() {
+    Gtk::TreeModel::iterator header;
+    for (const auto &row : m_model->children()) {
+        if (row[m_columns.m_type] == RenderType::DMHeader) {
+            header = row;
+            break;
+        }
+    }
+    if (!header) {
+        AddPrivateChannels();
+        return;
+    }
+    // top level rows might have been removed above it
+    m_dm_header = m_model->get_path(header);
+
+    auto &discord = Abaddon::Get().GetDiscordClient();
+    std::unordered_set<Snowflake> wanted;
+    for (const auto dm_id : discord.GetPrivateChannels()) {
+        const auto dm = discord.GetChannel(dm_id);
+        if (!dm.has_value()) continue;
+        wanted.insert(dm_id);
+        if (auto iter = GetIteratorForRowFromIDOfType(dm_id, RenderType::DM)) {
+            (*iter)[m_columns.m_name] = Glib::Markup::escape_text(dm->GetDisplayName());
+            (*iter)[m_columns.m_sort] = static_cast<int64_t>(-(dm->LastMessageID.has_value() ? *dm->LastMessageID : dm_id));
+        } else {
+            UpdateCreateDMChannel(*dm);
+        }
+    }
+
+    std::vector<Gtk::TreeModel::iterator> stale;
+    for (const auto &row : header->children()) {
+        if (wanted.find(static_cast<Snowflake>(row[m_columns.m_id])) == wanted.end())
+            stale.push_back(row);
+    }
+    for (const auto &iter : stale)
+        EraseRow(iter);
+}
+
 void ChannelListTree::UpdateRemoveGuild(Snowflake id) {
     auto iter = GetIteratorForGuildFromID(id);
     if (!iter) return;
-    m_model->erase(iter);
+    EraseRow(iter);
 }
 
 void ChannelListTree::UpdateRemoveChannel(Snowflake id) {
     auto iter = GetIteratorForRowFromID(id);
     if (!iter) return;
-    m_model->erase(iter);
+    EraseRow(iter);
 }
 
 void ChannelListTree::UpdateChannel(Snowflake id) {
+    TRACE_ZONE("ChannelListTree::UpdateChannel");
     auto iter = GetIteratorForRowFromID(id);
     auto channel = Abaddon::Get().GetDiscordClient().GetChannel(id);
     if (!iter || !channel.has_value()) return;
@@ -538,6 +766,7 @@ void ChannelListTree::UpdateChannel(Snowflake id) {
 }
 
 void ChannelListTree::UpdateCreateChannel(const ChannelData &channel) {
+    TRACE_ZONE("ChannelListTree::UpdateCreateChannel");
     if (channel.Type == ChannelType::GUILD_CATEGORY) return (void)UpdateCreateChannelCategory(channel);
     if (channel.Type == ChannelType::DM || channel.Type == ChannelType::GROUP_DM) return UpdateCreateDMChannel(channel);
     if (channel.Type != ChannelType::GUILD_TEXT && channel.Type != ChannelType::GUILD_NEWS && channel.Type != ChannelType::GUILD_VOICE) return;
@@ -555,6 +784,7 @@ void ChannelListTree::UpdateCreateChannel(const ChannelData &channel) {
     }
     channel_row[m_columns.m_type] = IsTextChannel(channel.Type) ? RenderType::TextChannel : RenderType::VoiceChannel;
     channel_row[m_columns.m_id] = channel.ID;
+    IndexRow(channel_row);
     channel_row[m_columns.m_name] = "#" + Glib::Markup::escape_text(*channel.Name);
     channel_row[m_columns.m_nsfw] = channel.NSFW();
     if (orphan)
@@ -564,6 +794,7 @@ void ChannelListTree::UpdateCreateChannel(const ChannelData &channel) {
 }
 
 void ChannelListTree::UpdateGuild(Snowflake id) {
+    TRACE_ZONE("ChannelListTree::UpdateGuild");
     auto iter = GetIteratorForGuildFromID(id);
     auto &img = Abaddon::Get().GetImageManager();
     const auto guild = Abaddon::Get().GetDiscordClient().GetGuild(id);
@@ -615,6 +846,7 @@ void ChannelListTree::OnThreadUpdate(const ThreadUpdateData &data) {
 }
 
 void ChannelListTree::OnThreadListSync(const ThreadListSyncData &data) {
+    TRACE_ZONE("ChannelListTree::OnThreadListSync");
     // get the threads in the guild
     std::vector<Snowflake> threads;
     auto guild_iter = GetIteratorForGuildFromID(data.GuildID);
@@ -636,7 +868,7 @@ void ChannelListTree::OnThreadListSync(const ThreadListSyncData &data) {
     for (auto thread_id : threads) {
         if (std::find_if(data.Threads.begin(), data.Threads.end(), [thread_id](const auto &x) { return x.ID == thread_id; }) == data.Threads.end()) {
             auto iter = GetIteratorForRowFromID(thread_id);
-            m_model->erase(iter);
+            EraseRow(iter);
         }
     }
 
@@ -644,7 +876,7 @@ void ChannelListTree::OnThreadListSync(const ThreadListSyncData &data) {
     for (auto thread : data.Threads) {
         if (thread.ThreadMetadata->IsArchived) {
             if (auto iter = GetIteratorForRowFromID(thread.ID))
-                m_model->erase(iter);
+                EraseRow(iter);
         }
     }
 }
@@ -662,7 +894,7 @@ void ChannelListTree::OnVoiceUserConnect(Snowflake user_id, Snowflake channel_id
 
 void ChannelListTree::OnVoiceUserDisconnect(Snowflake user_id, Snowflake channel_id) {
     if (auto iter = GetIteratorForRowFromIDOfType(user_id, RenderType::VoiceParticipant)) {
-        m_model->erase(iter);
+        EraseRow(iter);
     }
 }
 
@@ -675,7 +907,7 @@ void ChannelListTree::OnVoiceStateSet(Snowflake user_id, Snowflake channel_id, V
 void ChannelListTree::DeleteThreadRow(Snowflake id) {
     auto iter = GetIteratorForRowFromID(id);
     if (iter)
-        m_model->erase(iter);
+        EraseRow(iter);
 }
 
 void ChannelListTree::OnChannelMute(Snowflake id) {
@@ -713,7 +945,7 @@ void ChannelListTree::SetActiveChannel(Snowflake id, bool expand_to) {
         const auto thread_id = static_cast<Snowflake>((*m_temporary_thread_row)[m_columns.m_id]);
         const auto thread = Abaddon::Get().GetDiscordClient().GetChannel(thread_id);
         if (thread.has_value() && (!thread->IsJoinedThread() || thread->ThreadMetadata->IsArchived))
-            m_model->erase(m_temporary_thread_row);
+            EraseRow(m_temporary_thread_row);
         m_temporary_thread_row = {};
     }
 
@@ -747,12 +979,8 @@ void ChannelListTree::UseExpansionState(const ExpansionStateRoot &root) {
 
     auto recurse = [this](auto &self, const ExpansionStateRoot &root) -> void {
         for (const auto &[id, state] : root.Children) {
-            Gtk::TreeModel::iterator row_iter;
-            if (const auto map_iter = m_tmp_row_map.find(id); map_iter != m_tmp_row_map.end()) {
-                row_iter = map_iter->second;
-            } else if (const auto map_iter = m_tmp_guild_row_map.find(id); map_iter != m_tmp_guild_row_map.end()) {
-                row_iter = map_iter->second;
-            }
+            Gtk::TreeModel::iterator row_iter = GetIteratorForRowFromID(id);
+            if (!row_iter) row_iter = GetIteratorForGuildFromID(id);
 
             if (row_iter) {
                 (*row_iter)[m_columns.m_expanded] = state.IsExpanded;
@@ -788,9 +1016,6 @@ void ChannelListTree::UseExpansionState(const ExpansionStateRoot &root) {
 
     m_updating_listing = false;
     m_filter_model->refilter();
-
-    m_tmp_row_map.clear();
-    m_tmp_guild_row_map.clear();
 }
 
 ExpansionStateRoot ChannelListTree::GetExpansionState() const {
@@ -873,15 +1098,7 @@ Gtk::TreeModel::iterator ChannelListTree::AddFolder(const UserSettingsGuildFolde
         auto folder_row = *m_model->append();
         folder_row[m_columns.m_type] = RenderType::Folder;
         folder_row[m_columns.m_id] = *folder.ID;
-        m_tmp_row_map[*folder.ID] = folder_row;
-        if (folder.Name.has_value()) {
-            folder_row[m_columns.m_name] = Glib::Markup::escape_text(*folder.Name);
-        } else {
-            folder_row[m_columns.m_name] = "Folder";
-        }
-        if (folder.Color.has_value()) {
-            folder_row[m_columns.m_color] = IntToRGBA(*folder.Color);
-        }
+        UpdateFolderRow(folder_row, folder);
 
         int sort_value = 0;
         for (const auto &guild_id : folder.GuildIDs) {
@@ -898,6 +1115,19 @@ Gtk::TreeModel::iterator ChannelListTree::AddFolder(const UserSettingsGuildFolde
     return {};
 }
 
+void ChannelListTree::UpdateFolderRow(const Gtk::TreeModel::iterator &iter, const UserSettingsGuildFoldersEntry &folder) {
+    if (folder.Name.has_value()) {
+        (*iter)[m_columns.m_name] = Glib::Markup::escape_text(*folder.Name);
+    } else {
+        (*iter)[m_columns.m_name] = "Folder";
+    }
+    if (folder.Color.has_value()) {
+        (*iter)[m_columns.m_color] = IntToRGBA(*folder.Color);
+    } else {
+        (*iter)[m_columns.m_color] = std::nullopt;
+    }
+}
+
 Gtk::TreeModel::iterator ChannelListTree::AddGuild(const GuildData &guild, const Gtk::TreeNodeChildren &root) {
     auto &discord = Abaddon::Get().GetDiscordClient();
     auto &img = Abaddon::Get().GetImageManager();
@@ -907,7 +1137,6 @@ Gtk::TreeModel::iterator ChannelListTree::AddGuild(const GuildData &guild, const
     guild_row[m_columns.m_id] = guild.ID;
     guild_row[m_columns.m_name] = "<b>" + Glib::Markup::escape_text(guild.Name) + "</b>";
     guild_row[m_columns.m_icon] = img.GetPlaceholder(GuildIconSize);
-    m_tmp_guild_row_map[guild.ID] = guild_row;
 
     if (Abaddon::Get().GetSettings().ShowAnimations && guild.HasAnimatedIcon()) {
         const auto cb = [this, id = guild.ID](const Glib::RefPtr<Gdk::PixbufAnimation> &pb) {
@@ -982,10 +1211,10 @@ Gtk::TreeModel::iterator ChannelListTree::AddGuild(const GuildData &guild, const
             add_voice_participants(channel, channel_row->children());
         }
         channel_row[m_columns.m_id] = channel.ID;
+        IndexRow(channel_row);
         channel_row[m_columns.m_sort] = *channel.Position + OrphanChannelSortOffset;
         channel_row[m_columns.m_nsfw] = channel.NSFW();
         add_threads(channel, channel_row);
-        m_tmp_row_map[channel.ID] = channel_row;
     }
 
     for (const auto &[category_id, channels] : categories) {
@@ -994,10 +1223,10 @@ Gtk::TreeModel::iterator ChannelListTree::AddGuild(const GuildData &guild, const
         auto cat_row = *m_model->append(guild_row.children());
         cat_row[m_columns.m_type] = RenderType::Category;
         cat_row[m_columns.m_id] = category_id;
+        IndexRow(cat_row);
         cat_row[m_columns.m_name] = Glib::Markup::escape_text(*category->Name);
         cat_row[m_columns.m_sort] = *category->Position;
         cat_row[m_columns.m_expanded] = true;
-        m_tmp_row_map[category_id] = cat_row;
         // m_view.expand_row wont work because it might not have channels
 
         for (const auto &channel : channels) {
@@ -1015,10 +1244,10 @@ Gtk::TreeModel::iterator ChannelListTree::AddGuild(const GuildData &guild, const
                 add_voice_participants(channel, channel_row->children());
             }
             channel_row[m_columns.m_id] = channel.ID;
+            IndexRow(channel_row);
             channel_row[m_columns.m_sort] = *channel.Position;
             channel_row[m_columns.m_nsfw] = channel.NSFW();
             add_threads(channel, channel_row);
-            m_tmp_row_map[channel.ID] = channel_row;
         }
     }
 
@@ -1032,6 +1261,7 @@ Gtk::TreeModel::iterator ChannelListTree::UpdateCreateChannelCategory(const Chan
     auto cat_row = *m_model->append(iter->children());
     cat_row[m_columns.m_type] = RenderType::Category;
     cat_row[m_columns.m_id] = channel.ID;
+    IndexRow(cat_row);
     cat_row[m_columns.m_name] = Glib::Markup::escape_text(*channel.Name);
     cat_row[m_columns.m_sort] = *channel.Position;
     cat_row[m_columns.m_expanded] = true;
@@ -1044,6 +1274,7 @@ Gtk::TreeModel::iterator ChannelListTree::CreateThreadRow(const Gtk::TreeNodeChi
     auto thread_row = *thread_iter;
     thread_row[m_columns.m_type] = RenderType::Thread;
     thread_row[m_columns.m_id] = channel.ID;
+    IndexRow(thread_iter);
     thread_row[m_columns.m_name] = "- " + Glib::Markup::escape_text(*channel.Name);
     thread_row[m_columns.m_sort] = static_cast<int64_t>(channel.ID);
     thread_row[m_columns.m_nsfw] = false;
@@ -1055,6 +1286,7 @@ Gtk::TreeModel::iterator ChannelListTree::CreateVoiceParticipantRow(const UserDa
     auto row = *m_model->append(parent);
     row[m_columns.m_type] = RenderType::VoiceParticipant;
     row[m_columns.m_id] = user.ID;
+    IndexRow(row);
     row[m_columns.m_name] = user.GetDisplayNameEscaped();
 
     const auto voice_state = Abaddon::Get().GetDiscordClient().GetVoiceState(user.ID);
@@ -1113,37 +1345,19 @@ Gtk::TreeModel::iterator ChannelListTree::GetIteratorForGuildFromID(Snowflake id
 }
 
 Gtk::TreeModel::iterator ChannelListTree::GetIteratorForRowFromID(Snowflake id) {
-    std::queue<Gtk::TreeModel::iterator> queue;
-    for (const auto &child : m_model->children())
-        for (const auto &child2 : child.children())
-            queue.push(child2);
-
-    while (!queue.empty()) {
-        auto item = queue.front();
-        if ((*item)[m_columns.m_id] == id && (*item)[m_columns.m_type] != RenderType::Guild) return item;
-        for (const auto &child : item->children())
-            queue.push(child);
-        queue.pop();
-    }
-
-    return {};
+    return m_row_index.Find(id);
 }
 
 Gtk::TreeModel::iterator ChannelListTree::GetIteratorForRowFromIDOfType(Snowflake id, RenderType type) {
-    std::queue<Gtk::TreeModel::iterator> queue;
-    for (const auto &child : m_model->children())
-        for (const auto &child2 : child.children())
-            queue.push(child2);
+    return m_row_index.Find(id, type);
+}
 
-    while (!queue.empty()) {
-        auto item = queue.front();
-        if ((*item)[m_columns.m_type] == type && (*item)[m_columns.m_id] == id) return item;
-        for (const auto &child : item->children())
-            queue.push(child);
-        queue.pop();
-    }
+void ChannelListTree::IndexRow(const Gtk::TreeModel::iterator &iter) {
+    m_row_index.Add(iter);
+}
 
-    return {};
+void ChannelListTree::EraseRow(const Gtk::TreeModel::iterator &iter) {
+    m_row_index.Erase(m_model, iter);
 }
 
 bool ChannelListTree::IsTextChannel(ChannelType type) {
@@ -1199,7 +1413,7 @@ void ChannelListTree::AddPrivateChannels() {
     auto &discord = Abaddon::Get().GetDiscordClient();
     auto &img = Abaddon::Get().GetImageManager();
 
-    const auto dm_ids = discord.GetPrivateChannels();
+    const auto &dm_ids = discord.GetPrivateChannels();
     for (const auto dm_id : dm_ids) {
         const auto dm = discord.GetChannel(dm_id);
         if (!dm.has_value()) continue;
@@ -1213,6 +1427,7 @@ void ChannelListTree::AddPrivateChannels() {
         auto row = *iter;
         row[m_columns.m_type] = RenderType::DM;
         row[m_columns.m_id] = dm_id;
+        IndexRow(iter);
         row[m_columns.m_name] = Glib::Markup::escape_text(dm->GetDisplayName());
         row[m_columns.m_sort] = static_cast<int64_t>(-(dm->LastMessageID.has_value() ? *dm->LastMessageID : dm_id));
         row[m_columns.m_icon] = img.GetPlaceholder(DMIconSize);
@@ -1236,6 +1451,7 @@ void ChannelListTree::UpdateCreateDMChannel(const ChannelData &dm) {
     auto row = *iter;
     row[m_columns.m_type] = RenderType::DM;
     row[m_columns.m_id] = dm.ID;
+    IndexRow(iter);
     row[m_columns.m_name] = Glib::Markup::escape_text(dm.GetDisplayName());
     row[m_columns.m_sort] = static_cast<int64_t>(-(dm.LastMessageID.has_value() ? *dm.LastMessageID : dm.ID));
     row[m_columns.m_icon] = img.GetPlaceholder(DMIconSize);
@@ -1312,6 +1528,7 @@ void ChannelListTree::RedrawUnreadIndicatorsForChannel(const ChannelData &channe
 }
 
 void ChannelListTree::OnMessageAck(const MessageAckData &data) {
+    TRACE_ZONE("ChannelListTree::OnMessageAck");
     // trick renderer into redrawing
     m_model->row_changed(Gtk::TreeModel::Path("0"), m_model->get_iter("0")); // 0 is always path for dm header
     auto iter = GetIteratorForRowFromID(data.ChannelID);
@@ -1323,6 +1540,7 @@ void ChannelListTree::OnMessageAck(const MessageAckData &data) {
 }
 
 void ChannelListTree::OnMessageCreate(const Message &msg) {
+    TRACE_ZONE("ChannelListTree::OnMessageCreate");
     auto iter = GetIteratorForRowFromID(msg.ChannelID);
     if (iter) m_model->row_changed(m_model->get_path(iter), iter); // redraw
     const auto channel = Abaddon::Get().GetDiscordClient().GetChannel(msg.ChannelID);
@@ -1334,6 +1552,35 @@ void ChannelListTree::OnMessageCreate(const Message &msg) {
     RedrawUnreadIndicatorsForChannel(*channel);
 }
 
+bool ChannelListTree::OnMotionNotifyEvent(GdkEventMotion *ev) {
+    Snowflake hovered;
+    Gtk::TreeModel::Path path;
+    if (m_view.get_path_at_pos(static_cast<int>(ev->x), static_cast<int>(ev->y), path)) {
+        path = m_filter_model->convert_path_to_child_path(m_sort_model->convert_path_to_child_path(path));
+        if (path) {
+            auto row = (*m_model->get_iter(path));
+            const auto type = static_cast<RenderType>(row[m_columns.m_type]);
+            if (type == RenderType::TextChannel || type == RenderType::DM || type == RenderType::Thread)
+                hovered = static_cast<Snowflake>(row[m_columns.m_id]);
+        }
+    }
+
+    if (hovered != m_hovered_channel) {
+        m_hovered_channel = hovered;
+        m_signal_channel_hovered.emit(hovered);
+    }
+
+    return false;
+}
+
+bool ChannelListTree::OnLeaveNotifyEvent(GdkEventCrossing *ev) {
+    if (m_hovered_channel.IsValid()) {
+        m_hovered_channel = Snowflake::Invalid;
+        m_signal_channel_hovered.emit(Snowflake::Invalid);
+    }
+    return false;
+}
+
 bool ChannelListTree::OnButtonPressEvent(GdkEventButton *ev) {
     if (ev->button == GDK_BUTTON_SECONDARY && ev->type == GDK_BUTTON_PRESS) {
         if (m_view.get_path_at_pos(static_cast<int>(ev->x), static_cast<int>(ev->y), m_path_for_menu)) {
@@ -1387,7 +1634,8 @@ bool ChannelListTree::OnButtonPressEvent(GdkEventButton *ev) {
 
 void ChannelListTree::MoveRow(const Gtk::TreeModel::iterator &iter, const Gtk::TreeModel::iterator &new_parent) {
     // duplicate the row data under the new parent and then delete the old row
-    auto row = *m_model->append(new_parent->children());
+    // no parent means the top level
+    auto row = new_parent ? *m_model->append(new_parent->children()) : *m_model->append();
     // would be nice to be able to get all columns out at runtime so i dont need this
 #define M(name) \
     row[m_columns.name] = static_cast<decltype(m_columns.name)::ElementType>((*iter)[m_columns.name]);
@@ -1400,7 +1648,9 @@ void ChannelListTree::MoveRow(const Gtk::TreeModel::iterator &iter, const Gtk::T
     M(m_nsfw);
     M(m_expanded);
     M(m_color);
+    M(m_voice_flags);
 #undef M
+    IndexRow(row);
 
     // recursively move children
     // weird construct to work around iterator invalidation (at least i think thats what the problem was)
@@ -1410,7 +1660,7 @@ void ChannelListTree::MoveRow(const Gtk::TreeModel::iterator &iter, const Gtk::T
         MoveRow(children[i], row);
 
     // delete original
-    m_model->erase(iter);
+    EraseRow(iter);
 }
 
 void ChannelListTree::OnGuildSubmenuPopup() {
@@ -1546,6 +1796,10 @@ ChannelListTree::type_signal_action_guild_settings ChannelListTree::signal_actio
     return m_signal_action_guild_settings;
 }
 
+ChannelListTree::type_signal_channel_hovered ChannelListTree::signal_channel_hovered() {
+    return m_signal_channel_hovered;
+}
+
 #ifdef WITH_LIBHANDY
 ChannelListTree::type_signal_action_open_new_tab ChannelListTree::signal_action_open_new_tab() {
     return m_signal_action_open_new_tab;
@@ -15,6 +15,7 @@
 #include "discord/discord.hpp"
 #include "state.hpp"
 #include "cellrendererchannels.hpp"
+#include "rowindex.hpp"
 
 constexpr static int GuildIconSize = 24;
 constexpr static int DMIconSize = 20;
@@ -45,6 +46,13 @@ protected:
 
     void UpdateListingClassic();
 
+    // brings the existing rows in line with the store in place instead of rebuilding
+    // so expansion, selection and scroll position survive
+    // contents also reconciles the channels of guilds that are already listed and the dms
+    void ReconcileListing(bool contents = true);
+    void ReconcileGuild(const Gtk::TreeModel::iterator &guild_iter, const GuildData &guild);
+    void ReconcilePrivateChannels();
+
     void UpdateNewGuild(const GuildData &guild);
     void UpdateRemoveGuild(Snowflake id);
     void UpdateRemoveChannel(Snowflake id);
@@ -101,6 +109,7 @@ protected:
     Gtk::TreeIter ConvertViewIterToModel(const Gtk::TreeIter &iter);
     Gtk::TreePath GetViewPathFromViewIter(const Gtk::TreeIter &iter);
     Gtk::TreeModel::iterator AddFolder(const UserSettingsGuildFoldersEntry &folder);
+    void UpdateFolderRow(const Gtk::TreeModel::iterator &iter, const UserSettingsGuildFoldersEntry &folder);
     Gtk::TreeModel::iterator AddGuild(const GuildData &guild, const Gtk::TreeNodeChildren &root);
     Gtk::TreeModel::iterator UpdateCreateChannelCategory(const ChannelData &channel);
     Gtk::TreeModel::iterator CreateThreadRow(const Gtk::TreeNodeChildren &children, const ChannelData &channel);
@@ -114,12 +123,19 @@ protected:
     Gtk::TreeModel::iterator GetIteratorForRowFromID(Snowflake id);
     Gtk::TreeModel::iterator GetIteratorForRowFromIDOfType(Snowflake id, RenderType type);
 
+    // any row removal has to go through EraseRow to keep the index in sync
+    void IndexRow(const Gtk::TreeModel::iterator &iter);
+    void EraseRow(const Gtk::TreeModel::iterator &iter);
+    ChannelListRowIndex m_row_index;
+
     bool IsTextChannel(ChannelType type);
 
     void OnRowCollapsed(const Gtk::TreeModel::iterator &iter, const Gtk::TreeModel::Path &path) const;
     void OnRowExpanded(const Gtk::TreeModel::iterator &iter, const Gtk::TreeModel::Path &path);
     bool SelectionFunc(const Glib::RefPtr<Gtk::TreeModel> &model, const Gtk::TreeModel::Path &path, bool is_currently_selected);
     bool OnButtonPressEvent(GdkEventButton *ev);
+    bool OnMotionNotifyEvent(GdkEventMotion *ev);
+    bool OnLeaveNotifyEvent(GdkEventCrossing *ev);
 
     void MoveRow(const Gtk::TreeModel::iterator &iter, const Gtk::TreeModel::iterator &new_parent);
 
@@ -135,6 +151,7 @@ protected:
     void OnMessageCreate(const Message &msg);
 
     Gtk::TreeModel::Path m_path_for_menu;
+    Snowflake m_hovered_channel;
 
     // cant be recovered through selection
     Gtk::TreeModel::iterator m_temporary_thread_row;
@@ -206,14 +223,11 @@ protected:
 
     Snowflake m_active_channel;
 
-    // hashtable for the billion lookups done in UseExpansionState
-    std::unordered_map<Snowflake, Gtk::TreeModel::iterator> m_tmp_row_map;
-    std::unordered_map<Snowflake, Gtk::TreeModel::iterator> m_tmp_guild_row_map;
-
 public:
     using type_signal_action_channel_item_select = sigc::signal<void, Snowflake>;
     using type_signal_action_guild_leave = sigc::signal<void, Snowflake>;
     using type_signal_action_guild_settings = sigc::signal<void, Snowflake>;
+    using type_signal_channel_hovered = sigc::signal<void, Snowflake>; // invalid when the pointer leaves
 
 #ifdef WITH_LIBHANDY
     using type_signal_action_open_new_tab = sigc::signal<void, Snowflake>;
@@ -231,11 +245,13 @@ public:
     type_signal_action_channel_item_select signal_action_channel_item_select();
     type_signal_action_guild_leave signal_action_guild_leave();
     type_signal_action_guild_settings signal_action_guild_settings();
+    type_signal_channel_hovered signal_channel_hovered();
 
 private:
     type_signal_action_channel_item_select m_signal_action_channel_item_select;
     type_signal_action_guild_leave m_signal_action_guild_leave;
     type_signal_action_guild_settings m_signal_action_guild_settings;
+    type_signal_channel_hovered m_signal_channel_hovered;
 
 #ifdef WITH_LIBHANDY
     type_signal_action_open_new_tab m_signal_action_open_new_tab;
@@ -0,0 +1,54 @@
+#include "rowindex.hpp"
+
+#include <algorithm>
+#include <queue>
+
+ChannelListRowIndex::ChannelListRowIndex(const Gtk::TreeModelColumn<RenderType> &type_column, const Gtk::TreeModelColumn<uint64_t> &id_column)
+    : m_type(type_column)
+    , m_id(id_column) {}
+
+void ChannelListRowIndex::Add(const Gtk::TreeModel::iterator &iter) {
+    const auto type = static_cast<RenderType>((*iter)[m_type]);
+    if (type == RenderType::Folder || type == RenderType::Guild || type == RenderType::DMHeader) return;
+    const auto id = static_cast<Snowflake>((*iter)[m_id]);
+    m_rows[id].push_back(iter);
+}
+
+void ChannelListRowIndex::Erase(const Glib::RefPtr<Gtk::TreeStore> &model, const Gtk::TreeModel::iterator &iter) {
+    // treestore iters stay valid until their row is removed so drop every row in the subtree first
+    std::queue<Gtk::TreeModel::iterator> queue;
+    queue.push(iter);
+    while (!queue.empty()) {
+        auto item = queue.front();
+        queue.pop();
+        const auto id = static_cast<Snowflake>((*item)[m_id]);
+        if (auto it = m_rows.find(id); it != m_rows.end()) {
+            auto &rows = it->second;
+            rows.erase(std::remove(rows.begin(), rows.end(), item), rows.end());
+            if (rows.empty()) m_rows.erase(it);
+        }
+        for (const auto &child : item->children())
+            queue.push(child);
+    }
+
+    model->erase(iter);
+}
+
+void ChannelListRowIndex::Clear() {
+    m_rows.clear();
+}
+
+Gtk::TreeModel::iterator ChannelListRowIndex::Find(Snowflake id) const {
+    const auto it = m_rows.find(id);
+    if (it == m_rows.end() || it->second.empty()) return {};
+    return it->second.front();
+}
+
+Gtk::TreeModel::iterator ChannelListRowIndex::Find(Snowflake id, RenderType type) const {
+    const auto it = m_rows.find(id);
+    if (it == m_rows.end()) return {};
+    for (const auto &iter : it->second) {
+        if ((*iter)[m_type] == type) return iter;
+    }
+    return {};
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <gtkmm/treestore.h>
+#include "discord/snowflake.hpp"
+#include "cellrendererchannels.hpp"
+
+// rows below the top level of the channel list by id so lookups dont have to walk the whole tree
+// treestore iters are persistent so they stay usable until the row is removed
+// any row removal has to go through Erase to keep this in sync
+class ChannelListRowIndex {
+public:
+    ChannelListRowIndex(const Gtk::TreeModelColumn<RenderType> &type_column, const Gtk::TreeModelColumn<uint64_t> &id_column);
+
+    // folders, guilds and the dm header are skipped, guilds and channels can share ids
+    void Add(const Gtk::TreeModel::iterator &iter);
+    // drops the row and its whole subtree from the index, then from the model
+    void Erase(const Glib::RefPtr<Gtk::TreeStore> &model, const Gtk::TreeModel::iterator &iter);
+    void Clear();
+
+    [[nodiscard]] Gtk::TreeModel::iterator Find(Snowflake id) const;
+    [[nodiscard]] Gtk::TreeModel::iterator Find(Snowflake id, RenderType type) const;
+
+private:
+    const Gtk::TreeModelColumn<RenderType> &m_type;
+    const Gtk::TreeModelColumn<uint64_t> &m_id;
+    std::unordered_map<Snowflake, std::vector<Gtk::TreeModel::iterator>> m_rows;
+};
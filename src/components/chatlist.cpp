@@ -2,6 +2,7 @@
 #include "abaddon.hpp"
 #include "chatmessage.hpp"
 #include "constants.hpp"
+#include "trace.hpp"
 
 ChatList::ChatList() {
     m_list.get_style_context()->add_class("messages");
@@ -43,6 +44,7 @@ void ChatList::SetActiveChannel(Snowflake id) {
 }
 
 void ChatList::ProcessNewMessage(const Message &data, bool prepend) {
+    TRACE_ZONE("ChatList::ProcessNewMessage");
     auto &discord = Abaddon::Get().GetDiscordClient();
     if (!discord.IsStarted()) return;
     if (!prepend) m_ignore_next_upper = true;
@@ -183,6 +185,65 @@ void ChatList::ProcessNewMessage(const Message &data, bool prepend) {
     }
 }
 
+// brings whatever is listed in line with a freshly fetched page of the newest messages
+// without rebuilding rows that didn't change
+void ChatList::MergeMessages(std::vector<Message> msgs) {
+    if (msgs.empty()) return;
+    std::sort(msgs.begin(), msgs.end(), [](const Message &a, const Message &b) { return a.ID < b.ID; });
+
+    if (m_id_to_widget.empty()) {
+        SetMessages(msgs.begin(), msgs.end());
+        return;
+    }
+
+    const Snowflake oldest_listed = m_id_to_widget.begin()->first;
+    const Snowflake newest_listed = m_id_to_widget.rbegin()->first;
+
+    // a missing message in the middle of what's listed cant be slotted in, so just start over
+    for (const auto &msg : msgs) {
+        if (msg.ID > oldest_listed && msg.ID < newest_listed && m_id_to_widget.find(msg.ID) == m_id_to_widget.end()) {
+            SetMessages(msgs.begin(), msgs.end());
+            return;
+        }
+    }
+
+    // anything listed inside the fetched range that isnt in the page was deleted while we werent looking
+    // a short page is the whole channel
+    const Snowflake lower = msgs.size() < static_cast<size_t>(MaxMessagesForChatCull) ? Snowflake(0ULL) : msgs.front().ID;
+    const Snowflake upper = msgs.back().ID;
+    std::unordered_set<Snowflake> fetched;
+    for (const auto &msg : msgs)
+        fetched.insert(msg.ID);
+    for (auto it = m_id_to_widget.begin(); it != m_id_to_widget.end();) {
+        if (it->first >= lower && it->first <= upper && fetched.find(it->first) == fetched.end()) {
+            RemoveMessageAndHeader(it->second);
+            it = m_id_to_widget.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    for (const auto &msg : msgs) {
+        if (auto it = m_id_to_widget.find(msg.ID); it != m_id_to_widget.end()) {
+            auto *container = dynamic_cast<ChatMessageItemContainer *>(it->second);
+            if (container != nullptr && container->EditedTimestamp != msg.EditedTimestamp) {
+                container->UpdateContent();
+                container->UpdateAttributes();
+            }
+        }
+    }
+
+    for (auto it = msgs.rbegin(); it != msgs.rend(); it++) {
+        if (it->ID < oldest_listed)
+            ProcessNewMessage(*it, true);
+    }
+
+    for (const auto &msg : msgs) {
+        if (msg.ID > newest_listed)
+            ProcessNewMessage(msg, false);
+    }
+}
+
 void ChatList::DeleteMessage(Snowflake id) {
     auto widget = m_id_to_widget.find(id);
     if (widget == m_id_to_widget.end()) return;
@@ -217,6 +278,10 @@ Snowflake ChatList::GetOldestListedMessage() {
         return Snowflake::Invalid;
 }
 
+int ChatList::GetNumMessages() const noexcept {
+    return m_num_messages;
+}
+
 void ChatList::UpdateMessageReactions(Snowflake id) {
     auto it = m_id_to_widget.find(id);
     if (it == m_id_to_widget.end()) return;
@@ -251,7 +316,7 @@ std::vector<Snowflake> ChatList::GetRecentAuthors() {
 
     const auto chan = discord.GetChannel(m_active_channel);
     if (chan->GuildID.has_value()) {
-        const auto others = discord.GetUsersInGuild(*chan->GuildID);
+        const auto &others = discord.GetUsersInGuild(*chan->GuildID);
         for (const auto id : others)
             if (std::find(ret.begin(), ret.end(), id) == ret.end())
                 ret.push_back(id);
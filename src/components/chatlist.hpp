@@ -18,9 +18,11 @@ public:
     template<typename Iter>
     void PrependMessages(Iter begin, Iter end);
     void ProcessNewMessage(const Message &data, bool prepend);
+    void MergeMessages(std::vector<Message> msgs);
     void DeleteMessage(Snowflake id);
     void RefetchMessage(Snowflake id);
     Snowflake GetOldestListedMessage();
+    [[nodiscard]] int GetNumMessages() const noexcept;
     void UpdateMessageReactions(Snowflake id);
     void SetFailedByNonce(const std::string &nonce);
     std::vector<Snowflake> GetRecentAuthors();
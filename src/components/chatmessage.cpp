@@ -25,6 +25,7 @@ ChatMessageItemContainer *ChatMessageItemContainer::FromMessage(const Message &d
 
     if (data.Nonce.has_value())
         container->Nonce = *data.Nonce;
+    container->EditedTimestamp = data.EditedTimestamp;
 
     if (!data.Content.empty() || data.Type != MessageType::DEFAULT) {
         container->m_text_component = container->CreateTextComponent(data);
@@ -89,6 +90,8 @@ ChatMessageItemContainer *ChatMessageItemContainer::FromMessage(const Message &d
 // this doesnt rly make sense
 void ChatMessageItemContainer::UpdateContent() {
     const auto data = Abaddon::Get().GetDiscordClient().GetMessage(ID);
+    if (data.has_value())
+        EditedTimestamp = data->EditedTimestamp;
     if (m_text_component != nullptr)
         UpdateTextComponent(m_text_component);
 
@@ -190,12 +193,7 @@ void ChatMessageItemContainer::UpdateTextComponent(Gtk::TextView *tv) {
     switch (data->Type) {
         case MessageType::DEFAULT:
         case MessageType::INLINE_REPLY:
-            b->insert(s, data->Content);
-            ChatUtil::HandleRoleMentions(b);
-            ChatUtil::HandleUserMentions(b, ChannelID, false);
-            HandleLinks(*tv);
-            HandleChannelMentions(tv);
-            ChatUtil::HandleEmojis(*tv);
+            AppendTokens(*tv, *ChatUtil::GetTokens(*data));
             break;
         case MessageType::USER_PREMIUM_GUILD_SUBSCRIPTION:
             b->insert_markup(s, "<span color='#999999'><i>[boosted server]</i></span>");
@@ -217,11 +215,7 @@ void ChatMessageItemContainer::UpdateTextComponent(Gtk::TextView *tv) {
                     b->insert_markup(s, "<i>used <span color='#697ec4'>" + cmd + "</span> with " + app + "</i>");
                 }
             } else {
-                b->insert(s, data->Content);
-                ChatUtil::HandleUserMentions(b, ChannelID, false);
-                HandleLinks(*tv);
-                HandleChannelMentions(tv);
-                ChatUtil::HandleEmojis(*tv);
+                AppendTokens(*tv, *ChatUtil::GetTokens(*data));
             }
         } break;
         case MessageType::RECIPIENT_ADD: {
@@ -290,6 +284,91 @@ void ChatMessageItemContainer::UpdateTextComponent(Gtk::TextView *tv) {
     }
 }
 
+// everything is appended so there are never any offsets to fix up
+void ChatMessageItemContainer::AppendTokens(Gtk::TextView &tv, const ChatUtil::TokenList &tokens) {
+    const auto &discord = Abaddon::Get().GetDiscordClient();
+    const auto &settings = Abaddon::Get().GetSettings();
+    auto &emojis = Abaddon::Get().GetEmojis();
+    auto buf = tv.get_buffer();
+
+    const auto get_style_tag = [&buf](const char *name, const std::function<void(const Glib::RefPtr<Gtk::TextTag> &)> &init) {
+        auto tag = buf->get_tag_table()->lookup(name);
+        if (!tag) {
+            tag = buf->create_tag(name);
+            init(tag);
+        }
+        return tag;
+    };
+
+    for (const auto &token : tokens) {
+        const int start_offset = buf->end().get_offset();
+
+        switch (token.Type) {
+            case ChatUtil::TokenType::Text:
+                buf->insert(buf->end(), token.Text);
+                break;
+            case ChatUtil::TokenType::UserMention:
+            case ChatUtil::TokenType::RoleMention: {
+                const auto markup = token.Type == ChatUtil::TokenType::UserMention ? ChatUtil::GetUserMentionMarkup(token.ID, ChannelID) : ChatUtil::GetRoleMentionMarkup(token.ID);
+                if (markup.has_value()) {
+                    buf->insert_markup(buf->end(), *markup);
+                    if (settings.ShowStockEmojis)
+                        emojis.ReplaceEmojis(buf, EmojiSize, start_offset);
+                } else {
+                    buf->insert(buf->end(), token.Text);
+                }
+            } break;
+            case ChatUtil::TokenType::ChannelMention: {
+                const auto chan = discord.GetChannel(token.ID);
+                if (!chan.has_value()) {
+                    buf->insert(buf->end(), token.Text);
+                    break;
+                }
+                auto tag = buf->create_tag();
+                if (chan->Type == ChannelType::GUILD_TEXT) {
+                    m_channel_tagmap[tag] = token.ID;
+                    tag->property_weight() = Pango::WEIGHT_BOLD;
+                }
+                buf->insert_with_tag(buf->end(), "#" + *chan->Name, tag);
+                if (settings.ShowStockEmojis)
+                    emojis.ReplaceEmojis(buf, EmojiSize, start_offset);
+            } break;
+            case ChatUtil::TokenType::Link: {
+                auto tag = buf->create_tag();
+                m_link_tagmap[tag] = token.Text;
+                const auto color = tv.get_style_context()->get_color(Gtk::STATE_FLAG_LINK);
+                tag->property_foreground_rgba() = color;
+                tag->set_property("underline", 1); // stupid workaround for vcpkg bug (i think)
+                buf->insert_with_tag(buf->end(), token.Text, tag);
+            } break;
+            case ChatUtil::TokenType::CustomEmoji:
+                if (settings.ShowCustomEmojis)
+                    ChatUtil::AppendCustomEmoji(tv, token);
+                else
+                    buf->insert(buf->end(), token.Text);
+                break;
+            case ChatUtil::TokenType::StockEmoji: {
+                Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+                if (settings.ShowStockEmojis)
+                    pixbuf = emojis.GetPixBuf(token.Text, EmojiSize);
+                if (pixbuf)
+                    buf->insert_pixbuf(buf->end(), pixbuf);
+                else
+                    buf->insert(buf->end(), token.Text);
+            } break;
+        }
+
+        if (token.Style == ChatUtil::STYLE_NONE) continue;
+        const auto start_it = buf->get_iter_at_offset(start_offset);
+        if (token.Style & ChatUtil::STYLE_BOLD)
+            buf->apply_tag(get_style_tag("bold", [](const auto &tag) { tag->property_weight() = Pango::WEIGHT_BOLD; }), start_it, buf->end());
+        if (token.Style & ChatUtil::STYLE_STRIKE)
+            buf->apply_tag(get_style_tag("strike", [](const auto &tag) { tag->property_strikethrough() = true; }), start_it, buf->end());
+        if (token.Style & ChatUtil::STYLE_CODE)
+            buf->apply_tag(get_style_tag("code", [](const auto &tag) { tag->property_family() = "monospace"; }), start_it, buf->end());
+    }
+}
+
 Gtk::Widget *ChatMessageItemContainer::CreateEmbedsComponent(const std::vector<EmbedData> &embeds) {
     auto *box = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_VERTICAL));
     for (const auto &embed : embeds) {
@@ -619,10 +698,10 @@ Gtk::Widget *ChatMessageItemContainer::CreateReactionsComponent(const Message &d
             if (!shortcode.empty())
                 ev->set_tooltip_text(shortcode);
 
-            const auto &pb = emojis.GetPixBuf(reaction.Emoji.Name);
+            const auto &pb = emojis.GetPixBuf(reaction.Emoji.Name, 16);
             Gtk::Image *img;
             if (pb)
-                img = Gtk::manage(new Gtk::Image(pb->scale_simple(16, 16, Gdk::INTERP_BILINEAR)));
+                img = Gtk::manage(new Gtk::Image(pb));
             else
                 img = Gtk::manage(new Gtk::Image(placeholder));
             img->set_can_focus(false);
@@ -797,10 +876,6 @@ void ChatMessageItemContainer::HandleChannelMentions(const Glib::RefPtr<Gtk::Tex
     }
 }
 
-void ChatMessageItemContainer::HandleChannelMentions(Gtk::TextView *tv) {
-    HandleChannelMentions(tv->get_buffer());
-}
-
 // a lot of repetition here so there should probably just be one slot for textview's button-press
 bool ChatMessageItemContainer::OnClickChannel(GdkEventButton *ev) {
     if (m_text_component == nullptr) return false;
@@ -849,35 +924,6 @@ void ChatMessageItemContainer::on_link_menu_copy() {
     Gtk::Clipboard::get()->set_text(m_selected_link);
 }
 
-void ChatMessageItemContainer::HandleLinks(Gtk::TextView &tv) {
-    const auto rgx = Glib::Regex::create(R"(\bhttps?:\/\/[^\s]+\.[^\s]+\b)");
-
-    auto buf = tv.get_buffer();
-    Glib::ustring text = ChatUtil::GetText(buf);
-
-    int startpos = 0;
-    Glib::MatchInfo match;
-    while (rgx->match(text, startpos, match)) {
-        int mstart, mend;
-        match.fetch_pos(0, mstart, mend);
-        std::string link = match.fetch(0);
-        auto tag = buf->create_tag();
-        m_link_tagmap[tag] = link;
-        const auto color = tv.get_style_context()->get_color(Gtk::STATE_FLAG_LINK);
-        tag->property_foreground_rgba() = color;
-        tag->set_property("underline", 1); // stupid workaround for vcpkg bug (i think)
-
-        const auto chars_start = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mstart);
-        const auto chars_end = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mend);
-        const auto erase_from = buf->get_iter_at_offset(chars_start);
-        const auto erase_to = buf->get_iter_at_offset(chars_end);
-        auto it = buf->erase(erase_from, erase_to);
-        it = buf->insert_with_tag(it, link, tag);
-
-        startpos = mend;
-    }
-}
-
 bool ChatMessageItemContainer::OnLinkClick(GdkEventButton *ev) {
     if (m_text_component == nullptr) return false;
     if (ev->type != GDK_BUTTON_PRESS) return false;
@@ -933,7 +979,6 @@ ChatMessageHeader::ChatMessageHeader(const Message &data)
     ChannelID = data.ChannelID;
 
     const auto author = Abaddon::Get().GetDiscordClient().GetUser(UserID);
-    auto &img = Abaddon::Get().GetImageManager();
 
     std::string avatar_url;
     if (data.IsWebhook()) {
@@ -946,18 +991,7 @@ ChatMessageHeader::ChatMessageHeader(const Message &data)
         avatar_url = author->GetAvatarURL(data.GuildID);
     }
 
-    auto cb = [this](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
-        m_static_avatar = pb->scale_simple(AvatarSize, AvatarSize, Gdk::INTERP_BILINEAR);
-        m_avatar.property_pixbuf() = m_static_avatar;
-    };
-    img.LoadFromURL(avatar_url, sigc::track_obj(cb, *this));
-
-    if (author->HasAnimatedAvatar(data.GuildID)) {
-        auto cb = [this](const Glib::RefPtr<Gdk::PixbufAnimation> &pb) {
-            m_anim_avatar = pb;
-        };
-        img.LoadAnimationFromURL(author->GetAvatarURL(data.GuildID, "gif"), AvatarSize, AvatarSize, sigc::track_obj(cb, *this));
-    }
+    LoadAvatar(avatar_url, author->HasAnimatedAvatar(data.GuildID) ? author->GetAvatarURL(data.GuildID, "gif") : "");
 
     get_style_context()->add_class("message-container");
     m_author.get_style_context()->add_class("message-container-author");
@@ -1059,12 +1093,51 @@ ChatMessageHeader::ChatMessageHeader(const Message &data)
         discord.signal_role_update().connect(sigc::track_obj(role_update_cb, *this));
         auto guild_member_update_cb = [this](const auto &, const auto &) { UpdateName(); };
         discord.signal_guild_member_update().connect(sigc::track_obj(guild_member_update_cb, *this));
+        // every header listening to every chunk adds up with a long history, so only the ones still waiting on a member do
+        if (data.GuildID.has_value() && !discord.HasMember(data.Author.ID, *data.GuildID)) {
+            auto members_chunk_cb = [this, guild_id = *data.GuildID](const GuildMembersChunkData &chunk) { OnMembersChunk(guild_id, chunk); };
+            m_members_chunk_conn = discord.signal_guild_members_chunk().connect(sigc::track_obj(members_chunk_cb, *this));
+        }
         UpdateName();
     }
     AttachUserMenuHandler(m_meta_ev);
     AttachUserMenuHandler(m_avatar_ev);
 }
 
+void ChatMessageHeader::LoadAvatar(const std::string &url, const std::string &animated_url) {
+    auto &img = Abaddon::Get().GetImageManager();
+
+    auto cb = [this](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
+        m_static_avatar = pb->scale_simple(AvatarSize, AvatarSize, Gdk::INTERP_BILINEAR);
+        m_avatar.property_pixbuf() = m_static_avatar;
+    };
+    img.LoadFromURL(url, sigc::track_obj(cb, *this));
+
+    if (!animated_url.empty()) {
+        auto cb = [this](const Glib::RefPtr<Gdk::PixbufAnimation> &pb) {
+            m_anim_avatar = pb;
+        };
+        img.LoadAnimationFromURL(animated_url, AvatarSize, AvatarSize, sigc::track_obj(cb, *this));
+    }
+}
+
+// member data requested for this message showed up, so the name color and guild avatar can be filled in
+void ChatMessageHeader::OnMembersChunk(Snowflake guild_id, const GuildMembersChunkData &chunk) {
+    if (chunk.GuildID != guild_id) return;
+    const auto it = std::find_if(chunk.Members.begin(), chunk.Members.end(), [this](const GuildMember &member) {
+        return member.User->ID == UserID;
+    });
+    if (it == chunk.Members.end()) return;
+    m_members_chunk_conn.disconnect();
+
+    UpdateName();
+    if (it->Avatar.has_value()) {
+        const auto author = Abaddon::Get().GetDiscordClient().GetUser(UserID);
+        if (author.has_value())
+            LoadAvatar(author->GetAvatarURL(guild_id), author->HasAnimatedAvatar(guild_id) ? author->GetAvatarURL(guild_id, "gif") : "");
+    }
+}
+
 void ChatMessageHeader::UpdateName() {
     const auto &discord = Abaddon::Get().GetDiscordClient();
     const auto user = discord.GetUser(UserID);
@@ -6,6 +6,7 @@
 #include <gtkmm/listboxrow.h>
 #include <gtkmm/textview.h>
 #include "discord/discord.hpp"
+#include "misc/chatutil.hpp"
 
 class ChatMessageItemContainer : public Gtk::EventBox {
 public:
@@ -13,6 +14,7 @@ public:
     Snowflake ChannelID;
 
     std::string Nonce;
+    std::string EditedTimestamp; // as of the last render
 
     ChatMessageItemContainer();
     static ChatMessageItemContainer *FromMessage(const Message &data);
@@ -27,6 +29,7 @@ protected:
     static void AddClickHandler(Gtk::Widget *widget, const std::string &);
     Gtk::TextView *CreateTextComponent(const Message &data); // Message.Content
     void UpdateTextComponent(Gtk::TextView *tv);
+    void AppendTokens(Gtk::TextView &tv, const ChatUtil::TokenList &tokens);
     Gtk::Widget *CreateEmbedsComponent(const std::vector<EmbedData> &embeds);
     static Gtk::Widget *CreateEmbedComponent(const EmbedData &data); // Message.Embeds[0]
     Gtk::Widget *CreateImageComponent(const std::string &proxy_url, const std::string &url, int inw, int inh);
@@ -38,7 +41,6 @@ protected:
     static bool IsEmbedImageOnly(const EmbedData &data);
 
     void HandleChannelMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf);
-    void HandleChannelMentions(Gtk::TextView *tv);
     bool OnClickChannel(GdkEventButton *ev);
     bool OnTextViewButtonPress(GdkEventButton *ev);
 
@@ -49,7 +51,6 @@ protected:
     void on_link_menu_copy();
     Glib::ustring m_selected_link;
 
-    void HandleLinks(Gtk::TextView &tv);
     bool OnLinkClick(GdkEventButton *ev);
     std::map<Glib::RefPtr<Gtk::TextTag>, std::string> m_link_tagmap;
     std::map<Glib::RefPtr<Gtk::TextTag>, Snowflake> m_channel_tagmap;
@@ -90,6 +91,8 @@ public:
 
 protected:
     void AttachUserMenuHandler(Gtk::Widget &widget);
+    void LoadAvatar(const std::string &url, const std::string &animated_url);
+    void OnMembersChunk(Snowflake guild_id, const GuildMembersChunkData &chunk);
 
     bool on_author_button_press(GdkEventButton *ev);
 
@@ -109,6 +112,8 @@ protected:
     Glib::RefPtr<Gdk::Pixbuf> m_static_avatar;
     Glib::RefPtr<Gdk::PixbufAnimation> m_anim_avatar;
 
+    sigc::connection m_members_chunk_conn; // only while the member is missing
+
     typedef sigc::signal<void> type_signal_action_insert_mention;
     typedef sigc::signal<void, const GdkEvent *> type_signal_action_open_user_menu;
 
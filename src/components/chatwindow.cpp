@@ -14,7 +14,6 @@ ChatWindow::ChatWindow() {
     discord.signal_message_send_fail().connect(sigc::mem_fun(*this, &ChatWindow::OnMessageSendFail));
 
     m_main = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_VERTICAL));
-    m_chat = Gtk::manage(new ChatList);
     m_input = Gtk::manage(new ChatInput);
     m_input_indicator = Gtk::manage(new ChatInputIndicator);
     m_rate_limit_indicator = Gtk::manage(new RateLimitIndicator);
@@ -68,29 +67,8 @@ ChatWindow::ChatWindow() {
 
     m_completer.show();
 
-    m_chat->signal_action_channel_click().connect([this](Snowflake id) {
-        m_signal_action_channel_click.emit(id, true);
-    });
-    m_chat->signal_action_chat_load_history().connect([this](Snowflake id) {
-        m_signal_action_chat_load_history.emit(id);
-    });
-    m_chat->signal_action_insert_mention().connect([this](Snowflake id) {
-        // lowkey gross
-        m_signal_action_insert_mention.emit(id);
-    });
-    m_chat->signal_action_message_edit().connect([this](Snowflake channel_id, Snowflake message_id) {
-        m_signal_action_message_edit.emit(channel_id, message_id);
-    });
-    m_chat->signal_action_reaction_add().connect([this](Snowflake id, const Glib::ustring &param) {
-        m_signal_action_reaction_add.emit(id, param);
-    });
-    m_chat->signal_action_reaction_remove().connect([this](Snowflake id, const Glib::ustring &param) {
-        m_signal_action_reaction_remove.emit(id, param);
-    });
-    m_chat->signal_action_reply_to().connect([this](Snowflake id) {
-        StartReplying(id);
-    });
-    m_chat->show();
+    SwitchChatView(Snowflake::Invalid);
+    m_chat_stack.show();
 
     m_meta->set_hexpand(true);
     m_meta->set_halign(Gtk::ALIGN_FILL);
@@ -104,7 +82,7 @@ ChatWindow::ChatWindow() {
     m_tab_switcher->show();
 #endif
     m_main->add(m_topic);
-    m_main->add(*m_chat);
+    m_main->add(m_chat_stack);
     m_main->add(m_completer);
     m_main->add(*m_input);
     m_main->add(*m_meta);
@@ -121,12 +99,97 @@ ChatWindow::ChatWindow() {
     m_main->show();
 }
 
+ChatList *ChatWindow::CreateChatView(Snowflake id) {
+    auto *view = Gtk::manage(new ChatList);
+    view->SetActiveChannel(id);
+
+    view->signal_action_channel_click().connect([this](Snowflake id) {
+        m_signal_action_channel_click.emit(id, true);
+    });
+    view->signal_action_chat_load_history().connect([this](Snowflake id) {
+        // hidden views can get here from their adjustments changing
+        if (id == m_active_channel)
+            m_signal_action_chat_load_history.emit(id);
+    });
+    view->signal_action_insert_mention().connect([this](Snowflake id) {
+        // lowkey gross
+        m_signal_action_insert_mention.emit(id);
+    });
+    view->signal_action_message_edit().connect([this](Snowflake channel_id, Snowflake message_id) {
+        m_signal_action_message_edit.emit(channel_id, message_id);
+    });
+    view->signal_action_reaction_add().connect([this](Snowflake id, const Glib::ustring &param) {
+        m_signal_action_reaction_add.emit(id, param);
+    });
+    view->signal_action_reaction_remove().connect([this](Snowflake id, const Glib::ustring &param) {
+        m_signal_action_reaction_remove.emit(id, param);
+    });
+    view->signal_action_reply_to().connect([this](Snowflake id) {
+        StartReplying(id);
+    });
+    view->show();
+
+    m_chat_stack.add(*view);
+    return view;
+}
+
+ChatList *ChatWindow::GetChatView(Snowflake channel_id) {
+    if (const auto it = m_chat_views.find(channel_id); it != m_chat_views.end())
+        return it->second;
+    return nullptr;
+}
+
+void ChatWindow::SwitchChatView(Snowflake id) {
+    if (auto *view = GetChatView(id)) {
+        m_chat = view;
+        m_chat_view_cached = true;
+        m_chat_views_lru.remove(id);
+    } else {
+        m_chat = CreateChatView(id);
+        m_chat_views[id] = m_chat;
+        m_chat_view_cached = false;
+    }
+    m_chat_views_lru.push_front(id);
+    m_chat_stack.set_visible_child(*m_chat);
+
+    TrimChatViews();
+}
+
+void ChatWindow::TrimChatViews() {
+    const auto &settings = Abaddon::Get().GetSettings();
+    const size_t max_views = static_cast<size_t>(std::max(settings.ChatViewCache, 0)) + 1; // plus the active one
+
+    int total_messages = 0;
+    for (const auto &[id, view] : m_chat_views)
+        total_messages += view->GetNumMessages();
+
+    // the active view is at the front so it always stays
+    while (m_chat_views_lru.size() > 1 && (m_chat_views_lru.size() > max_views || total_messages > settings.ChatViewCacheMessages)) {
+        const auto id = m_chat_views_lru.back();
+        m_chat_views_lru.pop_back();
+        auto *view = m_chat_views.at(id);
+        m_chat_views.erase(id);
+        total_messages -= view->GetNumMessages();
+        delete view;
+    }
+}
+
 Gtk::Widget *ChatWindow::GetRoot() const {
     return m_main;
 }
 
 void ChatWindow::Clear() {
+    for (auto it = m_chat_views.begin(); it != m_chat_views.end();) {
+        if (it->second == m_chat) {
+            it++;
+            continue;
+        }
+        m_chat_views_lru.remove(it->first);
+        delete it->second;
+        it = m_chat_views.erase(it);
+    }
     m_chat->Clear();
+    m_chat_view_cached = false;
 }
 
 void ChatWindow::SetMessages(const std::vector<Message> &msgs) {
@@ -135,7 +198,7 @@ void ChatWindow::SetMessages(const std::vector<Message> &msgs) {
 
 void ChatWindow::SetActiveChannel(Snowflake id) {
     m_active_channel = id;
-    m_chat->SetActiveChannel(id);
+    SwitchChatView(id);
     m_input->SetActiveChannel(id);
     m_input_indicator->SetActiveChannel(id);
     m_rate_limit_indicator->SetActiveChannel(id);
@@ -147,20 +210,34 @@ void ChatWindow::SetActiveChannel(Snowflake id) {
 #endif
 }
 
+bool ChatWindow::IsViewCached() const noexcept {
+    return m_chat_view_cached;
+}
+
 void ChatWindow::AddNewMessage(const Message &data) {
-    m_chat->ProcessNewMessage(data, false);
+    if (auto *view = GetChatView(data.ChannelID))
+        view->ProcessNewMessage(data, false);
 }
 
-void ChatWindow::DeleteMessage(Snowflake id) {
-    m_chat->DeleteMessage(id);
+void ChatWindow::DeleteMessage(Snowflake id, Snowflake channel_id) {
+    if (auto *view = GetChatView(channel_id))
+        view->DeleteMessage(id);
 }
 
-void ChatWindow::UpdateMessage(Snowflake id) {
-    m_chat->RefetchMessage(id);
+void ChatWindow::UpdateMessage(Snowflake id, Snowflake channel_id) {
+    if (auto *view = GetChatView(channel_id))
+        view->RefetchMessage(id);
 }
 
 void ChatWindow::AddNewHistory(const std::vector<Message> &msgs) {
-    m_chat->PrependMessages(msgs.crbegin(), msgs.crend());
+    if (msgs.empty()) return;
+    if (auto *view = GetChatView(msgs.front().ChannelID))
+        view->PrependMessages(msgs.crbegin(), msgs.crend());
+}
+
+void ChatWindow::MergeMessages(Snowflake channel_id, const std::vector<Message> &msgs) {
+    if (auto *view = GetChatView(channel_id))
+        view->MergeMessages(msgs);
 }
 
 void ChatWindow::InsertChatInput(const std::string &text) {
@@ -172,7 +249,8 @@ Snowflake ChatWindow::GetOldestListedMessage() {
 }
 
 void ChatWindow::UpdateReactions(Snowflake id) {
-    m_chat->UpdateMessageReactions(id);
+    for (auto &[channel_id, view] : m_chat_views)
+        view->UpdateMessageReactions(id);
 }
 
 void ChatWindow::SetTopic(const std::string &text) {
@@ -366,7 +444,8 @@ void ChatWindow::OnScrollEdgeOvershot(Gtk::PositionType pos) {
 }
 
 void ChatWindow::OnMessageSendFail(const std::string &nonce, float retry_after) {
-    m_chat->SetFailedByNonce(nonce);
+    for (auto &[channel_id, view] : m_chat_views)
+        view->SetFailedByNonce(nonce);
 }
 
 ChatWindow::type_signal_action_message_edit ChatWindow::signal_action_message_edit() {
@@ -1,7 +1,10 @@
 #pragma once
+#include <list>
 #include <string>
 #include <set>
+#include <unordered_map>
 #include <gtkmm/eventbox.h>
+#include <gtkmm/stack.h>
 #include "discord/discord.hpp"
 #include "discord/chatsubmitparams.hpp"
 #include "completer.hpp"
@@ -28,10 +31,12 @@ public:
     void Clear();
     void SetMessages(const std::vector<Message> &msgs); // clear contents and replace with given set
     void SetActiveChannel(Snowflake id);
-    void AddNewMessage(const Message &data);              // append new message to bottom
-    void DeleteMessage(Snowflake id);                     // add [deleted] indicator
-    void UpdateMessage(Snowflake id);                     // add [edited] indicator
-    void AddNewHistory(const std::vector<Message> &msgs); // prepend messages
+    [[nodiscard]] bool IsViewCached() const noexcept;                          // active channel's messages were kept from an earlier visit
+    void AddNewMessage(const Message &data);                                   // append new message to bottom
+    void DeleteMessage(Snowflake id, Snowflake channel_id);                    // add [deleted] indicator
+    void UpdateMessage(Snowflake id, Snowflake channel_id);                    // add [edited] indicator
+    void AddNewHistory(const std::vector<Message> &msgs);                      // prepend messages
+    void MergeMessages(Snowflake channel_id, const std::vector<Message> &msgs); // diff a fetched page against what's listed
     void InsertChatInput(const std::string &text);
     Snowflake GetOldestListedMessage(); // oldest message that is currently in the ListBox
     void UpdateReactions(Snowflake id);
@@ -72,6 +77,18 @@ protected:
 
     void OnMessageSendFail(const std::string &nonce, float retry_after);
 
+    // recently viewed channels keep their ChatList around so switching back is just showing it again
+    // hidden ones still get live events. bounded by chat_view_cache and chat_view_cache_messages
+    ChatList *CreateChatView(Snowflake id);
+    ChatList *GetChatView(Snowflake channel_id);
+    void SwitchChatView(Snowflake id);
+    void TrimChatViews();
+
+    std::unordered_map<Snowflake, ChatList *> m_chat_views;
+    std::list<Snowflake> m_chat_views_lru; // most recent at the front
+    bool m_chat_view_cached = false;
+    Gtk::Stack m_chat_stack;
+
     Gtk::Box *m_main;
     // Gtk::ListBox *m_list;
     // Gtk::ScrolledWindow *m_scroll;
@@ -79,7 +96,7 @@ protected:
     Gtk::EventBox m_topic; // todo probably make everything else go on the stack
     Gtk::Label m_topic_text;
 
-    ChatList *m_chat;
+    ChatList *m_chat; // active view
 
     ChatInput *m_input;
 
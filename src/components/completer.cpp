@@ -107,7 +107,7 @@ void Completer::CompleteMentions(const Glib::ustring &term) {
     if (channel_id.IsValid()) {
         const auto chan = discord.GetChannel(channel_id);
         if (chan->GuildID.has_value()) {
-            const auto members = discord.GetUsersInGuild(*chan->GuildID);
+            const auto &members = discord.GetUsersInGuild(*chan->GuildID);
             for (const auto x : members)
                 if (std::find(author_ids.begin(), author_ids.end(), x) == author_ids.end())
                     author_ids.push_back(x);
@@ -120,7 +120,7 @@ void Completer::CompleteMentions(const Glib::ustring &term) {
         const auto author = discord.GetUser(id);
         if (!author.has_value()) continue;
         // todo improve the predicate here
-        if (!StringContainsCaseless(author->Username, term)) continue;
+        if (!StringContainsCaseless(author->Username.str(), term)) continue;
         if (i++ > 15) break;
 
         auto entry = CreateEntry(author->GetMention());
@@ -216,11 +216,11 @@ done:
             if (added_patterns.find(pattern) != added_patterns.end()) continue;
             if (!StringContainsCaseless(shortcode, term)) continue;
             if (i++ > 15) break;
-            const auto &pb = emojis.GetPixBuf(pattern);
+            const auto &pb = emojis.GetPixBuf(pattern, CompleterImageSize);
             if (!pb) continue;
             added_patterns.insert(pattern);
             const auto entry = make_entry(shortcode, pattern);
-            entry->SetImage(pb->scale_simple(CompleterImageSize, CompleterImageSize, Gdk::INTERP_BILINEAR));
+            entry->SetImage(pb);
         }
     }
 }
@@ -233,7 +233,7 @@ void Completer::CompleteChannels(const Glib::ustring &term) {
     const auto channel_id = m_channel_id_cb();
     const auto channel = discord.GetChannel(channel_id);
     if (!channel->GuildID.has_value()) return;
-    const auto channels = discord.GetChannelsInGuild(*channel->GuildID);
+    const auto &channels = discord.GetChannelsInGuild(*channel->GuildID);
     int i = 0;
     for (const auto chan_id : channels) {
         const auto chan = discord.GetChannel(chan_id);
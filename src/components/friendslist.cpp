@@ -334,9 +334,10 @@ void FriendsListFriendRow::UpdatePresenceLabel() {
     }
 }
 
-void FriendsListFriendRow::OnPresenceUpdate(const UserData &user, PresenceStatus status) {
-    if (user.ID != ID) return;
-    Status = status;
+void FriendsListFriendRow::OnPresenceUpdate(const std::unordered_map<Snowflake, PresenceStatus> &statuses) {
+    const auto it = statuses.find(ID);
+    if (it == statuses.end()) return;
+    Status = it->second;
     UpdatePresenceLabel();
     changed();
 }
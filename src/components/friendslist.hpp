@@ -1,4 +1,5 @@
 #pragma once
+#include <unordered_map>
 #include <gtkmm/box.h>
 #include <gtkmm/button.h>
 #include <gtkmm/buttonbox.h>
@@ -73,7 +74,7 @@ public:
 
 private:
     void UpdatePresenceLabel();
-    void OnPresenceUpdate(const UserData &user, PresenceStatus status);
+    void OnPresenceUpdate(const std::unordered_map<Snowflake, PresenceStatus> &statuses);
 
     Gtk::Label *m_status_lbl;
 
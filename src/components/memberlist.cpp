@@ -1,13 +1,14 @@
 #include "memberlist.hpp"
 
+#include <algorithm>
+
 #include "abaddon.hpp"
 #include "util.hpp"
 
 constexpr static int MemberListUserLimit = 200;
 
 MemberList::MemberList()
-    : m_model(Gtk::TreeStore::create(m_columns))
-    , m_menu_role_copy_id("_Copy ID", true) {
+    : m_menu_role_copy_id("_Copy ID", true) {
     m_main.get_style_context()->add_class("member-list");
 
     m_view.set_hexpand(true);
@@ -17,6 +18,7 @@ MemberList::MemberList()
     m_view.set_enable_search(false);
     m_view.set_headers_visible(false);
     m_view.get_selection()->set_mode(Gtk::SELECTION_NONE);
+    m_model = CreateModel();
     m_view.set_model(m_model);
     m_view.signal_button_press_event().connect(sigc::mem_fun(*this, &MemberList::OnButtonPressEvent), false);
 
@@ -34,10 +36,6 @@ MemberList::MemberList()
     column->add_attribute(renderer->property_status(), m_columns.m_status);
     m_view.append_column(*column);
 
-    m_model->set_sort_column(m_columns.m_sort, Gtk::SORT_ASCENDING);
-    m_model->set_default_sort_func([](const Gtk::TreeModel::iterator &, const Gtk::TreeModel::iterator &) -> int { return 0; });
-    m_model->set_sort_func(m_columns.m_sort, sigc::mem_fun(*this, &MemberList::SortFunc));
-
     renderer->signal_render().connect(sigc::mem_fun(*this, &MemberList::OnCellRender));
 
     // Menu stuff
@@ -56,8 +54,16 @@ Gtk::Widget *MemberList::GetRoot() {
     return &m_main;
 }
 
+Glib::RefPtr<Gtk::TreeStore> MemberList::CreateModel() {
+    auto model = Gtk::TreeStore::create(m_columns);
+    model->set_sort_column(m_columns.m_sort, Gtk::SORT_ASCENDING);
+    model->set_default_sort_func([](const Gtk::TreeModel::iterator &, const Gtk::TreeModel::iterator &) -> int { return 0; });
+    model->set_sort_func(m_columns.m_sort, sigc::mem_fun(*this, &MemberList::SortFunc));
+    return model;
+}
+
 void MemberList::UpdateMemberList() {
-    Clear();
+    ClearModel();
     if (!m_active_channel.IsValid()) return;
 
     auto &discord = Abaddon::Get().GetDiscordClient();
@@ -66,6 +72,7 @@ void MemberList::UpdateMemberList() {
     if (!channel.has_value()) {
         return;
     }
+    m_list_built = true;
 
     const static auto color_transparent = Gdk::RGBA("rgba(0,0,0,0)");
 
@@ -87,13 +94,7 @@ void MemberList::UpdateMemberList() {
     const auto guild = discord.GetGuild(m_active_guild);
     if (!guild.has_value()) return;
 
-    std::set<Snowflake> ids;
-    if (channel->IsThread()) {
-        const auto x = discord.GetUsersInThread(m_active_channel);
-        ids = { x.begin(), x.end() };
-    } else {
-        ids = discord.GetUsersInGuild(m_active_guild);
-    }
+    const auto &ids = channel->IsThread() ? discord.GetUsersInThread(m_active_channel) : discord.GetUsersInGuild(m_active_guild);
 
     std::unordered_map<Snowflake, std::vector<UserData>> role_to_users;
     std::unordered_map<Snowflake, int> user_to_color;
@@ -181,17 +182,62 @@ void MemberList::UpdateMemberList() {
 }
 
 void MemberList::Clear() {
+    DropCachedLists();
+    ClearModel();
+}
+
+void MemberList::ClearModel() {
     m_model->clear();
     m_pending_avatars.clear();
+    m_list_built = false;
 }
 
 void MemberList::SetActiveChannel(Snowflake id) {
     m_active_channel = id;
     m_active_guild = Snowflake::Invalid;
+    Snowflake key = id;
     if (m_active_channel.IsValid()) {
         const auto channel = Abaddon::Get().GetDiscordClient().GetChannel(m_active_channel);
         if (channel.has_value() && channel->GuildID.has_value()) m_active_guild = *channel->GuildID;
+        // every channel in a guild shows the same list
+        if (channel.has_value() && !channel->IsThread() && m_active_guild.IsValid()) key = m_active_guild;
+    }
+
+    if (key == m_list_key) {
+        m_list_cached = m_list_built;
+        return;
+    }
+
+    if (m_list_built)
+        m_cached_lists.push_front({ m_list_key, m_model, std::move(m_pending_avatars) });
+    m_pending_avatars.clear();
+
+    const auto it = std::find_if(m_cached_lists.begin(), m_cached_lists.end(), [key](const CachedList &list) { return list.Key == key; });
+    m_list_cached = it != m_cached_lists.end();
+    m_list_built = m_list_cached;
+    if (m_list_cached) {
+        m_model = it->Model;
+        m_pending_avatars = std::move(it->PendingAvatars);
+        m_cached_lists.erase(it);
+    } else {
+        m_model = CreateModel();
     }
+    m_list_key = key;
+
+    m_view.set_model(m_model);
+    m_view.expand_all();
+
+    const auto max_lists = static_cast<size_t>(std::max(Abaddon::Get().GetSettings().ChatViewCache, 0));
+    while (m_cached_lists.size() > max_lists)
+        m_cached_lists.pop_back();
+}
+
+bool MemberList::IsListCached() const noexcept {
+    return m_list_cached;
+}
+
+void MemberList::DropCachedLists() {
+    m_cached_lists.clear();
 }
 
 void MemberList::OnCellRender(uint64_t id) {
@@ -204,11 +250,11 @@ void MemberList::OnCellRender(uint64_t id) {
         (*row)[m_columns.m_av_requested] = true;
         const auto user = Abaddon::Get().GetDiscordClient().GetUser(real_id);
         if (!user.has_value()) return;
-        const auto cb = [this, row](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
+        const auto cb = [this, model = m_model, row](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
             // for some reason row::operator bool() returns true when m_model->iter_is_valid returns false
             // idk why since other code already does essentially the same thing im doing here
             // iter_is_valid is "slow" according to gtk but the only other workaround i can think of would be worse
-            if (row && m_model->iter_is_valid(row)) {
+            if (row && model->iter_is_valid(row)) {
                 (*row)[m_columns.m_pixbuf] = pb->scale_simple(16, 16, Gdk::INTERP_BILINEAR);
             }
         };
@@ -249,15 +295,23 @@ int MemberList::SortFunc(const Gtk::TreeModel::iterator &a, const Gtk::TreeModel
     return 0;
 }
 
-void MemberList::OnPresenceUpdate(const UserData &user, PresenceStatus status) {
-    for (auto &role : m_model->children()) {
-        for (auto &member : role.children()) {
-            if ((*member)[m_columns.m_id] == user.ID) {
-                (*member)[m_columns.m_status] = status;
-                return;
+void MemberList::OnPresenceUpdate(const std::unordered_map<Snowflake, PresenceStatus> &statuses) {
+    // one walk over each list for the whole batch
+    const auto update = [this, &statuses](const Glib::RefPtr<Gtk::TreeStore> &model) {
+        size_t remaining = statuses.size();
+        for (auto &role : model->children()) {
+            for (auto &member : role.children()) {
+                const auto it = statuses.find((*member)[m_columns.m_id]);
+                if (it == statuses.end()) continue;
+                (*member)[m_columns.m_status] = it->second;
+                if (--remaining == 0) return;
             }
         }
-    }
+    };
+
+    update(m_model);
+    for (const auto &list : m_cached_lists)
+        update(list.Model);
 }
 
 MemberList::ModelColumns::ModelColumns() {
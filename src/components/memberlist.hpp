@@ -1,4 +1,5 @@
 #pragma once
+#include <list>
 #include <unordered_map>
 
 #include <gdkmm/pixbuf.h>
@@ -19,8 +20,13 @@ public:
     void UpdateMemberList();
     void Clear();
     void SetActiveChannel(Snowflake id);
+    [[nodiscard]] bool IsListCached() const noexcept; // active channel's list was kept from an earlier visit
+    void DropCachedLists();                            // everything but the list being shown
 
 private:
+    Glib::RefPtr<Gtk::TreeStore> CreateModel();
+    void ClearModel();
+
     void OnCellRender(uint64_t id);
     bool OnButtonPressEvent(GdkEventButton *ev);
 
@@ -28,7 +34,7 @@ private:
 
     int SortFunc(const Gtk::TreeModel::iterator &a, const Gtk::TreeModel::iterator &b);
 
-    void OnPresenceUpdate(const UserData &user, PresenceStatus status);
+    void OnPresenceUpdate(const std::unordered_map<Snowflake, PresenceStatus> &statuses);
 
     class ModelColumns : public Gtk::TreeModel::ColumnRecord {
     public:
@@ -60,4 +66,15 @@ private:
     Gtk::MenuItem m_menu_role_copy_id;
 
     std::unordered_map<Snowflake, Gtk::TreeIter> m_pending_avatars;
+
+    // recently shown lists, keyed by guild (or channel for dms and threads)
+    struct CachedList {
+        Snowflake Key;
+        Glib::RefPtr<Gtk::TreeStore> Model;
+        std::unordered_map<Snowflake, Gtk::TreeIter> PendingAvatars;
+    };
+    std::list<CachedList> m_cached_lists; // most recent at the front
+    Snowflake m_list_key;
+    bool m_list_built = false; // m_model has been filled for m_list_key
+    bool m_list_cached = false;
 };
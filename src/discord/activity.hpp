@@ -26,6 +26,14 @@ constexpr inline const char *GetPresenceString(PresenceStatus s) {
     return "";
 }
 
+// anything unknown is treated as offline
+inline PresenceStatus GetPresenceFromString(const std::string &s) {
+    if (s == "online") return PresenceStatus::Online;
+    if (s == "idle") return PresenceStatus::Idle;
+    if (s == "dnd") return PresenceStatus::DND;
+    return PresenceStatus::Offline;
+}
+
 constexpr inline const char *GetPresenceDisplayString(PresenceStatus s) {
     switch (s) {
         case PresenceStatus::Online:
@@ -3,18 +3,23 @@
 
 #include "dave.hpp"
 #include "voiceclient.hpp"
+#include <dave/array_view.h>
 #include <dave/logger.h>
 #include <spdlog/spdlog.h>
 // clang-format on
 
 static bool s_dave_log_sink_set = false;
 
-DaveSession::DaveSession(Snowflake channelId, Snowflake userId,
-                         const std::unordered_map<uint32_t, Snowflake> &ssrcUserMap)
-    : m_channel_id(channelId)
+// anything slower than this holds up key rotation noticeably
+constexpr static auto SlowOperation = std::chrono::milliseconds(50);
+
+DaveSession::DaveSession(Snowflake channelId, Snowflake userId)
+    : m_media(std::make_shared<DaveMedia>())
+    , m_channel_id(channelId)
     , m_user_id(userId)
-    , m_ssrc_user_map(ssrcUserMap)
     , m_log(spdlog::get("voice")) {
+    m_media->m_log = m_log;
+
     if (!s_dave_log_sink_set) {
         s_dave_log_sink_set = true;
         discord::dave::SetLogSink([](discord::dave::LoggingSeverity severity,
@@ -46,14 +51,108 @@ DaveSession::DaveSession(Snowflake channelId, Snowflake userId,
         [this](const std::string &reason, const std::string &detail) {
             m_log->warn("MLS failure: {} {}", reason, detail);
         });
+
+    m_main_dispatcher.connect(sigc::mem_fun(*this, &DaveSession::OnMainDispatch));
+    m_worker = std::thread(&DaveSession::WorkerThread, this);
 }
 
-DaveSession::~DaveSession() = default;
+DaveSession::~DaveSession() {
+    {
+        std::lock_guard<std::mutex> _(m_tasks_mutex);
+        m_stop = true;
+        // whatever is still queued is for a session nobody cares about anymore
+        m_tasks.clear();
+    }
+    m_tasks_cv.notify_one();
+    if (m_worker.joinable()) m_worker.join();
+
+    std::lock_guard<std::mutex> _(m_stats_mutex);
+    for (const auto &[name, stats] : m_stats) {
+        const auto ms = [](std::chrono::steady_clock::duration d) {
+            return std::chrono::duration<double, std::milli>(d).count();
+        };
+        m_log->debug("DAVE {}: {} ops, {:.2f} ms avg, {:.2f} ms max, {:.2f} ms max queued",
+                     name, stats.Count, ms(stats.Total) / static_cast<double>(stats.Count), ms(stats.Max), ms(stats.MaxQueued));
+    }
+}
+
+void DaveSession::Post(const char *name, std::function<void()> func) {
+    {
+        std::lock_guard<std::mutex> _(m_tasks_mutex);
+        if (m_stop) return;
+        m_tasks.push_back({ name, std::move(func), std::chrono::steady_clock::now() });
+    }
+    m_tasks_cv.notify_one();
+}
+
+void DaveSession::WorkerThread() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_tasks_mutex);
+            m_tasks_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+            if (m_stop) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        task.Func();
+        const auto end = std::chrono::steady_clock::now();
+
+        const auto took = end - start;
+        const auto queued = start - task.Queued;
+        if (took > SlowOperation) {
+            m_log->warn("DAVE {} took {:.1f} ms", task.Name, std::chrono::duration<double, std::milli>(took).count());
+        }
+
+        std::lock_guard<std::mutex> _(m_stats_mutex);
+        auto &stats = m_stats[task.Name];
+        stats.Count++;
+        stats.Total += took;
+        stats.Max = std::max(stats.Max, took);
+        stats.MaxQueued = std::max(stats.MaxQueued, queued);
+    }
+}
+
+void DaveSession::PostMain(std::function<void()> func) {
+    {
+        std::lock_guard<std::mutex> _(m_main_mutex);
+        m_main_queue.push_back(std::move(func));
+    }
+    m_main_dispatcher.emit();
+}
+
+void DaveSession::OnMainDispatch() {
+    std::deque<std::function<void()>> queue;
+    {
+        std::lock_guard<std::mutex> _(m_main_mutex);
+        queue.swap(m_main_queue);
+    }
+    for (auto &func : queue) {
+        func();
+    }
+}
+
+void DaveSession::Publish() {
+    auto state = std::make_shared<DaveMedia::State>();
+    state->Enabled = m_enabled;
+    state->Downgraded = m_downgraded;
+    state->Encryptor = m_encryptor;
+    state->Decryptors = m_decryptors;
+    std::atomic_store(&m_media->m_state, std::shared_ptr<const DaveMedia::State>(std::move(state)));
+}
+
+std::shared_ptr<DaveMedia> DaveSession::GetMedia() const {
+    return m_media;
+}
 
 void DaveSession::Init(uint16_t version) {
-    m_protocol_version = version;
-    m_pending_protocol_version = version;
-    Reinit();
+    Post("Init", [this, version]() {
+        m_protocol_version = version;
+        m_pending_protocol_version = version;
+        Reinit();
+    });
 }
 
 void DaveSession::Reinit() {
@@ -72,114 +171,148 @@ void DaveSession::Reinit() {
         self_id,
         m_transient_key);
 
+    // ratchets get applied when the first transition completes
     m_decryptors.clear();
+    for (const auto &[ssrc, uid] : m_ssrc_users) {
+        auto slot = std::make_shared<DaveMedia::DecryptorSlot>();
+        slot->Decryptor = discord::dave::CreateDecryptor();
+        m_decryptors.emplace(ssrc, std::move(slot));
+    }
     m_pending_transition_ready = false;
 
-    m_encryptor = discord::dave::CreateEncryptor();
+    m_encryptor = std::make_shared<DaveMedia::EncryptorSlot>();
+    m_encryptor->Encryptor = discord::dave::CreateEncryptor();
     if (m_local_ssrc != 0)
-        m_encryptor->AssignSsrcToCodec(m_local_ssrc, discord::dave::Codec::Opus);
+        m_encryptor->Encryptor->AssignSsrcToCodec(m_local_ssrc, discord::dave::Codec::Opus);
+
+    Publish();
 
     auto keyPackage = m_mls_session->GetMarshalledKeyPackage();
     if (!keyPackage.empty()) {
         m_log->info("Sending MLS key package, size={}", keyPackage.size());
-        m_signal_send_binary.emit(static_cast<int>(VoiceGatewayOp::MlsKeyPackage), keyPackage);
+        PostMain([this, keyPackage = std::move(keyPackage)]() {
+            m_signal_send_binary.emit(static_cast<int>(VoiceGatewayOp::MlsKeyPackage), keyPackage);
+        });
     }
 }
 
 void DaveSession::OnExternalSenderPackage(const uint8_t *data, size_t size) {
-    m_log->info("Received external sender package, size={}", size);
-    std::vector<uint8_t> payload(data, data + size);
-    m_mls_session->SetExternalSender(payload);
+    Post("ExternalSender", [this, payload = std::vector<uint8_t>(data, data + size)]() {
+        m_log->info("Received external sender package, size={}", payload.size());
+        m_mls_session->SetExternalSender(payload);
+    });
 }
 
 void DaveSession::OnProposals(const uint8_t *data, size_t size) {
-    m_log->info("Received proposals, size={} connectedUsers={}", size, m_connected_users.size());
-    std::vector<uint8_t> payload(data, data + size);
-    auto response = m_mls_session->ProcessProposals(std::move(payload), m_connected_users);
-
-    if (response) {
-        m_log->info("Sending commit+welcome, size={}", response->size());
-        m_signal_send_binary.emit(static_cast<int>(VoiceGatewayOp::MlsCommitWelcome), *response);
-    }
+    Post("Proposals", [this, payload = std::vector<uint8_t>(data, data + size)]() mutable {
+        m_log->info("Received proposals, size={} connectedUsers={}", payload.size(), m_connected_users.size());
+        auto response = m_mls_session->ProcessProposals(std::move(payload), m_connected_users);
+
+        if (response) {
+            m_log->info("Sending commit+welcome, size={}", response->size());
+            PostMain([this, response = std::move(*response)]() {
+                m_signal_send_binary.emit(static_cast<int>(VoiceGatewayOp::MlsCommitWelcome), response);
+            });
+        }
+    });
 }
 
 void DaveSession::OnAnnounceCommitTransition(const uint8_t *data, size_t size) {
     if (size < 2) return;
 
-    int transitionId = (data[0] << 8) | data[1];
-    m_pending_transition_id = transitionId;
-
-    m_log->debug("Received announce commit transition: transitionId={} size={}", transitionId, size);
-
-    std::vector<uint8_t> payload(data + 2, data + size);
-    auto result = m_mls_session->ProcessCommit(std::move(payload));
-
-    if (auto *roster = std::get_if<discord::dave::RosterMap>(&result)) {
-        m_log->info("ProcessCommit succeeded, roster size={}", roster->size());
-        m_pending_transition_ready = true;
-        m_signal_send_ready.emit(transitionId);
-        if (transitionId == 0)
-            CompleteTransition();
-    } else if (std::holds_alternative<discord::dave::failed_t>(result)) {
-        m_log->warn("ProcessCommit failed (hard reject)");
-        m_signal_send_invalid.emit(transitionId);
-    } else {
-        m_log->debug("ProcessCommit ignored (soft reject)");
-    }
+    Post("Commit", [this, payload = std::vector<uint8_t>(data, data + size)]() {
+        int transitionId = (payload[0] << 8) | payload[1];
+        m_pending_transition_id = transitionId;
+
+        m_log->debug("Received announce commit transition: transitionId={} size={}", transitionId, payload.size());
+
+        auto result = m_mls_session->ProcessCommit(std::vector<uint8_t>(payload.begin() + 2, payload.end()));
+
+        if (auto *roster = std::get_if<discord::dave::RosterMap>(&result)) {
+            m_log->info("ProcessCommit succeeded, roster size={}", roster->size());
+            m_pending_transition_ready = true;
+            PostMain([this, transitionId]() {
+                m_signal_send_ready.emit(transitionId);
+            });
+            if (transitionId == 0)
+                CompleteTransition();
+        } else if (std::holds_alternative<discord::dave::failed_t>(result)) {
+            m_log->warn("ProcessCommit failed (hard reject)");
+            PostMain([this, transitionId]() {
+                m_signal_send_invalid.emit(transitionId);
+            });
+        } else {
+            m_log->debug("ProcessCommit ignored (soft reject)");
+        }
+    });
 }
 
 void DaveSession::OnWelcome(const uint8_t *data, size_t size) {
     if (size < 2) return;
 
-    int transitionId = (data[0] << 8) | data[1];
-    m_pending_transition_id = transitionId;
-
-    m_log->info("Received welcome: transitionId={} size={} connectedUsers={}",
-                transitionId, size, m_connected_users.size());
-
-    std::vector<uint8_t> payload(data + 2, data + size);
-    auto roster = m_mls_session->ProcessWelcome(std::move(payload), m_connected_users);
-
-    if (roster) {
-        m_log->info("ProcessWelcome succeeded, roster size={}", roster->size());
-        m_pending_transition_ready = true;
-        m_signal_send_ready.emit(transitionId);
-        if (transitionId == 0)
-            CompleteTransition();
-    } else {
-        m_log->warn("ProcessWelcome failed");
-        m_signal_send_invalid.emit(transitionId);
-    }
+    Post("Welcome", [this, payload = std::vector<uint8_t>(data, data + size)]() {
+        int transitionId = (payload[0] << 8) | payload[1];
+        m_pending_transition_id = transitionId;
+
+        m_log->info("Received welcome: transitionId={} size={} connectedUsers={}",
+                    transitionId, payload.size(), m_connected_users.size());
+
+        auto roster = m_mls_session->ProcessWelcome(std::vector<uint8_t>(payload.begin() + 2, payload.end()), m_connected_users);
+
+        if (roster) {
+            m_log->info("ProcessWelcome succeeded, roster size={}", roster->size());
+            m_pending_transition_ready = true;
+            PostMain([this, transitionId]() {
+                m_signal_send_ready.emit(transitionId);
+            });
+            if (transitionId == 0)
+                CompleteTransition();
+        } else {
+            m_log->warn("ProcessWelcome failed");
+            PostMain([this, transitionId]() {
+                m_signal_send_invalid.emit(transitionId);
+            });
+        }
+    });
 }
 
 void DaveSession::OnPrepareTransition(int version, int transitionId) {
-    m_log->info("Prepare transition: version={} transitionId={}", version, transitionId);
-    m_pending_transition_id = transitionId;
-    m_pending_protocol_version = static_cast<uint16_t>(version);
-    m_signal_send_ready.emit(transitionId);
+    Post("PrepareTransition", [this, version, transitionId]() {
+        m_log->info("Prepare transition: version={} transitionId={}", version, transitionId);
+        m_pending_transition_id = transitionId;
+        m_pending_protocol_version = static_cast<uint16_t>(version);
+        PostMain([this, transitionId]() {
+            m_signal_send_ready.emit(transitionId);
+        });
+    });
 }
 
 void DaveSession::OnExecuteTransition(int transitionId) {
-    m_log->info("Execute transition: transitionId={}", transitionId);
-
-    if (m_pending_protocol_version != m_protocol_version) {
-        m_protocol_version = m_pending_protocol_version;
-        if (m_protocol_version == 0) {
-            m_log->info("DAVE downgrade to version 0, disabling");
-            m_enabled = false;
-            m_downgraded = true;
-            m_signal_state_changed.emit(false);
-            return;
+    Post("ExecuteTransition", [this, transitionId]() {
+        m_log->info("Execute transition: transitionId={}", transitionId);
+
+        if (m_pending_protocol_version != m_protocol_version) {
+            m_protocol_version = m_pending_protocol_version;
+            if (m_protocol_version == 0) {
+                m_log->info("DAVE downgrade to version 0, disabling");
+                m_enabled = false;
+                m_downgraded = true;
+                Publish();
+                PostMain([this]() {
+                    m_signal_state_changed.emit(false);
+                });
+                return;
+            }
         }
-    }
 
-    if (!m_pending_transition_ready) {
-        m_log->warn("Execute transition {} but no pending commit/welcome, reinitializing", transitionId);
-        Reinit();
-        return;
-    }
+        if (!m_pending_transition_ready) {
+            m_log->warn("Execute transition {} but no pending commit/welcome, reinitializing", transitionId);
+            Reinit();
+            return;
+        }
 
-    CompleteTransition();
+        CompleteTransition();
+    });
 }
 
 void DaveSession::CompleteTransition() {
@@ -191,19 +324,21 @@ void DaveSession::CompleteTransition() {
 
     auto selfRatchet = m_mls_session->GetKeyRatchet(std::to_string(static_cast<uint64_t>(m_user_id)));
     if (selfRatchet) {
-        m_encryptor->SetKeyRatchet(std::move(selfRatchet));
+        std::lock_guard<std::mutex> _(m_encryptor->Mutex);
+        m_encryptor->Encryptor->SetKeyRatchet(std::move(selfRatchet));
         m_log->info("Refreshed encryptor key ratchet for new epoch");
     } else {
         m_log->warn("Could not get own key ratchet from MLS session");
     }
 
-    for (auto &[ssrc, dec] : m_decryptors) {
-        auto it = m_ssrc_user_map.find(ssrc);
-        if (it == m_ssrc_user_map.end())
+    for (auto &[ssrc, slot] : m_decryptors) {
+        auto it = m_ssrc_users.find(ssrc);
+        if (it == m_ssrc_users.end())
             continue;
         auto ratchet = m_mls_session->GetKeyRatchet(std::to_string(static_cast<uint64_t>(it->second)));
         if (ratchet) {
-            dec->TransitionToKeyRatchet(std::move(ratchet));
+            std::lock_guard<std::mutex> _(slot->Mutex);
+            slot->Decryptor->TransitionToKeyRatchet(std::move(ratchet));
             m_log->debug("Refreshed decryptor key ratchet for SSRC={}", ssrc);
         }
     }
@@ -214,91 +349,158 @@ void DaveSession::CompleteTransition() {
         m_log->info("DAVE encryption enabled");
     }
 
-    m_signal_state_changed.emit(true);
+    Publish();
+    PostMain([this]() {
+        m_signal_state_changed.emit(true);
+    });
     m_pending_transition_id = -1;
 }
 
 void DaveSession::OnPrepareEpoch(int version, int epoch) {
-    m_log->info("Prepare epoch: version={} epoch={}", version, epoch);
-    if (epoch == 1) {
-        m_protocol_version = static_cast<uint16_t>(version);
-        Reinit();
-    }
+    Post("PrepareEpoch", [this, version, epoch]() {
+        m_log->info("Prepare epoch: version={} epoch={}", version, epoch);
+        if (epoch == 1) {
+            // left pending from a downgrade, the next execute would downgrade again
+            m_protocol_version = static_cast<uint16_t>(version);
+            m_pending_protocol_version = m_protocol_version;
+            Reinit();
+        }
+    });
 }
 
-discord::dave::IEncryptor *DaveSession::GetEncryptor() {
-    return m_encryptor.get();
+void DaveSession::SetLocalSSRC(uint32_t ssrc) {
+    Post("SetLocalSSRC", [this, ssrc]() {
+        m_local_ssrc = ssrc;
+        if (m_encryptor) {
+            std::lock_guard<std::mutex> _(m_encryptor->Mutex);
+            m_encryptor->Encryptor->AssignSsrcToCodec(ssrc, discord::dave::Codec::Opus);
+        }
+    });
 }
 
-discord::dave::IDecryptor *DaveSession::GetOrCreateDecryptor(uint32_t ssrc, Snowflake uid) {
-    auto it = m_decryptors.find(ssrc);
-    if (it != m_decryptors.end())
-        return it->second.get();
+void DaveSession::SetSSRCUser(uint32_t ssrc, Snowflake uid) {
+    Post("SetSSRCUser", [this, ssrc, uid]() {
+        m_ssrc_users[ssrc] = uid;
+        UpdateDecryptor(ssrc, uid);
+    });
+}
 
-    auto decryptor = discord::dave::CreateDecryptor();
+void DaveSession::UpdateDecryptor(uint32_t ssrc, Snowflake uid) {
+    auto keyRatchet = m_mls_session->GetKeyRatchet(std::to_string(static_cast<uint64_t>(uid)));
 
-    bool hasRatchet = false;
-    if (static_cast<uint64_t>(uid) != 0) {
-        auto keyRatchet = m_mls_session->GetKeyRatchet(std::to_string(static_cast<uint64_t>(uid)));
+    if (auto it = m_decryptors.find(ssrc); it != m_decryptors.end()) {
         if (keyRatchet) {
-            decryptor->TransitionToKeyRatchet(std::move(keyRatchet));
-            hasRatchet = true;
+            std::lock_guard<std::mutex> _(it->second->Mutex);
+            it->second->Decryptor->TransitionToKeyRatchet(std::move(keyRatchet));
+            m_log->info("Applied key ratchet for SSRC={} user={}", ssrc, static_cast<uint64_t>(uid));
         }
+        return;
     }
 
-    auto *ptr = decryptor.get();
-    m_decryptors.emplace(ssrc, std::move(decryptor));
+    auto slot = std::make_shared<DaveMedia::DecryptorSlot>();
+    slot->Decryptor = discord::dave::CreateDecryptor();
+    const bool hasRatchet = keyRatchet != nullptr;
+    if (hasRatchet)
+        slot->Decryptor->TransitionToKeyRatchet(std::move(keyRatchet));
+    m_decryptors.emplace(ssrc, std::move(slot));
+    Publish();
 
     m_log->debug("Created decryptor for SSRC={} hasRatchet={}", ssrc, hasRatchet);
-    return ptr;
-}
-
-void DaveSession::SetLocalSSRC(uint32_t ssrc) {
-    m_local_ssrc = ssrc;
-    if (m_encryptor)
-        m_encryptor->AssignSsrcToCodec(ssrc, discord::dave::Codec::Opus);
 }
 
 void DaveSession::AddConnectedUser(const std::string &id) {
-    m_connected_users.insert(id);
+    Post("AddUser", [this, id]() {
+        m_connected_users.insert(id);
+    });
 }
 
 void DaveSession::RemoveConnectedUser(const std::string &id) {
-    m_connected_users.erase(id);
+    Post("RemoveUser", [this, id]() {
+        m_connected_users.erase(id);
+
+        const uint64_t uid = std::stoull(id);
+        for (auto it = m_ssrc_users.begin(); it != m_ssrc_users.end(); ++it) {
+            if (static_cast<uint64_t>(it->second) == uid) {
+                m_decryptors.erase(it->first);
+                m_ssrc_users.erase(it);
+                Publish();
+                break;
+            }
+        }
+    });
+}
 
-    uint64_t uid = std::stoull(id);
-    for (auto it = m_ssrc_user_map.begin(); it != m_ssrc_user_map.end(); ++it) {
-        if (static_cast<uint64_t>(it->second) == uid) {
-            m_decryptors.erase(it->first);
-            break;
+void DaveSession::GetPairwiseFingerprint(const std::string &userId, FingerprintCallback callback) {
+    Post("Fingerprint", [this, userId, callback = std::move(callback)]() {
+        const auto done = [this, callback](const std::vector<uint8_t> &fingerprint) {
+            PostMain([callback, fingerprint]() {
+                callback(fingerprint);
+            });
+        };
+        if (!m_enabled) {
+            done({});
+            return;
         }
-    }
+        m_mls_session->GetPairwiseFingerprint(0, userId, done);
+    });
 }
 
-void DaveSession::GetPairwiseFingerprint(const std::string &userId, FingerprintCallback callback) const {
-    if (!m_mls_session || !m_enabled) {
-        callback({});
-        return;
-    }
-    m_mls_session->GetPairwiseFingerprint(0, userId, std::move(callback));
+std::map<std::string, DaveSession::OperationStats> DaveSession::GetOperationStats() const {
+    std::lock_guard<std::mutex> _(m_stats_mutex);
+    return m_stats;
 }
 
-std::vector<uint8_t> DaveSession::GetLastEpochAuthenticator() const {
-    if (!m_mls_session || !m_enabled)
-        return {};
-    return m_mls_session->GetLastEpochAuthenticator();
+std::shared_ptr<const DaveMedia::State> DaveMedia::GetState() const {
+    return std::atomic_load(&m_state);
 }
 
-void DaveSession::ApplyKeyRatchetForSSRC(uint32_t ssrc, Snowflake uid) {
-    auto it = m_decryptors.find(ssrc);
-    if (it == m_decryptors.end())
-        return;
+bool DaveMedia::IsEnabled() const {
+    return GetState()->Enabled;
+}
 
-    auto keyRatchet = m_mls_session->GetKeyRatchet(std::to_string(static_cast<uint64_t>(uid)));
-    if (keyRatchet) {
-        it->second->TransitionToKeyRatchet(std::move(keyRatchet));
-        m_log->info("Applied key ratchet for SSRC={} user={}", ssrc, static_cast<uint64_t>(uid));
+bool DaveMedia::IsDowngraded() const {
+    return GetState()->Downgraded;
+}
+
+bool DaveMedia::Encrypt(uint32_t ssrc, const uint8_t *data, size_t size, std::vector<uint8_t> &out) const {
+    const auto state = GetState();
+    if (!state->Encryptor) return false;
+
+    std::lock_guard<std::mutex> _(state->Encryptor->Mutex);
+    auto &enc = *state->Encryptor->Encryptor;
+    out.resize(enc.GetMaxCiphertextByteSize(discord::dave::MediaType::Audio, size));
+    size_t bytes_written = 0;
+    const auto result = enc.Encrypt(
+        discord::dave::MediaType::Audio,
+        ssrc,
+        discord::dave::MakeArrayView(data, size),
+        discord::dave::MakeArrayView(out.data(), out.size()),
+        &bytes_written);
+    if (result != discord::dave::IEncryptor::Success) {
+        m_log->warn("DAVE encrypt failed: result={}", static_cast<int>(result));
+        return false;
     }
+    out.resize(bytes_written);
+    return true;
+}
+
+bool DaveMedia::Decrypt(uint32_t ssrc, const uint8_t *data, size_t size, std::vector<uint8_t> &out) const {
+    const auto state = GetState();
+    const auto it = state->Decryptors.find(ssrc);
+    if (it == state->Decryptors.end()) return false;
+
+    std::lock_guard<std::mutex> _(it->second->Mutex);
+    auto &dec = *it->second->Decryptor;
+    out.resize(dec.GetMaxPlaintextByteSize(discord::dave::MediaType::Audio, size));
+    size_t bytes_written = 0;
+    const auto result = dec.Decrypt(
+        discord::dave::MediaType::Audio,
+        discord::dave::MakeArrayView(data, size),
+        discord::dave::MakeArrayView(out.data(), out.size()),
+        &bytes_written);
+    if (result != discord::dave::IDecryptor::Success) return false;
+    out.resize(bytes_written);
+    return true;
 }
 
 DaveSession::type_signal_send_binary DaveSession::signal_send_binary() {
@@ -4,12 +4,19 @@
 
 #include "snowflake.hpp"
 #include <dave/dave_interfaces.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
+#include <glibmm/dispatcher.h>
 #include <sigc++/sigc++.h>
 #include <spdlog/logger.h>
 // clang-format on
@@ -18,10 +25,48 @@ namespace mlspp {
 struct SignaturePrivateKey;
 }
 
+// what the audio and udp threads use. holds no mls state so it's fine if they end up dropping the last reference
+// a new state is published whenever anything changes and is never modified after. the slots are shared between
+// states and locked while in use since ratchets get swapped underneath them
+class DaveMedia {
+public:
+    bool IsEnabled() const;
+    bool IsDowngraded() const;
+    bool Encrypt(uint32_t ssrc, const uint8_t *data, size_t size, std::vector<uint8_t> &out) const;
+    // false if theres no decryptor for the ssrc yet. they're created once DaveSession::SetSSRCUser gets to the worker
+    bool Decrypt(uint32_t ssrc, const uint8_t *data, size_t size, std::vector<uint8_t> &out) const;
+
+private:
+    friend class DaveSession;
+
+    struct EncryptorSlot {
+        std::mutex Mutex;
+        std::unique_ptr<discord::dave::IEncryptor> Encryptor;
+    };
+
+    struct DecryptorSlot {
+        std::mutex Mutex;
+        std::unique_ptr<discord::dave::IDecryptor> Decryptor;
+    };
+
+    struct State {
+        bool Enabled = false;
+        bool Downgraded = false;
+        std::shared_ptr<EncryptorSlot> Encryptor;
+        std::unordered_map<uint32_t, std::shared_ptr<DecryptorSlot>> Decryptors;
+    };
+
+    std::shared_ptr<const State> GetState() const;
+
+    std::shared_ptr<const State> m_state = std::make_shared<State>();
+    std::shared_ptr<spdlog::logger> m_log;
+};
+
+// all mls work happens on a worker thread owned by the session. the public methods just queue work and return,
+// and the signals are emitted back on the main thread. only create, use and destroy this on the main thread
 class DaveSession {
 public:
-    DaveSession(Snowflake channelId, Snowflake userId,
-                const std::unordered_map<uint32_t, Snowflake> &ssrcUserMap);
+    DaveSession(Snowflake channelId, Snowflake userId);
     ~DaveSession();
 
     void Init(uint16_t protocolVersion);
@@ -37,20 +82,26 @@ public:
     void OnExecuteTransition(int transitionId);
     void OnPrepareEpoch(int protocolVersion, int epoch);
 
-    discord::dave::IEncryptor *GetEncryptor();
-    discord::dave::IDecryptor *GetOrCreateDecryptor(uint32_t ssrc, Snowflake userId);
-
-    bool IsEnabled() const { return m_enabled; }
-    bool IsDowngraded() const { return m_downgraded; }
+    std::shared_ptr<DaveMedia> GetMedia() const;
 
     using FingerprintCallback = std::function<void(const std::vector<uint8_t> &)>;
-    void GetPairwiseFingerprint(const std::string &userId, FingerprintCallback callback) const;
-    std::vector<uint8_t> GetLastEpochAuthenticator() const;
+    // callback runs on the main thread
+    void GetPairwiseFingerprint(const std::string &userId, FingerprintCallback callback);
 
     void SetLocalSSRC(uint32_t ssrc);
+    void SetSSRCUser(uint32_t ssrc, Snowflake userId);
     void AddConnectedUser(const std::string &userId);
     void RemoveConnectedUser(const std::string &userId);
-    void ApplyKeyRatchetForSSRC(uint32_t ssrc, Snowflake userId);
+
+    struct OperationStats {
+        size_t Count = 0;
+        std::chrono::steady_clock::duration Total {};
+        std::chrono::steady_clock::duration Max {};
+        std::chrono::steady_clock::duration MaxQueued {}; // longest wait between being queued and starting
+    };
+
+    // keyed by operation name
+    std::map<std::string, OperationStats> GetOperationStats() const;
 
     // signal types
     using type_signal_send_binary = sigc::signal<void(int opcode, const std::vector<uint8_t> &data)>;
@@ -64,12 +115,47 @@ public:
     type_signal_state_changed signal_dave_state_changed();
 
 private:
+    void Publish();
+
+    // worker
+    void Post(const char *name, std::function<void()> func);
+    void WorkerThread();
+
+    // main thread
+    void PostMain(std::function<void()> func);
+    void OnMainDispatch();
+
+    // these run on the worker
     void Reinit();
     void CompleteTransition();
+    void UpdateDecryptor(uint32_t ssrc, Snowflake userId);
+
+    struct Task {
+        const char *Name;
+        std::function<void()> Func;
+        std::chrono::steady_clock::time_point Queued;
+    };
 
+    std::thread m_worker;
+    std::deque<Task> m_tasks;
+    std::mutex m_tasks_mutex;
+    std::condition_variable m_tasks_cv;
+    bool m_stop = false;
+
+    Glib::Dispatcher m_main_dispatcher;
+    std::deque<std::function<void()>> m_main_queue;
+    std::mutex m_main_mutex;
+
+    mutable std::mutex m_stats_mutex;
+    std::map<std::string, OperationStats> m_stats;
+
+    std::shared_ptr<DaveMedia> m_media;
+
+    // only touched on the worker
     std::unique_ptr<discord::dave::mls::ISession> m_mls_session;
-    std::unique_ptr<discord::dave::IEncryptor> m_encryptor;
-    std::unordered_map<uint32_t, std::unique_ptr<discord::dave::IDecryptor>> m_decryptors;
+    std::shared_ptr<DaveMedia::EncryptorSlot> m_encryptor;
+    std::unordered_map<uint32_t, std::shared_ptr<DaveMedia::DecryptorSlot>> m_decryptors;
+    std::unordered_map<uint32_t, Snowflake> m_ssrc_users;
 
     uint16_t m_protocol_version = 0;
     uint16_t m_pending_protocol_version = 0;
@@ -83,8 +169,6 @@ private:
     bool m_downgraded = false;
     bool m_pending_transition_ready = false;
 
-    const std::unordered_map<uint32_t, Snowflake> &m_ssrc_user_map;
-
     std::shared_ptr<::mlspp::SignaturePrivateKey> m_transient_key;
 
     std::shared_ptr<spdlog::logger> m_log;
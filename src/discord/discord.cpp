@@ -1,11 +1,21 @@
 #include "discord.hpp"
 
+#include <algorithm>
 #include <cinttypes>
 #include <utility>
 
 #include <spdlog/spdlog.h>
 
 #include "abaddon.hpp"
+#include "platform.hpp"
+#include "trace.hpp"
+
+constexpr static unsigned PresenceFlushInterval = 16; // ms, about a frame
+constexpr static unsigned MemberRequestWindow = 100;  // ms
+constexpr static size_t MaxMemberRequestIDs = 100;
+constexpr static size_t MaxMemberRequestsPerMinute = 60; // half of the gateway's send limit
+constexpr static auto MemberRequestTimeout = std::chrono::seconds(30);
+constexpr static size_t MemberWriteSlice = 100; // members per queued write, so a direct write waits on at most this many
 
 using namespace std::string_literals;
 
@@ -19,6 +29,7 @@ DiscordClient::DiscordClient(bool mem_store)
         auto func = m_generic_queue.front();
         m_generic_queue.pop();
         m_generic_mutex.unlock();
+        TRACE_ZONE("discord dispatch");
         func();
     };
     m_generic_dispatch.connect(dispatch_cb);
@@ -43,8 +54,23 @@ DiscordClient::DiscordClient(bool mem_store)
     LoadEventMap();
 }
 
+DiscordClient::~DiscordClient() {
+    // write callbacks post back to members that go away before the store does
+    m_store.StopWriter();
+    m_replay_waiter.kill();
+    if (m_replay_thread.joinable()) m_replay_thread.join();
+    if (m_guild_snapshots_thread.joinable()) m_guild_snapshots_thread.join();
+}
+
 void DiscordClient::Start() {
-    if (m_client_started) return;
+    if (m_client_started || m_replaying) return;
+
+    // whatever a replay left behind
+    if (m_replay_thread.joinable()) {
+        m_replay_thread.join();
+        m_store.ClearAll();
+        m_guild_to_users.clear();
+    }
 
     m_http.SetBase(GetAPIURL());
     SetHeaders();
@@ -68,7 +94,14 @@ bool DiscordClient::Stop() {
         if (m_heartbeat_thread.joinable()) m_heartbeat_thread.join();
         m_client_connected = false;
         m_reconnecting = false;
-
+        m_identify_pending = false;
+
+        m_presence_flush.disconnect();
+        m_pending_presences.clear();
+        m_member_requests_timer.disconnect();
+        m_member_requests_pending.clear();
+        m_member_requests_sent.clear();
+        m_member_request_times.clear();
         m_store.ClearAll();
         m_guild_to_users.clear();
 
@@ -161,7 +194,7 @@ void DiscordClient::FetchInvite(const std::string &code, const sigc::slot<void(s
 
 void DiscordClient::FetchMessagesInChannel(Snowflake id, const sigc::slot<void(const std::vector<Message> &)> &cb) {
     std::string path = "/channels/" + std::to_string(id) + "/messages?limit=50";
-    m_http.MakeGET(path, [this, id, cb](const http::response_type &r) {
+    m_http.MakeGETParsed<std::vector<Message>>(path, [this, id, cb](const http::response_type &r, const std::shared_ptr<std::vector<Message>> &msgs) {
         if (!CheckCode(r)) {
             // fake a thread delete event if the requested channel is a thread and we get a 404
 
@@ -179,42 +212,46 @@ void DiscordClient::FetchMessagesInChannel(Snowflake id, const sigc::slot<void(c
 
             return;
         }
-
-        std::vector<Message> msgs;
-
-        nlohmann::json::parse(r.text).get_to(msgs);
-
-        m_store.BeginTransaction();
-        for (auto &msg : msgs) {
-            StoreMessageData(msg);
-            if (msg.GuildID.has_value())
-                AddUserToGuild(msg.Author.ID, *msg.GuildID);
-        }
-        m_store.EndTransaction();
-
-        cb(msgs);
+        if (!msgs) return;
+
+        QueueStoreWrite([this, msgs] {
+            for (auto &msg : *msgs)
+                StoreMessageData(msg);
+        },
+                        [this, cb, msgs] {
+                            AddAuthorsToGuilds(*msgs);
+                            cb(*msgs);
+                        });
     });
 }
 
 void DiscordClient::FetchMessagesInChannelBefore(Snowflake channel_id, Snowflake before_id, const sigc::slot<void(const std::vector<Message> &)> &cb) {
-    std::string path = "/channels/" + std::to_string(channel_id) + "/messages?limit=50&before=" + std::to_string(before_id);
-    m_http.MakeGET(path, [this, cb](http::response_type r) {
-        if (!CheckCode(r)) return;
-
-        std::vector<Message> msgs;
-
-        nlohmann::json::parse(r.text).get_to(msgs);
+    FetchMessagesInChannelBefore(channel_id, before_id, cb, {});
+}
 
-        m_store.BeginTransaction();
-        for (auto &msg : msgs) {
-            StoreMessageData(msg);
-            if (msg.GuildID.has_value())
-                AddUserToGuild(msg.Author.ID, *msg.GuildID);
+void DiscordClient::FetchMessagesInChannelBefore(Snowflake channel_id, Snowflake before_id, const sigc::slot<void(const std::vector<Message> &)> &cb, const sigc::slot<void(int, float)> &err) {
+    std::string path = "/channels/" + std::to_string(channel_id) + "/messages?limit=50&before=" + std::to_string(before_id);
+    m_http.MakeGETParsed<std::vector<Message>>(path, [this, cb, err](const http::response_type &r, const std::shared_ptr<std::vector<Message>> &msgs) {
+        if (!CheckCode(r) || !msgs) {
+            float retry_after = 0.0F;
+            if (r.status_code == http::TooManyRequests) {
+                try {
+                    retry_after = nlohmann::json::parse(r.text).get<RateLimitedResponse>().RetryAfter;
+                } catch (...) {}
+            }
+            err(r.status_code, retry_after);
+            return;
         }
-        m_store.EndTransaction();
 
-        std::sort(msgs.begin(), msgs.end(), [](const Message &a, const Message &b) { return a.ID < b.ID; });
-        cb(msgs);
+        std::sort(msgs->begin(), msgs->end(), [](const Message &a, const Message &b) { return a.ID < b.ID; });
+        QueueStoreWrite([this, msgs] {
+            for (auto &msg : *msgs)
+                StoreMessageData(msg);
+        },
+                        [this, cb, msgs] {
+                            AddAuthorsToGuilds(*msgs);
+                            cb(*msgs);
+                        });
     });
 }
 
@@ -242,6 +279,10 @@ std::optional<GuildMember> DiscordClient::GetMember(Snowflake user_id, Snowflake
     return m_store.GetGuildMember(guild_id, user_id);
 }
 
+bool DiscordClient::HasMember(Snowflake user_id, Snowflake guild_id) const {
+    return m_store.HasGuildMember(guild_id, user_id);
+}
+
 std::optional<PermissionOverwrite> DiscordClient::GetPermissionOverwrite(Snowflake channel_id, Snowflake id) const {
     return m_store.GetPermissionOverwrite(channel_id, id);
 }
@@ -298,25 +339,43 @@ std::optional<RoleData> DiscordClient::GetMemberHighestRole(Snowflake guild_id,
     });
 }
 
-std::set<Snowflake> DiscordClient::GetUsersInGuild(Snowflake id) const {
-    auto it = m_guild_to_users.find(id);
-    if (it != m_guild_to_users.end())
-        return it->second;
+static const IDSet EmptyIDSet;
 
-    return {};
+const IDSet &DiscordClient::GetUsersInGuild(Snowflake id) const {
+    if (const auto *users = m_guild_to_users.find(id))
+        return *users;
+    return EmptyIDSet;
 }
 
-std::set<Snowflake> DiscordClient::GetChannelsInGuild(Snowflake id) const {
-    auto it = m_guild_to_channels.find(id);
-    if (it != m_guild_to_channels.end())
-        return it->second;
-    return {};
+const IDSet &DiscordClient::GetChannelsInGuild(Snowflake id) const {
+    if (const auto *channels = m_guild_to_channels.find(id))
+        return *channels;
+    return EmptyIDSet;
 }
 
-std::vector<Snowflake> DiscordClient::GetUsersInThread(Snowflake id) const {
-    if (auto it = m_thread_members.find(id); it != m_thread_members.end())
-        return it->second;
-    return {};
+const IDSet &DiscordClient::GetUsersInThread(Snowflake id) const {
+    if (const auto *users = m_thread_members.find(id))
+        return *users;
+    return EmptyIDSet;
+}
+
+std::vector<DiscordClient::IndexMemoryUsage> DiscordClient::GetIndexMemoryUsage() const {
+    const auto get_nested = [](const char *name, const IDMap<IDSet> &map) -> IndexMemoryUsage {
+        IndexMemoryUsage usage { name, 0, map.GetMemoryUsage() };
+        map.ForEach([&usage](Snowflake, const IDSet &set) {
+            usage.Entries += set.size();
+            usage.Bytes += set.GetMemoryUsage() - sizeof(IDSet); // the set itself is counted by the map
+        });
+        return usage;
+    };
+
+    return {
+        get_nested("guild users", m_guild_to_users),
+        get_nested("guild channels", m_guild_to_channels),
+        get_nested("thread members", m_thread_members),
+        { "user status", m_user_to_status.size(), m_user_to_status.GetMemoryUsage() },
+        { "last message", m_last_message_id.size(), m_last_message_id.GetMemoryUsage() },
+    };
 }
 
 // there is an endpoint for this but it should be synced before this is called anyways
@@ -669,8 +728,7 @@ void DiscordClient::UpdateStatus(PresenceStatus status, bool is_afk) {
 
     m_websocket.Send(nlohmann::json(msg));
     // fake message cuz we dont receive messages for ourself
-    m_user_to_status[m_user_data.ID] = status;
-    m_signal_presence_update.emit(GetUserData(), status);
+    SetUserStatus(m_user_data.ID, status);
 }
 
 void DiscordClient::UpdateStatus(PresenceStatus status, bool is_afk, const ActivityData &obj) {
@@ -680,8 +738,7 @@ void DiscordClient::UpdateStatus(PresenceStatus status, bool is_afk, const Activ
     msg.Activities.push_back(obj);
 
     m_websocket.Send(nlohmann::json(msg));
-    m_user_to_status[m_user_data.ID] = status;
-    m_signal_presence_update.emit(GetUserData(), status);
+    SetUserStatus(m_user_data.ID, status);
 }
 
 void DiscordClient::CloseDM(Snowflake channel_id) {
@@ -974,9 +1031,9 @@ void DiscordClient::UnArchiveThread(Snowflake channel_id, const sigc::slot<void(
 
 void DiscordClient::MarkChannelAsRead(Snowflake channel_id, const sigc::slot<void(DiscordError code)> &callback) {
     if (m_unread.find(channel_id) == m_unread.end()) return;
-    const auto iter = m_last_message_id.find(channel_id);
-    if (iter == m_last_message_id.end()) return;
-    m_http.MakePOST("/channels/" + std::to_string(channel_id) + "/messages/" + std::to_string(iter->second) + "/ack", "{\"token\":null}", [callback](const http::response_type &response) {
+    const auto *last_id = m_last_message_id.find(channel_id);
+    if (last_id == nullptr) return;
+    m_http.MakePOST("/channels/" + std::to_string(channel_id) + "/messages/" + std::to_string(*last_id) + "/ack", "{\"token\":null}", [callback](const http::response_type &response) {
         if (CheckCode(response))
             callback(DiscordError::NONE);
         else
@@ -986,15 +1043,15 @@ void DiscordClient::MarkChannelAsRead(Snowflake channel_id, const sigc::slot<voi
 
 void DiscordClient::MarkGuildAsRead(Snowflake guild_id, const sigc::slot<void(DiscordError code)> &callback) {
     AckBulkData data;
-    const auto channels = GetChannelsInGuild(guild_id);
+    const auto &channels = GetChannelsInGuild(guild_id);
     for (const auto &[unread, mention_count] : m_unread) {
-        if (channels.find(unread) == channels.end()) continue;
+        if (!channels.contains(unread)) continue;
 
-        const auto iter = m_last_message_id.find(unread);
-        if (iter == m_last_message_id.end()) continue;
+        const auto *last_id = m_last_message_id.find(unread);
+        if (last_id == nullptr) continue;
         auto &e = data.ReadStates.emplace_back();
         e.ID = unread;
-        e.LastMessageID = iter->second;
+        e.LastMessageID = *last_id;
     }
 
     if (data.ReadStates.empty()) return;
@@ -1080,17 +1137,18 @@ void DiscordClient::FetchPinned(Snowflake id, const sigc::slot<void(std::vector<
     }
     m_channels_pinned_requested.insert(id);
 
-    m_http.MakeGET("/channels/" + std::to_string(id) + "/pins", [this, callback](const http::response_type &response) {
-        if (!CheckCode(response)) {
+    m_http.MakeGETParsed<std::vector<Message>>("/channels/" + std::to_string(id) + "/pins", [this, callback](const http::response_type &response, const std::shared_ptr<std::vector<Message>> &data) {
+        if (!CheckCode(response) || !data) {
             callback({}, GetCodeFromResponse(response));
             return;
         }
 
-        auto data = nlohmann::json::parse(response.text).get<std::vector<Message>>();
-        std::sort(data.begin(), data.end(), [](const Message &a, const Message &b) { return a.ID < b.ID; });
-        for (auto &msg : data)
-            StoreMessageData(msg);
-        callback(data, DiscordError::NONE);
+        std::sort(data->begin(), data->end(), [](const Message &a, const Message &b) { return a.ID < b.ID; });
+        QueueStoreWrite([this, data] {
+            for (auto &msg : *data)
+                StoreMessageData(msg);
+        },
+                        [callback, data] { callback(*data, DiscordError::NONE); });
     });
 }
 
@@ -1111,69 +1169,72 @@ std::vector<BanData> DiscordClient::GetBansInGuild(Snowflake guild_id) {
     return m_store.GetBans(guild_id);
 }
 
+std::optional<BackfillCursor> DiscordClient::GetBackfillCursor(Snowflake channel_id) const {
+    return m_store.GetBackfillCursor(channel_id);
+}
+
+void DiscordClient::SetBackfillCursor(Snowflake channel_id, const BackfillCursor &cursor) {
+    m_store.SetBackfillCursor(channel_id, cursor);
+}
+
 void DiscordClient::FetchGuildBan(Snowflake guild_id, Snowflake user_id, const sigc::slot<void(BanData)> &callback) {
-    m_http.MakeGET("/guilds/" + std::to_string(guild_id) + "/bans/" + std::to_string(user_id), [this, callback, guild_id](const http::response_type &response) {
-        if (!CheckCode(response)) return;
-        auto ban = nlohmann::json::parse(response.text).get<BanData>();
-        m_store.SetBan(guild_id, ban.User.ID, ban);
-        m_store.SetUser(ban.User.ID, ban.User);
-        callback(ban);
+    m_http.MakeGETParsed<BanData>("/guilds/" + std::to_string(guild_id) + "/bans/" + std::to_string(user_id), [this, callback, guild_id](const http::response_type &response, const std::shared_ptr<BanData> &ban) {
+        if (!CheckCode(response) || !ban) return;
+        QueueStoreWrite([this, guild_id, ban] {
+            m_store.SetBan(guild_id, ban->User.ID, *ban);
+            m_store.SetUser(ban->User.ID, ban->User);
+        },
+                        [callback, ban] { callback(*ban); });
     });
 }
 
 void DiscordClient::FetchGuildBans(Snowflake guild_id, const sigc::slot<void(std::vector<BanData>)> &callback) {
-    m_http.MakeGET("/guilds/" + std::to_string(guild_id) + "/bans", [this, callback, guild_id](const http::response_type &response) {
-        if (!CheckCode(response)) return;
-        auto bans = nlohmann::json::parse(response.text).get<std::vector<BanData>>();
-        m_store.BeginTransaction();
-        for (const auto &ban : bans) {
-            m_store.SetBan(guild_id, ban.User.ID, ban);
-            m_store.SetUser(ban.User.ID, ban.User);
-        }
-        m_store.EndTransaction();
-        callback(bans);
+    m_http.MakeGETParsed<std::vector<BanData>>("/guilds/" + std::to_string(guild_id) + "/bans", [this, callback, guild_id](const http::response_type &response, const std::shared_ptr<std::vector<BanData>> &bans) {
+        if (!CheckCode(response) || !bans) return;
+        QueueStoreWrite([this, guild_id, bans] {
+            for (const auto &ban : *bans) {
+                m_store.SetBan(guild_id, ban.User.ID, ban);
+                m_store.SetUser(ban.User.ID, ban.User);
+            }
+        },
+                        [callback, bans] { callback(*bans); });
     });
 }
 
 void DiscordClient::FetchGuildInvites(Snowflake guild_id, const sigc::slot<void(std::vector<InviteData>)> &callback) {
-    m_http.MakeGET("/guilds/" + std::to_string(guild_id) + "/invites", [this, callback](const http::response_type &response) {
+    m_http.MakeGETParsed<std::vector<InviteData>>("/guilds/" + std::to_string(guild_id) + "/invites", [this, callback](const http::response_type &response, const std::shared_ptr<std::vector<InviteData>> &invites) {
         // store?
-        if (!CheckCode(response)) return;
-        auto invites = nlohmann::json::parse(response.text).get<std::vector<InviteData>>();
-
-        m_store.BeginTransaction();
-        for (const auto &invite : invites)
-            if (invite.Inviter.has_value())
-                m_store.SetUser(invite.Inviter->ID, *invite.Inviter);
-        m_store.EndTransaction();
-
-        callback(invites);
+        if (!CheckCode(response) || !invites) return;
+
+        QueueStoreWrite([this, invites] {
+            for (const auto &invite : *invites)
+                if (invite.Inviter.has_value())
+                    m_store.SetUser(invite.Inviter->ID, *invite.Inviter);
+        },
+                        [callback, invites] { callback(*invites); });
     });
 }
 
 void DiscordClient::FetchAuditLog(Snowflake guild_id, const sigc::slot<void(AuditLogData)> &callback) {
-    m_http.MakeGET("/guilds/" + std::to_string(guild_id) + "/audit-logs", [this, callback](const http::response &response) {
-        if (!CheckCode(response)) return;
-        auto data = nlohmann::json::parse(response.text).get<AuditLogData>();
-
-        m_store.BeginTransaction();
-        for (const auto &user : data.Users)
-            m_store.SetUser(user.ID, user);
-        m_store.EndTransaction();
-
-        callback(data);
+    m_http.MakeGETParsed<AuditLogData>("/guilds/" + std::to_string(guild_id) + "/audit-logs", [this, callback](const http::response_type &response, const std::shared_ptr<AuditLogData> &data) {
+        if (!CheckCode(response) || !data) return;
+
+        QueueStoreWrite([this, data] {
+            for (const auto &user : data->Users)
+                m_store.SetUser(user.ID, user);
+        },
+                        [callback, data] { callback(*data); });
     });
 }
 
 void DiscordClient::FetchGuildEmojis(Snowflake guild_id, const sigc::slot<void(std::vector<EmojiData>)> &callback) {
-    m_http.MakeGET("/guilds/" + std::to_string(guild_id) + "/emojis", [this, callback](const http::response_type &response) {
-        if (!CheckCode(response)) return;
-        auto emojis = nlohmann::json::parse(response.text).get<std::vector<EmojiData>>();
-        m_store.BeginTransaction();
-        for (const auto &emoji : emojis)
-            m_store.SetEmoji(emoji.ID, emoji);
-        m_store.EndTransaction();
-        callback(emojis);
+    m_http.MakeGETParsed<std::vector<EmojiData>>("/guilds/" + std::to_string(guild_id) + "/emojis", [this, callback](const http::response_type &response, const std::shared_ptr<std::vector<EmojiData>> &emojis) {
+        if (!CheckCode(response) || !emojis) return;
+        QueueStoreWrite([this, emojis] {
+            for (const auto &emoji : *emojis)
+                m_store.SetEmoji(emoji.ID, emoji);
+        },
+                        [callback, emojis] { callback(*emojis); });
     });
 }
 
@@ -1421,6 +1482,14 @@ void DiscordClient::SetBuildNumber(uint32_t build_number) {
     m_build_number = build_number;
 }
 
+void DiscordClient::SetIdentifyHeld(bool held) {
+    m_identify_held = held;
+    if (!held && m_identify_pending) {
+        m_identify_pending = false;
+        if (m_client_connected) SendIdentify();
+    }
+}
+
 void DiscordClient::SetCookie(std::string_view cookie) {
     m_http.SetCookie(cookie);
 }
@@ -1441,6 +1510,128 @@ void DiscordClient::SetDumpReady(bool dump) {
     m_dump_ready = dump;
 }
 
+void DiscordClient::SetRecordGateway(bool record) {
+    std::lock_guard<std::mutex> l(m_recorder_mutex);
+    if (!record) {
+        if (m_recorder) spdlog::get("discord")->info("Stopped recording gateway after {} messages", m_recorder->GetMessageCount());
+        m_recorder.reset();
+        return;
+    }
+    if (m_recorder) return;
+
+    const auto name = "./gateway-" + Glib::DateTime::create_now_utc().format("%Y-%m-%d_%H-%M-%S") + ".rec";
+    m_recorder = GatewayRecorder::Create(name);
+    if (m_recorder)
+        spdlog::get("discord")->info("Recording gateway to {}", name);
+    else
+        spdlog::get("discord")->error("Failed to open {} for recording", name);
+}
+
+bool DiscordClient::StartReplay(const std::string &path, bool realtime) {
+    if (m_client_started || m_replaying) return false;
+
+    auto recording = GatewayRecording::Open(path);
+    if (!recording) {
+        spdlog::get("discord")->error("{} isn't a gateway recording", path);
+        return false;
+    }
+
+    if (m_replay_thread.joinable()) m_replay_thread.join();
+    m_store.ClearAll();
+    m_guild_to_users.clear();
+
+    spdlog::get("discord")->info("Replaying {} {}", path, realtime ? "at recorded speed" : "as fast as possible");
+
+    m_replaying = true;
+    m_replay_messages = 0;
+    m_replay_stats.clear();
+    m_store.SetTiming(true);
+    m_replay_store_start = m_store.GetTime();
+    m_replay_start = std::chrono::steady_clock::now();
+    m_replay_waiter.revive();
+    m_replay_thread = std::thread(&DiscordClient::ReplayThread, this, std::move(recording), realtime);
+    return true;
+}
+
+bool DiscordClient::IsReplaying() const noexcept {
+    return m_replaying;
+}
+
+const std::map<std::string, DiscordClient::ReplayEventStats> &DiscordClient::GetReplayStats() const noexcept {
+    return m_replay_stats;
+}
+
+void DiscordClient::ReplayThread(std::unique_ptr<GatewayRecording> recording, bool realtime) {
+    std::chrono::microseconds delay;
+    std::string msg;
+    while (recording->Next(delay, msg)) {
+        if (realtime) {
+            if (!m_replay_waiter.wait_for(delay)) return;
+        } else {
+            // dont get too far ahead of the main thread or the queue just holds the whole file
+            while (true) {
+                m_msg_mutex.lock();
+                const auto queued = m_msg_queue.size();
+                m_msg_mutex.unlock();
+                if (queued < 32) break;
+                if (!m_replay_waiter.wait_for(std::chrono::milliseconds(1))) return;
+            }
+        }
+
+        if (msg.empty()) continue;
+        m_msg_mutex.lock();
+        m_msg_queue.push(std::move(msg));
+        m_msg_dispatch.emit();
+        m_msg_mutex.unlock();
+        msg.clear();
+    }
+
+    // empty message marks the end
+    m_msg_mutex.lock();
+    m_msg_queue.push(std::string());
+    m_msg_dispatch.emit();
+    m_msg_mutex.unlock();
+}
+
+void DiscordClient::FinishReplay() {
+    using ms = std::chrono::duration<double, std::milli>;
+
+    const auto elapsed = std::chrono::steady_clock::now() - m_replay_start;
+    const auto store_total = m_store.GetTime() - m_replay_store_start;
+    m_store.SetTiming(false);
+    m_replaying = false;
+
+    std::vector<std::pair<std::string, ReplayEventStats>> sorted(m_replay_stats.begin(), m_replay_stats.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+        return a.second.Parse + a.second.Handler > b.second.Parse + b.second.Handler;
+    });
+
+    const bool has_heap = Platform::GetHeapInUse().has_value();
+    ReplayEventStats total;
+    std::string report = fmt::format("{:<32} {:>8} {:>10} {:>10} {:>10} {:>12}\n", "event", "count", "parse ms", "handler ms", "store ms", has_heap ? "net heap KiB" : "");
+    for (const auto &[type, stats] : sorted) {
+        report += fmt::format("{:<32} {:>8} {:>10.2f} {:>10.2f} {:>10.2f} {:>12}\n",
+                              type, stats.Count, ms(stats.Parse).count(), ms(stats.Handler).count(), ms(stats.Store).count(),
+                              has_heap ? std::to_string(stats.Heap / 1024) : "");
+        total.Count += stats.Count;
+        total.Parse += stats.Parse;
+        total.Handler += stats.Handler;
+        total.Store += stats.Store;
+        total.Heap += stats.Heap;
+    }
+    report += fmt::format("{:<32} {:>8} {:>10.2f} {:>10.2f} {:>10.2f} {:>12}\n",
+                          "total", total.Count, ms(total.Parse).count(), ms(total.Handler).count(), ms(total.Store).count(),
+                          has_heap ? std::to_string(total.Heap / 1024) : "");
+    // batched writes and the like that get flushed from idle callbacks instead of the handlers
+    report += fmt::format("\n{} messages in {:.2f} ms, {:.2f} ms store time outside handlers, peak RSS {} MiB",
+                          m_replay_messages, ms(elapsed).count(), ms(store_total - total.Store).count(), Platform::GetPeakRSS() / (1024 * 1024));
+    report += has_heap ? "\nnet heap is growth left behind by each event (glibc mallinfo2), not how much it allocated"
+                       : "\nnet heap growth is only available with glibc";
+
+    spdlog::get("discord")->info("Replay finished:\n{}", report);
+    m_signal_replay_finished.emit(report);
+}
+
 bool DiscordClient::IsChannelMuted(Snowflake id) const noexcept {
     return m_muted_channels.find(id) != m_muted_channels.end();
 }
@@ -1455,6 +1646,20 @@ int DiscordClient::GetUnreadStateForChannel(Snowflake id) const noexcept {
     return iter->second;
 }
 
+std::vector<Snowflake> DiscordClient::GetChannelsWithMentions() const {
+    std::vector<std::pair<Snowflake, int>> mentioned;
+    for (const auto &[id, mention_count] : m_unread) {
+        if (mention_count > 0) mentioned.emplace_back(id, mention_count);
+    }
+    std::sort(mentioned.begin(), mentioned.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+
+    std::vector<Snowflake> ret;
+    ret.reserve(mentioned.size());
+    for (const auto &[id, mention_count] : mentioned)
+        ret.push_back(id);
+    return ret;
+}
+
 int DiscordClient::GetUnreadChannelsCountForCategory(Snowflake id) const noexcept {
     int result = 0;
     for (auto [channel_id, channel_type] : m_store.GetChannelIDsWithParentID(id)) {
@@ -1470,7 +1675,7 @@ int DiscordClient::GetUnreadChannelsCountForCategory(Snowflake id) const noexcep
 bool DiscordClient::GetUnreadStateForGuild(Snowflake id, int &total_mentions) const noexcept {
     total_mentions = 0;
     bool has_any_unread = false;
-    const auto channels = GetChannelsInGuild(id);
+    const auto &channels = GetChannelsInGuild(id);
     for (const auto channel_id : channels) {
         const auto channel_unread = GetUnreadStateForChannel(channel_id);
         if (channel_unread > -1)
@@ -1490,7 +1695,7 @@ bool DiscordClient::GetUnreadStateForGuild(Snowflake id, int &total_mentions) co
 }
 
 int DiscordClient::GetUnreadDMsCount() const {
-    const auto channels = GetPrivateChannels();
+    const auto &channels = GetPrivateChannels();
     int count = 0;
     for (const auto channel_id : channels)
         if (!IsChannelMuted(channel_id) && GetUnreadStateForChannel(channel_id) > -1) count++;
@@ -1498,9 +1703,8 @@ int DiscordClient::GetUnreadDMsCount() const {
 }
 
 PresenceStatus DiscordClient::GetUserStatus(Snowflake id) const {
-    auto it = m_user_to_status.find(id);
-    if (it != m_user_to_status.end())
-        return it->second;
+    if (const auto *status = m_user_to_status.find(id))
+        return *status;
 
     return PresenceStatus::Offline;
 }
@@ -1549,8 +1753,12 @@ void DiscordClient::HandleGatewayMessageRaw(std::string str) {
             if (err != Z_OK) {
                 fprintf(stderr, "Error decompressing input buffer %d (%d/%d)\n", err, m_zstream.avail_in, m_zstream.avail_out);
             } else {
+                std::string msg(m_decompress_buf.begin(), m_decompress_buf.begin() + m_zstream.total_out);
+                m_recorder_mutex.lock();
+                if (m_recorder) m_recorder->Write(msg);
+                m_recorder_mutex.unlock();
                 m_msg_mutex.lock();
-                m_msg_queue.push(std::string(m_decompress_buf.begin(), m_decompress_buf.begin() + m_zstream.total_out));
+                m_msg_queue.push(std::move(msg));
                 m_msg_dispatch.emit();
                 m_msg_mutex.unlock();
                 if (m_decompress_buf.size() > InflateChunkSize)
@@ -1568,18 +1776,40 @@ void DiscordClient::MessageDispatch() {
     auto msg = m_msg_queue.front();
     m_msg_queue.pop();
     m_msg_mutex.unlock();
+    if (m_replaying && msg.empty()) {
+        FinishReplay();
+        return;
+    }
     HandleGatewayMessage(msg);
 }
 
 void DiscordClient::HandleGatewayMessage(std::string str) {
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration store_start {};
+    std::optional<size_t> heap_start;
+    if (m_replaying) {
+        heap_start = Platform::GetHeapInUse();
+        store_start = m_store.GetTime();
+        start = std::chrono::steady_clock::now();
+    }
+
     GatewayMessage m;
     try {
+        TRACE_ZONE("gateway parse");
         m = nlohmann::json::parse(str);
     } catch (std::exception &e) {
         printf("Error decoding JSON. Discarding message: %s\n", e.what());
         return;
     }
 
+    if (m_replaying) {
+        // the connection itself isnt being replayed, a hello would start heartbeating into nothing
+        if (m.Opcode != GatewayOp::Dispatch) return;
+        m_replay_messages++;
+    }
+    const auto parsed = m_replaying ? std::chrono::steady_clock::now() : start;
+    TRACE_ZONE(m.Opcode == GatewayOp::Dispatch ? std::string_view(m.Type) : std::string_view("gateway op"));
+
     if (m.Sequence != -1)
         m_last_sequence = m.Sequence;
 
@@ -1605,7 +1835,7 @@ void DiscordClient::HandleGatewayMessage(std::string str) {
                 }
                 switch (iter->second) {
                     case GatewayEvent::READY: {
-                        HandleGatewayReady(m);
+                        HandleGatewayReady(m, str.size());
                     } break;
                     case GatewayEvent::MESSAGE_CREATE: {
                         HandleGatewayMessageCreate(m);
@@ -1765,6 +1995,16 @@ void DiscordClient::HandleGatewayMessage(std::string str) {
     } catch (std::exception &e) {
         fprintf(stderr, "error handling message (opcode %d): %s\n", static_cast<int>(m.Opcode), e.what());
     }
+
+    if (m_replaying) {
+        auto &stats = m_replay_stats[m.Type];
+        stats.Count++;
+        stats.Parse += parsed - start;
+        stats.Handler += std::chrono::steady_clock::now() - parsed;
+        stats.Store += m_store.GetTime() - store_start;
+        if (const auto heap = Platform::GetHeapInUse(); heap.has_value() && heap_start.has_value())
+            stats.Heap += static_cast<int64_t>(*heap) - static_cast<int64_t>(*heap_start);
+    }
 }
 
 void DiscordClient::HandleGatewayHello(const GatewayMessage &msg) {
@@ -1778,6 +2018,8 @@ void DiscordClient::HandleGatewayHello(const GatewayMessage &msg) {
     if (m_wants_resume) {
         m_wants_resume = false;
         SendResume();
+    } else if (m_identify_held) {
+        m_identify_pending = true;
     } else
         SendIdentify();
 }
@@ -1844,7 +2086,8 @@ void DiscordClient::ProcessNewGuild(GuildData &guild) {
     m_store.EndTransaction();
 }
 
-void DiscordClient::HandleGatewayReady(const GatewayMessage &msg) {
+void DiscordClient::HandleGatewayReady(GatewayMessage &msg, size_t bytes) {
+    const auto start = std::chrono::steady_clock::now();
     m_ready_received = true;
 
     if (m_dump_ready) {
@@ -1857,10 +2100,44 @@ void DiscordClient::HandleGatewayReady(const GatewayMessage &msg) {
         }
     }
 
+    // fill in whatever the server left out because our hash for it matched
+    size_t hydrated = 0;
+    size_t missing = 0;
+    auto &guilds = msg.Data.at("guilds");
+    for (auto &g : guilds) {
+        switch (m_guild_snapshots.Hydrate(g)) {
+            case GuildSnapshots::HydrateResult::Full:
+                break;
+            case GuildSnapshots::HydrateResult::Hydrated:
+                hydrated++;
+                break;
+            case GuildSnapshots::HydrateResult::Missing:
+                // shouldnt happen since we only send hashes we have data for. its left out of the new snapshots so
+                // it stays unavailable until the next identify, which gets it in full
+                spdlog::get("discord")->warn("READY omitted parts of guild {} that aren't in the snapshot, leaving it unavailable until the next connect", g.at("id").get<std::string>());
+                g["unavailable"] = true;
+                missing++;
+                break;
+        }
+    }
+
     ReadyEventData data = msg.Data;
     for (auto &g : data.Guilds)
         ProcessNewGuild(g);
 
+    if (!m_replaying) {
+        // built from scratch so guilds that werent in this READY (left, kicked) dont stick around
+        GuildSnapshots snapshots;
+        for (auto &g : guilds)
+            snapshots.Update(std::move(g));
+        if (m_guild_snapshots_thread.joinable()) m_guild_snapshots_thread.join();
+        m_guild_snapshots_thread = std::thread([snapshots = std::move(snapshots), path = Abaddon::GetStateCachePath("/guilds.bin"), token = m_token]() {
+            if (!snapshots.Save(path, token))
+                spdlog::get("discord")->warn("Failed to save guild snapshots");
+        });
+        m_guild_snapshots = {};
+    }
+
     m_store.BeginTransaction();
 
     for (const auto &dm : data.PrivateChannels) {
@@ -1903,6 +2180,13 @@ void DiscordClient::HandleGatewayReady(const GatewayMessage &msg) {
     HandleReadyReadState(data);
     HandleReadyGuildSettings(data);
 
+    for (const auto &usage : GetIndexMemoryUsage())
+        spdlog::get("discord")->debug("Index {}: {} entries, {} bytes", usage.Name, usage.Entries, usage.Bytes);
+
+    spdlog::get("discord")->info("READY: {} KiB, {} guilds, {} from snapshot ({} advertised, {} missing), ingested in {:.1f} ms",
+                                 bytes / 1024, data.Guilds.size(), hydrated, m_guild_snapshots_advertised, missing,
+                                 std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
     m_signal_gateway_ready.emit();
 }
 
@@ -1960,36 +2244,26 @@ void DiscordClient::HandleGatewayPresenceUpdate(const GatewayMessage &msg) {
     PresenceUpdateMessage data = msg.Data;
     const auto user_id = data.User.at("id").get<Snowflake>();
 
-    auto cur = m_store.GetUser(user_id);
-    if (cur.has_value()) {
-        cur->update_from_json(data.User);
-        m_store.SetUser(cur->ID, *cur);
-    } else
-        return;
-
-    PresenceStatus e;
-    if (data.StatusMessage == "online")
-        e = PresenceStatus::Online;
-    else if (data.StatusMessage == "offline")
-        e = PresenceStatus::Offline;
-    else if (data.StatusMessage == "idle")
-        e = PresenceStatus::Idle;
-    else if (data.StatusMessage == "dnd")
-        e = PresenceStatus::DND;
-
-    m_user_to_status[user_id] = e;
+    // most of these only carry the id so theres nothing to write
+    if (data.User.size() > 1) {
+        auto write = [this, user_id, user = std::move(data.User)] {
+            auto cur = m_store.GetUser(user_id);
+            if (!cur.has_value()) return;
+            cur->update_from_json(user);
+            m_store.SetUser(user_id, *cur);
+        };
+        QueueStoreWrite(std::move(write), {});
+    }
 
-    m_signal_presence_update.emit(*cur, e);
+    SetUserStatus(user_id, GetPresenceFromString(data.StatusMessage));
 }
 
 void DiscordClient::HandleGatewayChannelDelete(const GatewayMessage &msg) {
     const auto id = msg.Data.at("id").get<Snowflake>();
     const auto channel = GetChannel(id);
     if (channel.has_value() && channel->GuildID.has_value()) {
-        auto it = m_guild_to_channels.find(*channel->GuildID);
-        if (it != m_guild_to_channels.end()) {
-            it->second.erase(id);
-        }
+        if (auto *channels = m_guild_to_channels.find(*channel->GuildID))
+            channels->erase(id);
     }
     m_store.ClearChannel(id);
     m_signal_channel_delete.emit(id);
@@ -2041,7 +2315,7 @@ void DiscordClient::HandleGatewayGuildUpdate(const GatewayMessage &msg) {
 void DiscordClient::HandleGatewayGuildRoleUpdate(const GatewayMessage &msg) {
     GuildRoleUpdateObject data = msg.Data;
 
-    const auto channels = GetChannelsInGuild(data.GuildID);
+    const auto &channels = GetChannelsInGuild(data.GuildID);
     std::unordered_set<Snowflake> accessible;
     for (auto channel : channels) {
         if (HasChannelPermission(m_user_data.ID, channel, Permission::VIEW_CHANNEL))
@@ -2310,14 +2584,17 @@ void DiscordClient::HandleGatewayThreadUpdate(const GatewayMessage &msg) {
 
 void DiscordClient::HandleGatewayThreadMemberListUpdate(const GatewayMessage &msg) {
     ThreadMemberListUpdateData data = msg.Data;
+    std::vector<Snowflake> user_ids;
     m_store.BeginTransaction();
     for (const auto &entry : data.Members) {
-        m_thread_members[data.ThreadID].push_back(entry.UserID);
+        user_ids.push_back(entry.UserID);
         if (entry.Member.User.has_value())
             m_store.SetUser(entry.Member.User->ID, *entry.Member.User);
         m_store.SetGuildMember(data.GuildID, entry.Member.User->ID, entry.Member);
     }
     m_store.EndTransaction();
+    if (!user_ids.empty())
+        m_thread_members[data.ThreadID].insert(user_ids.begin(), user_ids.end());
     m_signal_thread_member_list_update.emit(data);
 }
 
@@ -2334,7 +2611,7 @@ void DiscordClient::HandleGatewayUserGuildSettingsUpdate(const GatewayMessage &m
 
     const bool for_dms = !data.Settings.GuildID.IsValid();
 
-    const auto channels = for_dms ? GetPrivateChannels() : GetChannelsInGuild(data.Settings.GuildID);
+    const auto &channels = for_dms ? GetPrivateChannels() : GetChannelsInGuild(data.Settings.GuildID);
     std::set<Snowflake> now_muted_channels;
     const auto now = Snowflake::FromNow();
 
@@ -2396,11 +2673,27 @@ void DiscordClient::HandleGatewayUserGuildSettingsUpdate(const GatewayMessage &m
 }
 
 void DiscordClient::HandleGatewayGuildMembersChunk(const GatewayMessage &msg) {
-    GuildMembersChunkData data = msg.Data;
-    m_store.BeginTransaction();
-    for (const auto &member : data.Members)
-        m_store.SetGuildMember(data.GuildID, member.User->ID, member);
-    m_store.EndTransaction();
+    auto data = std::make_shared<GuildMembersChunkData>(msg.Data.get<GuildMembersChunkData>());
+
+    // not found users stay as sent until they time out so they aren't asked for again right away
+    if (auto it = m_member_requests_sent.find(data->GuildID); it != m_member_requests_sent.end()) {
+        for (const auto &member : data->Members)
+            it->second.erase(member.User->ID);
+        if (it->second.empty()) m_member_requests_sent.erase(it);
+    }
+
+    for (size_t first = 0; first < data->Members.size(); first += MemberWriteSlice) {
+        const auto last = std::min(first + MemberWriteSlice, data->Members.size());
+        QueueStoreWrite([this, data, first, last] {
+            for (size_t i = first; i < last; i++) {
+                const auto &member = data->Members[i];
+                m_store.SetUser(member.User->ID, *member.User);
+                m_store.SetGuildMember(data->GuildID, member.User->ID, member);
+            }
+        },
+                        {});
+    }
+    QueueStoreWrite([] {}, [this, data] { m_signal_guild_members_chunk.emit(*data); });
 }
 
 void DiscordClient::HandleGatewayStageInstanceCreate(const GatewayMessage &msg) {
@@ -2548,18 +2841,7 @@ void DiscordClient::HandleGatewayReadySupplemental(const GatewayMessage &msg) {
     ReadySupplementalData data = msg.Data;
 
     const auto handle_presence = [this](const MergedPresence &p) {
-        const auto user = GetUser(p.UserID);
-        if (!user.has_value()) return; // should be sent in READY's `users`
-        const auto s = p.Presence.Status;
-        if (s == "online")
-            m_user_to_status[p.UserID] = PresenceStatus::Online;
-        else if (s == "offline")
-            m_user_to_status[p.UserID] = PresenceStatus::Offline;
-        else if (s == "idle")
-            m_user_to_status[p.UserID] = PresenceStatus::Idle;
-        else if (s == "dnd")
-            m_user_to_status[p.UserID] = PresenceStatus::DND;
-        m_signal_presence_update.emit(*user, m_user_to_status.at(p.UserID));
+        SetUserStatus(p.UserID, GetPresenceFromString(p.Presence.Status));
     };
 
     for (const auto &p : data.MergedPresences.Friends) {
@@ -2668,6 +2950,7 @@ void DiscordClient::HandleGatewayGuildMemberListUpdate(const GatewayMessage &msg
     m_store.BeginTransaction();
 
     bool has_sync = false;
+    std::vector<Snowflake> synced_ids;
     for (const auto &op : data.Ops) {
         if (op.Op == "SYNC") {
             has_sync = true;
@@ -2675,19 +2958,10 @@ void DiscordClient::HandleGatewayGuildMemberListUpdate(const GatewayMessage &msg
                 if (item->Type == "member") {
                     auto member = dynamic_cast<const GuildMemberListUpdateMessage::MemberItem *>(item.get());
                     m_store.SetUser(member->User.ID, member->User);
-                    AddUserToGuild(member->User.ID, data.GuildID);
+                    synced_ids.push_back(member->User.ID);
                     m_store.SetGuildMember(data.GuildID, member->User.ID, member->GetAsMemberData());
-                    if (member->Presence.has_value()) {
-                        const auto &s = member->Presence->Status;
-                        if (s == "online")
-                            m_user_to_status[member->User.ID] = PresenceStatus::Online;
-                        else if (s == "offline")
-                            m_user_to_status[member->User.ID] = PresenceStatus::Offline;
-                        else if (s == "idle")
-                            m_user_to_status[member->User.ID] = PresenceStatus::Idle;
-                        else if (s == "dnd")
-                            m_user_to_status[member->User.ID] = PresenceStatus::DND;
-                    }
+                    if (member->Presence.has_value())
+                        m_user_to_status[member->User.ID] = GetPresenceFromString(member->Presence->Status);
                 }
             }
         } else if (op.Op == "UPDATE") {
@@ -2701,6 +2975,10 @@ void DiscordClient::HandleGatewayGuildMemberListUpdate(const GatewayMessage &msg
 
     m_store.EndTransaction();
 
+    // the list is sorted by role and name, so these come in no useful order
+    if (!synced_ids.empty())
+        m_guild_to_users[data.GuildID].insert(synced_ids.begin(), synced_ids.end());
+
     // todo: manage this event a little better
     if (has_sync)
         m_signal_guild_member_list_update.emit(data.GuildID);
@@ -2749,10 +3027,18 @@ void DiscordClient::AddUserToGuild(Snowflake user_id, Snowflake guild_id) {
     m_guild_to_users[guild_id].insert(user_id);
 }
 
-std::set<Snowflake> DiscordClient::GetPrivateChannels() const {
-    if (const auto iter = m_guild_to_channels.find(Snowflake::Invalid); iter != m_guild_to_channels.end())
-        return iter->second;
-    return {};
+// a page of history is one channel but the authors are in any order
+void DiscordClient::AddAuthorsToGuilds(const std::vector<Message> &msgs) {
+    std::unordered_map<Snowflake, std::vector<Snowflake>> authors;
+    for (const auto &msg : msgs)
+        if (msg.GuildID.has_value())
+            authors[*msg.GuildID].push_back(msg.Author.ID);
+    for (const auto &[guild_id, user_ids] : authors)
+        m_guild_to_users[guild_id].insert(user_ids.begin(), user_ids.end());
+}
+
+const IDSet &DiscordClient::GetPrivateChannels() const {
+    return GetChannelsInGuild(Snowflake::Invalid);
 }
 
 const UserSettings &DiscordClient::GetUserSettings() const {
@@ -2807,6 +3093,13 @@ void DiscordClient::SendIdentify() {
     msg.Presence.Since = 0;
     msg.Presence.IsAFK = false;
     msg.DoesSupportCompression = false;
+
+    // a save from the last READY could still be going
+    if (m_guild_snapshots_thread.joinable()) m_guild_snapshots_thread.join();
+    m_guild_snapshots.Load(Abaddon::GetStateCachePath("/guilds.bin"), m_token);
+    m_guild_snapshots_advertised = m_guild_snapshots.Size();
+    msg.ClientState.GuildHashes = m_guild_snapshots.GetHashes();
+
     SetSuperPropertiesFromIdentity(msg);
     const bool b = m_websocket.GetPrintMessages();
     m_websocket.SetPrintMessages(false);
@@ -2876,6 +3169,81 @@ void DiscordClient::HandleSocketClose(const ix::WebSocketCloseInfo &info) {
     m_generic_mutex.unlock();
 }
 
+void DiscordClient::QueueStoreWrite(std::function<void()> write, std::function<void()> then) {
+    if (!then) {
+        m_store.Write(std::move(write));
+        return;
+    }
+
+    m_store.Write(std::move(write), [this, then = std::move(then)] {
+        std::lock_guard<std::mutex> l(m_generic_mutex);
+        m_generic_queue.push(then);
+        m_generic_dispatch.emit();
+    });
+}
+
+void DiscordClient::QueueMemberRequest(Snowflake guild_id, Snowflake user_id) {
+    if (auto guild_it = m_member_requests_sent.find(guild_id); guild_it != m_member_requests_sent.end()) {
+        if (auto it = guild_it->second.find(user_id); it != guild_it->second.end()) {
+            if (std::chrono::steady_clock::now() - it->second < MemberRequestTimeout) return;
+            guild_it->second.erase(it);
+        }
+    }
+
+    m_member_requests_pending[guild_id].insert(user_id);
+    if (!m_member_requests_timer.connected())
+        m_member_requests_timer = Glib::signal_timeout().connect(sigc::mem_fun(*this, &DiscordClient::FlushMemberRequests), MemberRequestWindow);
+}
+
+bool DiscordClient::FlushMemberRequests() {
+    const auto now = std::chrono::steady_clock::now();
+    while (!m_member_request_times.empty() && now - m_member_request_times.front() >= std::chrono::minutes(1))
+        m_member_request_times.pop_front();
+
+    for (auto it = m_member_requests_pending.begin(); it != m_member_requests_pending.end();) {
+        auto &[guild_id, user_ids] = *it;
+        auto &sent = m_member_requests_sent[guild_id];
+        while (!user_ids.empty()) {
+            // whatever is left goes out on a later tick
+            if (m_member_request_times.size() >= MaxMemberRequestsPerMinute) return true;
+
+            RequestGuildMembersMessage obj;
+            obj.GuildID = guild_id;
+            obj.Presences = false;
+            for (auto user_it = user_ids.begin(); user_it != user_ids.end() && obj.UserIDs.size() < MaxMemberRequestIDs;) {
+                obj.UserIDs.push_back(*user_it);
+                sent[*user_it] = now;
+                user_it = user_ids.erase(user_it);
+            }
+            m_websocket.Send(obj);
+            m_member_request_times.push_back(now);
+        }
+        it = m_member_requests_pending.erase(it);
+    }
+
+    return false;
+}
+
+void DiscordClient::SetUserStatus(Snowflake user_id, PresenceStatus status) {
+    if (auto *current = m_user_to_status.find(user_id)) {
+        if (*current == status) return;
+        *current = status;
+    } else {
+        m_user_to_status[user_id] = status;
+    }
+
+    m_pending_presences[user_id] = status;
+    if (!m_presence_flush.connected())
+        m_presence_flush = Glib::signal_timeout().connect(sigc::mem_fun(*this, &DiscordClient::FlushPresenceUpdates), PresenceFlushInterval);
+}
+
+bool DiscordClient::FlushPresenceUpdates() {
+    const auto batch = std::move(m_pending_presences);
+    m_pending_presences.clear();
+    m_signal_presence_update.emit(batch);
+    return false;
+}
+
 bool DiscordClient::CheckCode(const http::response_type &r) {
     if (r.status_code >= 300 || r.error) {
         fprintf(stderr, "api request to %s failed with status code %d: %s\n", r.url.c_str(), r.status_code, r.error_string.c_str());
@@ -2976,9 +3344,9 @@ void DiscordClient::HandleReadyReadState(const ReadyEventData &data) {
         }
     }
     for (const auto &entry : data.ReadState.Entries) {
-        const auto it = m_last_message_id.find(entry.ID);
-        if (it == m_last_message_id.end()) continue;
-        if (it->second > entry.LastMessageID) {
+        const auto *last_id = m_last_message_id.find(entry.ID);
+        if (last_id == nullptr) continue;
+        if (*last_id > entry.LastMessageID) {
             if (HasChannelPermission(GetUserData().ID, entry.ID, Permission::VIEW_CHANNEL))
                 m_unread[entry.ID] = entry.MentionCount;
         }
@@ -3410,6 +3778,10 @@ DiscordClient::type_signal_voice_channel_changed DiscordClient::signal_voice_cha
 }
 #endif
 
+DiscordClient::type_signal_replay_finished DiscordClient::signal_replay_finished() {
+    return m_signal_replay_finished;
+}
+
 DiscordClient::type_signal_voice_user_disconnect DiscordClient::signal_voice_user_disconnect() {
     return m_signal_voice_user_disconnect;
 }
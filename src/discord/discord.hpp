@@ -1,7 +1,10 @@
 #pragma once
 #include "chatsubmitparams.hpp"
+#include "gatewayrecorder.hpp"
+#include "guildsnapshots.hpp"
 #include "waiter.hpp"
 #include "httpclient.hpp"
+#include "idindex.hpp"
 #include "objects.hpp"
 #include "store.hpp"
 #include "voiceclient.hpp"
@@ -17,6 +20,8 @@
 #include <zlib.h>
 #include <glibmm.h>
 #include <queue>
+#include <deque>
+#include <chrono>
 
 #ifdef GetMessage
 #undef GetMessage
@@ -27,6 +32,7 @@ class DiscordClient {
 
 public:
     DiscordClient(bool mem_store = false);
+    ~DiscordClient();
     void Start();
     bool Stop();
     bool IsStarted() const;
@@ -39,13 +45,15 @@ public:
     std::vector<Snowflake> GetUserSortedGuilds() const;
     std::vector<Message> GetMessagesForChannel(Snowflake id, size_t limit = 50) const;
     std::vector<Message> GetMessagesBefore(Snowflake channel_id, Snowflake message_id, size_t limit = 50) const;
-    std::set<Snowflake> GetPrivateChannels() const;
+    const IDSet &GetPrivateChannels() const;
     const UserSettings &GetUserSettings() const;
 
     EPremiumType GetSelfPremiumType() const;
 
     void FetchMessagesInChannel(Snowflake id, const sigc::slot<void(const std::vector<Message> &)> &cb);
     void FetchMessagesInChannelBefore(Snowflake channel_id, Snowflake before_id, const sigc::slot<void(const std::vector<Message> &)> &cb);
+    // err receives the status code and retry_after (seconds, 0 if not rate limited)
+    void FetchMessagesInChannelBefore(Snowflake channel_id, Snowflake before_id, const sigc::slot<void(const std::vector<Message> &)> &cb, const sigc::slot<void(int, float)> &err);
     std::optional<Message> GetMessage(Snowflake id) const;
     std::optional<ChannelData> GetChannel(Snowflake id) const;
     std::optional<EmojiData> GetEmoji(Snowflake id) const;
@@ -54,12 +62,23 @@ public:
     std::optional<RoleData> GetRole(Snowflake id) const;
     std::optional<GuildData> GetGuild(Snowflake id) const;
     std::optional<GuildMember> GetMember(Snowflake user_id, Snowflake guild_id) const;
+    bool HasMember(Snowflake user_id, Snowflake guild_id) const;
     Snowflake GetMemberHoistedRole(Snowflake guild_id, Snowflake user_id, bool with_color = false) const;
     std::optional<RoleData> GetMemberHoistedRoleCached(const GuildMember &member, const std::unordered_map<Snowflake, RoleData> &roles, bool with_color = false) const;
     std::optional<RoleData> GetMemberHighestRole(Snowflake guild_id, Snowflake user_id) const;
-    std::set<Snowflake> GetUsersInGuild(Snowflake id) const;
-    std::set<Snowflake> GetChannelsInGuild(Snowflake id) const;
-    std::vector<Snowflake> GetUsersInThread(Snowflake id) const;
+    // views straight into the indexes, an empty set if theres nothing. main thread only like the rest of the indexes,
+    // and only good until the next write to any of them (the gateway handlers) since they move around as they grow.
+    // copy it if it has to outlive that, or if the loop over it can end up handling a gateway event
+    const IDSet &GetUsersInGuild(Snowflake id) const;
+    const IDSet &GetChannelsInGuild(Snowflake id) const;
+    const IDSet &GetUsersInThread(Snowflake id) const;
+
+    struct IndexMemoryUsage {
+        const char *Name;
+        size_t Entries;
+        size_t Bytes;
+    };
+    std::vector<IndexMemoryUsage> GetIndexMemoryUsage() const;
     std::vector<ChannelData> GetActiveThreads(Snowflake channel_id) const;
     void GetArchivedPublicThreads(Snowflake channel_id, const sigc::slot<void(DiscordError, const ArchivedThreadsResponseData &)> &callback);
     void GetArchivedPrivateThreads(Snowflake channel_id, const sigc::slot<void(DiscordError, const ArchivedThreadsResponseData &)> &callback);
@@ -71,9 +90,8 @@ public:
     template<typename Iter>
     std::unordered_set<Snowflake> FilterUnknownMembersFrom(Snowflake guild_id, Iter begin, Iter end) {
         std::unordered_set<Snowflake> ret;
-        const auto known = m_store.GetMembersInGuild(guild_id);
         for (auto iter = begin; iter != end; iter++)
-            if (known.find(*iter) == known.end())
+            if (ret.find(*iter) == ret.end() && !m_store.HasGuildMember(guild_id, *iter))
                 ret.insert(*iter);
         return ret;
     }
@@ -141,15 +159,12 @@ public:
     bool CanModifyRole(Snowflake guild_id, Snowflake role_id, Snowflake user_id) const;
 
     // send op 8 to get member data for unknown members
+    // requests are merged over a short window and anything already in flight is skipped
+    // signal_guild_members_chunk fires when they arrive
     template<typename Iter>
     void RequestMembers(Snowflake guild_id, Iter begin, Iter end) {
-        if (std::distance(begin, end) == 0) return;
-
-        RequestGuildMembersMessage obj;
-        obj.GuildID = guild_id;
-        obj.Presences = false;
-        obj.UserIDs = { begin, end };
-        m_websocket.Send(obj);
+        for (auto iter = begin; iter != end; iter++)
+            QueueMemberRequest(guild_id, *iter);
     }
 
     // real client doesn't seem to use the single role endpoints so neither do we
@@ -172,6 +187,9 @@ public:
 
     // FetchGuildBans fetches all bans+reasons via api, this func fetches stored bans (so usually just GUILD_BAN_ADD data)
     std::vector<BanData> GetBansInGuild(Snowflake guild_id);
+    // kept in the store next to the messages they fetched, so theyre cleared together
+    std::optional<BackfillCursor> GetBackfillCursor(Snowflake channel_id) const;
+    void SetBackfillCursor(Snowflake channel_id, const BackfillCursor &cursor);
     void FetchGuildBan(Snowflake guild_id, Snowflake user_id, const sigc::slot<void(BanData)> &callback);
     void FetchGuildBans(Snowflake guild_id, const sigc::slot<void(std::vector<BanData>)> &callback);
 
@@ -223,16 +241,36 @@ public:
     void SetReferringChannel(Snowflake id);
 
     void SetBuildNumber(uint32_t build_number);
+    // lets the gateway connect before the build number is known. identify is sent once released
+    void SetIdentifyHeld(bool held);
     void SetCookie(std::string_view cookie);
 
     void UpdateToken(const std::string &token);
     void SetUserAgent(const std::string &agent);
 
     void SetDumpReady(bool dump);
+    // writes every decompressed gateway message to ./gateway-<time>.rec as it comes in
+    void SetRecordGateway(bool record);
+    // feeds a recording through the gateway handlers and store like it came off the websocket,
+    // then reports where the time went. only while not connected
+    bool StartReplay(const std::string &path, bool realtime);
+    bool IsReplaying() const noexcept;
+
+    struct ReplayEventStats {
+        size_t Count = 0;
+        std::chrono::steady_clock::duration Parse {};
+        std::chrono::steady_clock::duration Handler {}; // includes store
+        std::chrono::steady_clock::duration Store {};
+        int64_t Heap = 0; // net heap growth in bytes, not an allocation count. glibc only
+    };
+
+    // by event type, from the last replay
+    const std::map<std::string, ReplayEventStats> &GetReplayStats() const noexcept;
 
     bool IsChannelMuted(Snowflake id) const noexcept;
     bool IsGuildMuted(Snowflake id) const noexcept;
     int GetUnreadStateForChannel(Snowflake id) const noexcept;
+    std::vector<Snowflake> GetChannelsWithMentions() const; // most mentions first
     int GetUnreadChannelsCountForCategory(Snowflake id) const noexcept;
     bool GetUnreadStateForGuild(Snowflake id, int &total_mentions) const noexcept;
     int GetUnreadDMsCount() const;
@@ -251,6 +289,24 @@ private:
 
     bool m_dump_ready = false;
 
+    // only held between identify and READY, the rest of the time it lives on disk
+    GuildSnapshots m_guild_snapshots;
+    size_t m_guild_snapshots_advertised = 0;
+    std::thread m_guild_snapshots_thread;
+
+    std::mutex m_recorder_mutex;
+    std::unique_ptr<GatewayRecorder> m_recorder;
+
+    std::thread m_replay_thread;
+    Waiter m_replay_waiter;
+    bool m_replaying = false;
+    size_t m_replay_messages = 0;
+    std::chrono::steady_clock::time_point m_replay_start;
+    std::chrono::steady_clock::duration m_replay_store_start {};
+    std::map<std::string, ReplayEventStats> m_replay_stats;
+    void ReplayThread(std::unique_ptr<GatewayRecording> recording, bool realtime);
+    void FinishReplay();
+
     static std::string GetAPIURL();
     static std::string GetGatewayURL();
 
@@ -261,7 +317,7 @@ private:
     void HandleGatewayMessageRaw(std::string str);
     void HandleGatewayMessage(std::string str);
     void HandleGatewayHello(const GatewayMessage &msg);
-    void HandleGatewayReady(const GatewayMessage &msg);
+    void HandleGatewayReady(GatewayMessage &msg, size_t bytes);
     void HandleGatewayMessageCreate(const GatewayMessage &msg);
     void HandleGatewayMessageDelete(const GatewayMessage &msg);
     void HandleGatewayMessageUpdate(const GatewayMessage &msg);
@@ -335,6 +391,24 @@ private:
 
     void StoreMessageData(Message &msg);
 
+    // store writes for parsed REST responses and member chunks, batched into transactions by the store.
+    // write runs on the store's writer thread so it can only touch m_store. then runs on the main thread after
+    // the write is committed
+    void QueueStoreWrite(std::function<void()> write, std::function<void()> then = {});
+
+    void QueueMemberRequest(Snowflake guild_id, Snowflake user_id);
+    bool FlushMemberRequests();
+    std::unordered_map<Snowflake, std::unordered_set<Snowflake>> m_member_requests_pending;                                    // guild -> users
+    std::unordered_map<Snowflake, std::unordered_map<Snowflake, std::chrono::steady_clock::time_point>> m_member_requests_sent; // guild -> user -> when
+    std::deque<std::chrono::steady_clock::time_point> m_member_request_times;                                                  // for the send limit
+    sigc::connection m_member_requests_timer;
+
+    // statuses are updated right away but listeners hear about them in batches, at most once per user per frame
+    void SetUserStatus(Snowflake user_id, PresenceStatus status);
+    bool FlushPresenceUpdates();
+    std::unordered_map<Snowflake, PresenceStatus> m_pending_presences;
+    sigc::connection m_presence_flush;
+
     static bool ShouldChannelTypeCountInUnread(ChannelType type);
 
     void HandleReadyReadState(const ReadyEventData &data);
@@ -343,16 +417,19 @@ private:
     std::string m_token;
 
     uint32_t m_build_number = 363557;
+    bool m_identify_held = false;
+    bool m_identify_pending = false;
 
     void AddUserToGuild(Snowflake user_id, Snowflake guild_id);
-    std::map<Snowflake, std::set<Snowflake>> m_guild_to_users;
-    std::map<Snowflake, std::set<Snowflake>> m_guild_to_channels;
+    void AddAuthorsToGuilds(const std::vector<Message> &msgs);
+    IDMap<IDSet> m_guild_to_users;
+    IDMap<IDSet> m_guild_to_channels; // dms are under Snowflake::Invalid
     std::map<Snowflake, GuildApplicationData> m_guild_join_requests;
-    std::map<Snowflake, PresenceStatus> m_user_to_status;
+    IDMap<PresenceStatus> m_user_to_status;
     std::map<Snowflake, RelationshipType> m_user_relationships;
     std::set<Snowflake> m_joined_threads;
-    std::map<Snowflake, std::vector<Snowflake>> m_thread_members;
-    std::map<Snowflake, Snowflake> m_last_message_id;
+    IDMap<IDSet> m_thread_members;
+    IDMap<Snowflake> m_last_message_id;
     std::unordered_set<Snowflake> m_muted_guilds;
     std::unordered_set<Snowflake> m_muted_channels;
     std::unordered_map<Snowflake, int> m_unread;
@@ -444,7 +521,7 @@ public:
     typedef sigc::signal<void, Snowflake, Snowflake> type_signal_guild_ban_add;       // guild id, user id
     typedef sigc::signal<void, InviteData> type_signal_invite_create;
     typedef sigc::signal<void, InviteDeleteObject> type_signal_invite_delete;
-    typedef sigc::signal<void, UserData, PresenceStatus> type_signal_presence_update;
+    typedef sigc::signal<void, const std::unordered_map<Snowflake, PresenceStatus> &> type_signal_presence_update; // user id -> new status
     typedef sigc::signal<void, Snowflake, std::string> type_signal_note_update;
     typedef sigc::signal<void, Snowflake, std::vector<EmojiData>> type_signal_guild_emojis_update; // guild id
     typedef sigc::signal<void, GuildJoinRequestCreateData> type_signal_guild_join_request_create;
@@ -491,6 +568,7 @@ public:
     using type_signal_voice_channel_changed = sigc::signal<void(Snowflake)>;
 #endif
 
+    using type_signal_replay_finished = sigc::signal<void(std::string /* report */)>;
     using type_signal_voice_user_disconnect = sigc::signal<void(Snowflake, Snowflake)>;
     using type_signal_voice_user_connect = sigc::signal<void(Snowflake, Snowflake)>;
     using type_signal_voice_state_set = sigc::signal<void(Snowflake, Snowflake, VoiceStateFlags)>;
@@ -564,6 +642,7 @@ public:
     type_signal_voice_channel_changed signal_voice_channel_changed();
 #endif
 
+    type_signal_replay_finished signal_replay_finished();
     type_signal_voice_user_disconnect signal_voice_user_disconnect();
     type_signal_voice_user_connect signal_voice_user_connect();
     type_signal_voice_state_set signal_voice_state_set();
@@ -638,6 +717,7 @@ protected:
     type_signal_voice_channel_changed m_signal_voice_channel_changed;
 #endif
 
+    type_signal_replay_finished m_signal_replay_finished;
     type_signal_voice_user_disconnect m_signal_voice_user_disconnect;
     type_signal_voice_user_connect m_signal_voice_user_connect;
     type_signal_voice_state_set m_signal_voice_state_set;
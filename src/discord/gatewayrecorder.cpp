@@ -0,0 +1,97 @@
+#include "gatewayrecorder.hpp"
+#include <array>
+#include <cstring>
+
+constexpr static std::array<char, 8> Magic { 'A', 'B', 'D', 'N', 'G', 'W', '0', '1' };
+// sanity check so a corrupt length doesnt try to allocate the world
+constexpr static uint64_t MaxMessageSize = 512ULL * 1024 * 1024;
+
+static void WriteVarint(gzFile file, uint64_t value) {
+    std::array<uint8_t, 10> buf;
+    size_t len = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if (value != 0) byte |= 0x80;
+        buf[len++] = byte;
+    } while (value != 0);
+    gzwrite(file, buf.data(), static_cast<unsigned>(len));
+}
+
+GatewayRecorder::GatewayRecorder(gzFile file)
+    : m_file(file) {}
+
+GatewayRecorder::~GatewayRecorder() {
+    gzclose(m_file);
+}
+
+std::unique_ptr<GatewayRecorder> GatewayRecorder::Create(const std::string &path) {
+    gzFile file = gzopen(path.c_str(), "wb6");
+    if (file == nullptr) return nullptr;
+    gzwrite(file, Magic.data(), static_cast<unsigned>(Magic.size()));
+    return std::unique_ptr<GatewayRecorder>(new GatewayRecorder(file));
+}
+
+void GatewayRecorder::Write(const std::string &msg) {
+    const auto now = std::chrono::steady_clock::now();
+    // the first message starts the clock, recording could have been turned on long before connecting
+    const auto delay = m_count == 0 ? 0 : std::chrono::duration_cast<std::chrono::microseconds>(now - m_last).count();
+    m_last = now;
+
+    WriteVarint(m_file, static_cast<uint64_t>(delay));
+    WriteVarint(m_file, msg.size());
+    gzwrite(m_file, msg.data(), static_cast<unsigned>(msg.size()));
+    m_count++;
+}
+
+size_t GatewayRecorder::GetMessageCount() const noexcept {
+    return m_count;
+}
+
+GatewayRecording::GatewayRecording(gzFile file)
+    : m_file(file) {}
+
+GatewayRecording::~GatewayRecording() {
+    gzclose(m_file);
+}
+
+std::unique_ptr<GatewayRecording> GatewayRecording::Open(const std::string &path) {
+    gzFile file = gzopen(path.c_str(), "rb");
+    if (file == nullptr) return nullptr;
+
+    std::array<char, Magic.size()> magic;
+    if (gzread(file, magic.data(), static_cast<unsigned>(magic.size())) != static_cast<int>(magic.size()) ||
+        std::memcmp(magic.data(), Magic.data(), Magic.size()) != 0) {
+        gzclose(file);
+        return nullptr;
+    }
+
+    // big messages like READY come in one read
+    gzbuffer(file, 256 * 1024);
+
+    return std::unique_ptr<GatewayRecording>(new GatewayRecording(file));
+}
+
+bool GatewayRecording::Next(std::chrono::microseconds &delay, std::string &msg) {
+    uint64_t delay_us;
+    uint64_t size;
+    if (!ReadVarint(delay_us) || !ReadVarint(size)) return false;
+    if (size > MaxMessageSize) return false;
+
+    msg.resize(size);
+    if (size > 0 && gzread(m_file, msg.data(), static_cast<unsigned>(size)) != static_cast<int>(size)) return false;
+
+    delay = std::chrono::microseconds(delay_us);
+    return true;
+}
+
+bool GatewayRecording::ReadVarint(uint64_t &out) {
+    out = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        const int byte = gzgetc(m_file);
+        if (byte < 0) return false;
+        out |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <zlib.h>
+
+// recordings are a gzip stream of: the magic, then per message a varint of microseconds since the
+// previous message, a varint length and the decompressed json
+
+// writes the gateway stream as it comes in. not thread safe, DiscordClient locks around it
+class GatewayRecorder {
+public:
+    GatewayRecorder(const GatewayRecorder &) = delete;
+    GatewayRecorder &operator=(const GatewayRecorder &) = delete;
+    ~GatewayRecorder();
+
+    // nullptr if the file cant be opened
+    static std::unique_ptr<GatewayRecorder> Create(const std::string &path);
+
+    void Write(const std::string &msg);
+
+    [[nodiscard]] size_t GetMessageCount() const noexcept;
+
+private:
+    GatewayRecorder(gzFile file);
+
+    gzFile m_file;
+    std::chrono::steady_clock::time_point m_last;
+    size_t m_count = 0;
+};
+
+class GatewayRecording {
+public:
+    GatewayRecording(const GatewayRecording &) = delete;
+    GatewayRecording &operator=(const GatewayRecording &) = delete;
+    ~GatewayRecording();
+
+    // nullptr if the file cant be opened or isnt a recording
+    static std::unique_ptr<GatewayRecording> Open(const std::string &path);
+
+    // false at the end or if the file is truncated
+    bool Next(std::chrono::microseconds &delay, std::string &msg);
+
+private:
+    GatewayRecording(gzFile file);
+
+    bool ReadVarint(uint64_t &out);
+
+    gzFile m_file;
+};
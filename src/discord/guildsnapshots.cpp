@@ -0,0 +1,156 @@
+#include "guildsnapshots.hpp"
+#include <array>
+#include <vector>
+#include <glibmm/checksum.h>
+#include <zlib.h>
+
+constexpr static int SnapshotVersion = 2; // 1 had a crc of the token as the owner
+
+// per session or changes too often to be worth keeping, these are always sent
+constexpr static std::array<const char *, 17> SessionKeys {
+    "id",
+    "guild_hashes",
+    "channels",
+    "roles",
+    "emojis",
+    "threads",
+    "members",
+    "presences",
+    "voice_states",
+    "stage_instances",
+    "guild_scheduled_events",
+    "joined_at",
+    "member_count",
+    "large",
+    "lazy",
+    "unavailable",
+    "application_command_counts",
+};
+
+// a crc is trivially reversed into something that matches, this isnt
+std::string GuildSnapshots::GetOwner(const std::string &token) {
+    return Glib::Checksum::compute_checksum(Glib::Checksum::CHECKSUM_SHA256, token);
+}
+
+bool GuildSnapshots::Load(const std::string &path, const std::string &token) {
+    m_guilds.clear();
+
+    gzFile file = gzopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+    std::vector<uint8_t> data;
+    std::array<uint8_t, 64 * 1024> buf;
+    int n;
+    while ((n = gzread(file, buf.data(), static_cast<unsigned>(buf.size()))) > 0)
+        data.insert(data.end(), buf.begin(), buf.begin() + n);
+    gzclose(file);
+    if (n < 0) return false;
+
+    const auto j = nlohmann::json::from_cbor(data, true, false);
+    if (j.is_discarded() || !j.is_object()) return false;
+    if (j.value("version", 0) != SnapshotVersion || j.value("owner", "") != GetOwner(token)) return false;
+
+    const auto guilds = j.find("guilds");
+    if (guilds == j.end() || !guilds->is_object()) return false;
+    for (const auto &[id, g] : guilds->items()) {
+        auto &entry = m_guilds[id];
+        entry.Hashes = g.value("hashes", nlohmann::json());
+        entry.Metadata = g.value("metadata", nlohmann::json());
+        entry.Channels = g.value("channels", nlohmann::json());
+        entry.Roles = g.value("roles", nlohmann::json());
+        entry.Emojis = g.value("emojis", nlohmann::json());
+    }
+
+    return true;
+}
+
+bool GuildSnapshots::Save(const std::string &path, const std::string &token) const {
+    nlohmann::json j;
+    j["version"] = SnapshotVersion;
+    j["owner"] = GetOwner(token);
+    auto &guilds = j["guilds"] = nlohmann::json::object();
+    for (const auto &[id, entry] : m_guilds) {
+        guilds[id] = {
+            { "hashes", entry.Hashes },
+            { "metadata", entry.Metadata },
+            { "channels", entry.Channels },
+            { "roles", entry.Roles },
+            { "emojis", entry.Emojis },
+        };
+    }
+    const auto data = nlohmann::json::to_cbor(j);
+
+    // cbor is already compact, this is mostly squeezing repeated keys out so dont spend long on it
+    gzFile file = gzopen(path.c_str(), "wb1");
+    if (file == nullptr) return false;
+    const bool ok = gzwrite(file, data.data(), static_cast<unsigned>(data.size())) == static_cast<int>(data.size());
+    return gzclose(file) == Z_OK && ok;
+}
+
+std::map<std::string, nlohmann::json> GuildSnapshots::GetHashes() const {
+    std::map<std::string, nlohmann::json> ret;
+    for (const auto &[id, entry] : m_guilds)
+        ret[id] = entry.Hashes;
+    return ret;
+}
+
+GuildSnapshots::HydrateResult GuildSnapshots::Hydrate(nlohmann::json &guild) const {
+    const auto hashes = guild.find("guild_hashes");
+    if (hashes == guild.end() || !hashes->is_object()) return HydrateResult::Full;
+
+    const auto omitted = [&hashes](const char *part) {
+        const auto it = hashes->find(part);
+        return it != hashes->end() && it->is_object() && it->value("omitted", false);
+    };
+    const bool metadata = omitted("metadata");
+    const bool channels = omitted("channels");
+    const bool roles = omitted("roles");
+    if (!metadata && !channels && !roles) return HydrateResult::Full;
+
+    const auto it = m_guilds.find(guild.at("id").get<std::string>());
+    if (it == m_guilds.end()) return HydrateResult::Missing;
+    const auto &entry = it->second;
+    if ((metadata && !entry.Metadata.is_object()) || (channels && !entry.Channels.is_array()) || (roles && !entry.Roles.is_array()))
+        return HydrateResult::Missing;
+
+    if (metadata) {
+        for (const auto &[key, value] : entry.Metadata.items()) {
+            if (!guild.contains(key)) guild[key] = value;
+        }
+        if (!guild.contains("emojis") && entry.Emojis.is_array()) guild["emojis"] = entry.Emojis;
+    }
+    if (channels) guild["channels"] = entry.Channels;
+    if (roles) guild["roles"] = entry.Roles;
+
+    return HydrateResult::Hydrated;
+}
+
+void GuildSnapshots::Update(nlohmann::json &&guild) {
+    const auto id = guild.at("id").get<std::string>();
+    const auto hashes = guild.find("guild_hashes");
+    if (hashes == guild.end() || !hashes->is_object() || guild.contains("unavailable")) {
+        m_guilds.erase(id);
+        return;
+    }
+
+    auto &entry = m_guilds[id];
+    entry.Hashes = std::move(*hashes);
+    for (auto &hash : entry.Hashes) {
+        if (hash.is_object()) hash.erase("omitted");
+    }
+
+    const auto take = [&guild](const char *key) {
+        const auto it = guild.find(key);
+        return it == guild.end() ? nlohmann::json() : std::move(*it);
+    };
+    entry.Channels = take("channels");
+    entry.Roles = take("roles");
+    entry.Emojis = take("emojis");
+
+    for (const auto *key : SessionKeys)
+        guild.erase(key);
+    entry.Metadata = std::move(guild);
+}
+
+size_t GuildSnapshots::Size() const noexcept {
+    return m_guilds.size();
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+
+// guilds as they were in the last READY along with the hashes the server gave for them. sending the hashes back
+// in identify lets the server leave out the parts of a guild that havent changed, which get filled back in from here
+class GuildSnapshots {
+public:
+    enum class HydrateResult {
+        Full,     // nothing was omitted
+        Hydrated, // something was omitted and filled in from the snapshot
+        Missing,  // something was omitted that we dont have
+    };
+
+    // snapshots are per token, the server hashes what that account can see. the file only has a sha256 of it
+    bool Load(const std::string &path, const std::string &token);
+    bool Save(const std::string &path, const std::string &token) const;
+
+    [[nodiscard]] std::map<std::string, nlohmann::json> GetHashes() const;
+
+    HydrateResult Hydrate(nlohmann::json &guild) const;
+    // takes a (hydrated) READY guild
+    void Update(nlohmann::json &&guild);
+
+    [[nodiscard]] size_t Size() const noexcept;
+
+private:
+    struct Entry {
+        nlohmann::json Hashes;
+        nlohmann::json Metadata;
+        nlohmann::json Channels;
+        nlohmann::json Roles;
+        nlohmann::json Emojis;
+    };
+
+    static std::string GetOwner(const std::string &token);
+
+    std::unordered_map<std::string, Entry> m_guilds;
+};
@@ -2,6 +2,8 @@
 
 #include <utility>
 
+#include "trace.hpp"
+
 HTTPClient::HTTPClient() {
     m_dispatcher.connect(sigc::mem_fun(*this, &HTTPClient::RunCallbacks));
 }
@@ -156,7 +158,10 @@ void HTTPClient::OnResponse(const http::response_type &r, const std::function<vo
     CleanupFutures();
     try {
         m_mutex.lock();
-        m_queue.push([r, cb] { cb(r); });
+        m_queue.push([r, cb] {
+            TRACE_ZONE("http callback", r.url);
+            cb(r);
+        });
         m_dispatcher.emit();
         m_mutex.unlock();
     } catch (const std::exception &e) {
@@ -7,6 +7,7 @@
 #include <mutex>
 #include <queue>
 #include <glibmm.h>
+#include <nlohmann/json.hpp>
 #include "http.hpp"
 
 class HTTPClient {
@@ -26,6 +27,33 @@ public:
     void MakePOST(const std::string &path, const std::string &payload, const std::function<void(http::response_type r)> &cb);
     void MakePUT(const std::string &path, const std::string &payload, const std::function<void(http::response_type r)> &cb);
 
+    // like MakeGET but the body is deserialized into T on the worker thread
+    // parsed is null if the request failed or the body couldnt be deserialized
+    template<typename T>
+    void MakeGETParsed(const std::string &path, const std::function<void(http::response_type r, std::shared_ptr<T> parsed)> &cb) {
+        printf("GET %s\n", path.c_str());
+        m_futures.push_back(std::async(std::launch::async, [this, path, cb] {
+            http::request req(http::REQUEST_GET, m_api_base + path);
+            AddHeaders(req);
+            req.set_header("Authorization", m_authorization);
+            req.set_user_agent(!m_agent.empty() ? m_agent : "Abaddon");
+
+            auto res = req.execute();
+
+            std::shared_ptr<T> parsed;
+            if (!res.error && res.status_code >= 200 && res.status_code < 300) {
+                try {
+                    parsed = std::make_shared<T>(nlohmann::json::parse(res.text).template get<T>());
+                    res.text.clear(); // dont copy the body over to the main thread for nothing
+                } catch (const std::exception &e) {
+                    fprintf(stderr, "error parsing response from %s: %s\n", res.url.c_str(), e.what());
+                }
+            }
+
+            OnResponse(res, [cb, parsed](http::response_type r) { cb(std::move(r), parsed); });
+        }));
+    }
+
     [[nodiscard]] http::request CreateRequest(http::EMethod method, std::string path);
     void Execute(http::request &&req, const std::function<void(http::response_type r)> &cb);
 
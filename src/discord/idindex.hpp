@@ -0,0 +1,205 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <vector>
+#include "snowflake.hpp"
+
+// compact containers for the id indexes in DiscordClient
+// these get very big with large guilds so node based containers waste a lot of memory on pointers
+
+// sorted vector of ids. always kept sorted so reads never have to touch anything, which makes const access safe
+// from more than one thread as long as nothing is writing. an id that isnt there yet costs a memmove of everything
+// after it, so anything that adds a page or a list of ids at once should go through the range insert
+class IDSet {
+public:
+    using const_iterator = std::vector<Snowflake>::const_iterator;
+
+    void insert(Snowflake id) {
+        if (m_ids.empty() || m_ids.back() < id) {
+            m_ids.push_back(id);
+            return;
+        }
+        const auto it = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+        if (*it != id) m_ids.insert(it, id);
+    }
+
+    // one sort and merge for the lot instead of a memmove per id. any order, duplicates are fine
+    template<typename Iter>
+    void insert(Iter first, Iter last) {
+        const auto old_size = static_cast<std::ptrdiff_t>(m_ids.size());
+        m_ids.insert(m_ids.end(), first, last);
+        const auto mid = m_ids.begin() + old_size;
+        std::sort(mid, m_ids.end());
+        std::inplace_merge(m_ids.begin(), mid, m_ids.end());
+        m_ids.erase(std::unique(m_ids.begin(), m_ids.end()), m_ids.end());
+    }
+
+    bool erase(Snowflake id) {
+        const auto it = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+        if (it == m_ids.end() || *it != id) return false;
+        m_ids.erase(it);
+        return true;
+    }
+
+    [[nodiscard]] bool contains(Snowflake id) const {
+        return std::binary_search(m_ids.begin(), m_ids.end(), id);
+    }
+
+    [[nodiscard]] size_t size() const noexcept {
+        return m_ids.size();
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return m_ids.empty();
+    }
+
+    [[nodiscard]] const_iterator begin() const noexcept {
+        return m_ids.cbegin();
+    }
+
+    [[nodiscard]] const_iterator end() const noexcept {
+        return m_ids.cend();
+    }
+
+    void clear() noexcept {
+        m_ids.clear();
+        m_ids.shrink_to_fit();
+    }
+
+    [[nodiscard]] size_t GetMemoryUsage() const noexcept {
+        return sizeof(*this) + m_ids.capacity() * sizeof(Snowflake);
+    }
+
+private:
+    std::vector<Snowflake> m_ids;
+};
+
+// open addressing hash map keyed by id with linear probing
+// 0 marks an empty slot so that key is kept off to the side
+template<typename V>
+class IDMap {
+public:
+    [[nodiscard]] V *find(Snowflake id) {
+        if (static_cast<uint64_t>(id) == 0) return m_zero.has_value() ? &*m_zero : nullptr;
+        if (m_keys.empty()) return nullptr;
+        const size_t slot = FindSlot(id);
+        return m_keys[slot] == static_cast<uint64_t>(id) ? &m_values[slot] : nullptr;
+    }
+
+    [[nodiscard]] const V *find(Snowflake id) const {
+        return const_cast<IDMap *>(this)->find(id);
+    }
+
+    V &operator[](Snowflake id) {
+        if (static_cast<uint64_t>(id) == 0) {
+            if (!m_zero.has_value()) {
+                m_zero.emplace();
+                m_size++;
+            }
+            return *m_zero;
+        }
+
+        if ((m_size + 1) * 4 > m_keys.size() * 3) Grow();
+        const size_t slot = FindSlot(id);
+        if (m_keys[slot] != static_cast<uint64_t>(id)) {
+            m_keys[slot] = static_cast<uint64_t>(id);
+            m_values[slot] = V {};
+            m_size++;
+        }
+        return m_values[slot];
+    }
+
+    bool erase(Snowflake id) {
+        if (static_cast<uint64_t>(id) == 0) {
+            if (!m_zero.has_value()) return false;
+            m_zero.reset();
+            m_size--;
+            return true;
+        }
+        if (m_keys.empty()) return false;
+
+        size_t slot = FindSlot(id);
+        if (m_keys[slot] != static_cast<uint64_t>(id)) return false;
+
+        // backward shift so probe chains stay intact without tombstones
+        const size_t mask = m_keys.size() - 1;
+        size_t next = (slot + 1) & mask;
+        while (m_keys[next] != 0) {
+            const size_t home = Hash(m_keys[next]);
+            if (((next - home) & mask) >= ((next - slot) & mask)) {
+                m_keys[slot] = m_keys[next];
+                m_values[slot] = std::move(m_values[next]);
+                slot = next;
+            }
+            next = (next + 1) & mask;
+        }
+        m_keys[slot] = 0;
+        m_values[slot] = V {};
+        m_size--;
+        return true;
+    }
+
+    [[nodiscard]] size_t size() const noexcept {
+        return m_size;
+    }
+
+    // no particular order
+    template<typename F>
+    void ForEach(F &&func) const {
+        if (m_zero.has_value()) func(Snowflake(0ULL), *m_zero);
+        for (size_t i = 0; i < m_keys.size(); i++)
+            if (m_keys[i] != 0) func(Snowflake(m_keys[i]), m_values[i]);
+    }
+
+    void clear() noexcept {
+        m_keys.clear();
+        m_keys.shrink_to_fit();
+        m_values.clear();
+        m_values.shrink_to_fit();
+        m_zero.reset();
+        m_size = 0;
+    }
+
+    [[nodiscard]] size_t GetMemoryUsage() const noexcept {
+        return sizeof(*this) + m_keys.capacity() * sizeof(uint64_t) + m_values.capacity() * sizeof(V);
+    }
+
+private:
+    [[nodiscard]] size_t Hash(uint64_t key) const noexcept {
+        // fibonacci hashing. the low bits of snowflakes are mostly the same process and increment
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> m_shift);
+    }
+
+    [[nodiscard]] size_t FindSlot(Snowflake id) const noexcept {
+        const size_t mask = m_keys.size() - 1;
+        size_t slot = Hash(static_cast<uint64_t>(id));
+        while (m_keys[slot] != 0 && m_keys[slot] != static_cast<uint64_t>(id))
+            slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    void Grow() {
+        auto keys = std::move(m_keys);
+        auto values = std::move(m_values);
+
+        const size_t capacity = keys.empty() ? 16 : keys.size() * 2;
+        m_keys.assign(capacity, 0);
+        m_values.assign(capacity, V {});
+        m_shift = 64;
+        for (size_t n = capacity; n > 1; n >>= 1) m_shift--;
+
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == 0) continue;
+            const size_t slot = FindSlot(keys[i]);
+            m_keys[slot] = keys[i];
+            m_values[slot] = std::move(values[i]);
+        }
+    }
+
+    std::vector<uint64_t> m_keys;
+    std::vector<V> m_values;
+    std::optional<V> m_zero;
+    size_t m_size = 0;
+    unsigned m_shift = 64;
+};
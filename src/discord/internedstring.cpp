@@ -0,0 +1,217 @@
+#include "internedstring.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+struct InternedString::Entry {
+    std::atomic<uint32_t> Refs = 1;
+    bool Pooled = false;
+    std::string Value;
+};
+
+// entries that drop to no references stay in the map until the next sweep, so handing out a popular string again
+// right after its last copy went away doesnt reallocate. sweeps happen under the lock, and the only way to get a
+// reference to an entry with none left is through the map, so nothing can be holding one a sweep deletes
+class InternedString::Pool {
+public:
+    static Pool &Get() {
+        static Pool pool;
+        return pool;
+    }
+
+    Entry *Intern(std::string_view str) {
+        if (!m_enabled.load(std::memory_order_relaxed)) {
+            auto *entry = new Entry;
+            entry->Value = str;
+            return entry;
+        }
+
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_lookups++;
+        if (const auto it = m_entries.find(str); it != m_entries.end()) {
+            m_hits++;
+            it->second->Refs.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+
+        if (m_entries.size() >= m_sweep_at) Sweep();
+
+        auto *entry = new Entry;
+        entry->Pooled = true;
+        entry->Value = str;
+        m_entries.emplace(entry->Value, entry);
+        return entry;
+    }
+
+    PoolStats GetStats() {
+        std::lock_guard<std::mutex> l(m_mutex);
+        PoolStats stats;
+        stats.Strings = m_entries.size();
+        for (const auto &[str, entry] : m_entries) {
+            stats.Bytes += sizeof(Entry);
+            if (entry->Value.capacity() > std::string().capacity()) stats.Bytes += entry->Value.capacity() + 1;
+        }
+        stats.Lookups = m_lookups;
+        stats.Hits = m_hits;
+        return stats;
+    }
+
+    void SetEnabled(bool enabled) {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+private:
+    void Sweep() {
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            if (it->second->Refs.load(std::memory_order_acquire) == 0) {
+                delete it->second;
+                it = m_entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        m_sweep_at = std::max<size_t>(4096, m_entries.size() * 2);
+    }
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string_view, Entry *> m_entries; // keys point into the entries
+    size_t m_sweep_at = 4096;
+    uint64_t m_lookups = 0;
+    uint64_t m_hits = 0;
+    std::atomic<bool> m_enabled = true;
+};
+
+static const std::string EmptyString;
+
+InternedString::InternedString(std::string_view str) {
+    if (!str.empty()) m_entry = Pool::Get().Intern(str);
+}
+
+InternedString::InternedString(const std::string &str)
+    : InternedString(std::string_view(str)) {}
+
+InternedString::InternedString(const char *str)
+    : InternedString(str == nullptr ? std::string_view() : std::string_view(str)) {}
+
+InternedString::InternedString(const InternedString &other) noexcept
+    : m_entry(other.m_entry) {
+    if (m_entry != nullptr) m_entry->Refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+InternedString::InternedString(InternedString &&other) noexcept
+    : m_entry(other.m_entry) {
+    other.m_entry = nullptr;
+}
+
+InternedString::~InternedString() {
+    Release();
+}
+
+InternedString &InternedString::operator=(const InternedString &other) noexcept {
+    if (m_entry != other.m_entry) {
+        Release();
+        m_entry = other.m_entry;
+        if (m_entry != nullptr) m_entry->Refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    return *this;
+}
+
+InternedString &InternedString::operator=(InternedString &&other) noexcept {
+    if (this != &other) {
+        Release();
+        m_entry = other.m_entry;
+        other.m_entry = nullptr;
+    }
+    return *this;
+}
+
+void InternedString::Release() noexcept {
+    if (m_entry == nullptr) return;
+    // read before letting go, a pooled entry can be swept as soon as the count hits zero
+    const bool pooled = m_entry->Pooled;
+    if (m_entry->Refs.fetch_sub(1, std::memory_order_acq_rel) == 1 && !pooled)
+        delete m_entry;
+    m_entry = nullptr;
+}
+
+const std::string &InternedString::str() const noexcept {
+    return m_entry == nullptr ? EmptyString : m_entry->Value;
+}
+
+const char *InternedString::c_str() const noexcept {
+    return str().c_str();
+}
+
+bool InternedString::empty() const noexcept {
+    return m_entry == nullptr;
+}
+
+size_t InternedString::size() const noexcept {
+    return str().size();
+}
+
+char InternedString::operator[](size_t i) const noexcept {
+    return str()[i];
+}
+
+InternedString::PoolStats InternedString::GetPoolStats() {
+    return Pool::Get().GetStats();
+}
+
+void InternedString::SetPoolEnabled(bool enabled) {
+    Pool::Get().SetEnabled(enabled);
+}
+
+bool operator==(const InternedString &a, const InternedString &b) noexcept {
+    // pooled values are unique so this is usually the pointer check
+    return a.m_entry == b.m_entry || a.str() == b.str();
+}
+
+bool operator==(const InternedString &a, const std::string &b) noexcept {
+    return a.str() == b;
+}
+
+bool operator==(const InternedString &a, const char *b) noexcept {
+    return a.str() == b;
+}
+
+bool operator!=(const InternedString &a, const InternedString &b) noexcept {
+    return !(a == b);
+}
+
+bool operator!=(const InternedString &a, const std::string &b) noexcept {
+    return !(a == b);
+}
+
+bool operator!=(const InternedString &a, const char *b) noexcept {
+    return !(a == b);
+}
+
+void from_json(const nlohmann::json &j, InternedString &s) {
+    s = InternedString(j.get_ref<const std::string &>());
+}
+
+void to_json(nlohmann::json &j, const InternedString &s) {
+    j = s.str();
+}
+
+std::string operator+(const std::string &a, const InternedString &b) {
+    return a + b.str();
+}
+
+std::string operator+(std::string &&a, const InternedString &b) {
+    return std::move(a) + b.str();
+}
+
+std::string operator+(const char *a, const InternedString &b) {
+    return a + b.str();
+}
+
+std::string operator+(const InternedString &a, const std::string &b) {
+    return a.str() + b;
+}
+
+std::string operator+(const InternedString &a, const char *b) {
+    return a.str() + b;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+#include <spdlog/fmt/fmt.h>
+
+// immutable string shared by every other InternedString with the same value. meant for what gets repeated across
+// users, members and messages (names, avatar hashes) so a copy is a pointer and a refcount instead of an allocation.
+// thread safe, the store hands these out on more than one thread
+class InternedString {
+public:
+    InternedString() noexcept = default;
+    InternedString(std::string_view str);
+    InternedString(const std::string &str);
+    InternedString(const char *str);
+    InternedString(const InternedString &other) noexcept;
+    InternedString(InternedString &&other) noexcept;
+    ~InternedString();
+
+    InternedString &operator=(const InternedString &other) noexcept;
+    InternedString &operator=(InternedString &&other) noexcept;
+
+    [[nodiscard]] const std::string &str() const noexcept;
+    [[nodiscard]] const char *c_str() const noexcept;
+    [[nodiscard]] bool empty() const noexcept;
+    [[nodiscard]] size_t size() const noexcept;
+    char operator[](size_t i) const noexcept;
+
+    operator const std::string &() const noexcept {
+        return str();
+    }
+
+    friend bool operator==(const InternedString &a, const InternedString &b) noexcept;
+    friend bool operator==(const InternedString &a, const std::string &b) noexcept;
+    friend bool operator==(const InternedString &a, const char *b) noexcept;
+    friend bool operator!=(const InternedString &a, const InternedString &b) noexcept;
+    friend bool operator!=(const InternedString &a, const std::string &b) noexcept;
+    friend bool operator!=(const InternedString &a, const char *b) noexcept;
+
+    friend void from_json(const nlohmann::json &j, InternedString &s);
+    friend void to_json(nlohmann::json &j, const InternedString &s);
+
+    struct PoolStats {
+        size_t Strings = 0; // distinct values held by the pool
+        size_t Bytes = 0;   // heap used by them
+        uint64_t Lookups = 0;
+        uint64_t Hits = 0;
+    };
+
+    static PoolStats GetPoolStats();
+    // with the pool off every string gets its own allocation, to see what interning saves
+    static void SetPoolEnabled(bool enabled);
+
+private:
+    struct Entry;
+    class Pool;
+
+    void Release() noexcept;
+
+    Entry *m_entry = nullptr; // null is the empty string
+};
+
+std::string operator+(const std::string &a, const InternedString &b);
+std::string operator+(std::string &&a, const InternedString &b);
+std::string operator+(const char *a, const InternedString &b);
+std::string operator+(const InternedString &a, const std::string &b);
+std::string operator+(const InternedString &a, const char *b);
+
+template<>
+struct fmt::formatter<InternedString> : fmt::formatter<std::string_view> {
+    auto format(const InternedString &s, format_context &ctx) const -> decltype(ctx.out()) {
+        return fmt::formatter<std::string_view>::format(s.str(), ctx);
+    }
+};
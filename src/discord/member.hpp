@@ -8,7 +8,7 @@
 
 struct GuildMember {
     std::optional<UserData> User; // only reliable to access id. only opt in MESSAGE_*
-    std::string Nickname;
+    InternedString Nickname;
     std::vector<Snowflake> Roles;
     std::string JoinedAt;
     std::optional<std::string> PremiumSince; // null
@@ -18,7 +18,7 @@ struct GuildMember {
     std::optional<bool> IsPending;   // this uses `pending` not `is_pending`
 
     // undocuemtned moment !!!1
-    std::optional<std::string> Avatar;
+    std::optional<InternedString> Avatar;
 
     [[nodiscard]] std::vector<RoleData> GetSortedRoles() const;
 
@@ -412,7 +412,7 @@ struct IdentifyProperties {
 };
 
 struct ClientStateProperties {
-    std::map<std::string, std::string> GuildHashes;
+    std::map<std::string, nlohmann::json> GuildHashes;
     std::string HighestLastMessageID = "0";
     int ReadStateVersion = 0;
     int UserGuildSettingsVersion = -1;
@@ -1,8 +1,15 @@
 #include "store.hpp"
+#include <algorithm>
 #include <cinttypes>
+#include "trace.hpp"
 
 using namespace std::literals::string_literals;
 
+// >0 while this thread holds the write connection, which is also where its reads need to go to see its own writes
+static thread_local int t_write_depth = 0;
+// the queued write the writer thread is running, 0 everywhere else
+static thread_local uint64_t t_queued_ticket = 0;
+
 static std::filesystem::path MakeDBPath(bool mem_store) {
     if (mem_store) {
         return ":memory:";
@@ -33,16 +40,47 @@ Store::Store(bool mem_store)
     }
 
     m_ok &= CreateTables();
+
+    if (m_ok && !mem_store) {
+        m_read_db = std::make_unique<Database>(m_db_path.string().c_str(), true);
+        if (!m_read_db->OK()) {
+            // everything still works off the one connection, reads just wait on writes
+            fprintf(stderr, "error opening read connection: %s\n", m_read_db->ErrStr());
+            m_read_db.reset();
+        }
+    }
+
     m_ok &= CreateStatements();
+
+    if (m_ok && m_read_db) {
+        // whichever commit pushes the wal over the limit would do the checkpoint while holding the write connection,
+        // so the writer thread does them instead through a connection of its own
+        m_db.Execute("PRAGMA wal_autocheckpoint = 0");
+        sqlite3_wal_hook(m_db.obj(), &Store::OnWALCommit, this);
+        m_writer_thread = std::thread(&Store::WriterThread, this);
+    }
 }
 
-Store::~Store() {}
+Store::~Store() {
+    StopWriter();
+}
+
+void Store::StopWriter() {
+    if (!m_writer_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> l(m_writes_mutex);
+        m_writer_stop = true;
+    }
+    m_writes_cv.notify_all();
+    m_writer_thread.join();
+}
 
 bool Store::IsValid() const {
     return m_db.OK() && m_ok;
 }
 
 void Store::SetBan(Snowflake guild_id, Snowflake user_id, const BanData &ban) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_set_ban;
 
     s->Bind(1, guild_id);
@@ -50,12 +88,27 @@ void Store::SetBan(Snowflake guild_id, Snowflake user_id, const BanData &ban) {
     s->Bind(3, ban.Reason);
 
     if (!s->Insert())
-        fprintf(stderr, "ban insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild_id), static_cast<uint64_t>(user_id), m_db.ErrStr());
+        fprintf(stderr, "ban insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild_id), static_cast<uint64_t>(user_id), DB().ErrStr());
+
+    s->Reset();
+}
+
+void Store::SetBackfillCursor(Snowflake channel_id, const BackfillCursor &cursor) {
+    const WriteGuard guard(this);
+    auto &s = m_stmt_set_backfill;
+
+    s->Bind(1, channel_id);
+    s->Bind(2, cursor.Before);
+    s->Bind(3, cursor.Complete);
+
+    if (!s->Insert())
+        fprintf(stderr, "backfill cursor insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(channel_id), DB().ErrStr());
 
     s->Reset();
 }
 
 void Store::SetWebhookMessage(const Message &message) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_set_webhook_msg;
 
     s->Bind(1, message.ID);
@@ -64,12 +117,13 @@ void Store::SetWebhookMessage(const Message &message) {
     s->Bind(4, message.Author.Avatar);
 
     if (!s->Insert())
-        fprintf(stderr, "webhook message insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(message.ID), m_db.ErrStr());
+        fprintf(stderr, "webhook message insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(message.ID), DB().ErrStr());
 
     s->Reset();
 }
 
 void Store::SetChannel(Snowflake id, const ChannelData &chan) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_set_chan;
 
     s->Bind(1, id);
@@ -99,7 +153,7 @@ void Store::SetChannel(Snowflake id, const ChannelData &chan) {
     }
 
     if (!s->Insert())
-        fprintf(stderr, "channel insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        fprintf(stderr, "channel insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
 
     if (chan.Recipients.has_value()) {
         BeginTransaction();
@@ -108,7 +162,7 @@ void Store::SetChannel(Snowflake id, const ChannelData &chan) {
             s->Bind(1, chan.ID);
             s->Bind(2, r.ID);
             if (!s->Insert())
-                fprintf(stderr, "recipient insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(chan.ID), static_cast<uint64_t>(r.ID), m_db.ErrStr());
+                fprintf(stderr, "recipient insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(chan.ID), static_cast<uint64_t>(r.ID), DB().ErrStr());
             s->Reset();
         }
         EndTransaction();
@@ -119,7 +173,7 @@ void Store::SetChannel(Snowflake id, const ChannelData &chan) {
             s->Bind(1, chan.ID);
             s->Bind(2, id);
             if (!s->Insert())
-                fprintf(stderr, "recipient insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(chan.ID), static_cast<uint64_t>(id), m_db.ErrStr());
+                fprintf(stderr, "recipient insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(chan.ID), static_cast<uint64_t>(id), DB().ErrStr());
             s->Reset();
         }
         EndTransaction();
@@ -129,6 +183,7 @@ void Store::SetChannel(Snowflake id, const ChannelData &chan) {
 }
 
 void Store::SetEmoji(Snowflake id, const EmojiData &emoji) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_set_emoji;
 
     s->Bind(1, id);
@@ -151,7 +206,7 @@ void Store::SetEmoji(Snowflake id, const EmojiData &emoji) {
             s->Bind(1, id);
             s->Bind(2, r);
             if (!s->Insert())
-                fprintf(stderr, "emoji role insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(r), m_db.ErrStr());
+                fprintf(stderr, "emoji role insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(r), DB().ErrStr());
             s->Reset();
         }
 
@@ -159,12 +214,13 @@ void Store::SetEmoji(Snowflake id, const EmojiData &emoji) {
     }
 
     if (!s->Insert())
-        fprintf(stderr, "emoji insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        fprintf(stderr, "emoji insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
 
     s->Reset();
 }
 
 void Store::SetGuild(Snowflake id, const GuildData &guild) {
+    const WriteGuard guard(this);
     BeginTransaction();
     auto &s = m_stmt_set_guild;
 
@@ -205,7 +261,7 @@ void Store::SetGuild(Snowflake id, const GuildData &guild) {
     s->Bind(35, guild.IsLazy);
 
     if (!s->Insert())
-        fprintf(stderr, "guild insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(guild.ID), m_db.ErrStr());
+        fprintf(stderr, "guild insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(guild.ID), DB().ErrStr());
 
     s->Reset();
 
@@ -215,7 +271,7 @@ void Store::SetGuild(Snowflake id, const GuildData &guild) {
             s->Bind(1, guild.ID);
             s->Bind(2, emoji.ID);
             if (!s->Insert())
-                fprintf(stderr, "guild emoji insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild.ID), static_cast<uint64_t>(emoji.ID), m_db.ErrStr());
+                fprintf(stderr, "guild emoji insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild.ID), static_cast<uint64_t>(emoji.ID), DB().ErrStr());
             s->Reset();
         }
     }
@@ -227,7 +283,7 @@ void Store::SetGuild(Snowflake id, const GuildData &guild) {
             s->Bind(1, guild.ID);
             s->Bind(2, feature);
             if (!s->Insert())
-                fprintf(stderr, "guild feature insert failed for %" PRIu64 "/%s: %s\n", static_cast<uint64_t>(guild.ID), feature.c_str(), m_db.ErrStr());
+                fprintf(stderr, "guild feature insert failed for %" PRIu64 "/%s: %s\n", static_cast<uint64_t>(guild.ID), feature.c_str(), DB().ErrStr());
             s->Reset();
         }
     }
@@ -239,7 +295,7 @@ void Store::SetGuild(Snowflake id, const GuildData &guild) {
             s->Bind(1, guild.ID);
             s->Bind(2, thread.ID);
             if (!s->Insert())
-                fprintf(stderr, "guild thread insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild.ID), static_cast<uint64_t>(thread.ID), m_db.ErrStr());
+                fprintf(stderr, "guild thread insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild.ID), static_cast<uint64_t>(thread.ID), DB().ErrStr());
             s->Reset();
         }
     }
@@ -248,6 +304,7 @@ void Store::SetGuild(Snowflake id, const GuildData &guild) {
 }
 
 void Store::SetGuildMember(Snowflake guild_id, Snowflake user_id, const GuildMember &data) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_set_member;
 
     s->Bind(1, user_id);
@@ -261,7 +318,7 @@ void Store::SetGuildMember(Snowflake guild_id, Snowflake user_id, const GuildMem
     s->Bind(9, data.IsPending);
 
     if (!s->Insert())
-        fprintf(stderr, "member insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), m_db.ErrStr());
+        fprintf(stderr, "member insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), DB().ErrStr());
 
     s->Reset();
 
@@ -282,7 +339,7 @@ void Store::SetGuildMember(Snowflake guild_id, Snowflake user_id, const GuildMem
             s->Bind(2, role);
             if (!s->Insert())
                 fprintf(stderr, "member role insert failed for %" PRIu64 "/%" PRIu64 "/%" PRIu64 ": %s\n",
-                        static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), static_cast<uint64_t>(role), m_db.ErrStr());
+                        static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), static_cast<uint64_t>(role), DB().ErrStr());
             s->Reset();
         }
         EndTransaction();
@@ -290,6 +347,7 @@ void Store::SetGuildMember(Snowflake guild_id, Snowflake user_id, const GuildMem
 }
 
 void Store::SetMessageInteractionPair(Snowflake message_id, const MessageInteractionData &interaction) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_set_interaction;
 
     s->Bind(1, message_id);
@@ -299,12 +357,15 @@ void Store::SetMessageInteractionPair(Snowflake message_id, const MessageInterac
     s->Bind(5, interaction.User.ID);
 
     if (!s->Insert())
-        fprintf(stderr, "message interaction failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(message_id), m_db.ErrStr());
+        fprintf(stderr, "message interaction failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(message_id), DB().ErrStr());
 
     s->Reset();
 }
 
 void Store::SetMessage(Snowflake id, const Message &message) {
+    if (!ShouldWriteMessage(id)) return;
+
+    const WriteGuard guard(this);
     auto &s = m_stmt_set_msg;
 
     BeginTransaction();
@@ -332,7 +393,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
     s->BindAsJSON(21, message.StickerItems);
 
     if (!s->Insert())
-        fprintf(stderr, "message insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        fprintf(stderr, "message insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
 
     s->Reset();
 
@@ -344,7 +405,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
         s->Bind(4, message.MessageReference->GuildID);
 
         if (!s->Insert())
-            fprintf(stderr, "message ref insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+            fprintf(stderr, "message ref insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
 
         s->Reset();
     }
@@ -354,7 +415,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
         s->Bind(1, id);
         s->Bind(2, u.ID);
         if (!s->Insert())
-            fprintf(stderr, "message mention insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(u.ID), m_db.ErrStr());
+            fprintf(stderr, "message mention insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(u.ID), DB().ErrStr());
         s->Reset();
     }
 
@@ -363,7 +424,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
         s->Bind(1, id);
         s->Bind(2, r);
         if (!s->Insert())
-            fprintf(stderr, "message role mention insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(r), m_db.ErrStr());
+            fprintf(stderr, "message role mention insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(r), DB().ErrStr());
         s->Reset();
     }
 
@@ -379,7 +440,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
         s->Bind(8, a.Width);
         s->Bind(9, a.Description);
         if (!s->Insert())
-            fprintf(stderr, "message attachment insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(a.ID), m_db.ErrStr());
+            fprintf(stderr, "message attachment insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(a.ID), DB().ErrStr());
         s->Reset();
     }
 
@@ -394,7 +455,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
             s->Bind(5, reaction.HasReactedWith);
             s->Bind(6, i);
             if (!s->Insert())
-                fprintf(stderr, "message reaction insert failed for %" PRIu64 "/%" PRIu64 "/%s: %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(reaction.Emoji.ID), reaction.Emoji.Name.c_str(), m_db.ErrStr());
+                fprintf(stderr, "message reaction insert failed for %" PRIu64 "/%" PRIu64 "/%s: %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(reaction.Emoji.ID), reaction.Emoji.Name.c_str(), DB().ErrStr());
             s->Reset();
         }
     }
@@ -406,6 +467,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
 }
 
 void Store::SetPermissionOverwrite(Snowflake channel_id, Snowflake id, const PermissionOverwrite &perm) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_set_perm;
 
     s->Bind(1, perm.ID);
@@ -415,12 +477,13 @@ void Store::SetPermissionOverwrite(Snowflake channel_id, Snowflake id, const Per
     s->Bind(5, perm.Deny);
 
     if (!s->Insert())
-        fprintf(stderr, "permission insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(channel_id), static_cast<uint64_t>(id), m_db.ErrStr());
+        fprintf(stderr, "permission insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(channel_id), static_cast<uint64_t>(id), DB().ErrStr());
 
     s->Reset();
 }
 
 void Store::SetRole(Snowflake guild_id, const RoleData &role) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_set_role;
 
     s->Bind(1, role.ID);
@@ -434,12 +497,13 @@ void Store::SetRole(Snowflake guild_id, const RoleData &role) {
     s->Bind(9, role.IsMentionable);
 
     if (!s->Insert())
-        fprintf(stderr, "role insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(role.ID), m_db.ErrStr());
+        fprintf(stderr, "role insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(role.ID), DB().ErrStr());
 
     s->Reset();
 }
 
 void Store::SetUser(Snowflake id, const UserData &user) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_set_user;
 
     s->Bind(1, id);
@@ -454,9 +518,29 @@ void Store::SetUser(Snowflake id, const UserData &user) {
     s->Bind(10, user.GlobalName);
 
     if (!s->Insert())
-        fprintf(stderr, "user insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        fprintf(stderr, "user insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
+
+    s->Reset();
+}
+
+std::optional<BackfillCursor> Store::GetBackfillCursor(Snowflake channel_id) const {
+    auto &s = m_stmt_get_backfill;
+
+    s->Bind(1, channel_id);
+    if (!s->FetchOne()) {
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching backfill cursor for %" PRIu64 ": %s\n", static_cast<uint64_t>(channel_id), DB().ErrStr());
+        s->Reset();
+        return {};
+    }
+
+    BackfillCursor r;
+    s->Get(1, r.Before);
+    s->Get(2, r.Complete);
 
     s->Reset();
+
+    return r;
 }
 
 std::optional<BanData> Store::GetBan(Snowflake guild_id, Snowflake user_id) const {
@@ -465,8 +549,8 @@ std::optional<BanData> Store::GetBan(Snowflake guild_id, Snowflake user_id) cons
     s->Bind(1, guild_id);
     s->Bind(2, user_id);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching ban for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild_id), static_cast<uint64_t>(user_id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching ban for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild_id), static_cast<uint64_t>(user_id), DB().ErrStr());
         s->Reset();
         return {};
     }
@@ -501,8 +585,8 @@ std::optional<WebhookMessageData> Store::GetWebhookMessage(Snowflake message_id)
 
     s->Bind(1, message_id);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching webhook message %" PRIu64 ": %s\n", static_cast<uint64_t>(message_id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching webhook message %" PRIu64 ": %s\n", static_cast<uint64_t>(message_id), DB().ErrStr());
         s->Reset();
         return {};
     }
@@ -682,6 +766,7 @@ std::unordered_set<Snowflake> Store::GetMembersInGuild(Snowflake guild_id) const
 }
 
 void Store::AddReaction(const MessageReactionAddObject &data, bool byself) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_add_reaction;
 
     s->Bind(1, data.MessageID);
@@ -695,12 +780,13 @@ void Store::AddReaction(const MessageReactionAddObject &data, bool byself) {
     s->Bind(6);
 
     if (!s->Insert())
-        fprintf(stderr, "failed to add reaction for %" PRIu64 ": %s\n", static_cast<uint64_t>(data.MessageID), m_db.ErrStr());
+        fprintf(stderr, "failed to add reaction for %" PRIu64 ": %s\n", static_cast<uint64_t>(data.MessageID), DB().ErrStr());
 
     s->Reset();
 }
 
 void Store::RemoveReaction(const MessageReactionRemoveObject &data, bool byself) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_sub_reaction;
 
     s->Bind(1, data.MessageID);
@@ -712,7 +798,7 @@ void Store::RemoveReaction(const MessageReactionRemoveObject &data, bool byself)
         s->Bind(4);
 
     if (!s->Insert())
-        fprintf(stderr, "failed to remove reaction for %" PRIu64 ": %s\n", static_cast<uint64_t>(data.MessageID), m_db.ErrStr());
+        fprintf(stderr, "failed to remove reaction for %" PRIu64 ": %s\n", static_cast<uint64_t>(data.MessageID), DB().ErrStr());
 
     s->Reset();
 }
@@ -721,8 +807,8 @@ std::optional<ChannelData> Store::GetChannel(Snowflake id) const {
     auto &s = m_stmt_get_chan;
     s->Bind(1, id);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching channel %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching channel %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
         s->Reset();
         return {};
     }
@@ -772,8 +858,8 @@ std::optional<EmojiData> Store::GetEmoji(Snowflake id) const {
 
     s->Bind(1, id);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching emoji %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching emoji %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
         s->Reset();
         return {};
     }
@@ -813,8 +899,8 @@ std::optional<GuildData> Store::GetGuild(Snowflake id) const {
     auto &s = m_stmt_get_guild;
     s->Bind(1, id);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching guild %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching guild %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
         s->Reset();
         return {};
     }
@@ -891,14 +977,25 @@ std::optional<GuildData> Store::GetGuild(Snowflake id) const {
     return r;
 }
 
+bool Store::HasGuildMember(Snowflake guild_id, Snowflake user_id) const {
+    auto &s = m_stmt_has_member;
+
+    s->Bind(1, user_id);
+    s->Bind(2, guild_id);
+    const bool ret = s->FetchOne();
+    s->Reset();
+
+    return ret;
+}
+
 std::optional<GuildMember> Store::GetGuildMember(Snowflake guild_id, Snowflake user_id) const {
     auto &s = m_stmt_get_member;
 
     s->Bind(1, user_id);
     s->Bind(2, guild_id);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching member %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching member %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), DB().ErrStr());
         s->Reset();
         return {};
     }
@@ -937,16 +1034,16 @@ std::optional<Message> Store::GetMessage(Snowflake id) const {
 
     s->Bind(1, id);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching message %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching message %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
         s->Reset();
         return {};
     }
 
     auto top = GetMessageBound(s);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching message %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching message %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
         s->Reset();
         return top;
     }
@@ -1091,8 +1188,8 @@ std::optional<PermissionOverwrite> Store::GetPermissionOverwrite(Snowflake chann
     s->Bind(1, id);
     s->Bind(2, channel_id);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "failed while fetching permission %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(channel_id), static_cast<uint64_t>(id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "failed while fetching permission %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(channel_id), static_cast<uint64_t>(id), DB().ErrStr());
         s->Reset();
         return {};
     }
@@ -1113,8 +1210,8 @@ std::optional<RoleData> Store::GetRole(Snowflake id) const {
 
     s->Bind(1, id);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching role %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching role %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
         s->Reset();
         return {};
     }
@@ -1146,8 +1243,8 @@ std::optional<UserData> Store::GetUser(Snowflake id) const {
     auto &s = m_stmt_get_user;
     s->Bind(1, id);
     if (!s->FetchOne()) {
-        if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching user %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        if (DB().Error() != SQLITE_DONE)
+            fprintf(stderr, "error while fetching user %" PRIu64 ": %s\n", static_cast<uint64_t>(id), DB().ErrStr());
         s->Reset();
         return {};
     }
@@ -1160,6 +1257,7 @@ std::optional<UserData> Store::GetUser(Snowflake id) const {
 }
 
 void Store::ClearGuild(Snowflake id) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_clr_guild;
 
     s->Bind(1, id);
@@ -1168,6 +1266,7 @@ void Store::ClearGuild(Snowflake id) {
 }
 
 void Store::ClearChannel(Snowflake id) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_clr_chan;
 
     s->Bind(1, id);
@@ -1176,6 +1275,7 @@ void Store::ClearChannel(Snowflake id) {
 }
 
 void Store::ClearBan(Snowflake guild_id, Snowflake user_id) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_clr_ban;
 
     s->Bind(1, guild_id);
@@ -1185,6 +1285,7 @@ void Store::ClearBan(Snowflake guild_id, Snowflake user_id) {
 }
 
 void Store::ClearRecipient(Snowflake channel_id, Snowflake user_id) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_clr_recipient;
 
     s->Bind(1, channel_id);
@@ -1194,6 +1295,7 @@ void Store::ClearRecipient(Snowflake channel_id, Snowflake user_id) {
 }
 
 void Store::ClearRole(Snowflake id) {
+    const WriteGuard guard(this);
     auto &s = m_stmt_clr_role;
 
     s->Bind(1, id);
@@ -1232,8 +1334,19 @@ std::unordered_set<Snowflake> Store::GetGuilds() const {
 }
 
 void Store::ClearAll() {
+    {
+        std::lock_guard<std::mutex> l(m_writes_mutex);
+        m_writes.clear();
+        m_direct_messages.clear();
+        m_cleared = m_committed = m_next_ticket - 1;
+    }
+    m_committed_cv.notify_all();
+
+    // waits for a batch thats already running
+    const WriteGuard guard(this);
     if (m_db.Execute(R"(
         DELETE FROM attachments;
+        DELETE FROM backfill;
         DELETE FROM bans;
         DELETE FROM channels;
         DELETE FROM emojis;
@@ -1258,12 +1371,192 @@ void Store::ClearAll() {
     }
 }
 
+bool Store::ShouldWriteMessage(Snowflake id) {
+    if (!m_writer_thread.joinable()) return true;
+
+    // a queued copy (a rest page) was fetched before any direct write (MESSAGE_UPDATE, MESSAGE_DELETE) made after it
+    // was queued, so it cant be newer than what that wrote
+    std::lock_guard<std::mutex> l(m_writes_mutex);
+    if (t_queued_ticket != 0) {
+        const auto it = m_direct_messages.find(id);
+        return it == m_direct_messages.end() || it->second <= t_queued_ticket;
+    }
+    if (m_committed + 1 < m_next_ticket)
+        m_direct_messages[id] = m_next_ticket;
+    return true;
+}
+
+void Store::LockWrite() const {
+    if (m_write_mutex.try_lock()) return;
+    m_direct_waiting++;
+    m_write_mutex.lock();
+    m_direct_waiting--;
+}
+
 void Store::BeginTransaction() {
-    m_db.StartTransaction();
+    LockWrite();
+    t_write_depth++;
+    if (m_transaction_depth++ == 0)
+        m_db.StartTransaction();
 }
 
 void Store::EndTransaction() {
-    m_db.EndTransaction();
+    if (--m_transaction_depth == 0)
+        m_db.EndTransaction();
+    t_write_depth--;
+    m_write_mutex.unlock();
+}
+
+Store::WriteTicket Store::Write(std::function<void()> write, std::function<void()> done) {
+    if (!m_writer_thread.joinable()) {
+        write();
+        if (done) done();
+        std::lock_guard<std::mutex> l(m_writes_mutex);
+        return m_committed = m_next_ticket++;
+    }
+
+    WriteTicket ticket;
+    {
+        std::lock_guard<std::mutex> l(m_writes_mutex);
+        ticket = m_next_ticket++;
+        m_writes.push_back({ ticket, std::move(write), std::move(done) });
+    }
+    m_writes_cv.notify_one();
+    return ticket;
+}
+
+void Store::Wait(WriteTicket ticket) {
+    std::unique_lock<std::mutex> l(m_writes_mutex);
+    m_committed_cv.wait(l, [this, ticket] { return m_committed >= ticket; });
+}
+
+void Store::Flush() {
+    WriteTicket last;
+    {
+        std::lock_guard<std::mutex> l(m_writes_mutex);
+        last = m_next_ticket - 1;
+    }
+    Wait(last);
+}
+
+int Store::OnWALCommit(void *data, sqlite3 *db, const char *name, int pages) {
+    auto *store = static_cast<Store *>(data);
+    if (pages >= CheckpointPages && !store->m_checkpoint_wanted.exchange(true)) {
+        std::lock_guard<std::mutex> l(store->m_writes_mutex);
+        store->m_writes_cv.notify_one();
+    }
+    return SQLITE_OK;
+}
+
+void Store::WriterThread() {
+    Trace::SetThreadName("store writer");
+
+    // small writes share a commit, but the write connection is given up at least this often so direct writes from
+    // the main thread never wait on more than about one queued write
+    constexpr auto MaxHold = std::chrono::milliseconds(2);
+
+    sqlite3 *checkpoint_db = nullptr;
+    if (sqlite3_open_v2(m_db_path.string().c_str(), &checkpoint_db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        fprintf(stderr, "error opening checkpoint connection: %s\n", sqlite3_errmsg(checkpoint_db));
+        sqlite3_close(checkpoint_db);
+        checkpoint_db = nullptr;
+        // back to the usual checkpointing on commit
+        const WriteGuard guard(this);
+        m_db.Execute("PRAGMA wal_autocheckpoint = 1000");
+    }
+
+    while (true) {
+        PendingWrite pending;
+        {
+            std::unique_lock<std::mutex> l(m_writes_mutex);
+            m_writes_cv.wait(l, [this] { return m_writer_stop || !m_writes.empty() || m_checkpoint_wanted; });
+            if (m_writer_stop) break;
+        }
+
+        // passive, so it doesnt block or get blocked by writes on the other connection
+        if (m_checkpoint_wanted.exchange(false) && checkpoint_db != nullptr) {
+            TRACE_ZONE("store checkpoint");
+            sqlite3_wal_checkpoint_v2(checkpoint_db, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr);
+        }
+
+        // let a direct write thats already waiting go first
+        while (m_direct_waiting.load(std::memory_order_relaxed) > 0)
+            std::this_thread::yield();
+
+        std::vector<PendingWrite> batch;
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> l(m_writes_mutex);
+            if (m_writes.empty()) continue;
+        }
+        BeginTransaction();
+        while (true) {
+            {
+                std::lock_guard<std::mutex> l(m_writes_mutex);
+                if (m_writes.empty()) break;
+                pending = std::move(m_writes.front());
+                m_writes.pop_front();
+                if (pending.Ticket <= m_cleared) continue;
+            }
+
+            t_queued_ticket = pending.Ticket;
+            try {
+                pending.Write();
+            } catch (const std::exception &e) {
+                fprintf(stderr, "queued store write failed: %s\n", e.what());
+            }
+            t_queued_ticket = 0;
+            batch.push_back(std::move(pending));
+
+            if (std::chrono::steady_clock::now() - start >= MaxHold || m_direct_waiting.load(std::memory_order_relaxed) > 0) break;
+        }
+        EndTransaction();
+
+        if (batch.empty()) continue;
+        {
+            std::lock_guard<std::mutex> l(m_writes_mutex);
+            // ClearAll can move this past us
+            m_committed = std::max(m_committed, batch.back().Ticket);
+            for (auto it = m_direct_messages.begin(); it != m_direct_messages.end();) {
+                if (it->second <= m_committed + 1)
+                    it = m_direct_messages.erase(it);
+                else
+                    ++it;
+            }
+        }
+        m_committed_cv.notify_all();
+
+        for (auto &write : batch) {
+            if (write.Done) write.Done();
+        }
+    }
+
+    sqlite3_close(checkpoint_db);
+}
+
+void Store::SetTiming(bool enabled) {
+    m_db.SetTiming(enabled);
+    if (m_read_db) m_read_db->SetTiming(enabled);
+}
+
+std::chrono::steady_clock::duration Store::GetTime() const {
+    return m_db.GetTime() + (m_read_db ? m_read_db->GetTime() : std::chrono::steady_clock::duration {});
+}
+
+const Store::Database &Store::DB() const {
+    if (t_write_depth > 0 || !m_read_db) return m_db;
+    return *m_read_db;
+}
+
+Store::WriteGuard::WriteGuard(const Store *store)
+    : m_lock(store->m_write_mutex, std::defer_lock) {
+    store->LockWrite();
+    m_lock = std::unique_lock<std::recursive_mutex>(store->m_write_mutex, std::adopt_lock);
+    t_write_depth++;
+}
+
+Store::WriteGuard::~WriteGuard() {
+    t_write_depth--;
 }
 
 bool Store::CreateTables() {
@@ -1545,6 +1838,15 @@ bool Store::CreateTables() {
         )
     )";
 
+    // the messages a crawl fetched only live here, so where it got to lives here too
+    const char *create_backfill = R"(
+        CREATE TABLE IF NOT EXISTS backfill (
+            channel_id INTEGER PRIMARY KEY,
+            before_id INTEGER NOT NULL,
+            complete BOOL NOT NULL
+        )
+    )";
+
     const char *create_webhook_messages = R"(
         CREATE TABLE IF NOT EXISTS webhook_messages (
             message_id INTEGER NOT NULL,
@@ -1664,6 +1966,11 @@ bool Store::CreateTables() {
         return false;
     }
 
+    if (m_db.Execute(create_backfill) != SQLITE_OK) {
+        fprintf(stderr, "failed to create backfill table: %s\n", m_db.ErrStr());
+        return false;
+    }
+
     if (m_db.Execute(R"(
         CREATE TRIGGER remove_zero_reactions AFTER UPDATE ON reactions WHEN new.count = 0
         BEGIN
@@ -1688,7 +1995,7 @@ bool Store::CreateTables() {
 }
 
 bool Store::CreateStatements() {
-    m_stmt_set_guild = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_guild = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO guilds VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
@@ -1698,7 +2005,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_guild = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM guilds WHERE id = ?
     )");
     if (!m_stmt_get_guild->OK()) {
@@ -1706,7 +2013,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_guild_ids = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_ids = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT id FROM guilds
     )");
     if (!m_stmt_get_guild_ids->OK()) {
@@ -1714,7 +2021,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_clr_guild = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_guild = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         DELETE FROM guilds WHERE id = ?
     )");
     if (!m_stmt_clr_guild->OK()) {
@@ -1722,7 +2029,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_chan = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_chan = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO channels VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
@@ -1732,7 +2039,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_chan = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_chan = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM channels WHERE id = ?
     )");
     if (!m_stmt_get_chan->OK()) {
@@ -1740,7 +2047,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_chan_ids = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_chan_ids = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT id FROM channels
     )");
     if (!m_stmt_get_chan_ids->OK()) {
@@ -1748,7 +2055,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_clr_chan = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_chan = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         DELETE FROM channels WHERE id = ?
     )");
     if (!m_stmt_clr_chan->OK()) {
@@ -1756,7 +2063,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_msg = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_msg = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO messages VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
@@ -1767,7 +2074,7 @@ bool Store::CreateStatements() {
     }
 
     // wew
-    m_stmt_get_msg = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_msg = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT messages.*,
                message_interactions.interaction_id,
                message_interactions.name,
@@ -1816,7 +2123,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_msg_ref = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_msg_ref = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO message_references VALUES (
             ?, ?, ?, ?
         );
@@ -1826,7 +2133,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_last_msgs = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_last_msgs = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM (
             SELECT messages.*,
                    message_interactions.interaction_id,
@@ -1855,7 +2162,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_user = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_user = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO users VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
@@ -1865,7 +2172,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_user = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_user = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM users WHERE id = ?
     )");
     if (!m_stmt_get_user->OK()) {
@@ -1873,7 +2180,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_member = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_member = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO members VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
@@ -1883,7 +2190,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_member = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_member = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM members WHERE user_id = ? AND guild_id = ?
     )");
     if (!m_stmt_get_member->OK()) {
@@ -1891,7 +2198,15 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_role = std::make_unique<Statement>(m_db, R"(
+    m_stmt_has_member = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
+        SELECT 1 FROM members WHERE user_id = ? AND guild_id = ?
+    )");
+    if (!m_stmt_has_member->OK()) {
+        fprintf(stderr, "failed to prepare has member statement: %s\n", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_set_role = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO roles VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
@@ -1901,7 +2216,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_role = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_role = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM roles WHERE id = ?
     )");
     if (!m_stmt_get_role->OK()) {
@@ -1909,7 +2224,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_guild_roles = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_roles = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM roles WHERE guild = ?
     )");
     if (!m_stmt_get_guild_roles->OK()) {
@@ -1917,7 +2232,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_emoji = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_emoji = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO emojis VALUES (
             ?, ?, ?, ?, ?, ?, ?
         )
@@ -1927,7 +2242,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_emoji = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_emoji = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM emojis WHERE id = ?
     )");
     if (!m_stmt_get_emoji->OK()) {
@@ -1935,7 +2250,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_perm = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_perm = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO permissions VALUES (
             ?, ?, ?, ?, ?
         )
@@ -1945,7 +2260,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_perm = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_perm = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM permissions WHERE id = ? AND channel_id = ?
     )");
     if (!m_stmt_get_perm->OK()) {
@@ -1953,7 +2268,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_ban = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_ban = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO bans VALUES (
             ?, ?, ?
         )
@@ -1963,7 +2278,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_ban = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_ban = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM bans WHERE guild_id = ? AND user_id = ?
     )");
     if (!m_stmt_get_ban->OK()) {
@@ -1971,7 +2286,25 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_bans = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_backfill = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
+        REPLACE INTO backfill VALUES (
+            ?, ?, ?
+        )
+    )");
+    if (!m_stmt_set_backfill->OK()) {
+        fprintf(stderr, "failed to prepare set backfill statement: %s\n", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_get_backfill = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
+        SELECT * FROM backfill WHERE channel_id = ?
+    )");
+    if (!m_stmt_get_backfill->OK()) {
+        fprintf(stderr, "failed to prepare get backfill statement: %s\n", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_get_bans = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM bans WHERE guild_id = ?
     )");
     if (!m_stmt_get_bans->OK()) {
@@ -1979,7 +2312,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_clr_ban = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_ban = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         DELETE FROM bans WHERE guild_id = ? AND user_id = ?
     )");
     if (!m_stmt_clr_ban->OK()) {
@@ -1987,7 +2320,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_interaction = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_interaction = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO message_interactions VALUES (
             ?, ?, ?, ?, ?
         )
@@ -1997,7 +2330,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_member_roles = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_member_roles = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO member_roles VALUES (
             ?, ?
         )
@@ -2007,7 +2340,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_member_roles = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_member_roles = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT id FROM roles, member_roles
         WHERE roles.id = member_roles.role
         AND member_roles.user = ?
@@ -2018,7 +2351,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_clr_member_roles = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_member_roles = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         DELETE FROM member_roles
         WHERE user = ? AND
         EXISTS (
@@ -2032,7 +2365,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_guild_emoji = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_guild_emoji = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO guild_emojis VALUES (
             ?, ?
         )
@@ -2042,7 +2375,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_guild_emojis = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_emojis = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT emoji FROM guild_emojis WHERE guild = ?
     )");
     if (!m_stmt_get_guild_emojis->OK()) {
@@ -2050,7 +2383,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_clr_guild_emoji = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_guild_emoji = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         DELETE FROM guild_emojis WHERE guild = ? AND emoji = ?
     )");
     if (!m_stmt_clr_guild_emoji->OK()) {
@@ -2058,7 +2391,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_guild_feature = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_guild_feature = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO guild_features VALUES (
             ?, ?
         )
@@ -2068,7 +2401,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_guild_features = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_features = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT feature FROM guild_features WHERE guild = ?  
     )");
     if (!m_stmt_get_guild_features->OK()) {
@@ -2076,7 +2409,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_guild_chans = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_chans = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT id FROM channels WHERE guild_id = ?
     )");
     if (!m_stmt_get_guild_chans->OK()) {
@@ -2084,7 +2417,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_thread = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_thread = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO threads VALUES (
             ?, ?
         )
@@ -2094,7 +2427,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_threads = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_threads = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT id FROM threads WHERE guild = ?
     )");
     if (!m_stmt_get_threads->OK()) {
@@ -2102,7 +2435,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_active_threads = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_active_threads = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT id FROM channels WHERE parent_id = ? AND (type = 10 OR type = 11 OR type = 12) AND archived = FALSE
     )");
     if (!m_stmt_get_active_threads->OK()) {
@@ -2110,7 +2443,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_messages_before = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_messages_before = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM (
             SELECT messages.*,
                    message_interactions.interaction_id,
@@ -2139,7 +2472,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_pins = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_pins = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM (
             SELECT messages.*,
                    message_interactions.interaction_id,
@@ -2168,7 +2501,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_emoji_role = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_emoji_role = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO emoji_roles VALUES (
             ?, ?
         )
@@ -2178,7 +2511,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_emoji_roles = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_emoji_roles = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT role FROM emoji_roles WHERE emoji = ?
     )");
     if (!m_stmt_get_emoji_roles->OK()) {
@@ -2186,7 +2519,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_mention = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_mention = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO mentions VALUES (
             ?, ?
         )
@@ -2196,7 +2529,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_mentions = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_mentions = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT user FROM mentions WHERE message = ?
     )");
     if (!m_stmt_get_mentions->OK()) {
@@ -2204,7 +2537,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_role_mention = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_role_mention = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO mention_roles VALUES (
             ?, ?
         )
@@ -2214,7 +2547,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_role_mentions = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_role_mentions = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT role FROM mention_roles WHERE message = ?
     )");
     if (!m_stmt_get_role_mentions->OK()) {
@@ -2222,7 +2555,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_attachment = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_attachment = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO attachments VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
@@ -2232,7 +2565,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_attachments = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_attachments = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM attachments WHERE message = ?
     )");
     if (!m_stmt_get_attachments->OK()) {
@@ -2240,7 +2573,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_recipient = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_recipient = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO recipients VALUES (
             ?, ?
         )
@@ -2250,7 +2583,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_recipients = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_recipients = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT user FROM recipients WHERE channel = ?
     )");
     if (!m_stmt_get_recipients->OK()) {
@@ -2258,7 +2591,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_clr_recipient = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_recipient = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         DELETE FROM recipients WHERE channel = ? AND user = ?
     )");
     if (!m_stmt_clr_recipient->OK()) {
@@ -2267,7 +2600,7 @@ bool Store::CreateStatements() {
     }
 
     // probably not the best way to do this lol but i just want one statement i guess
-    m_stmt_add_reaction = std::make_unique<Statement>(m_db, R"(
+    m_stmt_add_reaction = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         INSERT OR REPLACE INTO reactions VALUES (
             ?1, ?2, ?3,
             COALESCE(
@@ -2292,7 +2625,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_sub_reaction = std::make_unique<Statement>(m_db, R"(
+    m_stmt_sub_reaction = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         UPDATE reactions
         SET count = count - 1,
             me = COALESCE(?4, me)
@@ -2303,7 +2636,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_reactions = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_reactions = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT
             reactions.count,
             reactions.me,
@@ -2323,7 +2656,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_chan_ids_parent = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_chan_ids_parent = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT id, type FROM channels WHERE parent_id = ?
     )");
     if (!m_stmt_get_chan_ids_parent->OK()) {
@@ -2331,7 +2664,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_guild_member_ids = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_member_ids = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT user_id FROM members WHERE guild_id = ?
     )");
     if (!m_stmt_get_guild_member_ids->OK()) {
@@ -2339,7 +2672,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_clr_role = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_role = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         DELETE FROM roles
         WHERE id = ?1;
     )");
@@ -2348,7 +2681,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_guild_owner = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_owner = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT owner_id FROM guilds WHERE id = ?
     )");
     if (!m_stmt_get_guild_owner->OK()) {
@@ -2356,7 +2689,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_set_webhook_msg = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_webhook_msg = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         REPLACE INTO webhook_messages VALUES (
             ?, ?, ?, ?
         )
@@ -2366,7 +2699,7 @@ bool Store::CreateStatements() {
         return false;
     }
 
-    m_stmt_get_webhook_msg = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_webhook_msg = std::make_unique<Statement>(m_db, m_read_db.get(), R"(
         SELECT * FROM webhook_messages WHERE message_id = ?
     )");
     if (!m_stmt_get_webhook_msg->OK()) {
@@ -2377,8 +2710,14 @@ bool Store::CreateStatements() {
     return true;
 }
 
-Store::Database::Database(const char *path)
-    : m_db_path(path) {
+Store::Database::Database(const char *path, bool read_only)
+    : m_db_path(path)
+    , m_read_only(read_only) {
+    if (read_only) {
+        m_err = sqlite3_open_v2(path, &m_db, SQLITE_OPEN_READONLY, nullptr);
+        return;
+    }
+
     if (path != ":memory:"s) {
         std::error_code ec;
         if (std::filesystem::exists(path, ec) && !std::filesystem::remove(path, ec)) {
@@ -2401,7 +2740,7 @@ int Store::Database::Close() {
     if (!OK()) {
         fprintf(stderr, "error closing database: %s\n", ErrStr());
     } else {
-        if (m_db_path != ":memory:") {
+        if (m_db_path != ":memory:" && !m_read_only) {
             std::error_code ec;
             std::filesystem::remove(m_db_path, ec);
         }
@@ -2419,7 +2758,30 @@ int Store::Database::EndTransaction() {
 }
 
 int Store::Database::Execute(const char *command) {
-    return m_err = sqlite3_exec(m_db, command, nullptr, nullptr, nullptr);
+    TRACE_ZONE("store execute", command);
+    if (!m_timing) return m_err = sqlite3_exec(m_db, command, nullptr, nullptr, nullptr);
+    const auto start = std::chrono::steady_clock::now();
+    m_err = sqlite3_exec(m_db, command, nullptr, nullptr, nullptr);
+    m_time += (std::chrono::steady_clock::now() - start).count();
+    return m_err;
+}
+
+int Store::Database::Step(sqlite3_stmt *stmt) {
+    TRACE_ZONE("store step", sqlite3_sql(stmt));
+    if (!m_timing) return sqlite3_step(stmt);
+    const auto start = std::chrono::steady_clock::now();
+    const int err = sqlite3_step(stmt);
+    m_time += (std::chrono::steady_clock::now() - start).count();
+    return err;
+}
+
+void Store::Database::SetTiming(bool enabled) {
+    m_timing = enabled;
+    m_time = 0;
+}
+
+std::chrono::steady_clock::duration Store::Database::GetTime() const {
+    return std::chrono::steady_clock::duration(m_time.load());
 }
 
 int Store::Database::Error() const {
@@ -2447,13 +2809,31 @@ sqlite3 *Store::Database::obj() {
     return m_db;
 }
 
-Store::Statement::Statement(Database &db, const char *command)
+Store::Statement::Statement(Database &db, Database *read_db, const char *command)
     : m_db(&db) {
     if (m_db->SetError(sqlite3_prepare_v2(m_db->obj(), command, -1, &m_stmt, nullptr)) != SQLITE_OK) return;
+
+    if (read_db != nullptr && sqlite3_stmt_readonly(m_stmt)) {
+        if (read_db->SetError(sqlite3_prepare_v2(read_db->obj(), command, -1, &m_read_stmt, nullptr)) == SQLITE_OK)
+            m_read_db = read_db;
+        else
+            fprintf(stderr, "failed to prepare read statement, it will use the write connection: %s\n", read_db->ErrStr());
+    }
 }
 
 Store::Statement::~Statement() {
     sqlite3_finalize(m_stmt);
+    sqlite3_finalize(m_read_stmt);
+}
+
+Store::Database *Store::Statement::DB() const {
+    if (m_read_stmt != nullptr && t_write_depth == 0) return m_read_db;
+    return m_db;
+}
+
+sqlite3_stmt *Store::Statement::Stmt() const {
+    if (m_read_stmt != nullptr && t_write_depth == 0) return m_read_stmt;
+    return m_stmt;
 }
 
 bool Store::Statement::OK() const {
@@ -2466,53 +2846,66 @@ int Store::Statement::Bind(int index, Snowflake id) {
 
 int Store::Statement::Bind(int index, const char *str, size_t len) {
     if (len == -1) len = strlen(str);
-    return m_db->SetError(sqlite3_bind_blob(m_stmt, index, str, static_cast<int>(len), SQLITE_TRANSIENT));
+    return DB()->SetError(sqlite3_bind_blob(Stmt(), index, str, static_cast<int>(len), SQLITE_TRANSIENT));
 }
 
 int Store::Statement::Bind(int index, const std::string &str) {
-    return m_db->SetError(sqlite3_bind_blob(m_stmt, index, str.c_str(), static_cast<int>(str.size()), SQLITE_TRANSIENT));
+    return DB()->SetError(sqlite3_bind_blob(Stmt(), index, str.c_str(), static_cast<int>(str.size()), SQLITE_TRANSIENT));
+}
+
+int Store::Statement::Bind(int index, const InternedString &str) {
+    return Bind(index, str.str());
 }
 
 int Store::Statement::Bind(int index) {
-    return m_db->SetError(sqlite3_bind_null(m_stmt, index));
+    return DB()->SetError(sqlite3_bind_null(Stmt(), index));
 }
 
 void Store::Statement::Get(int index, Snowflake &out) const {
-    out = static_cast<uint64_t>(sqlite3_column_int64(m_stmt, index));
+    out = static_cast<uint64_t>(sqlite3_column_int64(Stmt(), index));
 }
 
 void Store::Statement::Get(int index, std::string &out) const {
-    const unsigned char *ptr = sqlite3_column_text(m_stmt, index);
+    const unsigned char *ptr = sqlite3_column_text(Stmt(), index);
     if (ptr == nullptr)
         out = "";
     else
         out = reinterpret_cast<const char *>(ptr);
 }
 
+// straight from the column so a value thats already interned doesnt allocate
+void Store::Statement::Get(int index, InternedString &out) const {
+    const unsigned char *ptr = sqlite3_column_text(Stmt(), index);
+    if (ptr == nullptr)
+        out = InternedString();
+    else
+        out = InternedString(std::string_view(reinterpret_cast<const char *>(ptr), sqlite3_column_bytes(Stmt(), index)));
+}
+
 bool Store::Statement::IsNull(int index) const {
-    return sqlite3_column_type(m_stmt, index) == SQLITE_NULL;
+    return sqlite3_column_type(Stmt(), index) == SQLITE_NULL;
 }
 
 int Store::Statement::Step() {
-    return m_db->SetError(sqlite3_step(m_stmt));
+    return DB()->SetError(DB()->Step(Stmt()));
 }
 
 bool Store::Statement::Insert() {
-    return m_db->SetError(sqlite3_step(m_stmt)) == SQLITE_DONE;
+    return DB()->SetError(DB()->Step(Stmt())) == SQLITE_DONE;
 }
 
 bool Store::Statement::FetchOne() {
-    return m_db->SetError(sqlite3_step(m_stmt)) == SQLITE_ROW;
+    return DB()->SetError(DB()->Step(Stmt())) == SQLITE_ROW;
 }
 
 int Store::Statement::Reset() {
-    if (m_db->SetError(sqlite3_reset(m_stmt)) != SQLITE_OK)
-        return m_db->Error();
-    if (m_db->SetError(sqlite3_clear_bindings(m_stmt)) != SQLITE_OK)
-        return m_db->Error();
-    return m_db->Error();
+    if (DB()->SetError(sqlite3_reset(Stmt())) != SQLITE_OK)
+        return DB()->Error();
+    if (DB()->SetError(sqlite3_clear_bindings(Stmt())) != SQLITE_OK)
+        return DB()->Error();
+    return DB()->Error();
 }
 
 sqlite3_stmt *Store::Statement::obj() {
-    return m_stmt;
+    return Stmt();
 }
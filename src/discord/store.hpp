@@ -2,7 +2,13 @@
 #include "objects.hpp"
 #include <unordered_map>
 #include <unordered_set>
+#include <atomic>
 #include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
 #include <filesystem>
 #include <sqlite3.h>
 
@@ -10,6 +16,12 @@
 #undef GetMessage
 #endif
 
+// position of the background history crawler in a channel
+struct BackfillCursor {
+    Snowflake Before; // oldest message fetched so far
+    bool Complete = false;
+};
+
 class Store {
 private:
     class Statement;
@@ -30,11 +42,13 @@ public:
     void SetEmoji(Snowflake id, const EmojiData &emoji);
     void SetBan(Snowflake guild_id, Snowflake user_id, const BanData &ban);
     void SetWebhookMessage(const Message &message);
+    void SetBackfillCursor(Snowflake channel_id, const BackfillCursor &cursor);
 
     std::optional<ChannelData> GetChannel(Snowflake id) const;
     std::optional<EmojiData> GetEmoji(Snowflake id) const;
     std::optional<GuildData> GetGuild(Snowflake id) const;
     std::optional<GuildMember> GetGuildMember(Snowflake guild_id, Snowflake user_id) const;
+    bool HasGuildMember(Snowflake guild_id, Snowflake user_id) const;
     std::optional<Message> GetMessage(Snowflake id) const;
     std::optional<PermissionOverwrite> GetPermissionOverwrite(Snowflake channel_id, Snowflake id) const;
     std::optional<RoleData> GetRole(Snowflake id) const;
@@ -42,6 +56,7 @@ public:
     std::optional<BanData> GetBan(Snowflake guild_id, Snowflake user_id) const;
     std::vector<BanData> GetBans(Snowflake guild_id) const;
     std::optional<WebhookMessageData> GetWebhookMessage(Snowflake message_id) const;
+    std::optional<BackfillCursor> GetBackfillCursor(Snowflake channel_id) const;
 
     Snowflake GetGuildOwner(Snowflake guild_id) const;
     std::vector<Snowflake> GetMemberRoles(Snowflake guild_id, Snowflake user_id) const;
@@ -96,21 +111,44 @@ public:
     std::unordered_set<Snowflake> GetChannels() const;
     std::unordered_set<Snowflake> GetGuilds() const;
 
+    // also drops writes that havent started yet
     void ClearAll();
 
+    // these nest, only the outermost pair commits. the caller has the write connection to itself in between
     void BeginTransaction();
     void EndTransaction();
 
+    // reads go through their own connection and see what was last committed, so they dont wait on the writer.
+    // writes queued here run on the writer thread, small ones sharing a transaction. done runs on the writer thread
+    // once the write is committed. the Set/Clear functions can still be called directly, they go ahead of queued
+    // writes that havent started and wait for at most the one that has. a queued SetMessage is dropped if the
+    // message was written directly after it was queued
+    using WriteTicket = uint64_t;
+    WriteTicket Write(std::function<void()> write, std::function<void()> done = {});
+    // blocks until that write is committed. not from inside a transaction
+    void Wait(WriteTicket ticket);
+    // waits for everything queued so far
+    void Flush();
+    // drops whatever is still queued. writes after this run on the calling thread
+    void StopWriter();
+
+    // accumulates time spent inside sqlite. only for measuring, off by default
+    void SetTiming(bool enabled);
+    std::chrono::steady_clock::duration GetTime() const;
+
 private:
     class Database {
     public:
-        Database(const char *path);
+        Database(const char *path, bool read_only = false);
         ~Database();
 
         int Close();
         int StartTransaction();
         int EndTransaction();
         int Execute(const char *command);
+        int Step(sqlite3_stmt *stmt);
+        void SetTiming(bool enabled);
+        std::chrono::steady_clock::duration GetTime() const;
         int Error() const;
         bool OK() const;
         const char *ErrStr() const;
@@ -122,13 +160,18 @@ private:
         int m_err = SQLITE_OK;
         mutable char m_err_scratch[256] { 0 };
         std::filesystem::path m_db_path;
+        bool m_read_only;
+
+        std::atomic<bool> m_timing = false;
+        std::atomic<std::chrono::steady_clock::rep> m_time = 0;
     };
 
     class Statement {
     public:
         Statement() = delete;
         Statement(const Statement &other) = delete;
-        Statement(Database &db, const char *command);
+        // read only statements are prepared on read_db as well, if there is one
+        Statement(Database &db, Database *read_db, const char *command);
         ~Statement();
         Statement &operator=(Statement &other) = delete;
 
@@ -137,6 +180,7 @@ private:
         int Bind(int index, Snowflake id);
         int Bind(int index, const char *str, size_t len = -1);
         int Bind(int index, const std::string &str);
+        int Bind(int index, const InternedString &str);
         int Bind(int index);
 
         template<typename T>
@@ -178,7 +222,7 @@ private:
         template<typename T>
         typename std::enable_if<std::is_integral<T>::value, int>::type
         Bind(int index, T val) {
-            return m_db->SetError(sqlite3_bind_int64(m_stmt, index, val));
+            return DB()->SetError(sqlite3_bind_int64(Stmt(), index, val));
         }
 
         template<typename T>
@@ -192,11 +236,12 @@ private:
         template<typename T>
         typename std::enable_if<std::is_integral<T>::value>::type
         Get(int index, T &out) const {
-            out = static_cast<T>(sqlite3_column_int64(m_stmt, index));
+            out = static_cast<T>(sqlite3_column_int64(Stmt(), index));
         }
 
         void Get(int index, Snowflake &out) const;
         void Get(int index, std::string &out) const;
+        void Get(int index, InternedString &out) const;
 
         template<typename T>
         void GetJSON(int index, std::optional<T> &out) const {
@@ -264,10 +309,36 @@ private:
         sqlite3_stmt *obj();
 
     private:
+        // whichever connection the calling thread should be using
+        [[nodiscard]] Database *DB() const;
+        [[nodiscard]] sqlite3_stmt *Stmt() const;
+
         Database *m_db;
         sqlite3_stmt *m_stmt;
+        Database *m_read_db = nullptr;
+        sqlite3_stmt *m_read_stmt = nullptr;
+    };
+
+    // holds the write connection for the current thread
+    class WriteGuard {
+    public:
+        WriteGuard(const Store *store);
+        ~WriteGuard();
+        WriteGuard(const WriteGuard &) = delete;
+        WriteGuard &operator=(const WriteGuard &) = delete;
+
+    private:
+        std::unique_lock<std::recursive_mutex> m_lock;
     };
 
+    [[nodiscard]] const Database &DB() const;
+
+    void WriterThread();
+    static int OnWALCommit(void *data, sqlite3 *db, const char *name, int pages);
+    // takes m_write_mutex, letting the writer thread know someone is waiting
+    void LockWrite() const;
+    bool ShouldWriteMessage(Snowflake id);
+
     UserData GetUserBound(Statement *stmt) const;
     Message GetMessageBound(std::unique_ptr<Statement> &stmt) const;
     static RoleData GetRoleBound(std::unique_ptr<Statement> &stmt);
@@ -281,6 +352,31 @@ private:
 
     std::filesystem::path m_db_path;
     Database m_db;
+    std::unique_ptr<Database> m_read_db; // none for memory stores, theres nothing to share
+
+    mutable std::recursive_mutex m_write_mutex;
+    mutable std::atomic<int> m_direct_waiting = 0;
+    int m_transaction_depth = 0;
+
+    struct PendingWrite {
+        WriteTicket Ticket;
+        std::function<void()> Write;
+        std::function<void()> Done;
+    };
+    std::thread m_writer_thread;
+    std::mutex m_writes_mutex;
+    std::condition_variable m_writes_cv;
+    std::condition_variable m_committed_cv;
+    std::deque<PendingWrite> m_writes;
+    WriteTicket m_next_ticket = 1;
+    WriteTicket m_committed = 0;
+    WriteTicket m_cleared = 0; // writes up to here were dropped by ClearAll
+    bool m_writer_stop = false;
+    constexpr static int CheckpointPages = 1000; // sqlites default for autocheckpoint
+    std::atomic<bool> m_checkpoint_wanted = false;
+    // messages written directly while writes were queued, and the ticket the next queued write got at the time
+    std::unordered_map<Snowflake, WriteTicket> m_direct_messages;
+
 #define STMT(x) mutable std::unique_ptr<Statement> m_stmt_##x
     STMT(set_guild);
     STMT(get_guild);
@@ -298,6 +394,7 @@ private:
     STMT(get_user);
     STMT(set_member);
     STMT(get_member);
+    STMT(has_member);
     STMT(set_role);
     STMT(get_role);
     STMT(get_guild_roles);
@@ -339,6 +436,8 @@ private:
     STMT(sub_reaction);
     STMT(get_reactions);
     STMT(get_chan_ids_parent);
+    STMT(set_backfill);
+    STMT(get_backfill);
     STMT(get_guild_member_ids);
     STMT(clr_role);
     STMT(get_guild_owner);
@@ -132,24 +132,53 @@ std::string UserData::GetUsername() const {
 
 std::string UserData::GetUsernameEscaped() const {
     if (IsPomelo()) {
-        return Glib::Markup::escape_text(Username);
+        return Glib::Markup::escape_text(Username.str());
     }
 
-    return Glib::Markup::escape_text(Username) + "#" + Discriminator;
+    return Glib::Markup::escape_text(Username.str()) + "#" + Discriminator.str();
 }
 
 std::string UserData::GetUsernameEscapedBold() const {
     if (IsPomelo()) {
-        return "<b>" + Glib::Markup::escape_text(Username) + "</b>";
+        return "<b>" + Glib::Markup::escape_text(Username.str()) + "</b>";
     }
-    return "<b>" + Glib::Markup::escape_text(Username) + "</b>#" + Discriminator;
+    return "<b>" + Glib::Markup::escape_text(Username.str()) + "</b>#" + Discriminator.str();
 }
 
 std::string UserData::GetUsernameEscapedBoldAt() const {
     if (IsPomelo()) {
-        return "<b>@" + Glib::Markup::escape_text(Username) + "</b>";
+        return "<b>@" + Glib::Markup::escape_text(Username.str()) + "</b>";
     }
-    return "<b>@" + Glib::Markup::escape_text(Username) + "</b>#" + Discriminator;
+    return "<b>@" + Glib::Markup::escape_text(Username.str()) + "</b>#" + Discriminator.str();
+}
+
+void from_json(const nlohmann::json &j, UserData::AccountData &m) {
+    JS_O("locale", m.Locale);
+    JS_O("verified", m.IsVerified);
+    JS_O("email", m.Email);
+    JS_O("desktop", m.IsDesktop);
+    JS_O("mobile", m.IsMobile);
+    JS_ON("nsfw_allowed", m.IsNSFWAllowed);
+    JS_ON("phone", m.Phone);
+    JS_ON("bio", m.Bio);
+    JS_ON("banner", m.BannerHash);
+}
+
+void to_json(nlohmann::json &j, const UserData::AccountData &m) {
+    JS_IF("locale", m.Locale);
+    JS_IF("verified", m.IsVerified);
+    JS_IF("email", m.Email);
+    JS_IF("desktop", m.IsDesktop);
+    JS_IF("mobile", m.IsMobile);
+    JS_IF("nsfw_allowed", m.IsNSFWAllowed);
+    JS_IF("phone", m.Phone);
+}
+
+static bool HasAccountFields(const nlohmann::json &j) {
+    for (const auto *key : { "locale", "verified", "email", "desktop", "mobile", "nsfw_allowed", "phone", "bio", "banner" }) {
+        if (j.contains(key)) return true;
+    }
+    return false;
 }
 
 void from_json(const nlohmann::json &j, UserData &m) {
@@ -160,19 +189,14 @@ void from_json(const nlohmann::json &j, UserData &m) {
     JS_O("bot", m.IsBot);
     JS_O("system", m.IsSystem);
     JS_O("mfa_enabled", m.IsMFAEnabled);
-    JS_O("locale", m.Locale);
-    JS_O("verified", m.IsVerified);
-    JS_O("email", m.Email);
     JS_O("flags", m.Flags);
     JS_ON("premium_type", m.PremiumType);
     JS_O("public_flags", m.PublicFlags);
-    JS_O("desktop", m.IsDesktop);
-    JS_O("mobile", m.IsMobile);
-    JS_ON("nsfw_allowed", m.IsNSFWAllowed);
-    JS_ON("phone", m.Phone);
-    JS_ON("bio", m.Bio);
-    JS_ON("banner", m.BannerHash);
     JS_ON("global_name", m.GlobalName);
+    if (HasAccountFields(j))
+        m.Account = std::make_shared<UserData::AccountData>(j.get<UserData::AccountData>());
+    else
+        m.Account = nullptr;
 }
 
 void to_json(nlohmann::json &j, const UserData &m) {
@@ -186,17 +210,12 @@ void to_json(nlohmann::json &j, const UserData &m) {
     JS_IF("bot", m.IsBot);
     JS_IF("system", m.IsSystem);
     JS_IF("mfa_enabled", m.IsMFAEnabled);
-    JS_IF("locale", m.Locale);
-    JS_IF("verified", m.IsVerified);
-    JS_IF("email", m.Email);
     JS_IF("flags", m.Flags);
     JS_IF("premium_type", m.PremiumType);
     JS_IF("public_flags", m.PublicFlags);
-    JS_IF("desktop", m.IsDesktop);
-    JS_IF("mobile", m.IsMobile);
-    JS_IF("nsfw_allowed", m.IsNSFWAllowed);
-    JS_IF("phone", m.Phone);
     JS_IF("global_name", m.GlobalName);
+    if (m.Account != nullptr)
+        j.update(nlohmann::json(*m.Account));
 }
 
 void UserData::update_from_json(const nlohmann::json &j) {
@@ -206,17 +225,22 @@ void UserData::update_from_json(const nlohmann::json &j) {
     JS_RD("bot", IsBot);
     JS_RD("system", IsSystem);
     JS_RD("mfa_enabled", IsMFAEnabled);
-    JS_RD("locale", Locale);
-    JS_RD("verified", IsVerified);
-    JS_RD("email", Email);
     JS_RD("flags", Flags);
     JS_RD("premium_type", PremiumType);
     JS_RD("public_flags", PublicFlags);
-    JS_RD("desktop", IsDesktop);
-    JS_RD("mobile", IsMobile);
-    JS_RD("nsfw_allowed", IsNSFWAllowed);
-    JS_RD("phone", Phone);
     JS_RD("global_name", GlobalName);
+    if (HasAccountFields(j)) {
+        // copies of this user share the old one
+        auto account = Account != nullptr ? std::make_shared<AccountData>(*Account) : std::make_shared<AccountData>();
+        JS_RD("locale", account->Locale);
+        JS_RD("verified", account->IsVerified);
+        JS_RD("email", account->Email);
+        JS_RD("desktop", account->IsDesktop);
+        JS_RD("mobile", account->IsMobile);
+        JS_RD("nsfw_allowed", account->IsNSFWAllowed);
+        JS_RD("phone", account->Phone);
+        Account = std::move(account);
+    }
 }
 
 const char *UserData::GetFlagName(uint64_t flag) {
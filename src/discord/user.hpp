@@ -1,6 +1,8 @@
 #pragma once
 #include "snowflake.hpp"
 #include "json.hpp"
+#include "internedstring.hpp"
+#include <memory>
 #include <string>
 
 enum class EPremiumType {
@@ -40,29 +42,35 @@ struct UserData {
     static const char *GetFlagName(uint64_t flag);
     static const char *GetFlagReadableName(uint64_t flag);
 
+    // only sent for the logged in user or in profiles. kept out of line so the copies of everyone else
+    // in messages, mentions and member lists stay small
+    struct AccountData {
+        std::optional<std::string> Locale;
+        std::optional<bool> IsVerified;
+        std::optional<std::string> Email; // null
+
+        // undocumented (opt)
+        std::optional<bool> IsDesktop;
+        std::optional<bool> IsMobile;
+        std::optional<bool> IsNSFWAllowed; // null
+        std::optional<std::string> Phone;  // null?
+        // for now (unserialized)
+        std::optional<std::string> BannerHash; // null
+        std::optional<std::string> Bio;        // null
+    };
+
     Snowflake ID;
-    std::string Username;
-    std::string Discriminator;
-    std::string Avatar; // null
-    std::optional<std::string> GlobalName;
+    InternedString Username;
+    InternedString Discriminator;
+    InternedString Avatar; // null
+    std::optional<InternedString> GlobalName;
     std::optional<bool> IsBot;
     std::optional<bool> IsSystem;
     std::optional<bool> IsMFAEnabled;
-    std::optional<std::string> Locale;
-    std::optional<bool> IsVerified;
-    std::optional<std::string> Email; // null
     std::optional<uint64_t> Flags;
     std::optional<EPremiumType> PremiumType; // null
     std::optional<uint64_t> PublicFlags;
-
-    // undocumented (opt)
-    std::optional<bool> IsDesktop;
-    std::optional<bool> IsMobile;
-    std::optional<bool> IsNSFWAllowed; // null
-    std::optional<std::string> Phone;  // null?
-    // for now (unserialized)
-    std::optional<std::string> BannerHash; // null
-    std::optional<std::string> Bio;        // null
+    std::shared_ptr<const AccountData> Account; // null if none of it was sent
 
     friend void from_json(const nlohmann::json &j, UserData &m);
     friend void to_json(nlohmann::json &j, const UserData &m);
@@ -8,8 +8,6 @@
 #include <spdlog/fmt/bin_to_hex.h>
 #include "abaddon.hpp"
 #include "audio/manager.hpp"
-#include <dave/dave_interfaces.h>
-#include <dave/array_view.h>
 
 #ifdef _WIN32
     #define S_ADDR(var) (var).sin_addr.S_un.S_addr
@@ -172,25 +170,14 @@ DiscordVoiceClient::DiscordVoiceClient()
     Glib::signal_idle().connect_once([this]() {
         auto &audio = Abaddon::Get().GetAudio();
         audio.SetOpusBuffer(m_opus_buffer.data());
-        audio.signal_opus_packet().connect([this](int payload_size) {
+        m_opus_packet_conn = audio.signal_opus_packet().connect([this](int payload_size) {
             if (!IsConnected()) return;
 
-            if (m_dave && m_dave->IsEnabled()) {
-                auto *enc = m_dave->GetEncryptor();
-                if (!enc) return;
-                auto max_size = enc->GetMaxCiphertextByteSize(discord::dave::MediaType::Audio, payload_size);
-                std::vector<uint8_t> dave_encrypted(max_size);
-                size_t bytes_written = 0;
-                auto result = enc->Encrypt(
-                    discord::dave::MediaType::Audio,
-                    m_ssrc,
-                    discord::dave::MakeArrayView(const_cast<const uint8_t *>(m_opus_buffer.data()), static_cast<size_t>(payload_size)),
-                    discord::dave::MakeArrayView(dave_encrypted.data(), dave_encrypted.size()),
-                    &bytes_written);
-                if (result == discord::dave::IEncryptor::Success) {
-                    m_udp.SendEncrypted(dave_encrypted.data(), bytes_written);
-                } else {
-                    m_log->warn("DAVE encrypt failed: result={}", static_cast<int>(result));
+            // capture thread
+            const auto dave = std::atomic_load(&m_dave_media);
+            if (dave && dave->IsEnabled()) {
+                if (dave->Encrypt(m_ssrc, m_opus_buffer.data(), static_cast<size_t>(payload_size), m_dave_encrypted)) {
+                    m_udp.SendEncrypted(m_dave_encrypted.data(), m_dave_encrypted.size());
                 }
             } else {
                 m_udp.SendEncrypted(m_opus_buffer.data(), payload_size);
@@ -201,6 +188,7 @@ DiscordVoiceClient::DiscordVoiceClient()
 
 DiscordVoiceClient::~DiscordVoiceClient() {
     if (IsConnected() || IsConnecting()) Stop();
+    m_opus_packet_conn.disconnect();
 }
 
 void DiscordVoiceClient::Start() {
@@ -212,10 +200,12 @@ void DiscordVoiceClient::Start() {
     m_ssrc_map.clear();
     m_ssrc_user_map.clear();
     m_connected_users.clear();
-    m_dave.reset();
+    ResetDaveSession();
     m_heartbeat_waiter.revive();
     m_keepalive_waiter.revive();
-    m_ws.StartConnection("wss://" + m_endpoint + "/?v=9");
+    // discord only gives a host. anything with a scheme, like a local test gateway, is used as is
+    const auto url = m_endpoint.find("://") == std::string::npos ? "wss://" + m_endpoint : m_endpoint;
+    m_ws.StartConnection(url + "/?v=9");
 
     m_signal_connected.emit();
 }
@@ -238,7 +228,7 @@ void DiscordVoiceClient::Stop() {
     m_ssrc_map.clear();
     m_ssrc_user_map.clear();
     m_connected_users.clear();
-    m_dave.reset();
+    ResetDaveSession();
 
     m_signal_disconnected.emit();
 }
@@ -296,6 +286,16 @@ bool DiscordVoiceClient::IsConnecting() const noexcept {
     return m_state == State::ConnectingToWebsocket || m_state == State::EstablishingConnection;
 }
 
+bool DiscordVoiceClient::IsDaveEnabled() const {
+    const auto dave = std::atomic_load(&m_dave_media);
+    return dave && dave->IsEnabled();
+}
+
+std::map<std::string, DaveSession::OperationStats> DiscordVoiceClient::GetDaveOperationStats() const {
+    if (!m_dave) return {};
+    return m_dave->GetOperationStats();
+}
+
 void DiscordVoiceClient::OnGatewayMessage(const std::string &str) {
     m_log->trace("IN: {}", str);
     auto j = nlohmann::json::parse(str);
@@ -433,7 +433,7 @@ void DiscordVoiceClient::HandleGatewaySpeaking(const VoiceGatewayMessage &m) {
         m_connected_users.insert(uid_str);
         if (m_dave) {
             m_dave->AddConnectedUser(uid_str);
-            m_dave->ApplyKeyRatchetForSSRC(d.SSRC, d.UserID);
+            m_dave->SetSSRCUser(d.SSRC, d.UserID);
         }
     }
 
@@ -596,7 +596,8 @@ void DiscordVoiceClient::OnUDPData(std::vector<uint8_t> data) {
 
     static const uint8_t OPUS_SILENCE[] = { 0xF8, 0xFF, 0xFE };
 
-    if (m_dave) {
+    // udp thread
+    if (const auto dave = std::atomic_load(&m_dave_media)) {
         // silence packets bypass DAVE per spec
         if (payload_size == sizeof(OPUS_SILENCE) &&
             std::memcmp(payload_start, OPUS_SILENCE, sizeof(OPUS_SILENCE)) == 0) {
@@ -604,26 +605,12 @@ void DiscordVoiceClient::OnUDPData(std::vector<uint8_t> data) {
             return;
         }
 
-        if (m_dave->IsEnabled()) {
-            Snowflake uid;
-            if (auto it = m_ssrc_user_map.find(ssrc); it != m_ssrc_user_map.end())
-                uid = it->second;
-
-            auto *dec = m_dave->GetOrCreateDecryptor(ssrc, uid);
-            auto max_size = dec->GetMaxPlaintextByteSize(discord::dave::MediaType::Audio, payload_size);
-            std::vector<uint8_t> plaintext(max_size);
-            size_t bytes_written = 0;
-            auto result = dec->Decrypt(
-                discord::dave::MediaType::Audio,
-                discord::dave::MakeArrayView(payload_start, payload_size),
-                discord::dave::MakeArrayView(plaintext.data(), plaintext.size()),
-                &bytes_written);
-
-            if (result == discord::dave::IDecryptor::Success) {
-                Abaddon::Get().GetAudio().FeedMeOpus(ssrc, { plaintext.data(), plaintext.data() + bytes_written });
+        if (dave->IsEnabled()) {
+            if (dave->Decrypt(ssrc, payload_start, payload_size, m_dave_decrypted)) {
+                Abaddon::Get().GetAudio().FeedMeOpus(ssrc, m_dave_decrypted);
             }
             return;
-        } else if (m_dave->IsDowngraded()) {
+        } else if (dave->IsDowngraded()) {
             // passthrough
         } else {
             // DAVE session exists but not yet enabled, drop
@@ -759,8 +746,10 @@ void DiscordVoiceClient::HandleGatewaySessionUpdate(const VoiceGatewayMessage &m
         m_ssrc_user_map[audio_ssrc] = uid;
     }
 
-    if (m_dave)
+    if (m_dave) {
         m_dave->AddConnectedUser(uid_str);
+        if (audio_ssrc != 0) m_dave->SetSSRCUser(audio_ssrc, uid);
+    }
 }
 
 void DiscordVoiceClient::HandleGatewayClientDisconnect(const VoiceGatewayMessage &m) {
@@ -787,11 +776,13 @@ void DiscordVoiceClient::EnsureDaveSession(uint16_t protocolVersion) {
 
     m_log->info("Creating DAVE session, protocol version={}", protocolVersion);
 
-    m_dave = std::make_unique<DaveSession>(m_channel_id, m_user_id, m_ssrc_user_map);
+    m_dave = std::make_unique<DaveSession>(m_channel_id, m_user_id);
     m_dave->SetLocalSSRC(m_ssrc);
 
     for (const auto &uid : m_connected_users)
         m_dave->AddConnectedUser(uid);
+    for (const auto &[ssrc, uid] : m_ssrc_user_map)
+        m_dave->SetSSRCUser(ssrc, uid);
 
     m_dave->signal_send_binary().connect(
         sigc::mem_fun(*this, &DiscordVoiceClient::SendBinaryPayload));
@@ -807,6 +798,13 @@ void DiscordVoiceClient::EnsureDaveSession(uint16_t protocolVersion) {
     });
 
     m_dave->Init(protocolVersion);
+    std::atomic_store(&m_dave_media, m_dave->GetMedia());
+}
+
+void DiscordVoiceClient::ResetDaveSession() {
+    // media threads can keep using their copy until they notice
+    std::atomic_store(&m_dave_media, std::shared_ptr<DaveMedia> {});
+    m_dave.reset();
 }
 
 DiscordVoiceClient::type_signal_disconnected DiscordVoiceClient::signal_connected() {
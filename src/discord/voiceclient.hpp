@@ -6,6 +6,7 @@
 #include "waiter.hpp"
 #include "websocket.hpp"
 #include "dave.hpp"
+#include <map>
 #include <mutex>
 #include <optional>
 #include <queue>
@@ -226,6 +227,11 @@ public:
     [[nodiscard]] bool IsConnected() const noexcept;
     [[nodiscard]] bool IsConnecting() const noexcept;
 
+    // media is end to end encrypted right now
+    [[nodiscard]] bool IsDaveEnabled() const;
+    // empty without a DAVE session
+    [[nodiscard]] std::map<std::string, DaveSession::OperationStats> GetDaveOperationStats() const;
+
     enum class State {
         ConnectingToWebsocket,
         EstablishingConnection,
@@ -263,6 +269,7 @@ private:
     void SendDaveReadyForTransition(int transitionId);
     void SendDaveInvalidCommitWelcome(int transitionId);
     void EnsureDaveSession(uint16_t protocolVersion);
+    void ResetDaveSession();
 
     void HeartbeatThread();
     void KeepaliveThread();
@@ -309,10 +316,14 @@ private:
     void OnDispatch();
 
     std::unique_ptr<DaveSession> m_dave;
+    std::shared_ptr<DaveMedia> m_dave_media; // atomic, read from the capture and udp threads
+    std::vector<uint8_t> m_dave_encrypted;   // capture thread
+    std::vector<uint8_t> m_dave_decrypted;   // udp thread
     std::unordered_map<uint32_t, Snowflake> m_ssrc_user_map;
     std::set<std::string> m_connected_users;
 
     std::array<uint8_t, 1275> m_opus_buffer;
+    sigc::connection m_opus_packet_conn; // the audio manager outlives us
 
     std::shared_ptr<spdlog::logger> m_log;
 
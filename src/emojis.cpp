@@ -1,9 +1,17 @@
 #include "emojis.hpp"
 
+#include <algorithm>
+#include <filesystem>
 #include <sstream>
 #include <utility>
 
 #include <gdkmm/pixbufloader.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include "util.hpp"
+
+constexpr static size_t WarmUpCount = 64;
 
 EmojiResource::EmojiResource(std::string filepath)
     : m_filepath(std::move(filepath)) {}
@@ -28,14 +36,68 @@ bool EmojiResource::Load() {
     }
     sqlite3_finalize(stmt);
 
-    std::sort(m_patterns.begin(), m_patterns.end(), [](const Glib::ustring &a, const Glib::ustring &b) {
-        return a.size() > b.size();
-    });
+    // only emojis that actually have an image can be replaced
+    m_trie_edges.clear();
+    m_trie_terminal.assign(1, false);
+    if (sqlite3_prepare_v2(m_db, "SELECT emoji FROM emoji_data", -1, &stmt, nullptr) != SQLITE_OK) return false;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        AddPattern(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
+    }
+    sqlite3_finalize(stmt);
 
     return true;
 }
 
+void EmojiResource::AddPattern(const Glib::ustring &pattern) {
+    if (pattern.empty()) return;
+
+    uint32_t node = 0;
+    for (const gunichar c : pattern) {
+        const uint64_t key = (static_cast<uint64_t>(node) << 21) | c;
+        if (const auto it = m_trie_edges.find(key); it != m_trie_edges.end()) {
+            node = it->second;
+        } else {
+            const auto next = static_cast<uint32_t>(m_trie_terminal.size());
+            m_trie_edges.emplace(key, next);
+            m_trie_terminal.push_back(false);
+            node = next;
+        }
+    }
+    m_trie_terminal[node] = true;
+}
+
+std::vector<EmojiResource::EmojiMatch> EmojiResource::FindPatterns(const Glib::ustring &text) const {
+    std::vector<EmojiMatch> matches;
+    if (m_trie_edges.empty()) return matches;
+
+    const std::vector<gunichar> chars(text.begin(), text.end());
+    size_t pos = 0;
+    while (pos < chars.size()) {
+        uint32_t node = 0;
+        size_t longest = 0;
+        for (size_t i = pos; i < chars.size(); i++) {
+            const auto it = m_trie_edges.find((static_cast<uint64_t>(node) << 21) | chars[i]);
+            if (it == m_trie_edges.end()) break;
+            node = it->second;
+            if (m_trie_terminal[node]) longest = i - pos + 1;
+        }
+
+        if (longest > 0) {
+            Glib::ustring pattern;
+            for (size_t i = pos; i < pos + longest; i++)
+                pattern += chars[i];
+            matches.push_back({ static_cast<int>(pos), static_cast<int>(longest), std::move(pattern) });
+            pos += longest;
+        } else {
+            pos++;
+        }
+    }
+
+    return matches;
+}
+
 Glib::RefPtr<Gdk::Pixbuf> EmojiResource::GetPixBuf(const Glib::ustring &pattern) {
+    m_stats.Decodes++;
     if (sqlite3_reset(m_get_emoji_stmt) != SQLITE_OK) return {};
     if (sqlite3_bind_text(m_get_emoji_stmt, 1, pattern.c_str(), -1, nullptr) != SQLITE_OK) return {};
     if (sqlite3_step(m_get_emoji_stmt) != SQLITE_ROW) return {};
@@ -49,41 +111,128 @@ Glib::RefPtr<Gdk::Pixbuf> EmojiResource::GetPixBuf(const Glib::ustring &pattern)
     return {};
 }
 
-void EmojiResource::ReplaceEmojis(Glib::RefPtr<Gtk::TextBuffer> buf, int size) {
-    auto get_text = [&]() -> auto {
-        Gtk::TextBuffer::iterator a, b;
-        buf->get_bounds(a, b);
-        return buf->get_slice(a, b, true);
-    };
-    auto text = get_text();
-
-    int searchpos;
-    for (const auto &pattern : m_patterns) {
-        searchpos = 0;
-        Glib::RefPtr<Gdk::Pixbuf> pixbuf;
-        while (true) {
-            size_t r = text.find(pattern, searchpos);
-            if (r == Glib::ustring::npos) break;
-            if (!pixbuf) {
-                pixbuf = GetPixBuf(pattern);
-                if (pixbuf)
-                    pixbuf = pixbuf->scale_simple(size, size, Gdk::INTERP_BILINEAR);
-                else
-                    break;
-            }
-            searchpos = static_cast<int>(r + pattern.size());
-
-            const auto start_it = buf->get_iter_at_offset(static_cast<int>(r));
-            const auto end_it = buf->get_iter_at_offset(static_cast<int>(r + pattern.size()));
-
-            auto it = buf->erase(start_it, end_it);
-            buf->insert_pixbuf(it, pixbuf);
-
-            int alen = static_cast<int>(text.size());
-            text = get_text();
-            int blen = static_cast<int>(text.size());
-            searchpos -= (alen - blen);
+Glib::RefPtr<Gdk::Pixbuf> EmojiResource::GetPixBuf(const Glib::ustring &pattern, int size) {
+    auto key = MakeCacheKey(pattern, size);
+    if (auto it = m_cache.find(key); it != m_cache.end()) {
+        m_stats.Hits++;
+        it->second.Uses++;
+        m_cache_lru.splice(m_cache_lru.begin(), m_cache_lru, it->second.LRU);
+        return it->second.Pixbuf;
+    }
+
+    m_stats.Misses++;
+    auto pixbuf = GetPixBuf(pattern);
+    if (!pixbuf) return {};
+    pixbuf = pixbuf->scale_simple(size, size, Gdk::INTERP_BILINEAR);
+
+    const auto bytes = static_cast<size_t>(pixbuf->get_rowstride()) * pixbuf->get_height();
+    m_cache_lru.push_front(key);
+    m_cache.emplace(std::move(key), CacheEntry { pixbuf, bytes, 1, m_cache_lru.begin() });
+    m_stats.Bytes += bytes;
+    m_stats.Entries = m_cache.size();
+    EvictCache();
+
+    return pixbuf;
+}
+
+std::string EmojiResource::MakeCacheKey(const Glib::ustring &pattern, int size) {
+    return std::to_string(size) + ":" + pattern;
+}
+
+void EmojiResource::EvictCache() {
+    // always keep the one that was just added
+    while (m_stats.Bytes > m_cache_budget && m_cache_lru.size() > 1) {
+        const auto it = m_cache.find(m_cache_lru.back());
+        m_stats.Bytes -= it->second.Bytes;
+        m_cache.erase(it);
+        m_cache_lru.pop_back();
+    }
+    m_stats.Entries = m_cache.size();
+}
+
+void EmojiResource::SetCacheBudget(size_t bytes) {
+    m_cache_budget = bytes;
+    EvictCache();
+}
+
+const EmojiResource::CacheStats &EmojiResource::GetCacheStats() const noexcept {
+    return m_stats;
+}
+
+void EmojiResource::WarmUp(const std::string &path) {
+    const auto data = ReadWholeFile(path);
+    if (data.empty()) return;
+
+    try {
+        const auto j = nlohmann::json::parse(data.begin(), data.end());
+        for (const auto &entry : j) {
+            GetPixBuf(entry.at("pattern").get<std::string>(), entry.at("size").get<int>());
         }
+    } catch (const std::exception &e) {
+        spdlog::get("ui")->warn("Failed to load emoji warm up list: {}", e.what());
+    }
+
+    // dont count these against the session
+    m_stats.Hits = 0;
+    m_stats.Misses = 0;
+    m_stats.Decodes = 0;
+}
+
+void EmojiResource::SaveWarmUp(const std::string &path) const {
+    spdlog::get("ui")->debug("Emoji cache: {} hits, {} misses, {} decodes, {} entries, {} KiB",
+                             m_stats.Hits, m_stats.Misses, m_stats.Decodes, m_stats.Entries, m_stats.Bytes / 1024);
+
+    std::vector<const std::pair<const std::string, CacheEntry> *> entries;
+    for (const auto &entry : m_cache)
+        entries.push_back(&entry);
+    const auto count = std::min(entries.size(), WarmUpCount);
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end(), [](const auto *a, const auto *b) {
+        return a->second.Uses > b->second.Uses;
+    });
+
+    nlohmann::json j = nlohmann::json::array();
+    for (size_t i = 0; i < count; i++) {
+        const auto &key = entries[i]->first;
+        const auto colon = key.find(':');
+        j.push_back({ { "pattern", key.substr(colon + 1) },
+                      { "size", std::stoi(key.substr(0, colon)) } });
+    }
+
+    // the state cache might not exist yet if nothing else has been saved there
+    const auto dir = std::filesystem::path(path).parent_path();
+    if (!dir.empty() && !util::IsFolder(dir.string())) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec) {
+            spdlog::get("ui")->warn("Not saving emoji warm up, couldn't create {}: {}", dir.string(), ec.message());
+            return;
+        }
+    }
+
+    auto *fp = std::fopen(path.c_str(), "wb");
+    if (fp == nullptr) {
+        spdlog::get("ui")->warn("Not saving emoji warm up, couldn't open {}", path);
+        return;
+    }
+    const auto s = j.dump();
+    std::fwrite(s.c_str(), 1, s.size(), fp);
+    std::fclose(fp);
+}
+
+void EmojiResource::ReplaceEmojis(Glib::RefPtr<Gtk::TextBuffer> buf, int size, int offset) {
+    // hidden chars are included so offsets line up with anything already inserted into the buffer
+    const auto matches = FindPatterns(buf->get_slice(buf->get_iter_at_offset(offset), buf->end(), true));
+    if (matches.empty()) return;
+
+    // back to front so earlier offsets stay valid
+    for (auto it = matches.rbegin(); it != matches.rend(); it++) {
+        const auto pixbuf = GetPixBuf(it->Pattern, size);
+        if (!pixbuf) continue;
+
+        const auto start_it = buf->get_iter_at_offset(offset + it->Offset);
+        const auto end_it = buf->get_iter_at_offset(offset + it->Offset + it->Length);
+        auto pos = buf->erase(start_it, end_it);
+        buf->insert_pixbuf(pos, pixbuf);
     }
 }
 
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <cstdio>
+#include <list>
 #include <unordered_map>
 #include <vector>
 
@@ -16,16 +17,66 @@ public:
     ~EmojiResource();
 
     bool Load();
+    // decodes straight from the db every time, prefer the sized overload
     Glib::RefPtr<Gdk::Pixbuf> GetPixBuf(const Glib::ustring &pattern);
+    // scaled to size x size and cached
+    Glib::RefPtr<Gdk::Pixbuf> GetPixBuf(const Glib::ustring &pattern, int size);
     const std::map<std::string, std::string> &GetShortCodes() const;
-    void ReplaceEmojis(Glib::RefPtr<Gtk::TextBuffer> buf, int size = 24);
+    // only looks at text from offset onwards
+    void ReplaceEmojis(Glib::RefPtr<Gtk::TextBuffer> buf, int size = 24, int offset = 0);
     std::string GetShortCodeForPattern(const Glib::ustring &pattern);
 
+    struct CacheStats {
+        uint64_t Hits = 0;
+        uint64_t Misses = 0;
+        uint64_t Decodes = 0;
+        size_t Entries = 0;
+        size_t Bytes = 0;
+    };
+
+    // the cache and its stats are main thread only
+    void SetCacheBudget(size_t bytes);
+    [[nodiscard]] const CacheStats &GetCacheStats() const noexcept;
+
+    // decodes whatever was used the most last time so it doesnt have to happen while scrolling
+    void WarmUp(const std::string &path);
+    void SaveWarmUp(const std::string &path) const;
+
+    struct EmojiMatch {
+        int Offset; // in characters
+        int Length;
+        Glib::ustring Pattern;
+    };
+
+    // leftmost longest matches in a single pass over the text
+    std::vector<EmojiMatch> FindPatterns(const Glib::ustring &text) const;
+
 private:
+    void AddPattern(const Glib::ustring &pattern);
+
     std::unordered_map<std::string, std::vector<std::string>> m_pattern_shortcode_index;
     std::map<std::string, std::string> m_shortcode_index; // shortcode -> pattern
     std::string m_filepath;
-    std::vector<Glib::ustring> m_patterns;
+
+    // trie over the code points of every emoji in the db. node 0 is the root
+    // edges are keyed by (node << 21) | code point since code points fit in 21 bits
+    std::unordered_map<uint64_t, uint32_t> m_trie_edges;
+    std::vector<bool> m_trie_terminal;
+
+    struct CacheEntry {
+        Glib::RefPtr<Gdk::Pixbuf> Pixbuf;
+        size_t Bytes;
+        uint64_t Uses;
+        std::list<std::string>::iterator LRU;
+    };
+
+    static std::string MakeCacheKey(const Glib::ustring &pattern, int size);
+    void EvictCache();
+
+    std::unordered_map<std::string, CacheEntry> m_cache; // "size:pattern"
+    std::list<std::string> m_cache_lru;                   // most recently used at the front
+    size_t m_cache_budget = 4 * 1024 * 1024;
+    CacheStats m_stats;
 
     sqlite3 *m_db = nullptr;
     sqlite3_stmt *m_get_emoji_stmt = nullptr;
@@ -1,14 +1,28 @@
 #include "imgmanager.hpp"
 
+#include <algorithm>
 #include <utility>
 
 #include <gdkmm/pixbufloader.h>
+#include <glibmm/main.h>
+#include <spdlog/spdlog.h>
 
 #include "abaddon.hpp"
+#include "trace.hpp"
 #include "util.hpp"
 
+constexpr static size_t MaxAnimationFrames = 1000;
+constexpr static int MinFrameDelay = 20;                            // ms, same clamp browsers use
+constexpr static auto AnimationFramesIdle = std::chrono::seconds(30); // drop frames nothing has asked for in this long
+constexpr static unsigned TrimInterval = 10;                       // seconds
+
+static std::string MakeAnimationKey(const std::string &url, int w, int h) {
+    return std::to_string(w) + ":" + std::to_string(h) + ":" + url;
+}
+
 ImageManager::ImageManager() {
     m_cb_dispatcher.connect(sigc::mem_fun(*this, &ImageManager::RunCallbacks));
+    m_trim_timer = Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &ImageManager::TrimAnimations), TrimInterval, Glib::PRIORITY_LOW);
 }
 
 void ImageManager::ClearCache() {
@@ -16,7 +30,8 @@ void ImageManager::ClearCache() {
 }
 
 Glib::RefPtr<Gdk::Pixbuf> ImageManager::ReadFileToPixbuf(std::string path) {
-    const auto &data = ReadWholeFile(std::move(path));
+    TRACE_ZONE("image decode", path);
+    const auto &data = ReadWholeFile(path);
     if (data.empty()) return Glib::RefPtr<Gdk::Pixbuf>(nullptr);
     auto loader = Gdk::PixbufLoader::create();
     loader->signal_size_prepared().connect([&loader](int w, int h) {
@@ -30,7 +45,8 @@ Glib::RefPtr<Gdk::Pixbuf> ImageManager::ReadFileToPixbuf(std::string path) {
 }
 
 Glib::RefPtr<Gdk::PixbufAnimation> ImageManager::ReadFileToPixbufAnimation(std::string path, int w, int h) {
-    const auto &data = ReadWholeFile(std::move(path));
+    TRACE_ZONE("animation decode", path);
+    const auto &data = ReadWholeFile(path);
     if (data.empty()) return Glib::RefPtr<Gdk::PixbufAnimation>(nullptr);
     auto loader = Gdk::PixbufLoader::create();
     loader->signal_size_prepared().connect([&loader, w, h](int, int) {
@@ -62,34 +78,216 @@ void ImageManager::LoadFromURL(const std::string &url, const callback_type &cb)
 }
 
 void ImageManager::LoadAnimationFromURL(const std::string &url, int w, int h, const callback_anim_type &cb) {
-    sigc::signal<void(Glib::RefPtr<Gdk::PixbufAnimation>)> signal;
-    signal.connect(cb);
-    m_cache.GetFileFromURL(url, [this, url, signal, w, h](const std::string &path) {
+    const auto key = MakeAnimationKey(url, w, h);
+    auto &entry = m_animations[key];
+    if (entry.Anim) {
+        QueueCallback([cb, anim = entry.Anim]() { cb(anim); });
+        return;
+    }
+
+    entry.Callbacks.push_back(cb);
+    if (entry.Callbacks.size() > 1) return; // already loading
+
+    entry.URL = url;
+    entry.Width = w;
+    entry.Height = h;
+    m_cache.GetFileFromURL(url, [this, key, url, w, h](const std::string &path) {
         try {
-            auto buf = ReadFileToPixbufAnimation(path, w, h);
-            if (!buf)
+            auto anim = ReadFileToPixbufAnimation(path, w, h);
+            if (!anim) {
                 printf("%s (%s) is null\n", url.c_str(), path.c_str());
-            else {
-                m_cb_mutex.lock();
-                m_cb_queue.push([signal, buf]() { signal.emit(buf); });
-                m_cb_dispatcher.emit();
-                m_cb_mutex.unlock();
+                QueueCallback([this, key]() { OnAnimationFailed(key); });
+                return;
             }
+            auto frames = DecodeFrames(anim);
+            QueueCallback([this, key, anim, frames]() { OnAnimationLoaded(key, anim, frames); });
         } catch (const std::exception &e) {
             fprintf(stderr, "err loading pixbuf animation from %s: %s\n", path.c_str(), e.what());
+            QueueCallback([this, key]() { OnAnimationFailed(key); });
+        }
+    });
+}
+
+std::shared_ptr<const AnimationFrames> ImageManager::GetAnimationFrames(const Glib::RefPtr<Gdk::PixbufAnimation> &anim) {
+    const auto key_it = m_animation_keys.find(anim->gobj());
+    if (key_it == m_animation_keys.end()) return nullptr;
+
+    auto &entry = m_animations.at(key_it->second);
+    entry.LastUsed = std::chrono::steady_clock::now();
+    if (entry.Frames) {
+        m_frames_lru.splice(m_frames_lru.begin(), m_frames_lru, entry.LRU);
+        return entry.Frames;
+    }
+
+    if (!entry.Decoding && !entry.TooLarge)
+        DecodeAnimationFrames(key_it->second);
+    return nullptr;
+}
+
+void ImageManager::SetAnimationCacheBudget(size_t bytes) {
+    m_frames_budget = bytes;
+    EvictAnimationFrames();
+}
+
+// runs on a worker, anim must not be shared with anything else yet
+std::shared_ptr<AnimationFrames> ImageManager::DecodeFrames(const Glib::RefPtr<Gdk::PixbufAnimation> &anim) {
+    TRACE_ZONE("animation frames decode");
+    auto frames = std::make_shared<AnimationFrames>();
+
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS // GTimeVal, but its what gdk-pixbuf takes
+    GTimeVal time { 0, 0 };
+    auto *iter = gdk_pixbuf_animation_get_iter(anim->gobj(), &time);
+    while (frames->Frames.size() < MaxAnimationFrames) {
+        // the iter reuses its pixbuf between frames
+        auto pixbuf = Glib::wrap(gdk_pixbuf_copy(gdk_pixbuf_animation_iter_get_pixbuf(iter)));
+        const int delay = gdk_pixbuf_animation_iter_get_delay_time(iter);
+        // there is no frame count, but on a fully loaded animation the loaders say theyre on the "currently loading"
+        // frame once theyre on the last one. loaders that dont just run into MaxAnimationFrames
+        const bool last = gdk_pixbuf_animation_iter_on_currently_loading_frame(iter);
+
+        frames->Bytes += static_cast<size_t>(pixbuf->get_rowstride()) * pixbuf->get_height();
+
+        // -1 is a static image or the end of an animation that doesnt loop
+        if (delay < 0) {
+            frames->Frames.push_back({ pixbuf, 0 });
+            frames->Loops = false;
+            break;
+        }
+
+        frames->Frames.push_back({ pixbuf, std::max(delay, MinFrameDelay) });
+        frames->Duration += frames->Frames.back().Delay;
+        if (last) break;
+
+        // step by the real delay, stepping by the clamped one could jump over short frames including the last
+        time.tv_usec += std::max(delay, 1) * 1000;
+        time.tv_sec += time.tv_usec / 1000000;
+        time.tv_usec %= 1000000;
+        gdk_pixbuf_animation_iter_advance(iter, &time);
+    }
+    g_object_unref(iter);
+    G_GNUC_END_IGNORE_DEPRECATIONS
+
+    return frames;
+}
+
+void ImageManager::OnAnimationLoaded(const std::string &key, const Glib::RefPtr<Gdk::PixbufAnimation> &anim, const std::shared_ptr<AnimationFrames> &frames) {
+    auto it = m_animations.find(key);
+    if (it == m_animations.end()) return;
+
+    auto &entry = it->second;
+    entry.Anim = anim;
+    m_animation_keys[anim->gobj()] = key;
+    StoreAnimationFrames(key, frames);
+
+    const auto callbacks = std::move(entry.Callbacks);
+    entry.Callbacks.clear();
+    for (const auto &cb : callbacks)
+        cb(anim);
+}
+
+void ImageManager::OnAnimationFailed(const std::string &key) {
+    // so the next request tries again
+    if (auto it = m_animations.find(key); it != m_animations.end() && !it->second.Anim)
+        m_animations.erase(it);
+}
+
+void ImageManager::DecodeAnimationFrames(const std::string &key) {
+    auto &entry = m_animations.at(key);
+    entry.Decoding = true;
+    m_cache.GetFileFromURL(entry.URL, [this, key, w = entry.Width, h = entry.Height](const std::string &path) {
+        std::shared_ptr<AnimationFrames> frames;
+        try {
+            if (auto anim = ReadFileToPixbufAnimation(path, w, h))
+                frames = DecodeFrames(anim);
+        } catch (const std::exception &e) {
+            fprintf(stderr, "err decoding animation frames from %s: %s\n", path.c_str(), e.what());
         }
+        QueueCallback([this, key, frames]() {
+            if (m_animations.find(key) != m_animations.end())
+                StoreAnimationFrames(key, frames);
+        });
     });
 }
 
+void ImageManager::StoreAnimationFrames(const std::string &key, const std::shared_ptr<AnimationFrames> &frames) {
+    auto &entry = m_animations.at(key);
+    entry.Decoding = false;
+    if (!frames || entry.Frames) return;
+
+    if (frames->Bytes > m_frames_budget) {
+        spdlog::get("ui")->debug("Animation {} is too large to cache frames ({} bytes)", entry.URL, frames->Bytes);
+        entry.TooLarge = true;
+        return;
+    }
+
+    entry.Frames = frames;
+    entry.LastUsed = std::chrono::steady_clock::now();
+    m_frames_lru.push_front(key);
+    entry.LRU = m_frames_lru.begin();
+    m_frames_bytes += frames->Bytes;
+    EvictAnimationFrames();
+}
+
+void ImageManager::DropAnimationFrames(AnimationEntry &entry) {
+    m_frames_bytes -= entry.Frames->Bytes;
+    entry.Frames.reset();
+    m_frames_lru.erase(entry.LRU);
+}
+
+void ImageManager::EvictAnimationFrames() {
+    for (auto it = m_frames_lru.end(); it != m_frames_lru.begin() && m_frames_bytes > m_frames_budget;) {
+        auto &entry = m_animations.at(*--it);
+        if (entry.Frames.use_count() > 1) continue; // on screen
+        it++;
+        DropAnimationFrames(entry);
+    }
+}
+
+bool ImageManager::TrimAnimations() {
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = m_animations.begin(); it != m_animations.end();) {
+        auto &entry = it->second;
+        if (!entry.Anim || entry.Decoding) {
+            it++;
+            continue;
+        }
+
+        const bool shown = entry.Frames.use_count() > 1;
+        if (entry.Frames && !shown && now - entry.LastUsed > AnimationFramesIdle)
+            DropAnimationFrames(entry);
+
+        // nothing else holds the animation anymore
+        if (!shown && G_OBJECT(entry.Anim->gobj())->ref_count == 1) {
+            if (entry.Frames) DropAnimationFrames(entry);
+            m_animation_keys.erase(entry.Anim->gobj());
+            it = m_animations.erase(it);
+            continue;
+        }
+        it++;
+    }
+
+    return true;
+}
+
 void ImageManager::Prefetch(const std::string &url) {
     m_cache.GetFileFromURL(url, [](const auto &) {});
 }
 
+void ImageManager::QueueCallback(std::function<void()> cb) {
+    m_cb_mutex.lock();
+    m_cb_queue.push(std::move(cb));
+    m_cb_dispatcher.emit();
+    m_cb_mutex.unlock();
+}
+
 void ImageManager::RunCallbacks() {
+    // callbacks can load more images
     m_cb_mutex.lock();
-    m_cb_queue.front()();
+    auto cb = std::move(m_cb_queue.front());
     m_cb_queue.pop();
     m_cb_mutex.unlock();
+    TRACE_ZONE("image callback");
+    cb();
 }
 
 Glib::RefPtr<Gdk::Pixbuf> ImageManager::GetPlaceholder(int size) {
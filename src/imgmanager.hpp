@@ -1,9 +1,13 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
+#include <list>
+#include <memory>
 #include <queue>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <gdkmm/pixbuf.h>
 #include <gdkmm/pixbufanimation.h>
@@ -11,6 +15,19 @@
 
 #include "filecache.hpp"
 
+// every frame of an animation decoded up front so playing it back is just picking a pixbuf
+struct AnimationFrames {
+    struct Frame {
+        Glib::RefPtr<Gdk::Pixbuf> Pixbuf;
+        int Delay; // ms
+    };
+
+    std::vector<Frame> Frames;
+    int Duration = 0; // ms
+    bool Loops = true;
+    size_t Bytes = 0;
+};
+
 class ImageManager {
 public:
     ImageManager();
@@ -21,7 +38,13 @@ public:
     void ClearCache();
     void LoadFromURL(const std::string &url, const callback_type &cb);
     // animations need dimensions before loading since there is no (easy) way to scale a PixbufAnimation
+    // the same url and size always gives back the same animation object
     void LoadAnimationFromURL(const std::string &url, int w, int h, const callback_anim_type &cb);
+    // frames of an animation that came from LoadAnimationFromURL
+    // null if they aren't in memory right now, in which case they're decoded again in the background
+    // frames that are still referenced somewhere else count as on screen and are never evicted
+    std::shared_ptr<const AnimationFrames> GetAnimationFrames(const Glib::RefPtr<Gdk::PixbufAnimation> &anim);
+    void SetAnimationCacheBudget(size_t bytes);
     void Prefetch(const std::string &url);
     Glib::RefPtr<Gdk::Pixbuf> GetPlaceholder(int size);
     Cache &GetCache();
@@ -29,8 +52,38 @@ public:
 private:
     static Glib::RefPtr<Gdk::Pixbuf> ReadFileToPixbuf(std::string path);
     static Glib::RefPtr<Gdk::PixbufAnimation> ReadFileToPixbufAnimation(std::string path, int w, int h);
+    static std::shared_ptr<AnimationFrames> DecodeFrames(const Glib::RefPtr<Gdk::PixbufAnimation> &anim);
+
+    struct AnimationEntry {
+        std::string URL;
+        int Width;
+        int Height;
+        Glib::RefPtr<Gdk::PixbufAnimation> Anim;
+        std::vector<callback_anim_type> Callbacks; // waiting on the first load
+        std::shared_ptr<const AnimationFrames> Frames;
+        std::list<std::string>::iterator LRU;
+        std::chrono::steady_clock::time_point LastUsed;
+        bool Decoding = false;
+        bool TooLarge = false; // bigger than the whole budget, so it plays from Anim instead
+    };
+
+    void OnAnimationLoaded(const std::string &key, const Glib::RefPtr<Gdk::PixbufAnimation> &anim, const std::shared_ptr<AnimationFrames> &frames);
+    void OnAnimationFailed(const std::string &key);
+    void DecodeAnimationFrames(const std::string &key);
+    void StoreAnimationFrames(const std::string &key, const std::shared_ptr<AnimationFrames> &frames);
+    void DropAnimationFrames(AnimationEntry &entry);
+    void EvictAnimationFrames();
+    bool TrimAnimations();
+
+    std::unordered_map<std::string, AnimationEntry> m_animations; // "w:h:url"
+    std::unordered_map<GdkPixbufAnimation *, std::string> m_animation_keys;
+    std::list<std::string> m_frames_lru; // most recently used at the front
+    size_t m_frames_bytes = 0;
+    size_t m_frames_budget = 32 * 1024 * 1024;
+    sigc::connection m_trim_timer;
 
     mutable std::mutex m_load_mutex;
+    void QueueCallback(std::function<void()> cb);
     void RunCallbacks();
     Glib::Dispatcher m_cb_dispatcher;
     mutable std::mutex m_cb_mutex;
@@ -0,0 +1,48 @@
+#include "abaddon.hpp"
+#include "platform.hpp"
+#include <clocale>
+#include <cstdlib>
+#include <locale>
+#include <gtkmm.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+int main(int argc, char **argv) {
+    if (std::getenv("ABADDON_NO_FC") == nullptr) {
+        Platform::SetupFonts();
+    }
+
+    // windows doesnt have langinfo.h so some localization falls back to translation strings
+    // i dont like the default translation so this lets us use strftime
+
+#ifdef _WIN32
+    char *systemLocale = std::setlocale(LC_ALL, "");
+    try {
+        if (systemLocale != nullptr) {
+            std::locale::global(std::locale(systemLocale));
+        }
+    } catch (...) {
+        try {
+            std::locale::global(std::locale::classic());
+            if (systemLocale != nullptr) {
+                std::setlocale(LC_ALL, systemLocale);
+            }
+        } catch (...) {}
+    }
+#endif
+
+#if defined(_WIN32) && defined(_MSC_VER)
+    TCHAR buf[2] { 0 };
+    GetEnvironmentVariableA("GTK_CSD", buf, sizeof(buf));
+    if (buf[0] != '1')
+        SetEnvironmentVariableA("GTK_CSD", "0");
+#endif
+
+    Abaddon::InitLogging();
+
+    Gtk::Main::init_gtkmm_internals(); // why???
+
+    return Abaddon::Get().StartGTK();
+}
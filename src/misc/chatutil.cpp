@@ -1,57 +1,314 @@
 #include "chatutil.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <deque>
+
 #include "abaddon.hpp"
+#include "components/animatedimage.hpp"
 #include "constants.hpp"
 #include "util.hpp"
 
 namespace ChatUtil {
-Glib::ustring GetText(const Glib::RefPtr<Gtk::TextBuffer> &buf) {
-    Gtk::TextBuffer::iterator a, b;
-    buf->get_bounds(a, b);
-    auto slice = buf->get_slice(a, b, true);
-    return slice;
+constexpr static size_t TokenCacheSize = 1024;
+
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
 }
 
-void HandleRoleMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf) {
-    constexpr static const auto mentions_regex = R"(<@&(\d+)>)";
+// non-ascii bytes count as word characters so links ending in unicode aren't cut short
+static bool IsWordByte(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+}
 
-    static auto rgx = Glib::Regex::create(mentions_regex);
+static bool IsSpaceByte(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
 
-    Glib::ustring text = GetText(buf);
-    const auto &discord = Abaddon::Get().GetDiscordClient();
+static bool ParseID(const std::string &s, size_t &pos, Snowflake &out) {
+    const size_t start = pos;
+    while (pos < s.size() && IsDigit(s[pos])) pos++;
+    if (pos == start) return false;
+    out = std::strtoull(s.c_str() + start, nullptr, 10);
+    return true;
+}
 
-    int startpos = 0;
-    Glib::MatchInfo match;
-    while (rgx->match(text, startpos, match)) {
-        int mstart, mend;
-        if (!match.fetch_pos(0, mstart, mend)) break;
-        const Glib::ustring role_id = match.fetch(1);
-        const auto role = discord.GetRole(role_id);
-        if (!role.has_value()) {
-            startpos = mend;
-            continue;
+// <@id> <@!id> <@&id> <#id> <:name:id> <a:name:id>
+static bool ParseAngle(const std::string &s, size_t pos, Token &tok, size_t &end) {
+    size_t p = pos + 1;
+    if (p >= s.size()) return false;
+
+    if (s[p] == '@') {
+        p++;
+        tok.Type = TokenType::UserMention;
+        if (p < s.size() && s[p] == '&') {
+            tok.Type = TokenType::RoleMention;
+            p++;
+        } else if (p < s.size() && s[p] == '!') {
+            p++;
+        }
+        if (!ParseID(s, p, tok.ID)) return false;
+    } else if (s[p] == '#') {
+        p++;
+        tok.Type = TokenType::ChannelMention;
+        if (!ParseID(s, p, tok.ID)) return false;
+    } else {
+        tok.Type = TokenType::CustomEmoji;
+        if (s[p] == 'a') {
+            tok.Animated = true;
+            p++;
         }
+        if (p >= s.size() || s[p] != ':') return false;
+        const size_t name_start = ++p;
+        while (p < s.size() && (std::isalnum(static_cast<unsigned char>(s[p])) || s[p] == '_')) p++;
+        if (p == name_start || p >= s.size() || s[p] != ':') return false;
+        tok.Name = s.substr(name_start, p - name_start);
+        p++;
+        if (!ParseID(s, p, tok.ID)) return false;
+    }
 
-        Glib::ustring replacement;
-        if (role->HasColor()) {
-            replacement = "<b><span color=\"#" + IntToCSSColor(role->Color) + "\">@" + role->GetEscapedName() + "</span></b>";
-        } else {
-            replacement = "<b>@" + role->GetEscapedName() + "</b>";
+    if (p >= s.size() || s[p] != '>') return false;
+    end = p + 1;
+    tok.Text = s.substr(pos, end - pos);
+    return true;
+}
+
+// same rules as the old \bhttps?:\/\/[^\s]+\.[^\s]+\b
+static bool ParseLink(const std::string &s, size_t pos, size_t &end) {
+    if (pos > 0 && IsWordByte(s[pos - 1])) return false;
+
+    size_t p;
+    if (s.compare(pos, 7, "http://") == 0) {
+        p = pos + 7;
+    } else if (s.compare(pos, 8, "https://") == 0) {
+        p = pos + 8;
+    } else {
+        return false;
+    }
+
+    const size_t host_start = p;
+    while (p < s.size() && !IsSpaceByte(s[p])) p++;
+    while (p > host_start && !IsWordByte(s[p - 1])) p--;
+
+    const auto dot = s.find('.', host_start + 1);
+    if (dot == std::string::npos || dot + 1 >= p) return false;
+
+    end = p;
+    return true;
+}
+
+// split plain text around stock emojis. offsets from the trie are in characters
+static void AppendText(TokenList &tokens, const std::string &text, uint8_t style, const EmojiResource &emojis) {
+    if (text.empty()) return;
+
+    std::vector<EmojiResource::EmojiMatch> matches;
+    if ((style & STYLE_CODE) == 0)
+        matches = emojis.FindPatterns(text);
+
+    const char *base = text.c_str();
+    const char *cur = base;
+    int cur_offset = 0;
+    for (const auto &match : matches) {
+        const char *match_start = g_utf8_offset_to_pointer(cur, match.Offset - cur_offset);
+        const char *match_end = g_utf8_offset_to_pointer(match_start, match.Length);
+        if (match_start != cur)
+            tokens.push_back({ TokenType::Text, style, std::string(cur, match_start) });
+        tokens.push_back({ TokenType::StockEmoji, style, std::string(match_start, match_end) });
+        cur = match_end;
+        cur_offset = match.Offset + match.Length;
+    }
+    if (static_cast<size_t>(cur - base) < text.size())
+        tokens.push_back({ TokenType::Text, style, std::string(cur) });
+}
+
+// ```lang at the start of a fence is only a highlighting hint, which isnt done here, so it goes with its newline
+static std::string GetFenceBody(const std::string &inner) {
+    const auto newline = inner.find('\n');
+    if (newline == std::string::npos) return inner;
+    const bool is_language = std::all_of(inner.begin(), inner.begin() + newline, [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '+' || c == '-' || c == '_' || c == '#' || c == '.';
+    });
+    return is_language ? inner.substr(newline + 1) : inner;
+}
+
+TokenList Tokenize(const std::string &content) {
+    return Tokenize(content, Abaddon::Get().GetEmojis());
+}
+
+TokenList Tokenize(const std::string &content, const EmojiResource &emojis) {
+    TokenList tokens;
+    std::string pending;
+    uint8_t style = STYLE_NONE;
+
+    const auto flush = [&]() {
+        AppendText(tokens, pending, style, emojis);
+        pending.clear();
+    };
+
+    // a delimiter only opens if it gets closed somewhere later
+    const auto toggle = [&](size_t &pos, const char *delim, uint8_t flag) -> bool {
+        if ((style & flag) == 0 && content.find(delim, pos + 2) == std::string::npos) return false;
+        flush();
+        style ^= flag;
+        pos += 2;
+        return true;
+    };
+
+    size_t pos = 0;
+    while (pos < content.size()) {
+        const char c = content[pos];
+        if (c == '<') {
+            Token tok;
+            size_t end;
+            if (ParseAngle(content, pos, tok, end)) {
+                flush();
+                tok.Style = style;
+                tokens.push_back(std::move(tok));
+                pos = end;
+                continue;
+            }
+        } else if (c == 'h') {
+            size_t end;
+            if (ParseLink(content, pos, end)) {
+                flush();
+                tokens.push_back({ TokenType::Link, style, content.substr(pos, end - pos) });
+                pos = end;
+                continue;
+            }
+        } else if (c == '`') {
+            // nothing inside code is parsed. the longest delimiter that gets closed wins, so fences come before
+            // double backticks (which can hold a single one) and those before plain inline code
+            size_t run = 1;
+            while (run < 3 && pos + run < content.size() && content[pos + run] == '`') run++;
+            bool matched = false;
+            for (size_t n = run; n > 0 && !matched; n--) {
+                const auto close = content.find(std::string(n, '`'), pos + n);
+                if (close == std::string::npos || close == pos + n) continue;
+                const auto inner = content.substr(pos + n, close - pos - n);
+                flush();
+                AppendText(tokens, n == 3 ? GetFenceBody(inner) : inner, style | STYLE_CODE, emojis);
+                pos = close + n;
+                matched = true;
+            }
+            if (matched) continue;
+        } else if (c == '*' && content.compare(pos, 2, "**") == 0) {
+            if (toggle(pos, "**", STYLE_BOLD)) continue;
+        } else if (c == '~' && content.compare(pos, 2, "~~") == 0) {
+            if (toggle(pos, "~~", STYLE_STRIKE)) continue;
         }
 
-        const auto chars_start = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mstart);
-        const auto chars_end = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mend);
-        const auto start_it = buf->get_iter_at_offset(chars_start);
-        const auto end_it = buf->get_iter_at_offset(chars_end);
+        pending += c;
+        pos++;
+    }
+    flush();
 
-        auto it = buf->erase(start_it, end_it);
-        buf->insert_markup(it, replacement);
+    return tokens;
+}
 
-        text = GetText(buf);
-        startpos = 0;
+std::shared_ptr<const TokenList> GetTokens(const Message &message) {
+    struct CacheEntry {
+        std::string EditedTimestamp;
+        std::shared_ptr<const TokenList> Tokens;
+    };
+    static std::unordered_map<Snowflake, CacheEntry> cache;
+    static std::deque<Snowflake> order;
+
+    if (!message.ID.IsValid())
+        return std::make_shared<const TokenList>(Tokenize(message.Content));
+
+    if (const auto it = cache.find(message.ID); it != cache.end()) {
+        if (it->second.EditedTimestamp == message.EditedTimestamp)
+            return it->second.Tokens;
+        it->second = { message.EditedTimestamp, std::make_shared<const TokenList>(Tokenize(message.Content)) };
+        return it->second.Tokens;
+    }
+
+    auto tokens = std::make_shared<const TokenList>(Tokenize(message.Content));
+    cache[message.ID] = { message.EditedTimestamp, tokens };
+    order.push_back(message.ID);
+    if (order.size() > TokenCacheSize) {
+        cache.erase(order.front());
+        order.pop_front();
+    }
+
+    return tokens;
+}
+
+std::optional<Glib::ustring> GetUserMentionMarkup(Snowflake user_id, Snowflake channel_id) {
+    const auto &discord = Abaddon::Get().GetDiscordClient();
+    const auto user = discord.GetUser(user_id);
+    const auto channel = discord.GetChannel(channel_id);
+    if (!user.has_value() || !channel.has_value()) return std::nullopt;
+
+    if (channel->Type == ChannelType::DM || channel->Type == ChannelType::GROUP_DM || !channel->GuildID.has_value())
+        return user->GetUsernameEscapedBoldAt();
+
+    const auto role_id = user->GetHoistedRole(*channel->GuildID, true);
+    const auto role = discord.GetRole(role_id);
+    if (!role.has_value())
+        return user->GetUsernameEscapedBoldAt();
+    return "<span color=\"#" + IntToCSSColor(role->Color) + "\">" + user->GetUsernameEscapedBoldAt() + "</span>";
+}
+
+std::optional<Glib::ustring> GetRoleMentionMarkup(Snowflake role_id) {
+    const auto role = Abaddon::Get().GetDiscordClient().GetRole(role_id);
+    if (!role.has_value()) return std::nullopt;
+
+    if (role->HasColor())
+        return "<b><span color=\"#" + IntToCSSColor(role->Color) + "\">@" + role->GetEscapedName() + "</span></b>";
+    return "<b>@" + role->GetEscapedName() + "</b>";
+}
+
+void AppendCustomEmoji(Gtk::TextView &tv, const Token &token) {
+    auto &img = Abaddon::Get().GetImageManager();
+    auto buf = tv.get_buffer();
+
+    const int start_offset = buf->end().get_offset();
+    buf->insert(buf->end(), token.Text);
+    auto end_it = buf->end();
+    end_it.backward_char();
+
+    // can't erase before pixbuf is ready or else marks that are in the same pos get mixed up
+    const auto mark_start = buf->create_mark(buf->get_iter_at_offset(start_offset), false);
+    const auto mark_end = buf->create_mark(end_it, false);
+
+    if (token.Animated && Abaddon::Get().GetSettings().ShowAnimations) {
+        const auto cb = [&tv, buf, mark_start, mark_end](const Glib::RefPtr<Gdk::PixbufAnimation> &pixbuf) {
+            auto start_it = mark_start->get_iter();
+            auto end_it = mark_end->get_iter();
+            end_it.forward_char();
+            buf->delete_mark(mark_start);
+            buf->delete_mark(mark_end);
+            auto it = buf->erase(start_it, end_it);
+            const auto anchor = buf->create_child_anchor(it);
+            auto img = Gtk::manage(new AnimatedImage(pixbuf));
+            img->show();
+            tv.add_child_at_anchor(*img, anchor);
+        };
+        img.LoadAnimationFromURL(EmojiData::URLFromID(token.ID, "gif"), EmojiSize, EmojiSize, sigc::track_obj(cb, tv));
+    } else {
+        const auto cb = [buf, mark_start, mark_end](const Glib::RefPtr<Gdk::Pixbuf> &pixbuf) {
+            auto start_it = mark_start->get_iter();
+            auto end_it = mark_end->get_iter();
+            end_it.forward_char();
+            buf->delete_mark(mark_start);
+            buf->delete_mark(mark_end);
+            auto it = buf->erase(start_it, end_it);
+            int width, height;
+            GetImageDimensions(pixbuf->get_width(), pixbuf->get_height(), width, height, EmojiSize, EmojiSize);
+            buf->insert_pixbuf(it, pixbuf->scale_simple(width, height, Gdk::INTERP_BILINEAR));
+        };
+        img.LoadFromURL(EmojiData::URLFromID(token.ID), sigc::track_obj(cb, tv));
     }
 }
 
+Glib::ustring GetText(const Glib::RefPtr<Gtk::TextBuffer> &buf) {
+    Gtk::TextBuffer::iterator a, b;
+    buf->get_bounds(a, b);
+    auto slice = buf->get_slice(a, b, true);
+    return slice;
+}
+
 void HandleUserMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf, Snowflake channel_id, bool plain) {
     constexpr static const auto mentions_regex = R"(<@!?(\d+)>)";
 
@@ -66,28 +323,17 @@ void HandleUserMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf, Snowflake chan
         int mstart, mend;
         if (!match.fetch_pos(0, mstart, mend)) break;
         const Glib::ustring user_id = match.fetch(1);
-        const auto user = discord.GetUser(user_id);
-        const auto channel = discord.GetChannel(channel_id);
-        if (!user.has_value() || !channel.has_value()) {
-            startpos = mend;
-            continue;
-        }
-
-        Glib::ustring replacement;
 
-        if (channel->Type == ChannelType::DM || channel->Type == ChannelType::GROUP_DM || !channel->GuildID.has_value() || plain) {
-            if (plain) {
+        std::optional<Glib::ustring> replacement;
+        if (plain) {
+            if (const auto user = discord.GetUser(user_id); user.has_value())
                 replacement = "@" + user->GetUsername();
-            } else {
-                replacement = user->GetUsernameEscapedBoldAt();
-            }
         } else {
-            const auto role_id = user->GetHoistedRole(*channel->GuildID, true);
-            const auto role = discord.GetRole(role_id);
-            if (!role.has_value())
-                replacement = user->GetUsernameEscapedBoldAt();
-            else
-                replacement = "<span color=\"#" + IntToCSSColor(role->Color) + "\">" + user->GetUsernameEscapedBoldAt() + "</span>";
+            replacement = GetUserMentionMarkup(user_id, channel_id);
+        }
+        if (!replacement.has_value()) {
+            startpos = mend;
+            continue;
         }
 
         // regex returns byte positions and theres no straightforward way in the c++ bindings to deal with that :(
@@ -97,83 +343,13 @@ void HandleUserMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf, Snowflake chan
         const auto end_it = buf->get_iter_at_offset(chars_end);
 
         auto it = buf->erase(start_it, end_it);
-        buf->insert_markup(it, replacement);
+        buf->insert_markup(it, *replacement);
 
         text = GetText(buf);
         startpos = 0;
     }
 }
 
-void HandleStockEmojis(Gtk::TextView &tv) {
-    Abaddon::Get().GetEmojis().ReplaceEmojis(tv.get_buffer(), EmojiSize);
-}
-
-void HandleCustomEmojis(Gtk::TextView &tv) {
-    static auto rgx = Glib::Regex::create(R"(<a?:([\w\d_]+):(\d+)>)");
-
-    auto &img = Abaddon::Get().GetImageManager();
-
-    auto buf = tv.get_buffer();
-    auto text = GetText(buf);
-
-    Glib::MatchInfo match;
-    int startpos = 0;
-    while (rgx->match(text, startpos, match)) {
-        int mstart, mend;
-        if (!match.fetch_pos(0, mstart, mend)) break;
-        const bool is_animated = match.fetch(0)[1] == 'a';
-
-        const auto chars_start = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mstart);
-        const auto chars_end = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mend);
-        auto start_it = buf->get_iter_at_offset(chars_start);
-        auto end_it = buf->get_iter_at_offset(chars_end);
-
-        startpos = mend;
-        if (is_animated && Abaddon::Get().GetSettings().ShowAnimations) {
-            const auto mark_start = buf->create_mark(start_it, false);
-            end_it.backward_char();
-            const auto mark_end = buf->create_mark(end_it, false);
-            const auto cb = [&tv, buf, mark_start, mark_end](const Glib::RefPtr<Gdk::PixbufAnimation> &pixbuf) {
-                auto start_it = mark_start->get_iter();
-                auto end_it = mark_end->get_iter();
-                end_it.forward_char();
-                buf->delete_mark(mark_start);
-                buf->delete_mark(mark_end);
-                auto it = buf->erase(start_it, end_it);
-                const auto anchor = buf->create_child_anchor(it);
-                auto img = Gtk::manage(new Gtk::Image(pixbuf));
-                img->show();
-                tv.add_child_at_anchor(*img, anchor);
-            };
-            img.LoadAnimationFromURL(EmojiData::URLFromID(match.fetch(2), "gif"), EmojiSize, EmojiSize, sigc::track_obj(cb, tv));
-        } else {
-            // can't erase before pixbuf is ready or else marks that are in the same pos get mixed up
-            const auto mark_start = buf->create_mark(start_it, false);
-            end_it.backward_char();
-            const auto mark_end = buf->create_mark(end_it, false);
-            const auto cb = [buf, mark_start, mark_end](const Glib::RefPtr<Gdk::Pixbuf> &pixbuf) {
-                auto start_it = mark_start->get_iter();
-                auto end_it = mark_end->get_iter();
-                end_it.forward_char();
-                buf->delete_mark(mark_start);
-                buf->delete_mark(mark_end);
-                auto it = buf->erase(start_it, end_it);
-                int width, height;
-                GetImageDimensions(pixbuf->get_width(), pixbuf->get_height(), width, height, EmojiSize, EmojiSize);
-                buf->insert_pixbuf(it, pixbuf->scale_simple(width, height, Gdk::INTERP_BILINEAR));
-            };
-            img.LoadFromURL(EmojiData::URLFromID(match.fetch(2)), sigc::track_obj(cb, tv));
-        }
-
-        text = GetText(buf);
-    }
-}
-
-void HandleEmojis(Gtk::TextView &tv) {
-    if (Abaddon::Get().GetSettings().ShowStockEmojis) HandleStockEmojis(tv);
-    if (Abaddon::Get().GetSettings().ShowCustomEmojis) HandleCustomEmojis(tv);
-}
-
 void CleanupEmojis(const Glib::RefPtr<Gtk::TextBuffer> &buf) {
     static auto rgx = Glib::Regex::create(R"(<a?:([\w\d_]+):(\d+)>)");
 
@@ -1,4 +1,8 @@
 #pragma once
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 #include <glibmm/refptr.h>
 #include <glibmm/ustring.h>
 #include "discord/snowflake.hpp"
@@ -8,12 +12,51 @@ class TextBuffer;
 class TextView;
 } // namespace Gtk
 
+struct Message;
+class EmojiResource;
+
 namespace ChatUtil {
+enum class TokenType {
+    Text,
+    UserMention,
+    RoleMention,
+    ChannelMention,
+    Link,
+    CustomEmoji,
+    StockEmoji,
+};
+
+enum TokenStyle : uint8_t {
+    STYLE_NONE = 0,
+    STYLE_BOLD = 1 << 0,
+    STYLE_STRIKE = 1 << 1,
+    STYLE_CODE = 1 << 2,
+};
+
+// one span of message content. Text is always the raw source so anything that can't be resolved can fall back to it
+struct Token {
+    TokenType Type;
+    uint8_t Style = STYLE_NONE;
+    std::string Text;
+    Snowflake ID;     // mentions and custom emojis
+    std::string Name; // custom emojis
+    bool Animated = false;
+};
+
+using TokenList = std::vector<Token>;
+
+// single pass over the content, markdown delimiters are consumed
+TokenList Tokenize(const std::string &content);
+TokenList Tokenize(const std::string &content, const EmojiResource &emojis);
+// cached by message id and edit timestamp
+std::shared_ptr<const TokenList> GetTokens(const Message &message);
+
+std::optional<Glib::ustring> GetUserMentionMarkup(Snowflake user_id, Snowflake channel_id);
+std::optional<Glib::ustring> GetRoleMentionMarkup(Snowflake role_id);
+// inserts the raw emoji text at the end of the buffer and swaps it for the image once it loads
+void AppendCustomEmoji(Gtk::TextView &tv, const Token &token);
+
 Glib::ustring GetText(const Glib::RefPtr<Gtk::TextBuffer> &buf);
-void HandleRoleMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf);
 void HandleUserMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf, Snowflake channel_id, bool plain);
-void HandleStockEmojis(Gtk::TextView &tv);
-void HandleCustomEmojis(Gtk::TextView &tv);
-void HandleEmojis(Gtk::TextView &tv);
 void CleanupEmojis(const Glib::RefPtr<Gtk::TextBuffer> &buf);
 } // namespace ChatUtil
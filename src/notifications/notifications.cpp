@@ -135,7 +135,7 @@ void Notifications::NotifyMessageDM(const Message &message) {
     Glib::ustring default_action = "app.go-to-channel";
     default_action += "::";
     default_action += std::to_string(message.ChannelID);
-    const auto title = message.Author.Username;
+    const auto title = message.Author.Username.str();
     const auto body = Sanitize(message);
 
     Abaddon::Get().GetImageManager().GetCache().GetFileFromURL(message.Author.GetAvatarURL("png", "64"), [=](const std::string &path) {
@@ -147,7 +147,7 @@ void Notifications::NotifyMessageGuild(const Message &message) {
     Glib::ustring default_action = "app.go-to-channel";
     default_action += "::";
     default_action += std::to_string(message.ChannelID);
-    Glib::ustring title = message.Author.Username;
+    Glib::ustring title = message.Author.Username.str();
     if (const auto channel = Abaddon::Get().GetDiscordClient().GetChannel(message.ChannelID); channel.has_value() && channel->Name.has_value()) {
         if (channel->ParentID.has_value()) {
             const auto category = Abaddon::Get().GetDiscordClient().GetChannel(*channel->ParentID);
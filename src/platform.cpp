@@ -10,6 +10,13 @@
 #ifdef __linux__
     #include "util.hpp"
 #endif
+#ifdef __GLIBC__
+    #include <malloc.h>
+#endif
+#ifndef _WIN32
+    #include <sys/resource.h>
+    #include <time.h>
+#endif
 
 #include <spdlog/spdlog.h>
 
@@ -244,3 +251,68 @@ std::string Platform::FindStateCacheFolder() {
     return ".";
 }
 #endif
+
+#if defined(_WIN32)
+    #include <psapi.h>
+    #pragma comment(lib, "psapi.lib")
+size_t Platform::GetPeakRSS() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+}
+#else
+size_t Platform::GetPeakRSS() {
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    #ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss); // bytes on mac
+    #else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes everywhere else
+    #endif
+}
+#endif
+
+#if defined(_WIN32)
+static double FileTimeSeconds(const FILETIME &kernel, const FILETIME &user) {
+    const auto ticks = [](const FILETIME &t) {
+        return (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+    };
+    return static_cast<double>(ticks(kernel) + ticks(user)) / 10000000.0; // 100ns ticks
+}
+
+double Platform::GetProcessCPUTime() {
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0.0;
+    return FileTimeSeconds(kernel, user);
+}
+
+double Platform::GetThreadCPUTime() {
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0.0;
+    return FileTimeSeconds(kernel, user);
+}
+#else
+static double ClockSeconds(clockid_t clock) {
+    timespec ts {};
+    if (clock_gettime(clock, &ts) != 0) return 0.0;
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1000000000.0;
+}
+
+double Platform::GetProcessCPUTime() {
+    return ClockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+double Platform::GetThreadCPUTime() {
+    return ClockSeconds(CLOCK_THREAD_CPUTIME_ID);
+}
+#endif
+
+std::optional<size_t> Platform::GetHeapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const auto info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return std::nullopt;
+#endif
+}
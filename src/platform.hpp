@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <optional>
 #include <string>
 
 namespace Platform {
@@ -6,4 +8,13 @@ bool SetupFonts();
 std::string FindResourceFolder();
 std::string FindConfigFile();
 std::string FindStateCacheFolder();
+
+// bytes, 0 if unknown
+size_t GetPeakRSS();
+// seconds of cpu (user and kernel) used so far by the whole process or the calling thread, 0 if unknown
+double GetProcessCPUTime();
+double GetThreadCPUTime();
+// bytes currently in use on the heap, from mallinfo2. only glibc can tell us this cheaply
+// differences between two calls are net growth, they say nothing about how many allocations happened in between
+std::optional<size_t> GetHeapInUse();
 } // namespace Platform
@@ -0,0 +1,171 @@
+#include "prefetch.hpp"
+
+#include <algorithm>
+
+#include <glibmm/main.h>
+#include <spdlog/spdlog.h>
+
+#include "abaddon.hpp"
+#include "misc/chatutil.hpp"
+
+constexpr static size_t MaxHistory = 10;
+constexpr static auto HoverDwell = std::chrono::milliseconds(150);
+
+void ChannelPrefetcher::Start() {
+    Stop();
+
+    if (!Abaddon::Get().GetSettings().PrefetchChannels) return;
+    if (Abaddon::Get().GetSettings().PrefetchBudget <= 0) return;
+
+    m_next_allowed = std::chrono::steady_clock::now();
+    m_timer = Glib::signal_timeout().connect(sigc::mem_fun(*this, &ChannelPrefetcher::OnTick), 100, Glib::PRIORITY_LOW);
+}
+
+void ChannelPrefetcher::Stop() {
+    m_timer.disconnect();
+    m_warm.clear();
+    m_prefetched.clear();
+    m_hovered = Snowflake::Invalid;
+    m_in_flight = false;
+    m_generation++;
+
+    if (m_opens > 0)
+        spdlog::get("discord")->info("Prefetch served {}/{} channel opens", m_hits, m_opens);
+    m_opens = 0;
+    m_hits = 0;
+}
+
+void ChannelPrefetcher::SetHovered(Snowflake id) {
+    m_hovered = id;
+    m_hovered_since = std::chrono::steady_clock::now();
+}
+
+void ChannelPrefetcher::OnChannelOpened(Snowflake id) {
+    if (!m_timer.connected()) return;
+
+    // only the first open of a channel in a session can be a hit or a miss
+    if (m_prefetched.erase(id) > 0) {
+        m_opens++;
+        m_hits++;
+        spdlog::get("discord")->debug("Prefetch hit for {} ({}/{})", id, m_hits, m_opens);
+    } else if (m_warm.find(id) == m_warm.end()) {
+        m_opens++;
+    }
+    m_warm.insert(id);
+
+    m_history.erase(std::remove(m_history.begin(), m_history.end(), id), m_history.end());
+    m_history.push_front(id);
+    if (m_history.size() > MaxHistory) m_history.pop_back();
+}
+
+int ChannelPrefetcher::GetOpenCount() const noexcept {
+    return m_opens;
+}
+
+int ChannelPrefetcher::GetHitCount() const noexcept {
+    return m_hits;
+}
+
+bool ChannelPrefetcher::OnTick() {
+    if (m_in_flight) return true;
+    if (std::chrono::steady_clock::now() < m_next_allowed) return true;
+
+    if (const auto id = GetNextCandidate(); id.has_value())
+        Fetch(*id);
+
+    return true;
+}
+
+std::optional<Snowflake> ChannelPrefetcher::GetNextCandidate() const {
+    if (IsCandidate(m_hovered) && std::chrono::steady_clock::now() - m_hovered_since >= HoverDwell)
+        return m_hovered;
+
+    for (const auto id : Abaddon::Get().GetDiscordClient().GetChannelsWithMentions()) {
+        if (IsCandidate(id)) return id;
+    }
+
+#ifdef WITH_LIBHANDY
+    const auto tabs = Abaddon::Get().GetMainWindow()->GetChatWindow()->GetTabsState();
+    for (const auto id : tabs.Channels) {
+        if (IsCandidate(id)) return id;
+    }
+#endif
+
+    for (const auto id : m_history) {
+        if (IsCandidate(id)) return id;
+    }
+
+    return std::nullopt;
+}
+
+bool ChannelPrefetcher::IsCandidate(Snowflake id) const {
+    if (!id.IsValid()) return false;
+    if (m_warm.find(id) != m_warm.end()) return false;
+    if (id == Abaddon::Get().GetActiveChannelID()) return false;
+
+    const auto &discord = Abaddon::Get().GetDiscordClient();
+    const auto channel = discord.GetChannel(id);
+    if (!channel.has_value()) return false;
+    if (!channel->IsText() && !channel->IsDM() && !channel->IsThread()) return false;
+    return discord.HasChannelPermission(discord.GetUserData().ID, id, Permission::VIEW_CHANNEL | Permission::READ_MESSAGE_HISTORY);
+}
+
+void ChannelPrefetcher::Fetch(Snowflake channel_id) {
+    const int budget = std::max(Abaddon::Get().GetSettings().PrefetchBudget, 1);
+    const auto spacing = std::chrono::milliseconds(60000 / budget);
+    m_next_allowed = std::chrono::steady_clock::now() + spacing;
+    m_in_flight = true;
+    m_warm.insert(channel_id);
+
+    const int generation = m_generation;
+    Abaddon::Get().GetDiscordClient().FetchMessagesInChannelBefore(
+        channel_id, Snowflake::FromNow(),
+        [this, generation, channel_id](const std::vector<Message> &msgs) {
+            if (generation != m_generation) return;
+            m_in_flight = false;
+            // opened while in flight, the open already did its own fetch
+            if (channel_id != Abaddon::Get().GetActiveChannelID())
+                m_prefetched.insert(channel_id);
+            for (const auto &msg : msgs)
+                PrefetchImages(msg);
+            m_signal_prefetched.emit(channel_id, msgs);
+            spdlog::get("discord")->debug("Prefetched {} messages in {}", msgs.size(), channel_id);
+        },
+        [this, generation, channel_id](int status, float retry_after) {
+            if (generation != m_generation) return;
+            m_in_flight = false;
+            if (retry_after > 0.0F) {
+                m_next_allowed = std::chrono::steady_clock::now() + std::chrono::milliseconds(static_cast<int64_t>(retry_after * 1000.0F));
+                m_warm.erase(channel_id); // try again later
+            }
+        });
+}
+
+void ChannelPrefetcher::PrefetchImages(const Message &message) {
+    auto &img = Abaddon::Get().GetImageManager();
+    const bool animations = Abaddon::Get().GetSettings().ShowAnimations;
+
+    // same urls the chat uses so these are cache hits later
+    if (message.Author.HasAvatar())
+        img.Prefetch(message.Author.GetAvatarURL(message.GuildID));
+
+    // also leaves the tokens cached for when the message is rendered
+    const auto tokens = ChatUtil::GetTokens(message);
+    if (Abaddon::Get().GetSettings().ShowCustomEmojis) {
+        for (const auto &token : *tokens) {
+            if (token.Type == ChatUtil::TokenType::CustomEmoji)
+                img.Prefetch(EmojiData::URLFromID(token.ID, token.Animated && animations ? "gif" : "png"));
+        }
+    }
+
+    if (message.Reactions.has_value()) {
+        for (const auto &reaction : *message.Reactions) {
+            if (reaction.Emoji.ID.IsValid())
+                img.Prefetch(reaction.Emoji.GetURL());
+        }
+    }
+}
+
+ChannelPrefetcher::type_signal_prefetched ChannelPrefetcher::signal_prefetched() {
+    return m_signal_prefetched;
+}
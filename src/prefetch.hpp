@@ -0,0 +1,57 @@
+#pragma once
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+#include <sigc++/sigc++.h>
+#include "discord/snowflake.hpp"
+
+struct Message;
+
+// warms the store and image cache for the channels the user is most likely to open next
+// candidates in order: hovered row in the channel list, channels with mentions, open tabs, recently visited
+class ChannelPrefetcher {
+public:
+    ChannelPrefetcher() = default;
+
+    void Start(); // on ready
+    void Stop();  // on disconnect
+
+    void SetHovered(Snowflake id);
+    void OnChannelOpened(Snowflake id);
+
+    [[nodiscard]] int GetOpenCount() const noexcept;
+    [[nodiscard]] int GetHitCount() const noexcept;
+
+private:
+    bool OnTick();
+    std::optional<Snowflake> GetNextCandidate() const;
+    bool IsCandidate(Snowflake id) const;
+    void Fetch(Snowflake channel_id);
+    static void PrefetchImages(const Message &message);
+
+    std::unordered_set<Snowflake> m_warm;       // fetched or opened this session
+    std::unordered_set<Snowflake> m_prefetched; // fetched by us and not opened yet
+    std::deque<Snowflake> m_history;
+
+    Snowflake m_hovered;
+    std::chrono::steady_clock::time_point m_hovered_since;
+
+    bool m_in_flight = false;
+    int m_generation = 0;
+    std::chrono::steady_clock::time_point m_next_allowed;
+
+    int m_opens = 0;
+    int m_hits = 0;
+
+    sigc::connection m_timer;
+
+public:
+    using type_signal_prefetched = sigc::signal<void, Snowflake, const std::vector<Message> &>;
+
+    type_signal_prefetched signal_prefetched();
+
+private:
+    type_signal_prefetched m_signal_prefetched;
+};
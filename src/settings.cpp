@@ -86,14 +86,27 @@ void SettingsManager::DefineSettings() {
     AddSetting("discord", "prefetch", false, &Settings::Prefetch);
     AddSetting("discord", "autoconnect", false, &Settings::Autoconnect);
     AddSetting("discord", "keychain", true, &Settings::UseKeychain);
+    AddSetting("discord", "backfill", false, &Settings::BackfillEnabled);
+    AddSetting("discord", "backfill_channels", ""s, &Settings::BackfillChannels);
+    AddSetting("discord", "backfill_interval", 3000, &Settings::BackfillInterval);
+    AddSetting("discord", "backfill_idle", 15, &Settings::BackfillIdle);
+    AddSetting("discord", "prefetch_channels", false, &Settings::PrefetchChannels);
+    AddSetting("discord", "prefetch_budget", 10, &Settings::PrefetchBudget);
+    AddSetting("discord", "startup_cache_ttl", 24, &Settings::StartupCacheTTL);
+    AddSetting("discord", "startup_trace", ""s, &Settings::StartupTrace);
 
     AddSetting("gui", "css", "main.css"s, &Settings::MainCSS);
     AddSetting("gui", "animated_guild_hover_only", true, &Settings::AnimatedGuildHoverOnly);
     AddSetting("gui", "animations", true, &Settings::ShowAnimations);
+    AddSetting("gui", "animation_cache_size", 32768, &Settings::AnimationCacheSize);
+    AddSetting("gui", "animation_unfocused_fps", 0, &Settings::AnimationUnfocusedFPS);
+    AddSetting("gui", "chat_view_cache", 4, &Settings::ChatViewCache);
+    AddSetting("gui", "chat_view_cache_messages", 1000, &Settings::ChatViewCacheMessages);
     AddSetting("gui", "custom_emojis", true, &Settings::ShowCustomEmojis);
     AddSetting("gui", "owner_crown", true, &Settings::ShowOwnerCrown);
     AddSetting("gui", "save_state", true, &Settings::SaveState);
     AddSetting("gui", "stock_emojis", false, &Settings::ShowStockEmojis);
+    AddSetting("gui", "emoji_cache_size", 4096, &Settings::EmojiCacheSize);
     AddSetting("gui", "unreads", true, &Settings::Unreads);
     AddSetting("gui", "alt_menu", false, &Settings::AltMenu);
     AddSetting("gui", "hide_to_tray", false, &Settings::HideToTray);
@@ -104,6 +117,7 @@ void SettingsManager::DefineSettings() {
     AddSetting("gui", "image_embed_clamp_width", 400, &Settings::ImageEmbedClampWidth);
     AddSetting("gui", "image_embed_clamp_height", 300, &Settings::ImageEmbedClampHeight);
     AddSetting("gui", "classic_channels", false, &Settings::ClassicChannels);
+    AddSetting("gui", "stall_threshold", 0, &Settings::StallThreshold);
 
     AddSetting("http", "concurrent", 20, &Settings::CacheHTTPConcurrency);
     AddSetting("http", "user_agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/67.0.3396.87 Safari/537.36"s, &Settings::UserAgent);
@@ -14,15 +14,28 @@ public:
         bool Prefetch;
         bool Autoconnect;
         bool UseKeychain;
+        bool BackfillEnabled;
+        std::string BackfillChannels;
+        int BackfillInterval;
+        int BackfillIdle;
+        bool PrefetchChannels;
+        int PrefetchBudget;
+        int StartupCacheTTL;
+        std::string StartupTrace;
 
         // [gui]
         std::string MainCSS;
         bool AnimatedGuildHoverOnly;
         bool ShowAnimations;
+        int AnimationCacheSize;
+        int AnimationUnfocusedFPS;
+        int ChatViewCache;
+        int ChatViewCacheMessages;
         bool ShowCustomEmojis;
         bool ShowOwnerCrown;
         bool SaveState;
         bool ShowStockEmojis;
+        int EmojiCacheSize;
         bool Unreads;
         bool AltMenu;
         bool HideToTray;
@@ -33,6 +46,7 @@ public:
         int ImageEmbedClampWidth;
         int ImageEmbedClampHeight;
         bool ClassicChannels;
+        int StallThreshold;
 
         // [http]
         int CacheHTTPConcurrency;
@@ -1,12 +1,72 @@
 #include "startup.hpp"
 
+#include <algorithm>
+#include <filesystem>
 #include <future>
 #include <memory>
 
 #include "abaddon.hpp"
+#include "util.hpp"
 
-DiscordStartupDialog::DiscordStartupDialog(Gtk::Window &window)
-    : Gtk::MessageDialog(window, "", false, Gtk::MESSAGE_INFO, Gtk::BUTTONS_NONE, true) {
+static int64_t GetUnixTime() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+StartupCache StartupCache::Load(int ttl_hours) {
+    StartupCache cache;
+    if (ttl_hours <= 0) return cache;
+
+    const auto data = ReadWholeFile(Abaddon::GetStateCachePath("/startup.json"));
+    if (data.empty()) return cache;
+
+    const int64_t oldest = GetUnixTime() - static_cast<int64_t>(ttl_hours) * 60 * 60;
+    try {
+        const auto j = nlohmann::json::parse(data.begin(), data.end());
+        if (j.contains("cookie") && j.at("cookie_time").get<int64_t>() >= oldest) {
+            cache.Cookie = j.at("cookie").get<std::string>();
+            cache.CookieTime = j.at("cookie_time").get<int64_t>();
+        }
+        if (j.contains("build_number") && j.at("build_number_time").get<int64_t>() >= oldest) {
+            cache.BuildNumber = j.at("build_number").get<uint32_t>();
+            cache.BuildNumberTime = j.at("build_number_time").get<int64_t>();
+        }
+    } catch (const std::exception &e) {
+        spdlog::get("discord")->warn("Failed to load startup cache: {}", e.what());
+        return {};
+    }
+
+    return cache;
+}
+
+void StartupCache::Save() const {
+    if (Abaddon::Get().GetSettings().StartupCacheTTL <= 0) return;
+
+    nlohmann::json j = nlohmann::json::object();
+    if (Cookie.has_value()) {
+        j["cookie"] = *Cookie;
+        j["cookie_time"] = CookieTime;
+    }
+    if (BuildNumber.has_value()) {
+        j["build_number"] = *BuildNumber;
+        j["build_number_time"] = BuildNumberTime;
+    }
+
+    const auto path = Abaddon::GetStateCachePath();
+    if (!util::IsFolder(path)) {
+        std::error_code ec;
+        std::filesystem::create_directories(path, ec);
+    }
+
+    auto *fp = std::fopen(Abaddon::GetStateCachePath("/startup.json").c_str(), "wb");
+    if (fp == nullptr) return;
+    const auto s = j.dump(4);
+    std::fwrite(s.c_str(), 1, s.size(), fp);
+    std::fclose(fp);
+}
+
+DiscordStartupDialog::DiscordStartupDialog(Gtk::Window &window, StartupCache cache)
+    : Gtk::MessageDialog(window, "", false, Gtk::MESSAGE_INFO, Gtk::BUTTONS_NONE, true)
+    , m_cache(std::move(cache)) {
     m_dispatcher.connect(sigc::mem_fun(*this, &DiscordStartupDialog::DispatchCallback));
 
     property_text() = "Getting connection info...";
@@ -15,11 +75,15 @@ DiscordStartupDialog::DiscordStartupDialog(Gtk::Window &window)
 }
 
 std::optional<std::string> DiscordStartupDialog::GetCookie() const {
-    return m_cookie;
+    return m_cache.Cookie;
 }
 
 std::optional<uint32_t> DiscordStartupDialog::GetBuildNumber() const {
-    return m_build_number;
+    return m_cache.BuildNumber;
+}
+
+const StartupCache &DiscordStartupDialog::GetCache() const {
+    return m_cache;
 }
 
 // good enough
@@ -119,14 +183,27 @@ std::pair<std::optional<std::string>, std::string> GetCookieTask() {
 void DiscordStartupDialog::RunAsync() {
     auto futptr = std::make_shared<std::future<void>>();
     *futptr = std::async(std::launch::async, [this, futptr] {
+        auto &trace = Abaddon::Get().GetStartupTrace();
+
+        // the app page is needed for fresh cookies and for finding the script with the build number. the script url
+        // changes with every build so theres no caching it to skip this when only the build number is stale
+        auto start = StartupTrace::clock::now();
         auto [opt_cookie, app_page] = GetCookieTask();
-        m_cookie = opt_cookie;
+        trace.Add("fetch app page", start);
         if (opt_cookie.has_value()) {
+            m_cache.Cookie = opt_cookie;
+            m_cache.CookieTime = GetUnixTime();
+        }
+
+        if (!m_cache.BuildNumber.has_value() && m_cache.Cookie.has_value()) {
             auto js_url = GetJavascriptFileFromAppPage(app_page);
             if (js_url.has_value()) {
-                m_build_number = GetBuildNumberFromJSURL(*js_url, *opt_cookie);
-                if (m_build_number.has_value()) {
-                    spdlog::get("discord")->debug("Found build number: {}", *m_build_number);
+                start = StartupTrace::clock::now();
+                m_cache.BuildNumber = GetBuildNumberFromJSURL(*js_url, *m_cache.Cookie);
+                trace.Add("fetch build number", start);
+                if (m_cache.BuildNumber.has_value()) {
+                    m_cache.BuildNumberTime = GetUnixTime();
+                    spdlog::get("discord")->debug("Found build number: {}", *m_cache.BuildNumber);
                 }
             }
         }
@@ -137,3 +214,55 @@ void DiscordStartupDialog::RunAsync() {
 void DiscordStartupDialog::DispatchCallback() {
     response(Gtk::RESPONSE_OK);
 }
+
+StartupTrace::StartupTrace()
+    : m_origin(clock::now()) {}
+
+void StartupTrace::Add(std::string name, clock::time_point start, clock::time_point end) {
+    std::scoped_lock<std::mutex> guard(m_mutex);
+    if (m_finished) return;
+    m_phases.push_back({ std::move(name), start, end });
+}
+
+StartupTrace::clock::time_point StartupTrace::GetOrigin() const noexcept {
+    return m_origin;
+}
+
+void StartupTrace::Finish() {
+    std::vector<Phase> phases;
+    {
+        std::scoped_lock<std::mutex> guard(m_mutex);
+        if (m_finished) return;
+        m_finished = true;
+        phases = std::move(m_phases);
+    }
+
+    std::sort(phases.begin(), phases.end(), [](const Phase &a, const Phase &b) {
+        return a.Start < b.Start;
+    });
+
+    const auto ms = [](clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+
+    // start offset from launch, duration, name
+    std::string text;
+    for (const auto &phase : phases) {
+        text += fmt::format("{:>9.1f} ms {:>9.1f} ms  {}\n", ms(phase.Start - m_origin), ms(phase.End - phase.Start), phase.Name);
+    }
+    const auto total = ms(clock::now() - m_origin);
+    text += fmt::format("{:>9.1f} ms {:>9.1f} ms  total\n", 0.0, total);
+
+    spdlog::get("discord")->info("Startup took {:.1f} ms", total);
+    spdlog::get("discord")->debug("Startup phases:\n{}", text);
+
+    const auto &path = Abaddon::Get().GetSettings().StartupTrace;
+    if (path.empty()) return;
+    auto *fp = std::fopen(path.c_str(), "wb");
+    if (fp == nullptr) {
+        spdlog::get("discord")->warn("Couldn't write startup trace to {}", path);
+        return;
+    }
+    std::fwrite(text.c_str(), 1, text.size(), fp);
+    std::fclose(fp);
+}
@@ -1,18 +1,36 @@
 #pragma once
 
+#include <chrono>
+#include <mutex>
 #include <optional>
+#include <vector>
 
 #include <glibmm/dispatcher.h>
 #include <gtkmm/messagedialog.h>
 
+// cookies and build number from the last successful fetch so warm starts can skip the network
+struct StartupCache {
+    std::optional<std::string> Cookie;
+    std::optional<uint32_t> BuildNumber;
+    int64_t CookieTime = 0; // unix seconds
+    int64_t BuildNumberTime = 0;
+
+    // entries older than ttl_hours are left empty. 0 disables the cache
+    static StartupCache Load(int ttl_hours);
+    void Save() const;
+};
+
 // fetch cookies, build number async
+// the app page is always fetched since its where both come from. the script with the build number is only fetched
+// if the build number isnt cached
 
 class DiscordStartupDialog : public Gtk::MessageDialog {
 public:
-    DiscordStartupDialog(Gtk::Window &window);
+    DiscordStartupDialog(Gtk::Window &window, StartupCache cache);
 
     [[nodiscard]] std::optional<std::string> GetCookie() const;
     [[nodiscard]] std::optional<uint32_t> GetBuildNumber() const;
+    [[nodiscard]] const StartupCache &GetCache() const;
 
 private:
     void RunAsync();
@@ -21,6 +39,32 @@ private:
 
     Glib::Dispatcher m_dispatcher;
 
-    std::optional<std::string> m_cookie;
-    std::optional<uint32_t> m_build_number;
+    StartupCache m_cache;
+};
+
+// phase by phase timing of everything between launch and the gateway being ready
+// phases can be added from any thread
+class StartupTrace {
+public:
+    using clock = std::chrono::steady_clock;
+
+    StartupTrace();
+
+    void Add(std::string name, clock::time_point start, clock::time_point end = clock::now());
+    [[nodiscard]] clock::time_point GetOrigin() const noexcept;
+
+    // logs the breakdown and writes it to the startup_trace path if set. only the first call does anything
+    void Finish();
+
+private:
+    struct Phase {
+        std::string Name;
+        clock::time_point Start;
+        clock::time_point End;
+    };
+
+    clock::time_point m_origin;
+    std::vector<Phase> m_phases;
+    bool m_finished = false;
+    mutable std::mutex m_mutex;
 };
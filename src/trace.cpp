@@ -0,0 +1,220 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+namespace Trace {
+namespace detail {
+std::atomic<uint8_t> Modes = 0;
+} // namespace detail
+
+struct Event {
+    int64_t Start;    // ns since the epoch below
+    int64_t Duration; // ns
+    uint32_t Thread;
+    uint8_t NameLen;
+    uint8_t DetailLen;
+    std::array<char, 40> Name;
+    std::array<char, 80> Detail;
+};
+
+constexpr static size_t RingSize = 1 << 15;
+
+static std::mutex s_mutex;
+static std::unique_ptr<std::array<Event, RingSize>> s_ring; // allocated the first time tracing is turned on
+static uint64_t s_next = 0;
+static const auto s_epoch = std::chrono::steady_clock::now();
+
+static std::atomic<uint32_t> s_next_thread = 1;
+static thread_local uint32_t t_thread = 0;
+static std::map<uint32_t, std::string> s_thread_names; // under s_mutex
+
+static uint32_t GetThread() {
+    if (t_thread == 0) t_thread = s_next_thread++;
+    return t_thread;
+}
+
+void SetEnabled(bool enabled) {
+    if (enabled) {
+        std::lock_guard<std::mutex> l(s_mutex);
+        if (!s_ring) s_ring = std::make_unique<std::array<Event, RingSize>>();
+    }
+    if (enabled)
+        detail::Modes.fetch_or(detail::ModeRecord, std::memory_order_relaxed);
+    else
+        detail::Modes.fetch_and(static_cast<uint8_t>(~detail::ModeRecord), std::memory_order_relaxed);
+}
+
+void SetThreadName(const char *name) {
+    const auto thread = GetThread();
+    std::lock_guard<std::mutex> l(s_mutex);
+    s_thread_names[thread] = name;
+}
+
+static thread_local bool t_watched = false;
+static thread_local int t_depth = 0;
+
+// what the watched thread is in. theres only one writer so its a seqlock: the sequence is odd while the watched thread
+// is changing it and readers retry until they get a copy it didnt change under them. words so every access is atomic
+constexpr static size_t ActivityNameWords = 5;
+constexpr static size_t ActivityDetailWords = 20;
+
+static std::atomic<uint64_t> s_activity_seq = 0;
+static std::atomic<bool> s_activity_active = false;
+static std::atomic<uint8_t> s_activity_name_len = 0;
+static std::atomic<uint8_t> s_activity_detail_len = 0;
+static std::array<std::atomic<uint64_t>, ActivityNameWords> s_activity_name {};
+static std::array<std::atomic<uint64_t>, ActivityDetailWords> s_activity_detail {};
+static std::atomic<int64_t> s_activity_since = 0; // ns since the epoch
+
+template<size_t N>
+static uint8_t StoreWords(std::array<std::atomic<uint64_t>, N> &words, std::string_view str) {
+    const auto len = std::min(str.size(), N * sizeof(uint64_t));
+    for (size_t i = 0; i * sizeof(uint64_t) < len; i++) {
+        uint64_t word = 0;
+        std::memcpy(&word, str.data() + i * sizeof(uint64_t), std::min(sizeof(uint64_t), len - i * sizeof(uint64_t)));
+        words[i].store(word, std::memory_order_relaxed);
+    }
+    return static_cast<uint8_t>(len);
+}
+
+template<size_t N>
+static std::string LoadWords(const std::array<std::atomic<uint64_t>, N> &words, size_t len) {
+    std::string out(len, '\0');
+    for (size_t i = 0; i * sizeof(uint64_t) < len; i++) {
+        const auto word = words[i].load(std::memory_order_relaxed);
+        std::memcpy(out.data() + i * sizeof(uint64_t), &word, std::min(sizeof(uint64_t), len - i * sizeof(uint64_t)));
+    }
+    return out;
+}
+
+template<typename Func>
+static void WriteActivity(Func &&func) {
+    const auto seq = s_activity_seq.load(std::memory_order_relaxed);
+    s_activity_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    func();
+    s_activity_seq.store(seq + 2, std::memory_order_release);
+}
+
+void SetWatchedThread() {
+    t_watched = true;
+}
+
+void SetWatching(bool watching) {
+    if (watching)
+        detail::Modes.fetch_or(detail::ModeWatch, std::memory_order_relaxed);
+    else
+        detail::Modes.fetch_and(static_cast<uint8_t>(~detail::ModeWatch), std::memory_order_relaxed);
+}
+
+bool detail::Enter(std::string_view name, const char *detail, size_t detail_len) {
+    if (!t_watched) return false;
+    if (t_depth++ == 0) {
+        std::string_view detail_view;
+        if (detail != nullptr) detail_view = detail_len == std::string_view::npos ? std::string_view(detail) : std::string_view(detail, detail_len);
+
+        const auto since = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+        WriteActivity([&] {
+            s_activity_active.store(true, std::memory_order_relaxed);
+            s_activity_name_len.store(StoreWords(s_activity_name, name), std::memory_order_relaxed);
+            s_activity_detail_len.store(StoreWords(s_activity_detail, detail_view), std::memory_order_relaxed);
+            s_activity_since.store(since, std::memory_order_relaxed);
+        });
+    }
+    return true;
+}
+
+void detail::Leave() {
+    if (--t_depth == 0) {
+        WriteActivity([] {
+            s_activity_active.store(false, std::memory_order_relaxed);
+        });
+    }
+}
+
+std::optional<Activity> GetWatchedActivity() {
+    while (true) {
+        const auto seq = s_activity_seq.load(std::memory_order_acquire);
+        if ((seq & 1) != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::optional<Activity> activity;
+        if (s_activity_active.load(std::memory_order_relaxed)) {
+            const auto since = std::chrono::nanoseconds(s_activity_since.load(std::memory_order_relaxed));
+            activity = Activity {
+                LoadWords(s_activity_name, s_activity_name_len.load(std::memory_order_relaxed)),
+                LoadWords(s_activity_detail, s_activity_detail_len.load(std::memory_order_relaxed)),
+                s_epoch + std::chrono::duration_cast<std::chrono::steady_clock::duration>(since),
+            };
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s_activity_seq.load(std::memory_order_relaxed) == seq) return activity;
+    }
+}
+
+void detail::Record(std::string_view name, std::string_view detail, std::chrono::steady_clock::time_point start) {
+    const auto end = std::chrono::steady_clock::now();
+    const auto thread = GetThread();
+
+    std::lock_guard<std::mutex> l(s_mutex);
+    if (!s_ring) return;
+    auto &ev = (*s_ring)[s_next++ % RingSize];
+    ev.Start = std::chrono::duration_cast<std::chrono::nanoseconds>(start - s_epoch).count();
+    ev.Duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    ev.Thread = thread;
+    ev.NameLen = static_cast<uint8_t>(std::min(name.size(), ev.Name.size()));
+    std::memcpy(ev.Name.data(), name.data(), ev.NameLen);
+    ev.DetailLen = static_cast<uint8_t>(std::min(detail.size(), ev.Detail.size()));
+    std::memcpy(ev.Detail.data(), detail.data(), ev.DetailLen);
+}
+
+bool Save(const std::string &path) {
+    auto events = nlohmann::json::array();
+    {
+        std::lock_guard<std::mutex> l(s_mutex);
+        if (!s_ring || s_next == 0) return false;
+
+        for (const auto &[thread, name] : s_thread_names) {
+            events.push_back({
+                { "name", "thread_name" },
+                { "ph", "M" },
+                { "pid", 1 },
+                { "tid", thread },
+                { "args", { { "name", name } } },
+            });
+        }
+
+        const uint64_t count = std::min<uint64_t>(s_next, RingSize);
+        for (uint64_t i = s_next - count; i < s_next; i++) {
+            const auto &ev = (*s_ring)[i % RingSize];
+            nlohmann::json j {
+                // chrome wants microseconds
+                { "name", std::string(ev.Name.data(), ev.NameLen) },
+                { "ph", "X" },
+                { "ts", static_cast<double>(ev.Start) / 1000.0 },
+                { "dur", static_cast<double>(ev.Duration) / 1000.0 },
+                { "pid", 1 },
+                { "tid", ev.Thread },
+            };
+            if (ev.DetailLen > 0) j["args"] = { { "detail", std::string(ev.Detail.data(), ev.DetailLen) } };
+            events.push_back(std::move(j));
+        }
+    }
+
+    std::ofstream file(path);
+    if (!file) return false;
+    // cut off sql or urls can end up with half a utf-8 sequence
+    file << nlohmann::json { { "traceEvents", std::move(events) }, { "displayTimeUnit", "ms" } }.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    return file.good();
+}
+} // namespace Trace
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// scoped timing zones kept in a fixed ring of the most recent ones, saved as chrome trace json (chrome://tracing
+// or ui.perfetto.dev). off by default, a zone is one relaxed load until tracing or watching is turned on
+namespace Trace {
+namespace detail {
+enum : uint8_t {
+    ModeRecord = 1 << 0,
+    ModeWatch = 1 << 1,
+};
+
+extern std::atomic<uint8_t> Modes;
+void Record(std::string_view name, std::string_view detail, std::chrono::steady_clock::time_point start);
+// true if this is the watched thread, it has to be matched with a Leave
+bool Enter(std::string_view name, const char *detail, size_t detail_len);
+void Leave();
+} // namespace detail
+
+inline bool IsEnabled() noexcept {
+    return (detail::Modes.load(std::memory_order_relaxed) & detail::ModeRecord) != 0;
+}
+
+void SetEnabled(bool enabled);
+// shows up as the thread name in the trace, threads that dont set one get a number
+void SetThreadName(const char *name);
+// writes what the ring holds. false if theres nothing or the file cant be written
+bool Save(const std::string &path);
+
+// watching keeps track of which zone the watched thread is in without recording anything, so something else can tell
+// what its stuck on. only the outermost zone counts since thats the handler that was dispatched. it doesnt lock
+void SetWatchedThread();
+void SetWatching(bool watching);
+
+struct Activity {
+    std::string Name;
+    std::string Detail;
+    std::chrono::steady_clock::time_point Since;
+};
+
+// nullopt if the watched thread isnt in a zone (or watching is off)
+std::optional<Activity> GetWatchedActivity();
+
+// name and detail have to outlive the zone, theyre copied when it ends
+class Zone {
+public:
+    explicit Zone(std::string_view name, std::string_view detail = {}) noexcept {
+        if (const auto modes = detail::Modes.load(std::memory_order_relaxed); modes != 0) Begin(modes, name, detail.data(), detail.size());
+    }
+
+    // the length is only worked out if its needed
+    Zone(std::string_view name, const char *detail) noexcept {
+        if (const auto modes = detail::Modes.load(std::memory_order_relaxed); modes != 0) Begin(modes, name, detail, detail == nullptr ? 0 : std::string_view::npos);
+    }
+
+    ~Zone() {
+        if (m_watched) detail::Leave();
+        if (m_active) {
+            const auto detail = m_detail_len == std::string_view::npos ? std::string_view(m_detail) : std::string_view(m_detail, m_detail_len);
+            detail::Record(m_name, detail, m_start);
+        }
+    }
+
+    Zone(const Zone &) = delete;
+    Zone &operator=(const Zone &) = delete;
+
+private:
+    void Begin(uint8_t modes, std::string_view name, const char *detail, size_t detail_len) noexcept {
+        if ((modes & detail::ModeWatch) != 0) m_watched = detail::Enter(name, detail, detail_len);
+        if ((modes & detail::ModeRecord) == 0) return;
+        m_name = name;
+        m_detail = detail;
+        m_detail_len = detail_len;
+        m_start = std::chrono::steady_clock::now();
+        m_active = true;
+    }
+
+    std::string_view m_name;
+    const char *m_detail = nullptr;
+    size_t m_detail_len = 0;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_active = false;
+    bool m_watched = false;
+};
+} // namespace Trace
+
+#define TRACE_ZONE_CONCAT_(a, b) a##b
+#define TRACE_ZONE_CONCAT(a, b) TRACE_ZONE_CONCAT_(a, b)
+
+// times the rest of the enclosing scope
+#define TRACE_ZONE(...) const Trace::Zone TRACE_ZONE_CONCAT(trace_zone_, __LINE__)(__VA_ARGS__)
@@ -0,0 +1,200 @@
+#include "watchdog.hpp"
+#include <algorithm>
+#include <cctype>
+#include <glibmm/main.h>
+#include <spdlog/spdlog.h>
+
+template<typename T>
+static int64_t ToMilliseconds(T duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+}
+
+MainLoopWatchdog::~MainLoopWatchdog() {
+    Stop();
+}
+
+void MainLoopWatchdog::Start(std::chrono::milliseconds threshold) {
+    Stop();
+
+    const auto now = clock::now();
+    m_threshold = threshold;
+    m_expected_beat = now + BeatInterval;
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_stop = false;
+        m_last_beat = now;
+        m_culprit.reset();
+    }
+
+    Trace::SetWatchedThread();
+    Trace::SetWatching(true);
+    m_beat_conn = Glib::signal_timeout().connect(sigc::mem_fun(*this, &MainLoopWatchdog::OnBeat), BeatInterval.count());
+    m_thread = std::thread(&MainLoopWatchdog::WatchThread, this);
+}
+
+void MainLoopWatchdog::Stop() {
+    if (!m_thread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    m_beat_conn.disconnect();
+    Trace::SetWatching(false);
+}
+
+bool MainLoopWatchdog::IsRunning() const noexcept {
+    return m_thread.joinable();
+}
+
+std::chrono::milliseconds MainLoopWatchdog::GetThreshold() const noexcept {
+    return m_threshold;
+}
+
+bool MainLoopWatchdog::OnBeat() {
+    const auto now = clock::now();
+    const auto late = std::max(clock::duration::zero(), now - m_expected_beat);
+    m_expected_beat = now + BeatInterval;
+
+    std::optional<std::string> culprit;
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        if (m_culprit.has_value() && m_culprit_beat == m_beats) culprit = std::move(m_culprit);
+        m_culprit.reset();
+        m_beats++;
+        m_last_beat = now;
+
+        if (m_samples.size() < MaxSamples)
+            m_samples.push_back(late);
+        else
+            m_samples[m_next_sample++ % MaxSamples] = late;
+
+        if (late < m_threshold) return true;
+
+        // nothing was zoned, so its gtk itself (layout, drawing) or a handler without a zone
+        if (!culprit.has_value()) culprit = "unattributed";
+        auto &stats = m_stats[*culprit];
+        stats.Count++;
+        stats.Total += late;
+        stats.Max = std::max(stats.Max, late);
+        const auto ms = ToMilliseconds(late);
+        const auto bucket = std::find_if(BucketLimitsMs.begin(), BucketLimitsMs.end(), [ms](int limit) { return ms < limit; });
+        stats.Buckets[std::distance(BucketLimitsMs.begin(), bucket)]++;
+        m_stall_count++;
+    }
+
+    spdlog::get("ui")->warn("Main loop stalled for {}ms in {}", ToMilliseconds(late), *culprit);
+    return true;
+}
+
+void MainLoopWatchdog::WatchThread() {
+    std::unique_lock<std::mutex> l(m_mutex);
+    while (!m_stop) {
+        // only wakes up when the beat would be late enough to count, not every beat
+        const auto beat = m_beats;
+        const auto deadline = m_last_beat + BeatInterval + m_threshold;
+        if (m_cv.wait_until(l, deadline, [this] { return m_stop; })) break;
+        if (m_beats != beat) continue;
+
+        // the main thread is still stuck in whatever it was doing. dont hold the lock while asking trace for it
+        l.unlock();
+        auto culprit = DescribeActivity(Trace::GetWatchedActivity());
+        l.lock();
+        if (m_beats != beat) continue;
+        if (!culprit.empty()) m_culprit = std::move(culprit);
+        m_culprit_beat = beat;
+
+        while (!m_stop && m_beats == beat)
+            m_cv.wait_for(l, BeatInterval, [this] { return m_stop; });
+    }
+}
+
+std::string MainLoopWatchdog::DescribeActivity(const std::optional<Trace::Activity> &activity) {
+    if (!activity.has_value()) return {};
+    if (activity->Detail.empty()) return activity->Name;
+
+    std::string_view detail = activity->Detail;
+    // urls are grouped by route
+    if (const auto scheme = detail.find("://"); scheme != std::string_view::npos) {
+        const auto path = detail.find('/', scheme + 3);
+        detail = path == std::string_view::npos ? std::string_view("/") : detail.substr(path);
+        detail = detail.substr(0, detail.find('?'));
+    }
+
+    std::string out = activity->Name + " ";
+    for (size_t i = 0; i < detail.size();) {
+        size_t digits = 0;
+        while (i + digits < detail.size() && std::isdigit(static_cast<unsigned char>(detail[i + digits])))
+            digits++;
+        if (digits >= 6) {
+            // snowflakes and the like
+            out += ":id";
+            i += digits;
+        } else if (digits > 0) {
+            out += detail.substr(i, digits);
+            i += digits;
+        } else {
+            out += detail[i++];
+        }
+    }
+    if (out.size() > 80) out.resize(80);
+    return out;
+}
+
+MainLoopWatchdog::Latency MainLoopWatchdog::GetLatency() const {
+    std::vector<clock::duration> samples;
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        samples = m_samples;
+    }
+
+    Latency latency;
+    latency.Samples = samples.size();
+    if (samples.empty()) return latency;
+
+    std::sort(samples.begin(), samples.end());
+    const auto at = [&samples](double p) {
+        const auto idx = std::min(samples.size() - 1, static_cast<size_t>(p * static_cast<double>(samples.size())));
+        return std::chrono::duration_cast<std::chrono::microseconds>(samples[idx]);
+    };
+    latency.P50 = at(0.50);
+    latency.P90 = at(0.90);
+    latency.P99 = at(0.99);
+    latency.Max = std::chrono::duration_cast<std::chrono::microseconds>(samples.back());
+    return latency;
+}
+
+size_t MainLoopWatchdog::GetStallCount() const {
+    std::lock_guard<std::mutex> l(m_mutex);
+    return m_stall_count;
+}
+
+std::string MainLoopWatchdog::GetReport() const {
+    std::lock_guard<std::mutex> l(m_mutex);
+    if (m_stats.empty()) return {};
+
+    std::vector<std::pair<std::string, CulpritStats>> sorted(m_stats.begin(), m_stats.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+        return a.second.Total > b.second.Total;
+    });
+
+    size_t width = 7;
+    for (const auto &[culprit, stats] : sorted)
+        width = std::max(width, culprit.size());
+
+    std::string out = fmt::format("{} main loop stalls over {}ms\n", m_stall_count, m_threshold.count());
+    out += fmt::format("{:<{}} {:>5} {:>8} {:>7}", "culprit", width, "count", "total", "max");
+    for (const auto *label : { "<0.5s", "<1s", "<2s", "<5s", ">5s" })
+        out += fmt::format(" {:>5}", label);
+    out += '\n';
+    for (const auto &[culprit, stats] : sorted) {
+        out += fmt::format("{:<{}} {:>5} {:>6}ms {:>5}ms", culprit, width, stats.Count, ToMilliseconds(stats.Total), ToMilliseconds(stats.Max));
+        for (const auto count : stats.Buckets)
+            out += fmt::format(" {:>5}", count);
+        out += '\n';
+    }
+    out.pop_back();
+    return out;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sigc++/connection.h>
+#include <sigc++/trackable.h>
+#include "trace.hpp"
+
+// notices when the main loop is held up for longer than a threshold and blames the trace zone the main thread was in
+// when it went over (gateway event, http route, dispatcher). a timeout beats on the main loop and a thread checks that
+// it keeps beating, so the check still happens while the main thread is stuck
+class MainLoopWatchdog : public sigc::trackable {
+public:
+    using clock = std::chrono::steady_clock;
+
+    MainLoopWatchdog() = default;
+    ~MainLoopWatchdog();
+
+    MainLoopWatchdog(const MainLoopWatchdog &) = delete;
+    MainLoopWatchdog &operator=(const MainLoopWatchdog &) = delete;
+
+    // main thread only
+    void Start(std::chrono::milliseconds threshold);
+    void Stop();
+    [[nodiscard]] bool IsRunning() const noexcept;
+    [[nodiscard]] std::chrono::milliseconds GetThreshold() const noexcept;
+
+    // how late the beat ran over about the last minute
+    struct Latency {
+        std::chrono::microseconds P50 {};
+        std::chrono::microseconds P90 {};
+        std::chrono::microseconds P99 {};
+        std::chrono::microseconds Max {};
+        size_t Samples = 0;
+    };
+
+    [[nodiscard]] Latency GetLatency() const;
+    [[nodiscard]] size_t GetStallCount() const;
+    // stalls by culprit with a histogram of how long they were. empty if there havent been any
+    [[nodiscard]] std::string GetReport() const;
+
+private:
+    bool OnBeat();
+    void WatchThread();
+
+    // "http callback https://discord.com/api/v9/channels/123/messages?limit=50" -> "http callback /api/v9/channels/:id/messages"
+    static std::string DescribeActivity(const std::optional<Trace::Activity> &activity);
+
+    constexpr static auto BeatInterval = std::chrono::milliseconds(100);
+    constexpr static size_t MaxSamples = 600;
+    constexpr static std::array<int, 4> BucketLimitsMs { 500, 1000, 2000, 5000 };
+
+    struct CulpritStats {
+        size_t Count = 0;
+        clock::duration Total {};
+        clock::duration Max {};
+        std::array<size_t, BucketLimitsMs.size() + 1> Buckets {};
+    };
+
+    std::chrono::milliseconds m_threshold {};
+    sigc::connection m_beat_conn;
+    std::thread m_thread;
+    clock::time_point m_expected_beat; // main thread only
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+    uint64_t m_beats = 0;
+    clock::time_point m_last_beat;
+    std::optional<std::string> m_culprit; // captured by the watch thread for the beat thats late
+    uint64_t m_culprit_beat = 0;
+    std::vector<clock::duration> m_samples;
+    size_t m_next_sample = 0;
+    std::map<std::string, CulpritStats> m_stats;
+    size_t m_stall_count = 0;
+};
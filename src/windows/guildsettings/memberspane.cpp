@@ -41,7 +41,7 @@ GuildSettingsMembersPaneMembers::GuildSettingsMembersPaneMembers(Snowflake id)
     m_list_scroll.set_propagate_natural_height(true);
 
     auto &discord = Abaddon::Get().GetDiscordClient();
-    auto members = discord.GetUsersInGuild(id);
+    const auto &members = discord.GetUsersInGuild(id);
     const auto guild = *discord.GetGuild(GuildID);
     for (const auto member_id : members) {
         auto member = discord.GetMember(member_id, GuildID);
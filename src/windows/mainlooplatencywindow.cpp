@@ -0,0 +1,69 @@
+#include "mainlooplatencywindow.hpp"
+
+#include "abaddon.hpp"
+
+static std::string FormatMilliseconds(std::chrono::microseconds us) {
+    return fmt::format("{:.1f}ms", static_cast<double>(us.count()) / 1000.0);
+}
+
+MainLoopLatencyWindow::MainLoopLatencyWindow()
+    : m_box(Gtk::ORIENTATION_VERTICAL) {
+    set_name("main-loop-latency");
+    set_default_size(600, 300);
+    set_title("Main Loop Latency");
+    set_position(Gtk::WIN_POS_CENTER);
+    get_style_context()->add_class("app-window");
+    get_style_context()->add_class("app-popup");
+    get_style_context()->add_class("main-loop-latency-window");
+
+    m_latency.set_halign(Gtk::ALIGN_START);
+    m_latency.set_margin_bottom(5);
+    m_emojis.set_halign(Gtk::ALIGN_START);
+    m_emojis.set_margin_bottom(5);
+    m_report.set_halign(Gtk::ALIGN_START);
+    m_report.set_valign(Gtk::ALIGN_START);
+    m_report.set_selectable(true);
+
+    m_scroll.set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
+    m_scroll.set_vexpand(true);
+    m_scroll.add(m_report);
+
+    m_box.set_margin_start(10);
+    m_box.set_margin_end(10);
+    m_box.set_margin_top(10);
+    m_box.set_margin_bottom(10);
+    m_box.add(m_latency);
+    m_box.add(m_emojis);
+    m_box.add(m_scroll);
+    add(m_box);
+    show_all_children();
+
+    Update();
+    Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &MainLoopLatencyWindow::Update), 1);
+}
+
+bool MainLoopLatencyWindow::Update() {
+    const auto &emojis = Abaddon::Get().GetEmojis().GetCacheStats();
+    m_emojis.set_text(fmt::format("Emoji cache: {} hits, {} misses, {} decodes, {} entries, {} KiB",
+                                  emojis.Hits, emojis.Misses, emojis.Decodes, emojis.Entries, emojis.Bytes / 1024));
+
+    const auto &watchdog = Abaddon::Get().GetMainLoopWatchdog();
+    if (!watchdog.IsRunning()) {
+        m_latency.set_text("The watchdog is off. Set stall_threshold in [gui] to turn it on");
+        return true;
+    }
+
+    const auto latency = watchdog.GetLatency();
+    m_latency.set_text(fmt::format("Over the last {} beats: p50 {}, p90 {}, p99 {}, max {}. Stalls over {}ms: {}",
+                                   latency.Samples,
+                                   FormatMilliseconds(latency.P50),
+                                   FormatMilliseconds(latency.P90),
+                                   FormatMilliseconds(latency.P99),
+                                   FormatMilliseconds(latency.Max),
+                                   watchdog.GetThreshold().count(),
+                                   watchdog.GetStallCount()));
+
+    const auto report = watchdog.GetReport();
+    m_report.set_markup("<tt>" + Glib::Markup::escape_text(report.empty() ? "No stalls yet" : report) + "</tt>");
+    return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <gtkmm/box.h>
+#include <gtkmm/label.h>
+#include <gtkmm/scrolledwindow.h>
+#include <gtkmm/window.h>
+
+// live view of the main loop watchdog, and of the emoji cache since decodes happen on the main thread
+class MainLoopLatencyWindow : public Gtk::Window {
+public:
+    MainLoopLatencyWindow();
+
+private:
+    bool Update();
+
+    Gtk::Box m_box;
+    Gtk::Label m_latency;
+    Gtk::Label m_emojis;
+    Gtk::ScrolledWindow m_scroll;
+    Gtk::Label m_report;
+};
@@ -1,6 +1,7 @@
 #include "mainwindow.hpp"
 
 #include "abaddon.hpp"
+#include "trace.hpp"
 #include "util.hpp"
 
 MainWindow::MainWindow()
@@ -103,6 +104,7 @@ void MainWindow::UpdateComponents() {
 
 void MainWindow::UpdateMembers() {
     m_members.UpdateMemberList();
+    m_members.DropCachedLists();
 }
 
 void MainWindow::UpdateChannelListing() {
@@ -110,10 +112,14 @@ void MainWindow::UpdateChannelListing() {
 }
 
 void MainWindow::UpdateChatWindowContents() {
-    auto &discord = Abaddon::Get().GetDiscordClient();
-    auto msgs = discord.GetMessagesForChannel(m_chat.GetActiveChannel(), 50);
-    m_chat.SetMessages(msgs);
-    m_members.UpdateMemberList();
+    // kept up to date by live events while they were hidden
+    if (!m_chat.IsViewCached()) {
+        auto &discord = Abaddon::Get().GetDiscordClient();
+        auto msgs = discord.GetMessagesForChannel(m_chat.GetActiveChannel(), 50);
+        m_chat.SetMessages(msgs);
+    }
+    if (!m_members.IsListCached())
+        m_members.UpdateMemberList();
 }
 
 void MainWindow::UpdateChatActiveChannel(Snowflake id, bool expand_to) {
@@ -128,25 +134,27 @@ Snowflake MainWindow::GetChatActiveChannel() const {
 }
 
 void MainWindow::UpdateChatNewMessage(const Message &data) {
-    if (data.ChannelID == GetChatActiveChannel()) {
-        m_chat.AddNewMessage(data);
-    }
+    m_chat.AddNewMessage(data);
 }
 
 void MainWindow::UpdateChatMessageDeleted(Snowflake id, Snowflake channel_id) {
-    if (channel_id == GetChatActiveChannel())
-        m_chat.DeleteMessage(id);
+    m_chat.DeleteMessage(id, channel_id);
 }
 
 void MainWindow::UpdateChatMessageUpdated(Snowflake id, Snowflake channel_id) {
-    if (channel_id == GetChatActiveChannel())
-        m_chat.UpdateMessage(id);
+    m_chat.UpdateMessage(id, channel_id);
 }
 
 void MainWindow::UpdateChatPrependHistory(const std::vector<Message> &msgs) {
     m_chat.AddNewHistory(msgs); // given vector should be sorted ascending
 }
 
+void MainWindow::UpdateChatMergeMessages(Snowflake channel_id, const std::vector<Message> &msgs) {
+    m_chat.MergeMessages(channel_id, msgs);
+    if (channel_id == GetChatActiveChannel())
+        m_members.UpdateMemberList();
+}
+
 void MainWindow::InsertChatInput(const std::string &text) {
     m_chat.InsertChatInput(text);
 }
@@ -209,15 +217,38 @@ void MainWindow::OnDiscordSubmenuPopup() {
     }
 
     const bool discord_active = Abaddon::Get().GetDiscordClient().IsStarted();
+    const bool replaying = Abaddon::Get().GetDiscordClient().IsReplaying();
 
     std::string token = Abaddon::Get().GetDiscordToken();
-    m_menu_discord_connect.set_sensitive(!token.empty() && !discord_active);
+    m_menu_discord_connect.set_sensitive(!token.empty() && !discord_active && !replaying);
     m_menu_discord_disconnect.set_sensitive(discord_active);
     m_menu_discord_set_token.set_sensitive(!discord_active);
 #ifdef WITH_QRLOGIN
     m_menu_discord_login_qr.set_sensitive(!discord_active);
 #endif
     m_menu_discord_set_status.set_sensitive(discord_active);
+    m_menu_file_replay_gateway.set_sensitive(!discord_active && !replaying);
+}
+
+void MainWindow::OnReplayGateway() {
+    auto dlg = Gtk::FileChooserNative::create("Choose gateway recording", *this, Gtk::FILE_CHOOSER_ACTION_OPEN);
+    dlg->set_modal(true);
+    if (dlg->run() != Gtk::RESPONSE_ACCEPT) return;
+    const auto path = dlg->get_filename();
+
+    Gtk::MessageDialog speed(*this, "Replay at the recorded speed?", false, Gtk::MESSAGE_QUESTION, Gtk::BUTTONS_NONE, true);
+    speed.set_secondary_text("Recorded speed reproduces the real load, as fast as possible measures throughput.");
+    speed.add_button("As fast as possible", Gtk::RESPONSE_NO);
+    speed.add_button("Recorded speed", Gtk::RESPONSE_YES);
+    const int response = speed.run();
+    if (response != Gtk::RESPONSE_YES && response != Gtk::RESPONSE_NO) return;
+    speed.hide();
+
+    if (!Abaddon::Get().GetDiscordClient().StartReplay(path, response == Gtk::RESPONSE_YES)) {
+        Gtk::MessageDialog dlg_err(*this, "Couldn't replay that file", false, Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
+        dlg_err.run();
+    }
+    UpdateMenus();
 }
 
 void MainWindow::OnViewSubmenuPopup() {
@@ -279,9 +310,20 @@ void MainWindow::SetupMenu() {
     m_menu_file_reload_css.set_label("Reload CSS");
     m_menu_file_clear_cache.set_label("Clear file cache");
     m_menu_file_dump_ready.set_label("Dump ready message");
+    m_menu_file_record_gateway.set_label("Record gateway");
+    m_menu_file_replay_gateway.set_label("Replay gateway recording...");
+    m_menu_file_trace.set_label("Record performance trace");
+    m_menu_file_trace.set_active(Trace::IsEnabled());
+    m_menu_file_save_trace.set_label("Save performance trace");
+    m_menu_file_latency.set_label("Main loop latency");
     m_menu_file_sub.append(m_menu_file_reload_css);
     m_menu_file_sub.append(m_menu_file_clear_cache);
     m_menu_file_sub.append(m_menu_file_dump_ready);
+    m_menu_file_sub.append(m_menu_file_record_gateway);
+    m_menu_file_sub.append(m_menu_file_replay_gateway);
+    m_menu_file_sub.append(m_menu_file_trace);
+    m_menu_file_sub.append(m_menu_file_save_trace);
+    m_menu_file_sub.append(m_menu_file_latency);
 
     m_menu_view.set_label("View");
     m_menu_view.set_submenu(m_menu_view_sub);
@@ -368,6 +410,24 @@ void MainWindow::SetupMenu() {
         Abaddon::Get().GetDiscordClient().SetDumpReady(m_menu_file_dump_ready.get_active());
     });
 
+    m_menu_file_record_gateway.signal_toggled().connect([this]() {
+        Abaddon::Get().GetDiscordClient().SetRecordGateway(m_menu_file_record_gateway.get_active());
+    });
+
+    m_menu_file_replay_gateway.signal_activate().connect(sigc::mem_fun(*this, &MainWindow::OnReplayGateway));
+
+    m_menu_file_trace.signal_toggled().connect([this]() {
+        Trace::SetEnabled(m_menu_file_trace.get_active());
+    });
+
+    m_menu_file_save_trace.signal_activate().connect([] {
+        Abaddon::Get().ActionSavePerformanceTrace();
+    });
+
+    m_menu_file_latency.signal_activate().connect([] {
+        Abaddon::Get().ActionViewMainLoopLatency();
+    });
+
     m_menu_discord_add_recipient.signal_activate().connect([this] {
         m_signal_action_add_recipient.emit(GetChatActiveChannel());
     });
@@ -23,6 +23,7 @@ public:
     void UpdateChatMessageDeleted(Snowflake id, Snowflake channel_id);
     void UpdateChatMessageUpdated(Snowflake id, Snowflake channel_id);
     void UpdateChatPrependHistory(const std::vector<Message> &msgs);
+    void UpdateChatMergeMessages(Snowflake channel_id, const std::vector<Message> &msgs);
     void InsertChatInput(const std::string &text);
     Snowflake GetChatOldestListedMessage();
     void UpdateChatReactionAdd(Snowflake id, const Glib::ustring &param);
@@ -85,6 +86,12 @@ private:
     Gtk::MenuItem m_menu_file_reload_css;
     Gtk::MenuItem m_menu_file_clear_cache;
     Gtk::CheckMenuItem m_menu_file_dump_ready;
+    Gtk::CheckMenuItem m_menu_file_record_gateway;
+    Gtk::MenuItem m_menu_file_replay_gateway;
+    void OnReplayGateway();
+    Gtk::CheckMenuItem m_menu_file_trace;
+    Gtk::MenuItem m_menu_file_save_trace;
+    Gtk::MenuItem m_menu_file_latency;
 
     Gtk::MenuItem m_menu_view;
     Gtk::Menu m_menu_view_sub;
@@ -250,8 +250,8 @@ ProfileUserInfoPane::ProfileUserInfoPane(Snowflake ID)
 }
 
 void ProfileUserInfoPane::SetProfile(const UserProfileData &data) {
-    if (data.User.Bio.has_value() && !data.User.Bio->empty()) {
-        m_bio.SetBio(*data.User.Bio);
+    if (data.User.Account != nullptr && data.User.Account->Bio.has_value() && !data.User.Account->Bio->empty()) {
+        m_bio.SetBio(*data.User.Account->Bio);
         m_bio.show();
     } else {
         m_bio.hide();
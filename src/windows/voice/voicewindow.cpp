@@ -21,6 +21,7 @@ VoiceWindow::VoiceWindow(Snowflake channel_id)
     , m_deafen("Deafen")
     , m_noise_suppression("Suppress Noise")
     , m_mix_mono("Mix Mono")
+    , m_high_pass("High-pass")
     , m_stage_command("Request to Speak")
     , m_disconnect("Disconnect")
     , m_stage_invite_lbl("You've been invited to speak")
@@ -127,6 +128,12 @@ VoiceWindow::VoiceWindow(Snowflake channel_id)
         Abaddon::Get().GetAudio().SetMixMono(m_mix_mono.get_active());
     });
 
+    m_high_pass.set_tooltip_text("Cut rumble and hum below 80 Hz");
+    m_high_pass.set_active(audio.GetHighPass());
+    m_high_pass.signal_toggled().connect([this]() {
+        Abaddon::Get().GetAudio().SetHighPass(m_high_pass.get_active());
+    });
+
     m_disconnect.signal_clicked().connect([this]() {
         Abaddon::Get().GetDiscordClient().DisconnectFromVoice();
     });
@@ -243,6 +250,7 @@ VoiceWindow::VoiceWindow(Snowflake channel_id)
     m_controls.add(m_deafen);
     m_controls.add(m_noise_suppression);
     m_controls.add(m_mix_mono);
+    m_controls.add(m_high_pass);
     m_buttons.set_halign(Gtk::ALIGN_CENTER);
     if (m_is_stage) m_buttons.pack_start(m_stage_command, false, true);
     m_buttons.pack_start(m_disconnect, false, true);
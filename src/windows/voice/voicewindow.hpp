@@ -66,6 +66,7 @@ private:
 
     Gtk::CheckButton m_noise_suppression;
     Gtk::CheckButton m_mix_mono;
+    Gtk::CheckButton m_high_pass;
 
     Gtk::HBox m_buttons;
     Gtk::Button m_disconnect;
@@ -2,6 +2,7 @@
 
 // clang-format off
 
+#include <gtkmm/filechoosernative.h>
 #include <spdlog/spdlog.h>
 
 #include "abaddon.hpp"
@@ -11,7 +12,9 @@
 // clang-format on
 
 VoiceSettingsWindow::VoiceSettingsWindow()
-    : m_main(Gtk::ORIENTATION_VERTICAL) {
+    : m_main(Gtk::ORIENTATION_VERTICAL)
+    , m_bench_file("Benchmark File...")
+    , m_bench_run("Benchmark Playback") {
     get_style_context()->add_class("app-window");
     get_style_context()->add_class("voice-settings-window");
     set_default_size(300, 300);
@@ -134,7 +137,50 @@ VoiceSettingsWindow::VoiceSettingsWindow()
     widgets->pack_start(m_bitrate);
     widgets->pack_start(m_gain);
 
+    m_timings.set_halign(Gtk::ALIGN_START);
+    m_timings.set_tooltip_text("Average time spent in each capture stage per 10ms frame");
+    m_timings_timer = Glib::signal_timeout().connect(sigc::mem_fun(*this, &VoiceSettingsWindow::UpdateTimings), 500);
+    UpdateTimings();
+
+    m_bench_file.set_tooltip_text("Run an audio file through the capture chain with the current settings");
+    m_bench_file.signal_clicked().connect([this]() {
+        auto dlg = Gtk::FileChooserNative::create("Choose audio file", Gtk::FILE_CHOOSER_ACTION_OPEN);
+        dlg->set_modal(true);
+        dlg->signal_response().connect([this, dlg](int response) {
+            if (response == Gtk::RESPONSE_ACCEPT) {
+                StartCaptureBenchmark(dlg->get_filename());
+            }
+        });
+        dlg->run();
+    });
+    m_benchmark_dispatcher.connect(sigc::mem_fun(*this, &VoiceSettingsWindow::OnBenchmarkDone));
+    m_benchmark_status.set_halign(Gtk::ALIGN_START);
+    m_benchmark_status.set_selectable(true);
+
+    m_bench_speakers.set_range(1.0, 64.0);
+    m_bench_speakers.set_increments(1.0, 4.0);
+    m_bench_speakers.set_value(8.0);
+    m_bench_speakers.set_tooltip_text("Speakers");
+    m_bench_loss.set_range(0.0, 50.0);
+    m_bench_loss.set_increments(1.0, 5.0);
+    m_bench_loss.set_tooltip_text("Packet loss (%)");
+    m_bench_jitter.set_range(0.0, 200.0);
+    m_bench_jitter.set_increments(5.0, 20.0);
+    m_bench_jitter.set_tooltip_text("Jitter (ms)");
+    m_bench_run.set_tooltip_text("Decrypt, decode and mix 10 seconds of synthetic speakers with this much loss and jitter");
+    m_bench_run.signal_clicked().connect(sigc::mem_fun(*this, &VoiceSettingsWindow::StartPlaybackBenchmark));
+
+    auto *benchmark_buttons = Gtk::make_managed<Gtk::HBox>();
+    benchmark_buttons->pack_start(m_bench_file, false, true, 5);
+    benchmark_buttons->pack_start(m_bench_run, false, true);
+    benchmark_buttons->pack_start(m_bench_speakers, false, true, 5);
+    benchmark_buttons->pack_start(m_bench_loss, false, true);
+    benchmark_buttons->pack_start(m_bench_jitter, false, true, 5);
+
     m_main.add(*layout);
+    m_main.pack_start(m_timings, false, true, 5);
+    m_main.pack_start(*benchmark_buttons, false, true);
+    m_main.pack_start(m_benchmark_status, false, true, 5);
     add(m_main);
     show_all_children();
 
@@ -144,6 +190,81 @@ VoiceSettingsWindow::VoiceSettingsWindow()
     });
 }
 
+VoiceSettingsWindow::~VoiceSettingsWindow() {
+    m_timings_timer.disconnect();
+    if (m_benchmark_thread.joinable()) m_benchmark_thread.join();
+}
+
+bool VoiceSettingsWindow::UpdateTimings() {
+    const auto timings = Abaddon::Get().GetAudio().GetCaptureStageTimings();
+    std::string text;
+    double total = 0.0;
+    for (size_t i = 0; i < CaptureChain::StageCount; i++) {
+        text += fmt::format("{}: {:.1f} µs\n", CaptureChain::GetStageName(static_cast<CaptureChain::Stage>(i)), timings[i]);
+        total += timings[i];
+    }
+    text += fmt::format("Total: {:.1f} µs", total);
+    m_timings.set_text(text);
+    return true;
+}
+
+void VoiceSettingsWindow::StartCaptureBenchmark(const std::string &path) {
+    const auto params = Abaddon::Get().GetAudio().GetCaptureParams();
+    RunBenchmark([path, params]() -> std::string {
+        const auto result = CaptureChain::BenchmarkFile(path, params);
+        if (!result.has_value()) return "Couldn't decode file";
+
+        spdlog::get("audio")->info("Capture benchmark: {} frames in {:.3f}s, {} transmitted", result->Frames, result->Seconds, result->Transmitted);
+        return result->ToString();
+    });
+}
+
+void VoiceSettingsWindow::StartPlaybackBenchmark() {
+    VoiceBench::Params params;
+    params.Speakers = m_bench_speakers.get_value_as_int();
+    params.Loss = m_bench_loss.get_value() / 100.0;
+    params.JitterMs = m_bench_jitter.get_value_as_int();
+    params.Bitrate = Abaddon::Get().GetAudio().GetBitrate();
+    RunBenchmark([params]() -> std::string {
+        const auto result = VoiceBench::Run(params);
+        if (!result.has_value()) return "Couldn't set up Opus";
+
+        std::string text = fmt::format("{} speakers, {} packets, {} lost, {} failed", result->Speakers, result->Packets, result->Lost, result->Failed);
+        text += fmt::format("\nCPU per speaker: {:.3f}%", result->GetCPUPerSpeaker());
+        text += fmt::format("\nDecode: {:.0f} frames/s", result->GetDecodeThroughput());
+        text += fmt::format("\nMix: {:.2f} µs per 10ms", result->GetMixMicroseconds());
+        text += fmt::format("\nMix latency: {:.1f} ms avg, {:.1f} ms max", result->MeanLatencyMs, result->MaxLatencyMs);
+        text += fmt::format("\nUnderruns: {}, clipped samples: {}", result->Underruns, result->Clipped);
+        spdlog::get("audio")->info("Playback benchmark: {} speakers, {:.3f}% cpu each, {} underruns", result->Speakers, result->GetCPUPerSpeaker(), result->Underruns);
+        return text;
+    });
+}
+
+void VoiceSettingsWindow::RunBenchmark(std::function<std::string()> job) {
+    if (m_benchmark_thread.joinable()) m_benchmark_thread.join();
+
+    m_bench_file.set_sensitive(false);
+    m_bench_run.set_sensitive(false);
+    m_benchmark_status.set_text("Running...");
+
+    m_benchmark_thread = std::thread([this, job = std::move(job)]() {
+        auto text = job();
+        {
+            std::lock_guard<std::mutex> _(m_benchmark_mutex);
+            m_benchmark_result = std::move(text);
+        }
+        m_benchmark_dispatcher.emit();
+    });
+}
+
+void VoiceSettingsWindow::OnBenchmarkDone() {
+    m_bench_file.set_sensitive(true);
+    m_bench_run.set_sensitive(true);
+
+    std::lock_guard<std::mutex> _(m_benchmark_mutex);
+    m_benchmark_status.set_text(m_benchmark_result);
+}
+
 VoiceSettingsWindow::type_signal_gain VoiceSettingsWindow::signal_gain() {
     return m_signal_gain;
 }
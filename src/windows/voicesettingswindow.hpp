@@ -3,17 +3,26 @@
 
 // clang-format off
 
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <glibmm/dispatcher.h>
 #include <gtkmm/box.h>
+#include <gtkmm/button.h>
 #include <gtkmm/comboboxtext.h>
+#include <gtkmm/label.h>
 #include <gtkmm/scale.h>
 #include <gtkmm/spinbutton.h>
 #include <gtkmm/window.h>
+#include "audio/capturechain.hpp"
+#include "audio/voicebench.hpp"
 
 // clang-format on
 
 class VoiceSettingsWindow : public Gtk::Window {
 public:
     VoiceSettingsWindow();
+    ~VoiceSettingsWindow() override;
 
     Gtk::Box m_main;
     Gtk::ComboBoxText m_encoding_mode;
@@ -21,7 +30,29 @@ public:
     Gtk::Scale m_bitrate;
     Gtk::SpinButton m_gain;
 
+    Gtk::Label m_timings;
+    Gtk::Button m_bench_file;
+    Gtk::Button m_bench_run;
+    Gtk::SpinButton m_bench_speakers;
+    Gtk::SpinButton m_bench_loss;
+    Gtk::SpinButton m_bench_jitter;
+    Gtk::Label m_benchmark_status;
+
 private:
+    bool UpdateTimings();
+    void StartCaptureBenchmark(const std::string &path);
+    void StartPlaybackBenchmark();
+    // job runs on its own thread and returns the text to show
+    void RunBenchmark(std::function<std::string()> job);
+    void OnBenchmarkDone();
+
+    sigc::connection m_timings_timer;
+
+    std::thread m_benchmark_thread;
+    Glib::Dispatcher m_benchmark_dispatcher;
+    std::mutex m_benchmark_mutex;
+    std::string m_benchmark_result;
+
     using type_signal_gain = sigc::signal<void(double)>;
     type_signal_gain m_signal_gain;
 